@@ -0,0 +1,64 @@
+import socket
+import argparse
+from ruamel.yaml import YAML as ym
+
+class RadarControl:
+    """Client for the radar's runtime control socket (CONTROL section of the config).
+
+    Changes are applied by the radar at the start of the next presum group. set()
+    returns the index of the first pulse the change applies to.
+    """
+
+    def __init__(self, socket_path, timeout=2.0):
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.settimeout(timeout)
+        self.sock.connect(socket_path)
+        self.reader = self.sock.makefile('r')
+
+    @classmethod
+    def from_yaml(cls, yaml_filename, timeout=2.0):
+        yaml = ym()
+        with open(yaml_filename) as stream:
+            config = yaml.load(stream)
+        socket_path = config.get('CONTROL', {}).get('socket_path', "")
+        if not socket_path:
+            raise RuntimeError(f"The control socket is disabled in {yaml_filename}")
+        return cls(socket_path, timeout)
+
+    def command(self, line):
+        self.sock.sendall((line + "\n").encode())
+        reply = self.reader.readline().strip()
+        if not reply.startswith("OK"):
+            raise RuntimeError(f"'{line}' failed: {reply}")
+        return reply[3:]
+
+    def set(self, parameter, value):
+        return int(self.command(f"set {parameter} {value}"))
+
+    def status(self):
+        return dict(item.split("=", 1) for item in self.command("status").split())
+
+    def close(self):
+        self.reader.close()
+        self.sock.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Change radar parameters while recording")
+    parser.add_argument("yaml_file", help="Path to the YAML configuration file the radar is running with")
+    parser.add_argument("parameter", nargs='?', help="rx_gain, tx_gain, pulse_rep_int, num_presums or transmit (omit for status)")
+    parser.add_argument("value", nargs='?', help="New value")
+    args = parser.parse_args()
+
+    with RadarControl.from_yaml(args.yaml_file) as radar:
+        if args.parameter is None:
+            for key, value in radar.status().items():
+                print(f"{key}: {value}")
+        else:
+            pulse = radar.set(args.parameter, args.value)
+            print(f"{args.parameter} = {args.value} from pulse {pulse}")
@@ -6,11 +6,15 @@ import sys
 import subprocess
 import signal
 import threading
+import socket
 
 sys.path.append("preprocessing")
 from generate_chirp import generate_from_yaml_filename
 sys.path.append("postprocessing")
 from save_data import save_data
+from altimetry import parse_altimetry_datagram, describe_pick
+from radar_control import RadarControl
+from ruamel.yaml import YAML
 
 # Nominal flow:
 # setup -> ready -[button press]-> starting -> recording -[button press]-> saving -> ready
@@ -30,6 +34,7 @@ expected_cwd = "/home/ubuntu/uhd_radar"
 yaml_filename = None
 uhd_process = None
 uhd_output_reader_thread = None
+last_altimetry = None        # Latest surface/bed pick sent by the radar (ALTIMETRY:udp_port)
 
 # Setup button and button LED
 button = gpiozero.Button(4, pull_up=False, hold_time=5)
@@ -101,24 +106,68 @@ def start_recording():
     current_state = "starting"
     update_led_state()
 
-    # Chirp generation
-    print("Re-generating chirp")
-    try:
-        generate_from_yaml_filename(yaml_filename)
-    except Exception as e:
-        print(e)
-        error_and_quit()
+    # Chirp generation (unless the radar generates it itself)
+    if not chirp_generated_in_radar():
+        print("Re-generating chirp")
+        try:
+            generate_from_yaml_filename(yaml_filename)
+        except Exception as e:
+            print(e)
+            error_and_quit()
 
     uhd_process = subprocess.Popen(["./radar", yaml_filename], stdout=subprocess.PIPE, bufsize=1, close_fds=True, text=True, cwd="sdr/build")
     uhd_output_reader_thread = threading.Thread(target=log_output_from_usrp, args=(uhd_process.stdout, open('uhd_stdout.log', 'w')))
     uhd_output_reader_thread.daemon = True # thread dies with the program
     uhd_output_reader_thread.start()
 
+def chirp_generated_in_radar():
+    """True if the radar synthesizes the chirp from GENERATE itself (GENERATE:in_radar), so chirp.bin isn't needed."""
+    yaml = YAML(typ='safe')
+    with open(yaml_filename) as stream:
+        config = yaml.load(stream)
+    return config['GENERATE'].get('in_radar', False)
+
+def altimetry_udp_port():
+    """UDP port the radar sends its surface/bed picks to (0 if altimetry is disabled)."""
+    yaml = YAML(typ='safe')
+    with open(yaml_filename) as stream:
+        config = yaml.load(stream)
+    altimetry = config.get('ALTIMETRY', {}) or {}
+    if not altimetry.get('enabled', False):
+        return 0
+    return int(altimetry.get('udp_port', 0))
+
+def receive_altimetry(port):
+    """Keeps last_altimetry up to date with the picks the radar sends while recording."""
+    global last_altimetry
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("127.0.0.1", port))
+    while True:
+        record = parse_altimetry_datagram(sock.recv(1024))
+        if record is not None:
+            last_altimetry = record
+            print(f"Altimetry: {describe_pick(record)}")
+
+def send_radar_command(parameter=None, value=None):
+    """Changes a parameter of the running radar (or returns its status) through the control socket."""
+    with RadarControl.from_yaml(yaml_filename) as radar:
+        if parameter is None:
+            return radar.status()
+        return radar.set(parameter, value)
+
 def stop_recording():
     global current_state, yaml_filename
 
     was_force_killed = False
 
+    # Log the final state while the radar is still running
+    try:
+        print(f"Radar status: {send_radar_command()}")
+    except (RuntimeError, OSError) as e:
+        pass # Control socket disabled or not up yet
+    if last_altimetry is not None:
+        print(f"Last altimetry: {describe_pick(last_altimetry)}")
+
     print("Attemping to stop UHD process")
     current_state = "saving"
     uhd_process.send_signal(signal.SIGINT)
@@ -175,12 +224,20 @@ parser.add_argument("yaml_file", nargs='?', default='config/default.yaml',
 args = parser.parse_args()
 yaml_filename = args.yaml_file
 
-# Chirp generation
-try:
-    generate_from_yaml_filename(yaml_filename)
-except Exception as e:
-    print(e)
-    error_and_quit()
+# Chirp generation (unless the radar generates it itself)
+if not chirp_generated_in_radar():
+    try:
+        generate_from_yaml_filename(yaml_filename)
+    except Exception as e:
+        print(e)
+        error_and_quit()
+
+# Listen for the radar's altimetry picks (if enabled)
+port = altimetry_udp_port()
+if port > 0:
+    altimetry_thread = threading.Thread(target=receive_altimetry, args=(port,))
+    altimetry_thread.daemon = True # thread dies with the program
+    altimetry_thread.start()
 
 # Compile UHD program
 def run_and_fail_on_nonzero(cmd):
@@ -0,0 +1,37 @@
+# Reader for the surface/bed picks the radar makes while recording (ALTIMETRY section of
+# the config file). See sdr/altimetry.hpp for the format.
+import argparse
+import numpy as np
+
+SURFACE_FOUND = 1
+BED_FOUND = 2
+RECORD = np.dtype([("pulse", "<i8"), ("host_time", "<f8"), ("surface_range", "<f4"), ("surface_snr", "<f4"),
+                   ("bed_depth", "<f4"), ("bed_snr", "<f4"), ("noise_floor", "<f4"), ("flags", "<u4")])
+
+def read_altimetry(filename):
+    """Returns a structured array with one record per pick (ranges in m, SNRs in dB, NaN if not found)."""
+    data = np.fromfile(filename, dtype=np.uint8)
+    return np.frombuffer(data, dtype=RECORD, count=len(data) // RECORD.itemsize)
+
+def parse_altimetry_datagram(datagram):
+    """Returns the record in one UDP datagram sent by the radar, or None if it isn't one."""
+    if len(datagram) != RECORD.itemsize:
+        return None
+    return np.frombuffer(datagram, dtype=RECORD, count=1)[0]
+
+def describe_pick(record):
+    surface = "not found"
+    if record["flags"] & SURFACE_FOUND:
+        surface = "%.1f m (%.1f dB)" % (record["surface_range"], record["surface_snr"])
+    bed = "not found"
+    if record["flags"] & BED_FOUND:
+        bed = "%.1f m below (%.1f dB)" % (record["bed_depth"], record["bed_snr"])
+    return "pulse %d: surface %s, bed %s" % (record["pulse"], surface, bed)
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Print the radar's onboard surface/bed picks")
+    parser.add_argument("filename", help="ALTIMETRY:file in output_dir")
+    args = parser.parse_args()
+
+    for record in read_altimetry(args.filename):
+        print(describe_pick(record))
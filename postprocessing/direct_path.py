@@ -0,0 +1,31 @@
+# Reader for the direct path measurements the radar writes while recording
+# (DIRECT_PATH section of the config file). See sdr/direct_path.hpp for the format.
+import argparse
+import numpy as np
+
+RECORD = np.dtype([("first_trace", "<i8"), ("delay", "<f8"), ("amplitude", "<f4"), ("phase", "<f4"),
+                   ("host_time", "<f8")])
+
+def read_direct_path(filename):
+    """Returns a structured array with one record per measurement (delay in RX samples, phase in radians)."""
+    data = np.fromfile(filename, dtype=np.uint8)
+    return np.frombuffer(data, dtype=RECORD, count=len(data) // RECORD.itemsize)
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Summarize the radar's direct path measurements")
+    parser.add_argument("filename", help="DIRECT_PATH:file in output_dir")
+    parser.add_argument("--rx-rate", type=float, default=None, help="RX sample rate [Hz], to print the drift in ns")
+    args = parser.parse_args()
+
+    records = read_direct_path(args.filename)
+    if len(records) == 0:
+        print("No measurements.")
+        exit(0)
+    phase = np.unwrap(records["phase"].astype(np.float64))
+    elapsed = records["host_time"][-1] - records["host_time"][0]
+    drift = records["delay"][-1] - records["delay"][0]
+    print("%d measurements over %.1f s" % (len(records), elapsed))
+    print("delay: %.3f to %.3f samples (drift %+.3f samples%s)" % (records["delay"].min(), records["delay"].max(), drift,
+          "" if args.rx_rate is None else ", %+.2f ns" % (drift / args.rx_rate * 1e9)))
+    print("amplitude: %.1f to %.1f dB" % tuple(20 * np.log10(np.maximum([records["amplitude"].min(), records["amplitude"].max()], 1e-30))))
+    print("phase: drift %+.1f deg, std %.1f deg" % (np.degrees(phase[-1] - phase[0]), np.degrees(np.std(phase))))
@@ -3,6 +3,27 @@ import glob
 import argparse
 import re
 import os
+import subprocess
+
+MERGE_TOOL = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "sdr", "build", "merge_files")
+
+def merge_split_files(inputs, output):
+    """
+    Concatenate inputs (in order) into output, which must not exist yet.
+
+    Uses the merge_files tool from sdr/build when it has been built: it shares (reflinks) or copies the data
+    in the kernel where the filesystem allows it and verifies every chunk. Otherwise the data is copied
+    through Python.
+    """
+    if os.path.exists(output):
+        raise FileExistsError(f"Output file {output} already exists.")
+    if os.path.isfile(MERGE_TOOL) and os.access(MERGE_TOOL, os.X_OK):
+        subprocess.run([MERGE_TOOL, output] + list(inputs), check=True)
+        return
+    with open(output, 'wb') as outfile:
+        for filename in inputs:
+            with open(filename, 'rb') as infile:
+                shutil.copyfileobj(infile, outfile)
 
 if __name__ == "__main__":
     # Accept one command line argument, a string called prefix
@@ -51,9 +72,6 @@ if __name__ == "__main__":
         exit(1)
     
     print(f"\nEverything looks OK. Merging files to {args.output}...")
-    with open(args.output, 'wb') as outfile:
-        for idx in file_idxs:
-            print(f"Copying {file_ordering[idx]}...")
-            shutil.copyfileobj(open(file_ordering[idx], 'rb'), outfile)
+    merge_split_files([file_ordering[idx] for idx in file_idxs], args.output)
 
     print(f"Done. Merged data written to {args.output}")
\ No newline at end of file
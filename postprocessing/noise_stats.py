@@ -0,0 +1,36 @@
+# Reader for the noise statistics summaries the radar writes while recording
+# (NOISE_STATS section of the config file). See sdr/noise_stats.hpp for the format.
+import argparse
+import numpy as np
+
+NOISE_STATS_MAGIC = 0x54534e52
+HEADER = np.dtype([("magic", "<u4"), ("num_bins", "<u4"), ("decimation", "<u4"), ("num_traces", "<u4"),
+                   ("first_trace", "<i8"), ("noise_floor", "<f8"), ("host_time", "<f8")])
+BIN = np.dtype([("mean_re", "<f4"), ("mean_im", "<f4"), ("variance", "<f4"), ("power", "<f4")])
+
+def read_noise_stats(filename):
+    """Returns (headers, bins): a structured array with one header per summary
+    and a (num_summaries, num_bins) structured array of per-bin statistics."""
+    data = np.fromfile(filename, dtype=np.uint8)
+    if len(data) < HEADER.itemsize:
+        return np.zeros(0, dtype=HEADER), np.zeros((0, 0), dtype=BIN)
+    first = np.frombuffer(data, dtype=HEADER, count=1)[0]
+    if first["magic"] != NOISE_STATS_MAGIC:
+        raise ValueError("%s is not a noise statistics file" % filename)
+    record = np.dtype([("header", HEADER), ("bins", BIN, (int(first["num_bins"]),))])
+    records = np.frombuffer(data, dtype=record, count=len(data) // record.itemsize)
+    return records["header"], records["bins"]
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Summarize the radar's noise statistics file")
+    parser.add_argument("filename", help="NOISE_STATS:file in output_dir")
+    args = parser.parse_args()
+
+    headers, bins = read_noise_stats(args.filename)
+    for header, summary in zip(headers, bins):
+        coherent = summary["mean_re"]**2 + summary["mean_im"]**2
+        snr = 10 * np.log10(np.maximum(coherent, 1e-30) / max(header["noise_floor"], 1e-30))
+        peak = np.argmax(snr)
+        print("traces %d-%d: noise floor %.1f dB, peak SNR %.1f dB at range bin %d (RX sample %d)" % (
+            header["first_trace"], header["first_trace"] + header["num_traces"] - 1,
+            10 * np.log10(max(header["noise_floor"], 1e-30)), snr[peak], peak, peak * header["decimation"]))
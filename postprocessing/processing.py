@@ -72,8 +72,8 @@ def load_radar_data(prefix, load_start_seconds=0, max_seconds_to_load=60*100, ma
         log = log_f.readlines()
         
         for idx, line in enumerate(log):
-            if "Receiver error:" in line:
-                error_code = re.search("(?:Receiver error: )([\w_]+)", line).groups()[0]
+            if "Receiver error:" in line or "Transmitter error:" in line:
+                error_code = re.search("(?:(?:Receiver|Transmitter) error: )([\w_|]+)", line).groups()[0]
                 old_style_regex_search = re.search("(?:Scheduling chirp )([\d]+)", log[idx-1])
                 if old_style_regex_search is not None:
                     chirp_idx = int(re.search("(?:Scheduling chirp )([\d]+)", log[idx-1]).groups()[0])
@@ -129,6 +129,23 @@ def extractSig (filename, count=-1, offset=0):
     sig_floats = np.fromfile(filename, dtype=np.float32, count=count, sep='', offset=offset)
     return (sig_floats[::2] + (1j * sig_floats[1::2])).astype(np.csingle)
 
+# Load a measured reference chirp written by a loopback calibration run
+# (CALIBRATION:loopback) for use with pulse_compress instead of the ideal chirp.
+# The reference is aligned with the ideal chirp and has the loopback gain
+# removed, so amplitudes and zero_sample_idx are unchanged. The metadata
+# (delay_samples, gain_db, snr_db, max_ripple_db, ...) is read from the .yaml
+# file next to it, or is None if there isn't one.
+# -----
+# filename - the reference chirp file (eg. data/reference_chirp.bin)
+def load_reference_chirp(filename):
+    chirp = extractSig(filename)
+    meta_file = os.path.splitext(filename)[0] + ".yaml"
+    metadata = None
+    if os.path.exists(meta_file):
+        with open(meta_file) as stream:
+            metadata = dict(ym(typ='safe').load(stream))
+    return chirp, metadata
+
 # Load samples from a file safely
 # Maximum file size and chunk-by-chunk loading used to manage memory
 def loadSamplesFromFile(filename, config, reshape=True, max_chunk_size=int(5e8), max_seconds_to_load=60*20, load_start_seconds=0):
@@ -21,9 +21,9 @@ def process_stdout_log(log):
     num_pulses_attempted = None
 
     for idx, line in enumerate(log.splitlines()):
-        if "Receiver error:" in line:
+        if "Receiver error:" in line or "Transmitter error:" in line:
             error_code = re.search(
-                r"(?:Receiver error: )([\w_]+)", line).groups()[0]
+                r"(?:(?:Receiver|Transmitter) error: )([\w_|]+)", line).groups()[0]
             old_style_regex_search = re.search(
                 r"(?:Scheduling chirp )([\d]+)", log[idx-1])
             if old_style_regex_search is not None:
@@ -0,0 +1,51 @@
+# Reader for the pulse time log the radar writes while recording (FILES:pulse_times_loc),
+# and the nominal pulse spacing from the CHIRP section (pri_stagger, pri_jitter).
+# See PriSequence in sdr/scheduler.hpp for how pulse times are computed.
+import argparse
+import numpy as np
+
+RECORD = np.dtype([("pulse_index", "<i8"), ("rx_time", "<f8")])
+
+def read_pulse_times(filename):
+    """Returns a structured array with the index and scheduled RX time of every pulse (including errored pulses)."""
+    return np.fromfile(filename, dtype=RECORD)
+
+def pri_jitter(pulses, jitter, seed=0):
+    """Pseudo-random offset [s] of each pulse, the same as PriSequence::getJitter()."""
+    mask = (1 << 64) - 1
+    offsets = np.zeros(len(pulses))
+    if jitter == 0:
+        return offsets
+    for i, pulse in enumerate(pulses):
+        z = (seed + int(pulse) + 0x9e3779b97f4a7c15) & mask
+        z = ((z ^ (z >> 30)) * 0xbf58476d1ce4e5b9) & mask
+        z = ((z ^ (z >> 27)) * 0x94d049bb133111eb) & mask
+        z = z ^ (z >> 31)
+        offsets[i] = jitter * (2 * (z >> 11) * 2.0**-53 - 1)
+    return offsets
+
+def nominal_pulse_times(config, pulses):
+    """Time [s] of each pulse relative to time_offset with the configured stagger and jitter,
+    without error delays or runtime pulse_rep_int changes."""
+    chirp = config['CHIRP']
+    pulses = np.asarray(pulses, dtype=np.int64)
+    stagger = np.asarray(chirp.get('pri_stagger', []) or [1.0], dtype=float)
+    stagger = stagger * len(stagger) / np.sum(stagger)
+    cumulative = np.concatenate(([0], np.cumsum(stagger)))
+    position = (pulses // len(stagger)) * cumulative[-1] + cumulative[pulses % len(stagger)]
+    jitter = pri_jitter(pulses, float(chirp.get('pri_jitter', 0)), int(chirp.get('pri_jitter_seed', 0)))
+    return float(chirp['pulse_rep_int']) * position + jitter
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Summarize the radar's pulse time log")
+    parser.add_argument("filename", help="FILES:pulse_times_loc in output_dir")
+    args = parser.parse_args()
+
+    records = read_pulse_times(args.filename)
+    if len(records) < 2:
+        print("%d pulses" % len(records))
+    else:
+        spacing = np.diff(records["rx_time"])
+        print("%d pulses over %.3f s: mean spacing %.3f us (%.1f Hz), min %.3f us, max %.3f us" % (
+            len(records), records["rx_time"][-1] - records["rx_time"][0], np.mean(spacing) * 1e6,
+            1 / np.mean(spacing), np.min(spacing) * 1e6, np.max(spacing) * 1e6))
@@ -0,0 +1,47 @@
+# Viewer for the rolling quicklook radargram the radar writes while recording
+# (QUICKLOOK section of the config file). See sdr/quicklook.hpp for the format.
+import argparse
+import struct
+import time
+import numpy as np
+import matplotlib.pyplot as plt
+
+QUICKLOOK_MAGIC = 0x4b4c5152
+QUICKLOOK_VERSION = 1
+HEADER = struct.Struct("<IIIIQIId24x")  # magic, version, width, num_rows, rows_written, traces_per_row, samps_per_trace, row_period
+
+def read_quicklook(filename):
+    """Returns (image, header) where image holds the rows currently in the
+    file in time order (oldest first), one row per slow-time step, in dB."""
+    with open(filename, "rb") as f:
+        data = f.read()
+    magic, version, width, num_rows, rows_written, traces_per_row, samps_per_trace, row_period = HEADER.unpack_from(data, 0)
+    if magic != QUICKLOOK_MAGIC or version != QUICKLOOK_VERSION:
+        raise ValueError("%s is not a quicklook file" % filename)
+    rows = np.frombuffer(data, dtype=np.float32, count=num_rows * width, offset=HEADER.size).reshape(num_rows, width)
+    if rows_written > num_rows:
+        first = rows_written % num_rows
+        image = np.concatenate((rows[first:], rows[:first]))
+    else:
+        image = rows[:rows_written]
+    header = {"width": width, "num_rows": num_rows, "rows_written": rows_written,
+              "traces_per_row": traces_per_row, "samps_per_trace": samps_per_trace, "row_period": row_period}
+    return image, header
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Show the live quicklook radargram")
+    parser.add_argument("filename", help="Quicklook file (QUICKLOOK:file in output_dir)")
+    parser.add_argument("--interval", type=float, default=1, help="Refresh interval in seconds")
+    args = parser.parse_args()
+
+    fig, ax = plt.subplots()
+    while plt.fignum_exists(fig.number):
+        image, header = read_quicklook(args.filename)
+        ax.clear()
+        if len(image) > 0:
+            ax.imshow(image.T, aspect="auto", cmap="gray",
+                      extent=[0, len(image) * header["row_period"], header["samps_per_trace"], 0])
+        ax.set_xlabel("Time in quicklook [s]")
+        ax.set_ylabel("RX sample")
+        ax.set_title("Quicklook: %d rows, %d traces per row" % (header["rows_written"], header["traces_per_row"]))
+        plt.pause(args.interval)
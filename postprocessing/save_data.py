@@ -23,7 +23,23 @@ def save_data(yaml_filename, extra_files={}, alternative_rx_samps_loc=None, num_
     print(f"Copying data to {file_prefix}...")
 
     shutil.copy(yaml_filename, file_prefix + "_config.yaml")
-    if config['FILES']['max_chirps_per_file'] == -1:
+    if config.get('SCHEDULE', {}).get('enabled', False):
+        # One file per waveform of the schedule, named like main.cpp's stream_filename()
+        base, ext = os.path.splitext(save_loc)
+        for waveform in config['SCHEDULE']['waveforms']:
+            shutil.move(f"{base}_{waveform['name']}{ext}", f"{file_prefix}_{waveform['name']}_rx_samps.bin")
+    elif len(str(config['DEVICE']['rx_channels']).split(',')) > 1:
+        # One file per RX channel, named like main.cpp's stream_filename()
+        base, ext = os.path.splitext(save_loc)
+        num_tx = len(str(config['DEVICE']['tx_channels']).split(','))
+        for ch in range(len(str(config['DEVICE']['rx_channels']).split(','))):
+            if config['CHIRP'].get('tx_phase_codes', ""):
+                # Phase-coded transmitters: one file per TX channel for each RX channel
+                for tx in range(num_tx):
+                    shutil.move(f"{base}_ch{ch}_tx{tx}{ext}", f"{file_prefix}_ch{ch}_tx{tx}_rx_samps.bin")
+            else:
+                shutil.move(f"{base}_ch{ch}{ext}", f"{file_prefix}_ch{ch}_rx_samps.bin")
+    elif config['FILES']['max_chirps_per_file'] == -1:
             shutil.move(save_loc, file_prefix + "_rx_samps.bin")
     else:
         if config['RUN_MANAGER']['save_partial_files']:
@@ -37,6 +53,19 @@ def save_data(yaml_filename, extra_files={}, alternative_rx_samps_loc=None, num_
     for source_file, dest_tag in extra_files.items():
         shutil.copy(source_file, file_prefix + "_" + dest_tag)
 
+    if config['FILES'].get('raw_capture', False):
+        meta_loc = os.path.join(output_dir, config['FILES'].get('meta_loc', 'rx_meta.bin'))
+        shutil.copy(meta_loc, file_prefix + "_rx_meta.bin")
+
+    if config['FILES'].get('pulse_times_loc', ""):
+        shutil.copy(os.path.join(output_dir, config['FILES']['pulse_times_loc']), file_prefix + "_pulse_times.bin")
+
+    # Logs of parameters that changed while recording
+    if config.get('AGC', {}).get('enabled', False):
+        shutil.copy(os.path.join(output_dir, config['AGC'].get('log', 'gain_log.csv')), file_prefix + "_gain_log.csv")
+    if config.get('CONTROL', {}).get('socket_path', ""):
+        shutil.copy(os.path.join(output_dir, config['CONTROL'].get('log', 'control_log.csv')), file_prefix + "_control_log.csv")
+
     if config['RUN_MANAGER']['save_gps']:
         shutil.copy(gps_loc, file_prefix + "_gps_log.txt")
 
@@ -0,0 +1,97 @@
+# Read-only client for the live trace ring the radar publishes in shared memory
+# (PUBLISH:shm_name in the config file). See sdr/trace_ring.hpp for the layout.
+#
+# Run as a script to follow the ring and print how many traces were received and
+# missed. A large --consume-ms shows that a slow reader only misses traces; the
+# radar never waits for it.
+import argparse
+import mmap
+import os
+import struct
+import time
+import numpy as np
+
+TRACE_RING_MAGIC = 0x52545243
+TRACE_RING_VERSION = 1
+RING_HEADER = struct.Struct("<IIIIQQ32x")        # magic, version, num_slots, samps_per_trace, slot_bytes, num_published
+SLOT_HEADER = struct.Struct("<QqqqiidQQ")        # seq, trace_index, num_pulses, error_count, num_presums, reserved, publish_time
+NUM_PUBLISHED_OFFSET = 24
+
+class TraceRing:
+    def __init__(self, name):
+        path = "/dev/shm/" + name.lstrip("/")
+        fd = os.open(path, os.O_RDONLY)
+        try:
+            self.mem = mmap.mmap(fd, 0, prot=mmap.PROT_READ)
+        finally:
+            os.close(fd)
+        magic, version, self.num_slots, self.samps_per_trace, self.slot_bytes, _ = RING_HEADER.unpack_from(self.mem, 0)
+        if magic != TRACE_RING_MAGIC or version != TRACE_RING_VERSION:
+            raise ValueError("%s is not a compatible trace ring" % path)
+
+    def num_published(self):
+        return struct.unpack_from("<Q", self.mem, NUM_PUBLISHED_OFFSET)[0]
+
+    def read(self, trace):
+        """Returns (info, samples) for the given trace index, or None if it
+        hasn't been published yet. Raises LookupError if it was overwritten."""
+        offset = RING_HEADER.size + (trace % self.num_slots) * self.slot_bytes
+        seq = struct.unpack_from("<Q", self.mem, offset)[0]
+        if seq < 2 * trace + 2:
+            return None
+        if seq > 2 * trace + 2:
+            raise LookupError("trace %d was overwritten" % trace)
+        _, trace_index, num_pulses, error_count, num_presums, _, publish_time, _, _ = SLOT_HEADER.unpack_from(self.mem, offset)
+        samples = np.frombuffer(self.mem, dtype=np.complex64, count=self.samps_per_trace,
+                                offset=offset + SLOT_HEADER.size).copy()
+        if struct.unpack_from("<Q", self.mem, offset)[0] != seq:
+            raise LookupError("trace %d was overwritten" % trace)
+        info = {"trace_index": trace_index, "num_pulses": num_pulses, "error_count": error_count,
+                "num_presums": num_presums, "publish_time": publish_time}
+        return info, samples
+
+    def close(self):
+        self.mem.close()
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Follow the radar's live trace ring")
+    parser.add_argument("shm_name", help="PUBLISH:shm_name from the radar config")
+    parser.add_argument("--consume-ms", type=float, default=0,
+            help="Simulated per-trace processing time in milliseconds")
+    args = parser.parse_args()
+
+    ring = TraceRing(args.shm_name)
+    print("Attached to %s: %d slots of %d samples" % (args.shm_name, ring.num_slots, ring.samps_per_trace))
+
+    next_trace = ring.num_published()
+    received = 0
+    missed = 0
+    info = None
+    last_print = time.monotonic()
+    while True:
+        published = ring.num_published()
+        # Skip ahead past anything that has already been overwritten
+        if published > next_trace + ring.num_slots:
+            missed += published - ring.num_slots - next_trace
+            next_trace = published - ring.num_slots
+        try:
+            result = ring.read(next_trace)
+        except LookupError:
+            missed += 1
+            next_trace += 1
+            continue
+        if result is None:
+            time.sleep(0.001)
+        else:
+            info, samples = result
+            received += 1
+            next_trace += 1
+            time.sleep(args.consume_ms / 1000)
+
+        if time.monotonic() - last_print >= 1:
+            line = "published: %d  received: %d  missed: %d" % (published, received, missed)
+            if info is not None:
+                line += "  last trace: %d (%d pulses, %d errors, %.1f ms old)" % (info["trace_index"],
+                        info["num_pulses"], info["error_count"], (time.time() - info["publish_time"]) * 1e3)
+            print(line)
+            last_print = time.monotonic()
@@ -2,7 +2,6 @@ import time
 import argparse
 import os
 import sys
-import shutil
 import subprocess
 import signal
 import threading
@@ -13,6 +12,7 @@ sys.path.append("preprocessing")
 from generate_chirp import generate_from_yaml_filename
 sys.path.append("postprocessing")
 from save_data import save_data
+from merge_data import merge_split_files
 
 """
 Provides a simple interface to build, run, and manage data outputs from the SDR code
@@ -43,7 +43,6 @@ class RadarProcessRunner():
 
         self.file_queue = queue.Queue()
         self.file_queue_size = 1
-        self.output_file = None
         self.output_file_path = None
 
     """
@@ -177,23 +176,21 @@ class RadarProcessRunner():
         file_prefix = save_data(self.yaml_filename, alternative_rx_samps_loc=alternative_rx_samps_loc, num_files=self.file_queue_size, extra_files={"uhd_stdout.log": "uhd_stdout.log"})
         print("Finished copying data.")
 
-        self.output_file = None
-
         return file_prefix
     
     """
     Copy data from split files into a single data output file
     """
     def save_from_queue(self):
-        if self.output_file is None:
-            self.output_file_path = self.config['RUN_MANAGER']['final_save_loc']
-            self.output_file = open(self.output_file_path, 'wb')
+        self.output_file_path = self.config['RUN_MANAGER']['final_save_loc']
+        if os.path.exists(self.output_file_path):
+            os.remove(self.output_file_path)
 
+        files = []
         while(not self.file_queue.empty()):
-            with open(self.file_queue.get(), 'rb') as f:
-                shutil.copyfileobj(f, self.output_file)
+            files.append(self.file_queue.get())
 
-        self.output_file.close()
+        merge_split_files(files, self.output_file_path)
 
 
 if __name__ == "__main__":
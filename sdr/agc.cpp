@@ -0,0 +1,189 @@
+#include <cmath>
+#include <iomanip>
+#include "agc.hpp"
+
+/**
+ * @brief Computes the gain controller's metrics for one pulse
+ *
+ * @param pulse Received samples
+ * @param n_samps Number of samples
+ * @param clip_level |I| or |Q| at or above this counts as clipped (fraction of full scale)
+ * @param pulse_index Index of the pulse
+ * @return Peak, clip count and mean power of the pulse
+ */
+TraceMetrics compute_trace_metrics(const complex<float>* pulse, size_t n_samps, float clip_level, long int pulse_index) {
+  TraceMetrics metrics;
+  metrics.pulse_index = pulse_index;
+  metrics.num_samps = n_samps;
+  float peak = 0;
+  long int num_clipped = 0;
+  double power = 0;
+  for (size_t i = 0; i < n_samps; i++) {
+    float m = max(abs(pulse[i].real()), abs(pulse[i].imag()));
+    peak = max(peak, m);
+    num_clipped += (m >= clip_level);
+    power += norm(pulse[i]);
+  }
+  metrics.peak = peak;
+  metrics.num_clipped = num_clipped;
+  metrics.mean_power = (n_samps > 0) ? power / n_samps : 0;
+  return metrics;
+}
+
+/**
+ * @brief Decides how much to change the gain, given the metrics of the last few presum groups
+ *
+ * Clipping always reduces the gain by max_step. Otherwise the gain is moved towards the setting that
+ * brings the largest peak to target_peak, limited to max_step, and ignored if smaller than hysteresis.
+ * @param settings Controller settings
+ * @param window Metrics to base the decision on
+ * @return [dB] Gain change (0 for no change). Not yet limited to [min_gain, max_gain].
+ */
+double agc_gain_step(const AgcSettings& settings, const vector<TraceMetrics>& window) {
+  if (window.empty()) {
+    return 0;
+  }
+  float peak = 0;
+  long int num_clipped = 0;
+  size_t num_samps = 0;
+  for (const TraceMetrics& m : window) {
+    peak = max(peak, m.peak);
+    num_clipped += m.num_clipped;
+    num_samps += m.num_samps;
+  }
+
+  if (num_clipped > settings.max_clip_fraction * num_samps) {
+    return -settings.max_step;
+  }
+  double step = 20 * log10(settings.target_peak / max(peak, 1e-9f));
+  step = max(-settings.max_step, min(settings.max_step, step));
+  return (abs(step) < settings.hysteresis) ? 0 : step;
+}
+
+/**
+ * @brief Constructs a new AgcController and starts its thread
+ *
+ * Throws runtime_error if the gain log can't be created.
+ * @param settings Controller settings
+ * @param initial_gain [dB] RX gain the USRP was set up with
+ * @param log_filename CSV file every gain change is recorded in
+ */
+AgcController::AgcController(const AgcSettings& settings, double initial_gain, const string& log_filename) :
+  settings(settings), gain(initial_gain), pending_gain(initial_gain), change_pending(false), change_in_flight(false),
+  effective_pulse(0), num_changes(0), stopping(false) {
+  log.open(log_filename);
+  if (!log.is_open()) {
+    throw runtime_error("Could not create gain log " + log_filename);
+  }
+  log << "pulse_index,rx_time,old_gain,new_gain" << endl;
+  controller_thread = thread(&AgcController::run, this);
+}
+
+AgcController::~AgcController() {
+  stop();
+}
+
+/**
+ * @brief Hands the metrics of one pulse to the controller
+ *
+ * Called from the RX loop. Only takes a mutex for a moment; all decisions happen in the controller thread.
+ * @param metrics Metrics of the first pulse of a presum group
+ */
+void AgcController::addMetrics(const TraceMetrics& metrics) {
+  {
+    lock_guard<mutex> lock(agc_mutex);
+    new_metrics.push_back(metrics);
+  }
+  metrics_cv.notify_one();
+}
+
+/**
+ * @brief Takes the gain change the controller decided on, if there is one
+ *
+ * Called from the RX command thread at a presum-group boundary. Once taken, the caller must apply the
+ * gain and call confirmGainChange().
+ * @param gain Set to the new gain
+ * @return Returns true if there is a change to apply
+ */
+bool AgcController::takeGainChange(double& gain) {
+  lock_guard<mutex> lock(agc_mutex);
+  if (!change_pending) {
+    return false;
+  }
+  change_pending = false;
+  change_in_flight = true;
+  gain = pending_gain;
+  return true;
+}
+
+/**
+ * @brief Records that a gain change has been scheduled on the device
+ *
+ * @param pulse_index First pulse received with the new gain
+ * @param rx_time [s] Device time of that pulse's RX window
+ * @param gain [dB] New gain
+ */
+void AgcController::confirmGainChange(long int pulse_index, double rx_time, double gain) {
+  lock_guard<mutex> lock(agc_mutex);
+  log << pulse_index << "," << setprecision(12) << rx_time << "," << this->gain << "," << gain << endl;
+  {
+    lock_guard<mutex> cout_lock(cout_mutex);
+    cout << "[AGC] (Chirp " << pulse_index << ") RX gain " << this->gain << " -> " << gain << " dB" << endl;
+  }
+  this->gain = gain;
+  effective_pulse = pulse_index;
+  change_in_flight = false;
+  num_changes++;
+  window.clear();
+}
+
+/**
+ * @brief Stops the controller thread. Changes that were not taken yet are dropped.
+ */
+void AgcController::stop() {
+  {
+    lock_guard<mutex> lock(agc_mutex);
+    stopping = true;
+  }
+  metrics_cv.notify_all();
+  if (controller_thread.joinable()) {
+    controller_thread.join();
+  }
+}
+
+void AgcController::run() {
+  unique_lock<mutex> lock(agc_mutex);
+  while (true) {
+    metrics_cv.wait(lock, [this]() { return stopping || !new_metrics.empty(); });
+    if (stopping) {
+      return;
+    }
+    while (!new_metrics.empty()) {
+      // Metrics taken before the last change (or while one is on its way) don't describe the current gain
+      if (!change_pending && !change_in_flight && new_metrics.front().pulse_index >= effective_pulse) {
+        window.push_back(new_metrics.front());
+      }
+      new_metrics.pop_front();
+    }
+    if ((int) window.size() < settings.window) {
+      continue;
+    }
+
+    double new_gain = max(settings.min_gain, min(settings.max_gain, gain + agc_gain_step(settings, window)));
+    window.clear();
+    if (abs(new_gain - gain) > 1e-6) {
+      pending_gain = new_gain;
+      change_pending = true;
+    }
+  }
+}
+
+double AgcController::getGain() const {
+  lock_guard<mutex> lock(agc_mutex);
+  return gain;
+}
+
+long int AgcController::getNumChanges() const {
+  lock_guard<mutex> lock(agc_mutex);
+  return num_changes;
+}
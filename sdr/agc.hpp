@@ -0,0 +1,70 @@
+#ifndef AGC_HPP
+#define AGC_HPP
+
+#include <complex>
+#include <deque>
+#include <condition_variable>
+#include <fstream>
+#include "common.hpp"
+
+// Cheap metrics of one received pulse, used by the gain controller
+struct TraceMetrics {
+    long int pulse_index; // Pulse the metrics were taken from (value of pulses_received, counting errors)
+    float peak;           // Largest |I| or |Q| (full scale = 1.0)
+    long int num_clipped; // Samples with |I| or |Q| at or above the clip level
+    size_t num_samps;
+    double mean_power;    // Mean |x|^2 over the RX window
+};
+
+TraceMetrics compute_trace_metrics(const complex<float>* pulse, size_t n_samps, float clip_level, long int pulse_index);
+
+struct AgcSettings {
+    double target_peak;       // Desired peak (fraction of full scale)
+    double max_clip_fraction; // Above this fraction of clipped samples, the gain is always reduced
+    float clip_level;         // |I| or |Q| at or above this counts as clipped (fraction of full scale)
+    double max_step;          // [dB] Largest gain change at once
+    double hysteresis;        // [dB] Smaller corrections are not applied
+    double min_gain;          // [dB]
+    double max_gain;          // [dB]
+    int window;               // Number of presum groups the controller looks at for each decision
+};
+
+double agc_gain_step(const AgcSettings& settings, const vector<TraceMetrics>& window);
+
+// Closed-loop RX gain control. The RX loop hands in metrics of the first pulse of each presum group,
+// the controller thread decides on gain changes, and the RX command thread applies them as timed
+// commands in front of a presum-group boundary.
+class AgcController {
+  public:
+    AgcController(const AgcSettings& settings, double initial_gain, const string& log_filename);
+    ~AgcController();
+
+    void addMetrics(const TraceMetrics& metrics);
+    bool takeGainChange(double& gain);
+    void confirmGainChange(long int pulse_index, double rx_time, double gain);
+    void stop();
+
+    double getGain() const;
+    long int getNumChanges() const;
+
+  private:
+    void run();
+
+    AgcSettings settings;
+    ofstream log;
+
+    mutable mutex agc_mutex;
+    condition_variable metrics_cv;
+    deque<TraceMetrics> new_metrics;  // Handed in by the RX loop, not yet looked at by the controller
+    vector<TraceMetrics> window;
+    double gain;                      // Gain currently in effect (or about to be, once confirmed)
+    double pending_gain;
+    bool change_pending;              // Decided, waiting for the RX command thread to take it
+    bool change_in_flight;            // Taken, waiting for confirmGainChange()
+    long int effective_pulse;         // Metrics from pulses before this one predate the last change
+    long int num_changes;
+    bool stopping;
+    thread controller_thread;
+};
+
+#endif // AGC_HPP
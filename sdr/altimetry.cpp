@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include "altimetry.hpp"
+#include "fft.hpp"
+
+static const double SPEED_OF_LIGHT = 299792458.0; // [m/s]
+
+EchoPickerMethod parse_picker_method(const string& method) {
+  if (method == "threshold") {
+    return PICKER_THRESHOLD;
+  } else if (method == "cfar") {
+    return PICKER_CFAR;
+  }
+  throw invalid_argument("Unknown echo picker method '" + method + "' (threshold, cfar).");
+}
+
+/**
+ * @brief Prepares the matched filter
+ *
+ * @param reference Transmitted chirp at the RX sample rate
+ * @param samps_per_trace Number of samples in each trace
+ * @param settings Picker settings
+ */
+EchoPicker::EchoPicker(const vector<complex<float>>& reference, size_t samps_per_trace, const EchoPickerSettings& settings) :
+  settings(settings), num_samps(samps_per_trace), reference_length(reference.size()), detection_level(0) {
+  if (reference.empty() || samps_per_trace < 1) {
+    throw invalid_argument("The echo picker needs a reference chirp and at least one sample per trace.");
+  }
+  // Zero padding to a power of 2 covering every lag, so the circular correlation is a linear one
+  size_t n_fft = 1;
+  while (n_fft < samps_per_trace + reference.size() - 1) {
+    n_fft <<= 1;
+  }
+  reference_spectrum.assign(n_fft, 0);
+  copy(reference.begin(), reference.end(), reference_spectrum.begin());
+  dft(reference_spectrum, false);
+  for (complex<double>& bin : reference_spectrum) {
+    bin = conj(bin) / (double) n_fft;
+  }
+  spectrum.resize(n_fft);
+  power.resize(samps_per_trace);
+  power_sum.resize(samps_per_trace + 1);
+}
+
+/**
+ * @brief Returns true if sample n of the compressed power is a detection
+ */
+bool EchoPicker::detect(size_t n) const {
+  if (settings.method == PICKER_THRESHOLD) {
+    return power[n] > detection_level;
+  }
+  // Cell-averaging CFAR, with the training cells that fall inside the trace
+  size_t gap = settings.cfar_guard + 1;
+  size_t lead_end = n >= gap ? n - gap + 1 : 0;
+  size_t lead_start = lead_end > settings.cfar_train ? lead_end - settings.cfar_train : 0;
+  size_t lag_start = min(n + gap, num_samps);
+  size_t lag_end = min(lag_start + settings.cfar_train, num_samps);
+  size_t cells = (lead_end - lead_start) + (lag_end - lag_start);
+  if (cells == 0) {
+    return false;
+  }
+  double train = (power_sum[lead_end] - power_sum[lead_start]) + (power_sum[lag_end] - power_sum[lag_start]);
+  return power[n] > train / cells * pow(10, settings.threshold / 10);
+}
+
+/**
+ * @brief Pulse compresses a trace and picks the direct path, surface and bed
+ *
+ * The direct path is the strongest return in the first direct_window samples. The surface is the first
+ * detection at least surface_min_delay samples after it, moved to the strongest sample within one chirp
+ * length (so a leading range sidelobe doesn't bias it), and the bed is the strongest detection at least
+ * bed_min_delay samples after the surface.
+ * @param trace samps_per_trace samples
+ * @return Picks (delays from the direct path)
+ */
+EchoPick EchoPicker::pick(const complex<float>* trace) {
+  fill(spectrum.begin(), spectrum.end(), complex<double>(0, 0));
+  copy(trace, trace + num_samps, spectrum.begin());
+  dft(spectrum, false);
+  for (size_t k = 0; k < spectrum.size(); k++) {
+    spectrum[k] *= reference_spectrum[k];
+  }
+  dft(spectrum, true);
+  power_sum[0] = 0;
+  for (size_t n = 0; n < num_samps; n++) {
+    power[n] = norm(spectrum[n]);
+    power_sum[n + 1] = power_sum[n] + power[n];
+  }
+
+  EchoPick result = {0, false, 0, 0, false, 0, 0, 0};
+  vector<double> sorted(power);
+  nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+  result.noise_floor = max(sorted[sorted.size() / 2], 1e-30);
+  detection_level = result.noise_floor * pow(10, settings.threshold / 10);
+  auto snr = [&](size_t n) { return 10 * log10(max(power[n], 1e-30) / result.noise_floor); };
+
+  size_t direct_end = min(max<size_t>(settings.direct_window, 1), num_samps);
+  result.direct_index = max_element(power.begin(), power.begin() + direct_end) - power.begin();
+
+  size_t n = result.direct_index + settings.surface_min_delay;
+  for (; n < num_samps && !detect(n); n++) {}
+  if (n < num_samps) {
+    // The first detection may be a range sidelobe: the peak is the strongest sample within one chirp length
+    n = max_element(power.begin() + n, power.begin() + min(n + reference_length, num_samps)) - power.begin();
+    result.surface_found = true;
+    result.surface_delay = n - result.direct_index;
+    result.surface_snr = snr(n);
+
+    for (size_t m = n + settings.bed_min_delay; m < num_samps; m++) {
+      if (detect(m) && (!result.bed_found || power[m] > power[result.direct_index + result.bed_delay])) {
+        result.bed_found = true;
+        result.bed_delay = m - result.direct_index;
+      }
+    }
+    if (result.bed_found) {
+      result.bed_snr = snr(result.direct_index + result.bed_delay);
+    }
+  }
+  return result;
+}
+
+const vector<double>& EchoPicker::getPower() const {return power;}
+
+/**
+ * @brief Creates the altimetry file (and UDP socket) and starts the picker thread
+ *
+ * Throws runtime_error if the file or socket can't be created.
+ * @param filename File the records are appended to
+ * @param udp_port Port on localhost to send each record to as a datagram (0 to disable)
+ * @param reference Transmitted chirp at the RX sample rate
+ * @param samps_per_trace Number of samples in each trace
+ * @param settings Picker settings
+ * @param rx_rate [Hz] RX sample rate
+ * @param ice_velocity [m/s] Wave speed below the surface, for the bed depth
+ * @param pick_period [s] Shortest time between picks
+ */
+Altimeter::Altimeter(const string& filename, int udp_port, const vector<complex<float>>& reference, size_t samps_per_trace,
+                     const EchoPickerSettings& settings, double rx_rate, double ice_velocity, double pick_period) :
+  picker(reference, samps_per_trace, settings), rx_rate(rx_rate), ice_velocity(ice_velocity), pick_period(pick_period),
+  udp_fd(-1), trace(samps_per_trace), trace_pulse(0), last_offer_time(-INFINITY), busy(false), stopping(false),
+  last_record(), num_picks(0) {
+  outfile.open(filename, ofstream::binary);
+  if (!outfile.is_open()) {
+    throw runtime_error("Could not create altimetry file " + filename);
+  }
+  if (udp_port > 0) {
+    udp_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(udp_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (udp_fd < 0 || connect(udp_fd, (struct sockaddr*) &addr, sizeof(addr)) != 0) {
+      if (udp_fd >= 0) {
+        close(udp_fd);
+      }
+      throw runtime_error("Could not create the altimetry UDP socket: " + string(strerror(errno)));
+    }
+  }
+  picker_thread = thread(&Altimeter::run, this);
+}
+
+Altimeter::~Altimeter() {
+  stop();
+  if (udp_fd >= 0) {
+    close(udp_fd);
+  }
+}
+
+/**
+ * @brief Hands a trace to the picker, unless it is busy or the last pick was less than pick_period ago
+ *
+ * Never waits: if the picker thread happens to hold the lock, the trace is skipped too.
+ * @param trace samps_per_trace samples (copied)
+ * @param pulse_num Number of error-free pulses received up to and including this trace
+ * @return Returns true if the trace will be picked
+ */
+bool Altimeter::offer(const complex<float>* trace_in, long int pulse_num) {
+  double now = chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+  unique_lock<mutex> lock(altimeter_mutex, try_to_lock);
+  if (!lock.owns_lock() || busy || stopping || now - last_offer_time < pick_period) {
+    return false;
+  }
+  copy(trace_in, trace_in + trace.size(), trace.begin());
+  trace_pulse = pulse_num;
+  last_offer_time = now;
+  busy = true;
+  trace_ready.notify_one();
+  return true;
+}
+
+/**
+ * @brief Stops the picker thread (a pick in progress is finished first)
+ */
+void Altimeter::stop() {
+  {
+    lock_guard<mutex> lock(altimeter_mutex);
+    stopping = true;
+  }
+  trace_ready.notify_one();
+  if (picker_thread.joinable()) {
+    picker_thread.join();
+  }
+}
+
+void Altimeter::run() {
+  // Lowest priority for this thread only, so the picker always yields to the capture threads
+  setpriority(PRIO_PROCESS, syscall(SYS_gettid), 19);
+  while (true) {
+    {
+      unique_lock<mutex> lock(altimeter_mutex);
+      trace_ready.wait(lock, [this]() { return busy || stopping; });
+      if (stopping) {
+        return;
+      }
+    }
+    // trace is only written by offer() while busy is false
+    EchoPick pick = picker.pick(trace.data());
+
+    AltimetryRecord record;
+    memset(&record, 0, sizeof(record));
+    record.pulse = trace_pulse;
+    record.host_time = chrono::duration<double>(chrono::system_clock::now().time_since_epoch()).count();
+    record.surface_range = pick.surface_found ? pick.surface_delay / rx_rate * SPEED_OF_LIGHT / 2 : NAN;
+    record.surface_snr = pick.surface_found ? pick.surface_snr : NAN;
+    record.bed_depth = pick.bed_found ? (double) (pick.bed_delay - pick.surface_delay) / rx_rate * ice_velocity / 2 : NAN;
+    record.bed_snr = pick.bed_found ? pick.bed_snr : NAN;
+    record.noise_floor = 10 * log10(pick.noise_floor);
+    record.flags = (pick.surface_found ? ALTIMETRY_SURFACE_FOUND : 0) | (pick.bed_found ? ALTIMETRY_BED_FOUND : 0);
+    {
+      lock_guard<mutex> lock(altimeter_mutex);
+      last_record = record;
+      num_picks++;
+    }
+    publish(record);
+
+    cout_mutex.lock();
+    cout << "[ALT] Pulse " << record.pulse << ": surface ";
+    if (pick.surface_found) {
+      cout << record.surface_range << " m (" << record.surface_snr << " dB), bed ";
+      if (pick.bed_found) {
+        cout << record.bed_depth << " m below (" << record.bed_snr << " dB)" << endl;
+      } else {
+        cout << "not found" << endl;
+      }
+    } else {
+      cout << "not found" << endl;
+    }
+    cout_mutex.unlock();
+
+    lock_guard<mutex> lock(altimeter_mutex);
+    busy = false;
+  }
+}
+
+/**
+ * @brief Appends a record to the file and sends it to the UDP port
+ *
+ * Errors are ignored: nobody listening must never stop the picker (or the capture).
+ */
+void Altimeter::publish(const AltimetryRecord& record) {
+  outfile.write((const char*) &record, sizeof(record));
+  outfile.flush();
+  if (udp_fd >= 0) {
+    send(udp_fd, &record, sizeof(record), MSG_DONTWAIT);
+  }
+}
+
+AltimetryRecord Altimeter::getLastRecord() {
+  lock_guard<mutex> lock(altimeter_mutex);
+  return last_record;
+}
+
+uint64_t Altimeter::getNumPicks() const {return num_picks;}
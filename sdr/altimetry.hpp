@@ -0,0 +1,116 @@
+#ifndef ALTIMETRY_HPP
+#define ALTIMETRY_HPP
+
+#include <atomic>
+#include <complex>
+#include <condition_variable>
+#include <fstream>
+#include "common.hpp"
+
+// The altimetry file is a sequence of AltimetryRecords, one per pick. The same records are sent as
+// UDP datagrams if a port is configured (see manager/uav_payload_manager.py).
+const uint32_t ALTIMETRY_SURFACE_FOUND = 1;
+const uint32_t ALTIMETRY_BED_FOUND = 2;
+
+struct AltimetryRecord {
+    int64_t pulse;         // Number of error-free pulses received up to and including the picked trace
+    double host_time;      // [s] Host (UNIX) time of the pick
+    float surface_range;   // [m] Range to the surface (from the direct path)
+    float surface_snr;     // [dB] Surface peak power over the noise floor
+    float bed_depth;       // [m] Depth of the strongest echo below the surface
+    float bed_snr;         // [dB] Its power over the noise floor
+    float noise_floor;     // [dB] Median power of the compressed trace
+    uint32_t flags;        // ALTIMETRY_SURFACE_FOUND | ALTIMETRY_BED_FOUND
+};
+
+static_assert(sizeof(AltimetryRecord) == 40, "AltimetryRecord layout changed");
+
+enum EchoPickerMethod {
+    PICKER_THRESHOLD, // Power above a fixed number of dB over the trace's noise floor
+    PICKER_CFAR       // Cell-averaging CFAR: power above the mean of the training cells either side
+};
+
+EchoPickerMethod parse_picker_method(const string& method);
+
+struct EchoPickerSettings {
+    EchoPickerMethod method;
+    double threshold;         // [dB] Detection threshold over the noise floor (or the CFAR training cells)
+    size_t cfar_guard;        // [samples] Guard cells either side of the cell under test
+    size_t cfar_train;        // [samples] Training cells either side, beyond the guard cells
+    size_t direct_window;     // [samples] The direct path is the strongest return in this many first samples
+    size_t surface_min_delay; // [samples] Blanking after the direct path before the surface is searched for
+    size_t bed_min_delay;     // [samples] Blanking after the surface before the bed is searched for
+};
+
+// Result of picking one trace. Delays are from the direct path peak.
+struct EchoPick {
+    size_t direct_index;  // Sample of the direct path peak
+    bool surface_found;
+    size_t surface_delay; // [samples] First detection after the blanking, moved to its peak
+    double surface_snr;   // [dB]
+    bool bed_found;
+    size_t bed_delay;     // [samples] Strongest detection after the surface blanking
+    double bed_snr;       // [dB]
+    double noise_floor;   // Median of the compressed power
+};
+
+// Pulse compression (FFT correlation with the reference chirp) and surface/bed picking of one trace.
+class EchoPicker {
+  public:
+    EchoPicker(const vector<complex<float>>& reference, size_t samps_per_trace, const EchoPickerSettings& settings);
+
+    EchoPick pick(const complex<float>* trace);
+
+    const vector<double>& getPower() const;
+
+  private:
+    bool detect(size_t n) const;
+
+    EchoPickerSettings settings;
+    size_t num_samps;
+    size_t reference_length;
+    vector<complex<double>> reference_spectrum; // Conjugate spectrum of the reference
+    vector<complex<double>> spectrum;           // Work buffer
+    vector<double> power;                       // Compressed power of the last trace
+    vector<double> power_sum;                   // Prefix sums of power, for CFAR
+    double detection_level;                     // Threshold method: absolute power threshold
+};
+
+// Runs the echo picker on its own (low-priority) thread at no more than one trace per pick_period and
+// publishes the result. offer() never waits: traces arriving while a pick is running, or sooner than
+// pick_period after the last one, are skipped, so the capture never waits for the picker.
+class Altimeter {
+  public:
+    Altimeter(const string& filename, int udp_port, const vector<complex<float>>& reference, size_t samps_per_trace,
+              const EchoPickerSettings& settings, double rx_rate, double ice_velocity, double pick_period);
+    ~Altimeter();
+
+    bool offer(const complex<float>* trace, long int pulse_num);
+    void stop();
+
+    AltimetryRecord getLastRecord();
+    uint64_t getNumPicks() const;
+
+  private:
+    void run();
+    void publish(const AltimetryRecord& record);
+
+    EchoPicker picker;
+    double rx_rate;
+    double ice_velocity;
+    double pick_period;
+    ofstream outfile;
+    int udp_fd;                // -1 if not sending datagrams
+    vector<complex<float>> trace;
+    long int trace_pulse;
+    double last_offer_time;
+    mutex altimeter_mutex;
+    condition_variable trace_ready;
+    bool busy;                 // A trace is waiting for or being picked
+    bool stopping;
+    AltimetryRecord last_record;
+    atomic<uint64_t> num_picks;
+    thread picker_thread;
+};
+
+#endif // ALTIMETRY_HPP
@@ -0,0 +1,123 @@
+#include <fstream>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "buffer_pool.hpp"
+
+// From <numaif.h>. Defined here so libnuma isn't needed just to call mbind().
+const int MPOL_BIND_MODE = 2;
+const unsigned int MPOL_MF_MOVE_FLAG = (1 << 1);
+
+/**
+ * @brief Constructs a new SampleBufferPool
+ *
+ * Allocates one region holding num_buffers buffers of samps_per_buffer samples each. If use_huge_pages is set,
+ * the region is first requested from hugetlbfs (needs vm.nr_hugepages to be set), then falls back to transparent
+ * huge pages, then to normal pages. If numa_node >= 0, the region is bound to that node before it is touched.
+ * The whole region is pre-faulted so no page faults happen while capturing.
+ * @param samps_per_buffer Number of complex<float> samples in each buffer
+ * @param num_buffers Number of buffers in the pool
+ * @param use_huge_pages Back the region with 2 MB pages if possible
+ * @param numa_node NUMA node to bind the region to, or -1 to leave placement to the kernel
+ */
+SampleBufferPool::SampleBufferPool(size_t samps_per_buffer, size_t num_buffers, bool use_huge_pages, int numa_node) :
+  samps_per_buffer(samps_per_buffer), num_buffers(num_buffers), region(MAP_FAILED), page_type("default"), numa_node(-1) {
+  stride_bytes = ((samps_per_buffer * sizeof(complex<float>) + BUFFER_ALIGNMENT - 1) / BUFFER_ALIGNMENT) * BUFFER_ALIGNMENT;
+  region_bytes = max(stride_bytes * num_buffers, BUFFER_ALIGNMENT);
+
+  if (use_huge_pages) {
+    region_bytes = ((region_bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE) * HUGE_PAGE_SIZE;
+    region = mmap(nullptr, region_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (region != MAP_FAILED) {
+      page_type = "hugetlbfs";
+    }
+  }
+  if (region == MAP_FAILED) {
+    region = mmap(nullptr, region_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+      throw bad_alloc();
+    }
+    if (use_huge_pages && madvise(region, region_bytes, MADV_HUGEPAGE) == 0) {
+      page_type = "transparent";
+    }
+  }
+
+  if (numa_node >= 0) {
+    unsigned long node_mask = 1UL << numa_node;
+    if (syscall(SYS_mbind, region, region_bytes, MPOL_BIND_MODE, &node_mask, sizeof(node_mask) * 8, MPOL_MF_MOVE_FLAG) == 0) {
+      this->numa_node = numa_node;
+    } else {
+      cout << "WARNING: Failed to bind sample buffers to NUMA node " << numa_node << ": " << strerror(errno) << endl;
+    }
+  }
+
+  // Touch every page now rather than on the first pulse
+  memset(region, 0, region_bytes);
+
+  free_buffers.reserve(num_buffers);
+  for (size_t i = num_buffers; i > 0; i--) {
+    free_buffers.push_back((complex<float>*) ((char*) region + (i - 1) * stride_bytes));
+  }
+}
+
+SampleBufferPool::~SampleBufferPool() {
+  if (region != MAP_FAILED) {
+    munmap(region, region_bytes);
+  }
+}
+
+/**
+ * @brief Takes a buffer out of the pool
+ *
+ * @return Pointer to a BUFFER_ALIGNMENT-aligned buffer of getSampsPerBuffer() samples
+ */
+complex<float>* SampleBufferPool::acquire() {
+  lock_guard<mutex> lock(free_mutex);
+  if (free_buffers.empty()) {
+    throw runtime_error("SampleBufferPool exhausted: more buffers requested than were allocated.");
+  }
+  complex<float>* buffer = free_buffers.back();
+  free_buffers.pop_back();
+  return buffer;
+}
+
+/**
+ * @brief Returns a buffer to the pool
+ *
+ * @param buffer Pointer previously returned by acquire()
+ */
+void SampleBufferPool::release(complex<float>* buffer) {
+  lock_guard<mutex> lock(free_mutex);
+  free_buffers.push_back(buffer);
+}
+
+size_t SampleBufferPool::getSampsPerBuffer() const {return samps_per_buffer;}
+size_t SampleBufferPool::getNumBuffers() const {return num_buffers;}
+size_t SampleBufferPool::getRegionBytes() const {return region_bytes;}
+string SampleBufferPool::getPageType() const {return page_type;}
+int SampleBufferPool::getNumaNode() const {return numa_node;}
+
+size_t SampleBufferPool::getNumFree() {
+  lock_guard<mutex> lock(free_mutex);
+  return free_buffers.size();
+}
+
+/**
+ * @brief Looks up the NUMA node a device is attached to
+ *
+ * @param device Network interface name (e.g. "enp1s0" for an X310) or a sysfs device directory
+ *               (e.g. "/sys/bus/pci/devices/0000:00:14.0" for a USB controller)
+ * @return NUMA node number, or -1 if it can't be determined
+ */
+int numa_node_of_device(const string& device) {
+  vector<string> candidates = {"/sys/class/net/" + device + "/device/numa_node", device + "/numa_node"};
+  for (auto& path : candidates) {
+    ifstream f(path);
+    int node;
+    if (f.is_open() && (f >> node)) {
+      return node;
+    }
+  }
+  return -1;
+}
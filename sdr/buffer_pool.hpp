@@ -0,0 +1,71 @@
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+
+#include <complex>
+#include <cstdlib>
+#include <new>
+#include "common.hpp"
+
+const size_t BUFFER_ALIGNMENT = 64;            // [bytes] Alignment of every sample buffer (cache line / AVX-512)
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024; // [bytes]
+
+// STL allocator returning BUFFER_ALIGNMENT-aligned memory, for sample vectors that aren't worth pooling
+template <typename T>
+struct AlignedAllocator {
+    typedef T value_type;
+
+    AlignedAllocator() = default;
+    template <typename U> AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        size_t n_bytes = ((n * sizeof(T) + BUFFER_ALIGNMENT - 1) / BUFFER_ALIGNMENT) * BUFFER_ALIGNMENT;
+        void* p = aligned_alloc(BUFFER_ALIGNMENT, n_bytes);
+        if (p == nullptr) {
+            throw bad_alloc();
+        }
+        return (T*) p;
+    }
+    void deallocate(T* p, size_t) { free(p); }
+
+    template <typename U> bool operator==(const AlignedAllocator<U>&) const { return true; }
+    template <typename U> bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+typedef vector<complex<float>, AlignedAllocator<complex<float>>> aligned_sample_vector;
+
+// Fixed set of equally sized, aligned sample buffers carved out of one region that is allocated,
+// optionally bound to a NUMA node and pre-faulted up front, so nothing is allocated per pulse.
+class SampleBufferPool {
+  public:
+    SampleBufferPool(size_t samps_per_buffer, size_t num_buffers, bool use_huge_pages, int numa_node);
+    ~SampleBufferPool();
+    SampleBufferPool(const SampleBufferPool&) = delete;
+    SampleBufferPool& operator=(const SampleBufferPool&) = delete;
+
+    complex<float>* acquire();
+    void release(complex<float>* buffer);
+
+    size_t getSampsPerBuffer() const;
+    size_t getNumBuffers() const;
+    size_t getNumFree();
+    size_t getRegionBytes() const;
+    string getPageType() const;
+    int getNumaNode() const;
+
+  private:
+    size_t samps_per_buffer;
+    size_t num_buffers;
+    size_t stride_bytes; // Buffer size rounded up to BUFFER_ALIGNMENT
+    size_t region_bytes;
+    void* region;
+    string page_type;    // "hugetlbfs", "transparent" or "default"
+    int numa_node;       // NUMA node the region is bound to (-1 if not bound)
+
+    mutex free_mutex;
+    vector<complex<float>*> free_buffers;
+};
+
+// Look up the NUMA node of a network interface (e.g. "eth0") or sysfs device directory. Returns -1 if unknown.
+int numa_node_of_device(const string& device);
+
+#endif // BUFFER_POOL_HPP
@@ -31,6 +31,8 @@ void Chirp::assignVarFromYaml(const string& kYamlFile){
     num_pulses = chirp["num_pulses"].as<int>();
     num_presums = chirp["num_presums"].as<int>(1); // Default of 1 is equivalent to no pre-summing
     phase_dither = chirp["phase_dithering"].as<bool>(false);
+    tx_lookahead = chirp["tx_lookahead"].as<int>(6);
+    rx_lookahead = chirp["rx_lookahead"].as<int>(6);
 
     /**
     * sanity checks for Chirp class
@@ -43,6 +45,9 @@ void Chirp::assignVarFromYaml(const string& kYamlFile){
      if (config["CHIRP"]["rx_duration"].as<double>() < tx_duration) {
         cout << "WARNING: RX duration is shorter than TX duration.\n";
      }
+     if (tx_lookahead < 1 || rx_lookahead < 1) {
+        throw invalid_argument("tx_lookahead and rx_lookahead must be at least 1.");
+     }
 }
 
 double Chirp::getTimeOffset() const {return time_offset;}
@@ -56,6 +61,8 @@ int Chirp::getNumPulses() const {return num_pulses;}
 int Chirp::getNumPresums() const {return num_presums;}
 bool Chirp::getPhaseDither() const {return phase_dither;}
 int Chirp::getMaxChirpsPerFile() const {return max_chirps_per_file;}
+int Chirp::getTxLookahead() const {return tx_lookahead;}
+int Chirp::getRxLookahead() const {return rx_lookahead;}
 
 void Chirp::setTimeOffset(double value) {
     if (value < 0.0) {
@@ -20,6 +20,8 @@ public:
     int getNumPresums() const;
     bool getPhaseDither() const;
     int getMaxChirpsPerFile() const;
+    int getTxLookahead() const;
+    int getRxLookahead() const;
     void setMaxChirpsPerFile(int value);
 
 private:
@@ -37,6 +39,8 @@ private:
     bool phase_dither;       // Enable phase dithering
     int max_chirps_per_file; // Maximum number of RX from a chirp to write to a single file set to -1 to avoid breaking
                              // into multiple files
+    int tx_lookahead;        // Max. number of pulses the TX thread may send ahead of the last received pulse
+    int rx_lookahead;        // Max. number of pulses the RX command thread may schedule ahead of the last received pulse
 };
 
 #endif
@@ -0,0 +1,155 @@
+#include <cmath>
+#include <cstring>
+#include "chirp_generator.hpp"
+
+/**
+ * @brief Reads chirp parameters from the GENERATE block, with the same defaults as generate_chirp.py
+ *
+ * @param generate GENERATE node of the configuration file
+ * @return Chirp parameters
+ */
+ChirpParams load_chirp_params(const YAML::Node& generate) {
+  ChirpParams params;
+  params.chirp_type = generate["chirp_type"].as<string>();
+  params.sample_rate = generate["sample_rate"].as<double>();
+  params.chirp_bandwidth = generate["chirp_bandwidth"].as<double>();
+  params.lo_offset_sw = generate["lo_offset_sw"].as<double>(0);
+  params.window = generate["window"].as<string>();
+  params.chirp_length = generate["chirp_length"].as<double>();
+  params.pulse_length = generate["pulse_length"].as<double>(params.chirp_length);
+  return params;
+}
+
+/**
+ * @brief Returns the number of samples in a span, counted like np.arange(0, length - 1/(2*fs), 1/fs)
+ *
+ * @param length [s] Span length
+ * @param sample_rate [Hz] Sample rate
+ * @return Number of samples
+ */
+size_t arange_size(double length, double sample_rate) {
+  double step = 1 / sample_rate;
+  double n = ceil((length - 1 / (2 * sample_rate)) / step);
+  return n > 0 ? (size_t) n : 0;
+}
+
+/**
+ * @brief Computes a window function, with the same definition as numpy's
+ *
+ * Throws invalid_argument for an unknown window name.
+ * @param window "rectangular", "hamming", "blackman", "kaiser10", "kaiser14" or "kaiser18"
+ * @param n Window length
+ * @return Window coefficients
+ */
+vector<double> make_window(const string& window, size_t n) {
+  if (window != "rectangular" && window != "hamming" && window != "blackman" &&
+      window != "kaiser10" && window != "kaiser14" && window != "kaiser18") {
+    throw invalid_argument("Unrecognized window function '" + window + "'");
+  }
+  vector<double> w(n, 1.0);
+  if (window == "rectangular" || n < 2) {
+    return w;
+  }
+  double m = n - 1;
+  if (window == "hamming") {
+    for (size_t i = 0; i < n; i++) {
+      w[i] = 0.54 - 0.46 * cos(2 * M_PI * i / m);
+    }
+  } else if (window == "blackman") {
+    for (size_t i = 0; i < n; i++) {
+      w[i] = 0.42 - 0.5 * cos(2 * M_PI * i / m) + 0.08 * cos(4 * M_PI * i / m);
+    }
+  } else {
+    double beta = stod(window.substr(6));
+    double alpha = m / 2;
+    double i0_beta = cyl_bessel_i(0.0, beta);
+    for (size_t i = 0; i < n; i++) {
+      double x = (i - alpha) / alpha;
+      w[i] = cyl_bessel_i(0.0, beta * sqrt(max(0.0, 1 - x * x))) / i0_beta;
+    }
+  }
+  return w;
+}
+
+/**
+ * @brief Generates the chirp to transmit, matching preprocessing/generate_chirp.py
+ *
+ * The chirp sweeps from -bandwidth/2 to bandwidth/2 (shifted by lo_offset_sw), is windowed, and is zero
+ * padded symmetrically to pulse_length. As in the Python version, an odd number of padding samples is
+ * rounded down. The phase is computed in double precision for the whole chirp at once, then rotated
+ * into samples.
+ * Throws invalid_argument for unknown chirp types or windows, or parameters that don't give a valid chirp.
+ * @param params Chirp parameters
+ * @return Chirp samples
+ */
+aligned_sample_vector generate_chirp(const ChirpParams& params) {
+  double end_freq = params.chirp_bandwidth / 2 + params.lo_offset_sw;
+  double start_freq = -params.chirp_bandwidth / 2 + params.lo_offset_sw;
+  size_t n = arange_size(params.chirp_length, params.sample_rate);
+  size_t n_zp = arange_size(params.pulse_length, params.sample_rate);
+  if (n == 0 || n_zp < n) {
+    throw invalid_argument("chirp_length must be positive and no longer than pulse_length");
+  }
+
+  vector<double> phase(n);
+  double dt = 1 / params.sample_rate;
+  if (params.chirp_type == "linear") {
+    double rate = (end_freq - start_freq) / (2 * params.chirp_length);
+    for (size_t i = 0; i < n; i++) {
+      double t = i * dt;
+      phase[i] = 2 * M_PI * (start_freq * t + rate * t * t);
+    }
+  } else if (params.chirp_type == "hyperbolic") {
+    double scale = -1 * start_freq * end_freq * params.chirp_length / (end_freq - start_freq);
+    double rate = (end_freq - start_freq) / (end_freq * params.chirp_length);
+    if (1 - rate * (n - 1) * dt <= 0) {
+      throw invalid_argument("A hyperbolic chirp needs start and end frequencies of the same sign (set lo_offset_sw)");
+    }
+    for (size_t i = 0; i < n; i++) {
+      phase[i] = 2 * M_PI * scale * log(1 - rate * i * dt);
+    }
+  } else {
+    throw invalid_argument("Unrecognized chirp type '" + params.chirp_type + "'");
+  }
+
+  vector<double> window = make_window(params.window, n);
+  size_t pad = (n_zp - n) / 2;
+  aligned_sample_vector chirp(n + 2 * pad, complex<float>(0, 0));
+  for (size_t i = 0; i < n; i++) {
+    chirp[pad + i] = complex<float>(polar(window[i], phase[i]));
+  }
+  return chirp;
+}
+
+/**
+ * @brief Converts chirp samples to a cpu_format, as written to chirp.bin by generate_chirp.py
+ *
+ * Throws invalid_argument for unsupported formats.
+ * @param chirp Chirp samples
+ * @param cpu_format "fc32", "sc16" or "sc8"
+ * @return Interleaved I/Q samples
+ */
+vector<char> convert_chirp(const aligned_sample_vector& chirp, const string& cpu_format) {
+  vector<char> out;
+  if (cpu_format == "fc32") {
+    out.resize(chirp.size() * sizeof(complex<float>));
+    memcpy(out.data(), chirp.data(), out.size());
+  } else if (cpu_format == "sc16") {
+    vector<int16_t> samples(2 * chirp.size());
+    for (size_t i = 0; i < chirp.size(); i++) {
+      samples[2 * i] = (int16_t) (32766.0 * chirp[i].real());
+      samples[2 * i + 1] = (int16_t) (32766.0 * chirp[i].imag());
+    }
+    out.resize(samples.size() * sizeof(int16_t));
+    memcpy(out.data(), samples.data(), out.size());
+  } else if (cpu_format == "sc8") {
+    out.resize(2 * chirp.size());
+    for (size_t i = 0; i < chirp.size(); i++) {
+      out[2 * i] = (int8_t) (126.0 * chirp[i].real());
+      out[2 * i + 1] = (int8_t) (126.0 * chirp[i].imag());
+    }
+  } else {
+    throw invalid_argument("Unrecognized cpu_format '" + cpu_format + "'. Must be one of 'fc32', 'sc16', or 'sc8'.");
+  }
+  return out;
+}
@@ -0,0 +1,25 @@
+#ifndef CHIRP_GENERATOR_HPP
+#define CHIRP_GENERATOR_HPP
+
+#include "yaml-cpp/yaml.h"
+#include "buffer_pool.hpp"
+#include "common.hpp"
+
+// Chirp parameters from the GENERATE block of the configuration file (see preprocessing/generate_chirp.py)
+struct ChirpParams {
+    string chirp_type;      // "linear" or "hyperbolic"
+    double sample_rate;     // [Hz]
+    double chirp_bandwidth; // [Hz]
+    double lo_offset_sw;    // [Hz] Center frequency of the chirp relative to the RF center frequency
+    string window;          // "rectangular", "hamming", "blackman", "kaiser10", "kaiser14" or "kaiser18"
+    double chirp_length;    // [s] Without zero padding
+    double pulse_length;    // [s] Including symmetric zero padding
+};
+
+ChirpParams load_chirp_params(const YAML::Node& generate);
+size_t arange_size(double length, double sample_rate);
+vector<double> make_window(const string& window, size_t n);
+aligned_sample_vector generate_chirp(const ChirpParams& params);
+vector<char> convert_chirp(const aligned_sample_vector& chirp, const string& cpu_format);
+
+#endif // CHIRP_GENERATOR_HPP
@@ -10,6 +10,10 @@
 #include <thread>
 #include <boost/filesystem.hpp>
 #include <vector>
+#include <mutex>
 
 using namespace std;
-using namespace uhd;
\ No newline at end of file
+using namespace uhd;
+
+// Cout mutex (shared by every thread that prints while the radar is running)
+inline mutex cout_mutex;
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "control_socket.hpp"
+
+/**
+ * @brief Parses one line received on the control socket
+ *
+ * @param line Command line, without the newline
+ * @param command Set to "set" or "status"
+ * @param parameter Set to the parameter name (set only)
+ * @param value Set to the new value (set only)
+ * @param error Set to a description of the problem if the line can't be parsed
+ * @return Returns true if the line is a valid command
+ */
+bool parse_control_command(const string& line, string& command, string& parameter, double& value, string& error) {
+  stringstream ss(line);
+  string extra;
+  if (!(ss >> command)) {
+    error = "empty command";
+    return false;
+  }
+  if (command == "status") {
+    if (ss >> extra) {
+      error = "status takes no arguments";
+      return false;
+    }
+    return true;
+  }
+  if (command != "set") {
+    error = "unknown command '" + command + "'";
+    return false;
+  }
+  string value_string;
+  if (!(ss >> parameter >> value_string) || (ss >> extra)) {
+    error = "usage: set <parameter> <value>";
+    return false;
+  }
+  try {
+    size_t pos;
+    value = stod(value_string, &pos);
+    if (pos != value_string.size() || !isfinite(value)) { // nan and inf would slip through every range check
+      throw invalid_argument(value_string);
+    }
+  } catch (const logic_error&) {
+    error = "invalid value '" + value_string + "'";
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Creates the control socket and starts serving it
+ *
+ * Throws runtime_error if the socket can't be created.
+ * @param socket_path Filesystem path of the socket. A stale socket at this path is replaced.
+ * @param set_parameter Validates and schedules a change. Returns the reply: "OK <first pulse>" or "ERROR <reason>".
+ * @param get_status Returns a status line ("key=value ..."), sent back as "OK <status>"
+ */
+ControlServer::ControlServer(const string& socket_path, function<string(const string&, double)> set_parameter,
+                             function<string()> get_status) :
+  socket_path(socket_path), set_parameter(set_parameter), get_status(get_status), stopping(false) {
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(addr.sun_path)) {
+    throw runtime_error("Control socket path is too long: " + socket_path);
+  }
+  strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+  listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_fd < 0) {
+    throw runtime_error(string("Could not create control socket: ") + strerror(errno));
+  }
+  unlink(socket_path.c_str());
+  if (::bind(listen_fd, (sockaddr*) &addr, sizeof(addr)) != 0 || listen(listen_fd, 4) != 0) {
+    string reason = strerror(errno);
+    close(listen_fd);
+    throw runtime_error("Could not listen on control socket " + socket_path + ": " + reason);
+  }
+  server_thread = thread(&ControlServer::run, this);
+}
+
+ControlServer::~ControlServer() {
+  stop();
+}
+
+/**
+ * @brief Stops serving and removes the socket
+ */
+void ControlServer::stop() {
+  stopping = true;
+  if (server_thread.joinable()) {
+    server_thread.join();
+    close(listen_fd);
+    unlink(socket_path.c_str());
+  }
+}
+
+void ControlServer::run() {
+  pollfd pfd = {listen_fd, POLLIN, 0};
+  while (!stopping) {
+    if (poll(&pfd, 1, 200) <= 0) {
+      continue;
+    }
+    int client_fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client_fd >= 0) {
+      serve(client_fd);
+      close(client_fd);
+    }
+  }
+}
+
+/**
+ * @brief Answers commands from one client until it disconnects (or the server stops)
+ */
+void ControlServer::serve(int client_fd) {
+  pollfd pfd = {client_fd, POLLIN, 0};
+  string pending;
+  char buf[256];
+  while (!stopping) {
+    if (poll(&pfd, 1, 200) <= 0) {
+      continue;
+    }
+    ssize_t n = recv(client_fd, buf, sizeof(buf), 0);
+    if (n <= 0) {
+      return;
+    }
+    pending.append(buf, n);
+    size_t newline;
+    while ((newline = pending.find('\n')) != string::npos) {
+      string reply = handle(pending.substr(0, newline)) + "\n";
+      pending.erase(0, newline + 1);
+      if (send(client_fd, reply.data(), reply.size(), MSG_NOSIGNAL) < 0) {
+        return;
+      }
+    }
+    if (pending.size() > 1024) {
+      return; // Not a line-based client
+    }
+  }
+}
+
+string ControlServer::handle(const string& line) {
+  string command, parameter, error;
+  double value = 0;
+  if (!parse_control_command(line, command, parameter, value, error)) {
+    return "ERROR " + error;
+  }
+  if (command == "status") {
+    return "OK " + get_status();
+  }
+  string reply = set_parameter(parameter, value);
+  lock_guard<mutex> lock(cout_mutex);
+  cout << "[CONTROL] set " << parameter << " " << value << ": " << reply << endl;
+  return reply;
+}
+
+/**
+ * @brief Creates the change log
+ *
+ * Throws runtime_error if the file can't be created.
+ * @param filename CSV file to write
+ */
+ChangeLog::ChangeLog(const string& filename) {
+  log.open(filename);
+  if (!log.is_open()) {
+    throw runtime_error("Could not create change log " + filename);
+  }
+  log << "pulse_index,rx_time,parameter,old_value,new_value" << endl;
+}
+
+/**
+ * @brief Records a change that has taken effect. Safe to call from any thread.
+ *
+ * @param pulse First pulse the change applies to
+ * @param rx_time [s] Device time of that pulse's RX window
+ * @param parameter Name of the parameter
+ * @param old_value Value before the change
+ * @param new_value Value after the change
+ */
+void ChangeLog::record(long int pulse, double rx_time, const string& parameter, double old_value, double new_value) {
+  {
+    lock_guard<mutex> lock(log_mutex);
+    log << pulse << "," << setprecision(12) << rx_time << "," << parameter << "," << old_value << "," << new_value << endl;
+  }
+  lock_guard<mutex> lock(cout_mutex);
+  cout << "[CONTROL] (Chirp " << pulse << ") " << parameter << " " << old_value << " -> " << new_value << endl;
+}
@@ -0,0 +1,49 @@
+#ifndef CONTROL_SOCKET_HPP
+#define CONTROL_SOCKET_HPP
+
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include "common.hpp"
+
+// Line-based commands accepted on the control socket:
+//   set <parameter> <value>   ->  "OK <first pulse the change applies to>" or "ERROR <reason>"
+//   status                    ->  "OK <key>=<value> ..."
+bool parse_control_command(const string& line, string& command, string& parameter, double& value, string& error);
+
+// Unix-domain socket for changing parameters while the radar is running (e.g. from uav_payload_manager.py).
+// Connections are served one at a time from the server's own thread.
+class ControlServer {
+  public:
+    ControlServer(const string& socket_path, function<string(const string&, double)> set_parameter,
+                  function<string()> get_status);
+    ~ControlServer();
+
+    void stop();
+
+  private:
+    void run();
+    void serve(int client_fd);
+    string handle(const string& line);
+
+    string socket_path;
+    int listen_fd;
+    function<string(const string&, double)> set_parameter;
+    function<string()> get_status;
+    atomic<bool> stopping;
+    thread server_thread;
+};
+
+// CSV record of every runtime parameter change, with the pulse it took effect at
+class ChangeLog {
+  public:
+    ChangeLog(const string& filename);
+
+    void record(long int pulse, double rx_time, const string& parameter, double old_value, double new_value);
+
+  private:
+    mutex log_mutex;
+    ofstream log;
+};
+
+#endif // CONTROL_SOCKET_HPP
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "direct_path.hpp"
+
+/**
+ * @brief Correlates a trace with the reference chirp at a range of delays and interpolates the peak
+ *
+ * The delay of the largest correlation magnitude is refined with a parabola through it and its two
+ * neighbours; the amplitude and phase are taken from the same (complex) parabola at the refined delay.
+ * Costs (last_delay - first_delay + 1) * reference.size() complex multiply-adds.
+ * @param trace Trace samples (at least last_delay + reference.size() of them)
+ * @param reference Reference chirp
+ * @param first_delay First delay to try [samples]
+ * @param last_delay Last delay to try [samples]
+ * @return Peak delay, amplitude (relative to the reference) and phase
+ */
+DirectPathPeak find_direct_path(const complex<float>* trace, const vector<complex<float>>& reference,
+                                size_t first_delay, size_t last_delay) {
+  double energy = 0;
+  for (const complex<float>& r : reference) {
+    energy += norm(r);
+  }
+  vector<complex<double>> correlation(last_delay - first_delay + 1);
+  size_t peak = 0;
+  for (size_t k = 0; k < correlation.size(); k++) {
+    const complex<float>* x = trace + first_delay + k;
+    complex<float> sum = 0;
+    for (size_t i = 0; i < reference.size(); i++) {
+      sum += x[i] * conj(reference[i]);
+    }
+    correlation[k] = complex<double>(sum) / energy;
+    if (abs(correlation[k]) > abs(correlation[peak])) {
+      peak = k;
+    }
+  }
+
+  DirectPathPeak result = {(double) (first_delay + peak), abs(correlation[peak]), arg(correlation[peak]), true};
+  if (peak > 0 && peak + 1 < correlation.size()) {
+    double a = abs(correlation[peak - 1]);
+    double b = abs(correlation[peak]);
+    double c = abs(correlation[peak + 1]);
+    double curvature = a - 2 * b + c;
+    double offset = curvature < 0 ? 0.5 * (a - c) / curvature : 0;
+    complex<double> value = correlation[peak] + offset * (correlation[peak + 1] - correlation[peak - 1]) / 2.0 +
+                            offset * offset * (correlation[peak - 1] - 2.0 * correlation[peak] + correlation[peak + 1]) / 2.0;
+    result.delay += offset;
+    result.amplitude = b - 0.25 * (a - c) * offset;
+    result.phase = arg(value);
+    result.at_edge = false;
+  }
+  return result;
+}
+
+/**
+ * @brief Creates the direct path file and sets up the search window
+ *
+ * Throws invalid_argument if the search window doesn't fit in a trace.
+ * @param filename File the measurements are appended to
+ * @param reference Transmitted chirp at the RX sample rate (zero padding is skipped)
+ * @param samps_per_trace Number of samples in each trace
+ * @param expected_delay [samples] Expected position of the start of the reference in the traces
+ * @param window Delays up to this many samples either side of expected_delay are searched
+ * @param traces_per_measurement Number of traces stacked into each measurement
+ */
+DirectPathTracker::DirectPathTracker(const string& filename, const vector<complex<float>>& reference_in,
+                                     size_t samps_per_trace, double expected_delay, size_t window,
+                                     uint32_t traces_per_measurement) :
+  traces_per_measurement(traces_per_measurement), num_traces(0), next_trace(0), first_peak(), last_peak(),
+  num_measurements(0) {
+  auto is_nonzero = [](const complex<float>& s) { return s != complex<float>(0, 0); };
+  auto first = find_if(reference_in.begin(), reference_in.end(), is_nonzero);
+  auto last = find_if(reference_in.rbegin(), reference_in.rend(), is_nonzero).base();
+  if (first >= last || traces_per_measurement < 1) {
+    throw invalid_argument("The direct path tracker needs a non-zero reference and at least 1 trace per measurement.");
+  }
+  reference.assign(first, last);
+  lead_zeros = first - reference_in.begin();
+
+  long int center = lround(expected_delay) + lead_zeros;
+  long int max_delay = (long int) samps_per_trace - (long int) reference.size();
+  first_delay = max(0L, center - (long int) window);
+  long int window_end = min(max_delay, center + (long int) window);
+  if (max_delay < 0 || window_end < (long int) first_delay) {
+    throw invalid_argument("The direct path search window doesn't fit in the RX window.");
+  }
+  last_delay = window_end;
+  stack.resize(last_delay - first_delay + reference.size(), 0);
+
+  outfile.open(filename, ofstream::binary);
+  if (!outfile.is_open()) {
+    throw runtime_error("Could not create direct path file " + filename);
+  }
+}
+
+/**
+ * @brief Adds one presummed trace to the stack, measuring the direct path once the stack is full
+ *
+ * @param trace samps_per_trace samples
+ * @return Returns true if this trace completed a measurement
+ */
+bool DirectPathTracker::addTrace(const complex<float>* trace) {
+  const complex<float>* x = trace + first_delay;
+  for (size_t i = 0; i < stack.size(); i++) {
+    stack[i] += x[i];
+  }
+  next_trace++;
+  if (++num_traces < traces_per_measurement) {
+    return false;
+  }
+
+  for (complex<float>& s : stack) {
+    s /= (float) num_traces;
+  }
+  last_peak = find_direct_path(stack.data(), reference, 0, last_delay - first_delay);
+  last_peak.delay += (double) first_delay - (double) lead_zeros;
+  if (num_measurements++ == 0) {
+    first_peak = last_peak;
+  }
+
+  DirectPathRecord record;
+  record.first_trace = next_trace - num_traces;
+  record.delay = last_peak.delay;
+  record.amplitude = last_peak.amplitude;
+  record.phase = last_peak.phase;
+  record.host_time = chrono::duration<double>(chrono::system_clock::now().time_since_epoch()).count();
+  outfile.write((const char*) &record, sizeof(record));
+  outfile.flush();
+
+  fill(stack.begin(), stack.end(), complex<float>(0, 0));
+  num_traces = 0;
+  return true;
+}
+
+const DirectPathPeak& DirectPathTracker::getLastPeak() const {return last_peak;}
+const DirectPathPeak& DirectPathTracker::getFirstPeak() const {return first_peak;}
+uint64_t DirectPathTracker::getNumMeasurements() const {return num_measurements;}
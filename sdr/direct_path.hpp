@@ -0,0 +1,61 @@
+#ifndef DIRECT_PATH_HPP
+#define DIRECT_PATH_HPP
+
+#include <complex>
+#include <fstream>
+#include "common.hpp"
+
+// The direct path file is a sequence of DirectPathRecords, one per measurement.
+struct DirectPathRecord {
+    int64_t first_trace; // Index of the first trace stacked into this measurement
+    double delay;        // [samples] Interpolated position of the start of the reference in the trace
+    float amplitude;     // Peak correlation divided by the reference energy (same units as the trace samples)
+    float phase;         // [rad] Phase of the peak
+    double host_time;    // [s] Host (UNIX) time the measurement was made
+};
+
+static_assert(sizeof(DirectPathRecord) == 32, "DirectPathRecord layout changed");
+
+// Correlation peak of one trace near the expected direct path delay
+struct DirectPathPeak {
+    double delay;     // [samples] Sub-sample delay (parabolic interpolation)
+    double amplitude; // |correlation| at the peak / reference energy
+    double phase;     // [rad]
+    bool at_edge;     // Peak on the edge of the search window (delay not interpolated)
+};
+
+DirectPathPeak find_direct_path(const complex<float>* trace, const vector<complex<float>>& reference,
+                                size_t first_delay, size_t last_delay);
+
+// Tracks the direct path (TX leakage) delay, amplitude and phase during a run. The part of each trace
+// around the expected delay is stacked coherently (window + reference length samples per trace), and every
+// traces_per_measurement traces the stack is correlated with the reference chirp at the delays in the
+// window. Timing drift shows up as a moving delay, LO or inversion problems as a wandering phase or a
+// collapsing amplitude.
+class DirectPathTracker {
+  public:
+    DirectPathTracker(const string& filename, const vector<complex<float>>& reference, size_t samps_per_trace,
+                      double expected_delay, size_t window, uint32_t traces_per_measurement);
+
+    bool addTrace(const complex<float>* trace);
+
+    const DirectPathPeak& getLastPeak() const;
+    const DirectPathPeak& getFirstPeak() const;
+    uint64_t getNumMeasurements() const;
+
+  private:
+    ofstream outfile;
+    vector<complex<float>> reference; // Reference chirp without its zero padding
+    size_t lead_zeros;                // Zero padding removed from the start of the reference
+    size_t first_delay;               // First and last delay searched [samples into the trace]
+    size_t last_delay;
+    uint32_t traces_per_measurement;
+    vector<complex<float>> stack;     // Sum of the traces from first_delay on
+    uint32_t num_traces;              // Traces in the current stack
+    int64_t next_trace;
+    DirectPathPeak first_peak;
+    DirectPathPeak last_peak;
+    uint64_t num_measurements;
+};
+
+#endif // DIRECT_PATH_HPP
@@ -0,0 +1,76 @@
+#include <cmath>
+#include "fft.hpp"
+
+// Radix-2 FFT, in place (x.size() must be a power of 2, inverse without the 1/n scaling)
+static void fft_radix2(vector<complex<double>>& x, bool inverse) {
+  size_t n = x.size();
+  for (size_t i = 1, j = 0; i < n; i++) {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      swap(x[i], x[j]);
+    }
+  }
+  for (size_t len = 2; len <= n; len <<= 1) {
+    double angle = (inverse ? 2 : -2) * M_PI / len;
+    complex<double> step(cos(angle), sin(angle));
+    for (size_t i = 0; i < n; i += len) {
+      complex<double> w(1, 0);
+      for (size_t k = 0; k < len / 2; k++) {
+        complex<double> u = x[i + k];
+        complex<double> v = x[i + k + len / 2] * w;
+        x[i + k] = u + v;
+        x[i + k + len / 2] = u - v;
+        w *= step;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Discrete Fourier transform of any length, in place
+ *
+ * Powers of 2 use a radix-2 FFT, other lengths Bluestein's algorithm on top of it.
+ * @param x Samples, replaced by their transform
+ * @param inverse True for the inverse transform (not divided by x.size())
+ */
+void dft(vector<complex<double>>& x, bool inverse) {
+  size_t n = x.size();
+  if (n <= 1) {
+    return;
+  }
+  if ((n & (n - 1)) == 0) {
+    fft_radix2(x, inverse);
+    return;
+  }
+  size_t m = 1;
+  while (m < 2 * n - 1) {
+    m <<= 1;
+  }
+  // Chirp w[k] = exp(-+j pi k^2 / n), with k^2 taken modulo 2n to keep the angle accurate
+  vector<complex<double>> w(n);
+  for (size_t k = 0; k < n; k++) {
+    double angle = M_PI * (double) ((k * k) % (2 * n)) / n;
+    w[k] = polar(1.0, inverse ? angle : -angle);
+  }
+  vector<complex<double>> a(m, 0.0), b(m, 0.0);
+  for (size_t k = 0; k < n; k++) {
+    a[k] = x[k] * w[k];
+  }
+  b[0] = conj(w[0]);
+  for (size_t k = 1; k < n; k++) {
+    b[k] = b[m - k] = conj(w[k]);
+  }
+  fft_radix2(a, false);
+  fft_radix2(b, false);
+  for (size_t k = 0; k < m; k++) {
+    a[k] *= b[k];
+  }
+  fft_radix2(a, true);
+  for (size_t k = 0; k < n; k++) {
+    x[k] = a[k] * w[k] / (double) m;
+  }
+}
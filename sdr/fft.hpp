@@ -0,0 +1,10 @@
+#ifndef FFT_HPP
+#define FFT_HPP
+
+#include <complex>
+#include "common.hpp"
+
+// Discrete Fourier transform of any length, in place (inverse without the 1/n scaling)
+void dft(vector<complex<double>>& x, bool inverse);
+
+#endif // FFT_HPP
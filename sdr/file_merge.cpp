@@ -0,0 +1,216 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <memory>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#include "file_merge.hpp"
+#include "utils.hpp"
+
+using namespace std;
+
+static const size_t MERGE_ALIGNMENT = 4096; // Buffer alignment and chunk size granularity [bytes]
+
+string MergeStats::summary() const {
+  return (boost::format("%d bytes in %d chunks (%d reflinked, %d copy_file_range, %d streamed, %d chunks verified)")
+          % bytes % chunks % reflinked % copy_ranged % streamed % verified).str();
+}
+
+/**
+ * @brief 64-bit FNV-1a style checksum of a block of memory
+ *
+ * Mixes in 8 bytes per step (then the trailing bytes one at a time), which is fast enough to keep up
+ * with a disk while still catching misplaced, missing or corrupted chunks.
+ * @param data Start of the block
+ * @param n_bytes Length of the block [bytes]
+ * @param seed Initial hash value
+ * @return Checksum
+ */
+uint64_t chunk_checksum(const void* data, size_t n_bytes, uint64_t seed) {
+  const uint64_t prime = 0x100000001b3ULL;
+  const unsigned char* p = (const unsigned char*) data;
+  uint64_t hash = seed;
+  size_t i = 0;
+  for (; i + 8 <= n_bytes; i += 8) {
+    uint64_t word;
+    memcpy(&word, p + i, 8);
+    hash = (hash ^ word) * prime;
+  }
+  for (; i < n_bytes; i++) {
+    hash = (hash ^ p[i]) * prime;
+  }
+  return hash;
+}
+
+// Errors meaning the filesystem (or kernel) can't do this kind of copy between these files at all
+static bool is_unsupported(int err) {
+  return err == EOPNOTSUPP || err == ENOTTY || err == ENOSYS || err == EXDEV || err == EBADF || err == EPERM;
+}
+
+/**
+ * @brief Shares a range of the input with the output (FICLONERANGE), without copying any data
+ *
+ * @return True if the whole range was cloned
+ */
+static bool clone_range(int in_fd, int out_fd, off_t in_offset, off_t out_offset, size_t n_bytes, bool& supported) {
+#ifdef FICLONERANGE
+  struct file_clone_range range;
+  range.src_fd = in_fd;
+  range.src_offset = in_offset;
+  range.src_length = n_bytes;
+  range.dest_offset = out_offset;
+  if (ioctl(out_fd, FICLONERANGE, &range) == 0) {
+    return true;
+  }
+  if (is_unsupported(errno)) {
+    supported = false;
+  }
+#else
+  supported = false;
+#endif
+  return false;
+}
+
+/**
+ * @brief Copies a range in the kernel with copy_file_range()
+ *
+ * @return Number of bytes copied (less than n_bytes if copy_file_range() stopped or isn't supported)
+ */
+static size_t copy_range(int in_fd, int out_fd, off_t in_offset, off_t out_offset, size_t n_bytes, bool& supported) {
+  size_t done = 0;
+  while (done < n_bytes) {
+    loff_t in_off = in_offset + done;
+    loff_t out_off = out_offset + done;
+    ssize_t n = copy_file_range(in_fd, &in_off, out_fd, &out_off, n_bytes - done, 0);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      if (n < 0 && (is_unsupported(errno) || errno == EINVAL)) {
+        supported = false;
+      }
+      break;
+    }
+    done += n;
+  }
+  return done;
+}
+
+/**
+ * @brief Concatenates files without copying the data through user space where the filesystem allows it
+ *
+ * Each input is handled in chunks of chunk_size bytes. A chunk is first shared with FICLONERANGE
+ * (reflink, e.g. on btrfs and XFS), which needs the chunk to start on a filesystem block boundary in
+ * both files. If that isn't possible the chunk is copied with copy_file_range(), and if that isn't
+ * supported either (or stops early) the rest is streamed through an aligned buffer with pread()/pwrite().
+ * Once a method is found to be unsupported it isn't tried again.
+ *
+ * With verify, the checksum of every output chunk is compared against the same chunk of the input
+ * right after it is written, so a failed merge stops at the first bad chunk. Without verify, reflinked
+ * and kernel-copied chunks are never read by this process.
+ * @param inputs Files to concatenate, in order
+ * @param output File to create (must not exist yet; it is removed again if the merge fails)
+ * @param chunk_size Chunk size [bytes] (rounded up to a multiple of 4096)
+ * @param verify True to check every chunk of the output against the input
+ * @return Bytes moved by each method
+ */
+MergeStats merge_files(const vector<string>& inputs, const string& output, size_t chunk_size, bool verify) {
+  chunk_size = max(MERGE_ALIGNMENT, (chunk_size + MERGE_ALIGNMENT - 1) / MERGE_ALIGNMENT * MERGE_ALIGNMENT);
+  int out_fd = open(output.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (out_fd < 0) {
+    throw runtime_error("Failed to create " + output + ": " + strerror(errno));
+  }
+  void* buff_ptr = nullptr;
+  if (posix_memalign(&buff_ptr, MERGE_ALIGNMENT, chunk_size) != 0) {
+    close(out_fd);
+    unlink(output.c_str());
+    throw runtime_error("Failed to allocate a merge buffer of " + to_string(chunk_size) + " bytes");
+  }
+  unique_ptr<char, decltype(&free)> buff((char*) buff_ptr, &free);
+
+  MergeStats stats = {0, 0, 0, 0, 0, 0};
+  bool reflink_supported = true;
+  bool copy_range_supported = true;
+  int in_fd = -1;
+  try {
+    struct stat out_stat;
+    fstat(out_fd, &out_stat);
+    off_t block_size = max<off_t>(out_stat.st_blksize, 1);
+
+    for (const string& input : inputs) {
+      in_fd = open(input.c_str(), O_RDONLY);
+      struct stat in_stat;
+      if (in_fd < 0 || fstat(in_fd, &in_stat) != 0) {
+        throw runtime_error("Failed to open " + input + ": " + strerror(errno));
+      }
+      posix_fadvise(in_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+      off_t base = stats.bytes;
+      // Chunks start at multiples of chunk_size in the input, so they are block-aligned in the output only if base is
+      bool aligned = base % block_size == 0 && chunk_size % block_size == 0;
+
+      for (off_t offset = 0; offset < in_stat.st_size; offset += chunk_size) {
+        size_t n_bytes = min<off_t>(chunk_size, in_stat.st_size - offset);
+        bool have_input = false;
+        uint64_t in_sum = 0;
+        auto read_input = [&]() {
+          if (!pread_all(in_fd, buff.get(), n_bytes, offset)) {
+            throw runtime_error("Failed to read " + input + " at offset " + to_string(offset));
+          }
+          in_sum = chunk_checksum(buff.get(), n_bytes);
+          have_input = true;
+        };
+        if (verify) {
+          read_input();
+        }
+
+        size_t done = 0;
+        if (reflink_supported && aligned && clone_range(in_fd, out_fd, offset, base + offset, n_bytes, reflink_supported)) {
+          stats.reflinked += n_bytes;
+          done = n_bytes;
+        }
+        if (done < n_bytes && copy_range_supported) {
+          done = copy_range(in_fd, out_fd, offset, base + offset, n_bytes, copy_range_supported);
+          stats.copy_ranged += done;
+        }
+        if (done < n_bytes) {
+          if (!have_input) {
+            read_input();
+          }
+          if (!pwrite_all(out_fd, buff.get() + done, n_bytes - done, base + offset + done)) {
+            throw runtime_error("Failed to write " + output + " at offset " + to_string(base + offset + done) + ": " + strerror(errno));
+          }
+          stats.streamed += n_bytes - done;
+        }
+
+        if (verify) {
+          if (!pread_all(out_fd, buff.get(), n_bytes, base + offset)) {
+            throw runtime_error("Failed to read back " + output + " at offset " + to_string(base + offset));
+          }
+          if (chunk_checksum(buff.get(), n_bytes) != in_sum) {
+            throw runtime_error("Checksum mismatch in " + output + " at offset " + to_string(base + offset) + " (from " + input + ")");
+          }
+          stats.verified++;
+        }
+        stats.chunks++;
+        stats.bytes += n_bytes;
+      }
+      close(in_fd);
+      in_fd = -1;
+    }
+    if (fdatasync(out_fd) != 0) {
+      throw runtime_error("Failed to sync " + output + ": " + strerror(errno));
+    }
+  } catch (...) {
+    if (in_fd >= 0) {
+      close(in_fd);
+    }
+    close(out_fd);
+    unlink(output.c_str());
+    throw;
+  }
+  close(out_fd);
+  return stats;
+}
@@ -0,0 +1,23 @@
+#ifndef FILE_MERGE_HPP
+#define FILE_MERGE_HPP
+
+#include <cstdint>
+#include "common.hpp"
+
+// Bytes of the output produced by each copy method, and the number of verified chunks
+struct MergeStats {
+    uint64_t bytes;        // Total bytes written to the output
+    uint64_t reflinked;    // Shared with the input through FICLONERANGE (no data copied)
+    uint64_t copy_ranged;  // Copied in the kernel by copy_file_range()
+    uint64_t streamed;     // Copied through an aligned user-space buffer
+    size_t chunks;         // Number of chunks
+    size_t verified;       // Chunks whose output checksum was compared against the input
+
+    string summary() const;
+};
+
+uint64_t chunk_checksum(const void* data, size_t n_bytes, uint64_t seed = 0xcbf29ce484222325ULL);
+MergeStats merge_files(const vector<string>& inputs, const string& output, size_t chunk_size = 64 << 20,
+                       bool verify = true);
+
+#endif // FILE_MERGE_HPP
@@ -0,0 +1,39 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include "chirp_generator.hpp"
+
+using namespace std;
+
+// Native replacement for preprocessing/generate_chirp.py: writes the chirp described by the GENERATE
+// block in the configured cpu_format.
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 3) {
+        cout << "Usage: " << argv[0] << " <config.yaml> [output.bin]" << endl;
+        cout << "Writes the chirp described by GENERATE, in DEVICE:cpu_format, like preprocessing/generate_chirp.py." << endl;
+        cout << "The default output is <FILES:output_dir>/<GENERATE:out_file>, relative to the current directory." << endl;
+        return 1;
+    }
+
+    try {
+        YAML::Node config = YAML::LoadFile(argv[1]);
+        string filename = (argc == 3) ? string(argv[2]) :
+            config["FILES"]["output_dir"].as<string>("data") + "/" + config["GENERATE"]["out_file"].as<string>();
+        string cpu_format = config["DEVICE"]["cpu_format"].as<string>("fc32");
+
+        aligned_sample_vector chirp = generate_chirp(load_chirp_params(config["GENERATE"]));
+        vector<char> samples = convert_chirp(chirp, cpu_format);
+
+        ofstream outfile(filename, ofstream::binary);
+        outfile.write(samples.data(), samples.size());
+        if (!outfile.good()) {
+            throw runtime_error("Could not write " + filename);
+        }
+        cout << chirp.size() << " samples (" << cpu_format << ") written to " << filename << endl;
+    } catch (const exception& e) {
+        cout << "ERROR: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include "yaml-cpp/yaml.h"
+#include "loopback_cal.hpp"
+#include "direct_path.hpp"
+#include "fft.hpp"
+
+/**
+ * @brief Sets up the average
+ *
+ * @param ideal Transmitted (ideal) chirp at the RX sample rate, including its zero padding
+ * @param samps_per_trace Number of samples in each trace
+ * @param sample_rate [Hz] RX sample rate
+ * @param band_center [Hz] Center frequency of the chirp, relative to the RF center frequency
+ * @param bandwidth [Hz] Chirp bandwidth (the transfer function is only estimated inside it)
+ */
+LoopbackCalibrator::LoopbackCalibrator(const vector<complex<float>>& ideal, size_t samps_per_trace, double sample_rate,
+                                       double band_center, double bandwidth) :
+  ideal(ideal), sample_rate(sample_rate), band_center(band_center), bandwidth(bandwidth), sum(samps_per_trace, 0),
+  num_traces(0) {
+  if (ideal.empty() || ideal.size() > samps_per_trace || sample_rate <= 0 || bandwidth <= 0) {
+    throw invalid_argument("Loopback calibration needs a chirp no longer than the RX window and a positive sample rate and bandwidth.");
+  }
+}
+
+/**
+ * @brief Adds one presummed trace to the average
+ *
+ * @param trace samps_per_trace samples
+ */
+void LoopbackCalibrator::addTrace(const complex<float>* trace) {
+  for (size_t i = 0; i < sum.size(); i++) {
+    sum[i] += complex<double>(trace[i]);
+  }
+  num_traces++;
+}
+
+long int LoopbackCalibrator::getNumTraces() const {return num_traces;}
+
+/**
+ * @brief Estimates the system delay, gain and transfer function from the averaged traces
+ *
+ * The delay is the interpolated correlation peak with the ideal chirp. The chirp-length segment of the
+ * average starting there is moved by the remaining fraction of a sample in the frequency domain, and its
+ * spectrum divided by the ideal chirp's gives the transfer function inside the chirp band (where the ideal
+ * spectrum is within 10 dB of its peak). The measured reference is that segment divided by the gain, so
+ * correlating with it keeps the amplitude scale and zero-delay phase of the ideal chirp.
+ * Throws runtime_error if nothing was averaged or the loopback chirp isn't entirely inside the RX window.
+ * @return Calibration
+ */
+LoopbackCalibration LoopbackCalibrator::calibrate() const {
+  if (num_traces == 0) {
+    throw runtime_error("No traces were averaged for the loopback calibration.");
+  }
+  size_t n_samps = sum.size();
+  vector<complex<float>> average(n_samps);
+  for (size_t i = 0; i < n_samps; i++) {
+    average[i] = complex<float>(sum[i] / (double) num_traces);
+  }
+
+  // Delay and gain from the part of the ideal chirp that isn't zero padding
+  auto is_nonzero = [](const complex<float>& s) { return s != complex<float>(0, 0); };
+  auto first = find_if(ideal.begin(), ideal.end(), is_nonzero);
+  auto last = find_if(ideal.rbegin(), ideal.rend(), is_nonzero).base();
+  if (first >= last) {
+    throw runtime_error("The ideal chirp is all zeros.");
+  }
+  vector<complex<float>> trimmed(first, last);
+  size_t lead_zeros = first - ideal.begin();
+  DirectPathPeak peak = find_direct_path(average.data(), trimmed, 0, n_samps - trimmed.size());
+
+  LoopbackCalibration cal;
+  cal.delay = peak.delay - lead_zeros;
+  cal.gain = polar(peak.amplitude, peak.phase);
+  cal.num_traces = num_traces;
+  long int start = (long int) floor(cal.delay);
+  if (peak.at_edge || start < 0 || start + ideal.size() > n_samps) {
+    throw runtime_error("The loopback chirp isn't entirely inside the RX window (delay " + to_string(cal.delay) + " samples).");
+  }
+  double fraction = cal.delay - start;
+
+  // Noise: everything outside the chirp
+  double trimmed_energy = 0;
+  for (const complex<float>& s : trimmed) {
+    trimmed_energy += norm(s);
+  }
+  double noise = 0;
+  size_t noise_samps = 0;
+  for (size_t i = 0; i < n_samps; i++) {
+    if ((long int) i < start || i > start + ideal.size()) {
+      noise += norm(average[i]);
+      noise_samps++;
+    }
+  }
+  double signal = norm(cal.gain) * trimmed_energy / trimmed.size();
+  cal.snr = noise_samps > 0 ? 10 * log10(signal / max(noise / noise_samps, 1e-30)) : NAN;
+
+  // Spectra with enough zero padding that the fractional shift doesn't wrap around
+  size_t n_fft = 1;
+  while (n_fft < 2 * ideal.size()) {
+    n_fft <<= 1;
+  }
+  vector<complex<double>> measured(n_fft, 0), reference(n_fft, 0);
+  copy(average.begin() + start, average.begin() + start + ideal.size(), measured.begin());
+  copy(ideal.begin(), ideal.end(), reference.begin());
+  dft(measured, false);
+  dft(reference, false);
+  double max_power = 0;
+  for (const complex<double>& bin : reference) {
+    max_power = max(max_power, norm(bin));
+  }
+
+  cal.transfer_function.assign(n_fft, 0);
+  cal.max_ripple = 0;
+  double phase_sum = 0;
+  size_t band_bins = 0;
+  for (size_t k = 0; k < n_fft; k++) {
+    double freq = ((k < n_fft / 2) ? (double) k : (double) k - n_fft) * sample_rate / n_fft;
+    measured[k] *= polar(1.0, 2 * M_PI * freq / sample_rate * fraction) / cal.gain;
+    // Bins where the ideal chirp has little energy would only measure noise
+    if (fabs(freq - band_center) <= bandwidth / 2 && norm(reference[k]) > 0.1 * max_power) {
+      cal.transfer_function[k] = measured[k] / reference[k];
+      cal.max_ripple = max(cal.max_ripple, fabs(20 * log10(max(abs(cal.transfer_function[k]), 1e-15))));
+      phase_sum += pow(arg(cal.transfer_function[k]), 2);
+      band_bins++;
+    }
+  }
+  cal.rms_phase = band_bins > 0 ? sqrt(phase_sum / band_bins) : 0;
+
+  dft(measured, true);
+  cal.reference.resize(ideal.size());
+  for (size_t i = 0; i < ideal.size(); i++) {
+    cal.reference[i] = complex<float>(measured[i] / (double) n_fft);
+  }
+  return cal;
+}
+
+/**
+ * @brief Writes a loopback calibration
+ *
+ * The measured reference chirp is written to filename as complex float32 samples (like chirp.bin), the
+ * transfer function to <stem>_transfer.bin (complex float32, FFT bin order) and everything else to
+ * <stem>.yaml next to it.
+ * @param filename Reference chirp file
+ * @param cal Calibration
+ * @param sample_rate [Hz] RX sample rate
+ * @param band_center [Hz] Chirp center frequency relative to the RF center frequency
+ * @param bandwidth [Hz] Chirp bandwidth
+ * @return Returns true if every file was written
+ */
+bool save_loopback_calibration(const string& filename, const LoopbackCalibration& cal, double sample_rate,
+                               double band_center, double bandwidth) {
+  std::filesystem::path path(filename);
+  std::filesystem::path transfer_path = path.parent_path() / (path.stem().string() + "_transfer.bin");
+  std::filesystem::path meta_path = path.parent_path() / (path.stem().string() + ".yaml");
+
+  ofstream reference_file(filename, ofstream::binary);
+  reference_file.write((const char*) cal.reference.data(), cal.reference.size() * sizeof(complex<float>));
+  ofstream transfer_file(transfer_path, ofstream::binary);
+  for (const complex<double>& bin : cal.transfer_function) {
+    complex<float> value(bin);
+    transfer_file.write((const char*) &value, sizeof(value));
+  }
+
+  YAML::Node meta;
+  meta["reference_file"] = path.filename().string();
+  meta["transfer_function_file"] = transfer_path.filename().string();
+  meta["sample_rate"] = sample_rate;
+  meta["band_center"] = band_center;
+  meta["bandwidth"] = bandwidth;
+  meta["num_samples"] = cal.reference.size();
+  meta["n_fft"] = cal.transfer_function.size();
+  meta["delay_samples"] = cal.delay;
+  meta["delay_seconds"] = cal.delay / sample_rate;
+  meta["gain_db"] = 20 * log10(max(abs(cal.gain), 1e-15));
+  meta["gain_phase_deg"] = arg(cal.gain) * 180 / M_PI;
+  meta["snr_db"] = cal.snr;
+  meta["num_traces"] = cal.num_traces;
+  meta["max_ripple_db"] = cal.max_ripple;
+  meta["rms_phase_deg"] = cal.rms_phase * 180 / M_PI;
+  meta["host_time"] = chrono::duration<double>(chrono::system_clock::now().time_since_epoch()).count();
+  ofstream meta_file(meta_path, ofstream::trunc);
+  meta_file << meta << "\n";
+  return reference_file.good() && transfer_file.good() && meta_file.good();
+}
+
+/**
+ * @brief Reads a reference chirp written by save_loopback_calibration() (or any complex float32 chirp file)
+ *
+ * Throws runtime_error if the file can't be read or is empty.
+ * @param filename Reference chirp file
+ * @return Chirp samples
+ */
+vector<complex<float>> load_reference_chirp(const string& filename) {
+  ifstream infile(filename, ifstream::binary | ifstream::ate);
+  if (!infile.is_open()) {
+    throw runtime_error("Could not open reference chirp " + filename);
+  }
+  vector<complex<float>> reference(infile.tellg() / (streamoff) sizeof(complex<float>));
+  if (reference.empty()) {
+    throw runtime_error("Reference chirp " + filename + " is empty.");
+  }
+  infile.seekg(0);
+  infile.read((char*) reference.data(), reference.size() * sizeof(complex<float>));
+  return reference;
+}
@@ -0,0 +1,44 @@
+#ifndef LOOPBACK_CAL_HPP
+#define LOOPBACK_CAL_HPP
+
+#include <complex>
+#include "common.hpp"
+
+// System response measured with TX looped back into RX (through an attenuator)
+struct LoopbackCalibration {
+    double delay;                              // [samples] Start of the ideal chirp in the averaged trace
+    complex<double> gain;                      // Complex gain of the loopback at the delay
+    double snr;                                // [dB] Loopback chirp power over the noise outside it (per sample)
+    long int num_traces;                       // Presummed traces averaged
+    vector<complex<float>> reference;          // Measured chirp: aligned to the ideal one, gain removed
+    vector<complex<double>> transfer_function; // Measured / ideal spectrum on n_fft bins, gain removed (0 outside the band)
+    double max_ripple;                         // [dB] Largest |transfer_function| deviation from 1 in the band
+    double rms_phase;                          // [rad] RMS phase of transfer_function in the band
+};
+
+// Averages presummed loopback traces (the phase dither is already removed by presumming, so pulses add
+// coherently) and estimates the system delay and transfer function from the average.
+class LoopbackCalibrator {
+  public:
+    LoopbackCalibrator(const vector<complex<float>>& ideal, size_t samps_per_trace, double sample_rate,
+                       double band_center, double bandwidth);
+
+    void addTrace(const complex<float>* trace);
+    long int getNumTraces() const;
+
+    LoopbackCalibration calibrate() const;
+
+  private:
+    vector<complex<float>> ideal;
+    double sample_rate;
+    double band_center;  // [Hz] Relative to the RF center frequency
+    double bandwidth;    // [Hz]
+    vector<complex<double>> sum;
+    long int num_traces;
+};
+
+bool save_loopback_calibration(const string& filename, const LoopbackCalibration& cal, double sample_rate,
+                               double band_center, double bandwidth);
+vector<complex<float>> load_reference_chirp(const string& filename);
+
+#endif // LOOPBACK_CAL_HPP
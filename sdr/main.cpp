@@ -15,73 +15,275 @@ string chirp_loc;
 string output_dir;
 string save_loc;
 string gps_save_loc;
+string meta_save_loc;
+string pulse_times_loc; // Scheduled time of every pulse (empty to disable)
+ofstream pulse_time_file;
+
+// Raw capture mode: write pulses without inversion or presumming (see offline_presum)
+bool raw_capture;
+
+// Several RX channels (on one or more motherboards), each presummed into its own file
+bool multi_channel;
+unique_ptr<PhaseCodes> phase_codes; // Per-TX-channel phase codes, decoded per RX channel (null if every channel sends the same chirp)
+
+// SCHEDULE
+unique_ptr<PulseSchedule> schedule; // Waveform-agile pulse schedule (null for a single waveform)
+double base_freq;   // [Hz] RF0 center frequency, used by waveforms without their own
+double lo_offset;   // [Hz] RF0 LO offset, for stepped-frequency retunes
+string tuning_args; // RF0 tuning arguments, for stepped-frequency retunes
+
+// BUFFERS
+bool use_huge_pages; // Back RX sample buffers with 2 MB pages
+int numa_node;       // NUMA node to allocate RX sample buffers on (-1 to leave it to the kernel)
+
+// PUBLISH
+unique_ptr<TracePublisher> trace_publisher; // Live traces in shared memory for other processes (null if disabled)
+
+// QUICKLOOK
+unique_ptr<Quicklook> quicklook; // Low-rate live radargram (null if disabled)
+
+// NOISE_STATS
+unique_ptr<NoiseStats> noise_stats; // Online per-range-bin noise and SNR statistics (null if disabled)
+
+// CALIBRATION
+unique_ptr<LoopbackCalibrator> loopback_cal; // Averages loopback traces into a measured reference chirp (null if disabled)
+string loopback_cal_loc;   // Measured reference chirp written at the end of a loopback calibration run
+string reference_chirp_loc; // Measured reference chirp used instead of the ideal one for correlating (empty for the ideal one)
+double cal_sample_rate;    // [Hz] RX sample rate
+double cal_band_center;    // [Hz] Chirp center frequency relative to the RF center frequency
+double cal_bandwidth;      // [Hz]
+
+// DIRECT_PATH
+unique_ptr<DirectPathTracker> direct_path; // Direct path delay/amplitude/phase tracker (null if disabled)
+double direct_path_max_drift;   // [samples] Delay change since the first measurement before warning
+double direct_path_max_drop;    // [dB] Amplitude drop since the first measurement before warning
+
+// ALTIMETRY
+unique_ptr<Altimeter> altimeter; // Onboard surface/bed picking, published for the payload manager (null if disabled)
+
+// AGC
+AgcSettings agc_settings;
+unique_ptr<AgcController> agc; // Closed-loop RX gain control (null if disabled)
+
+// THREADS
+int num_rx_workers; // Number of worker threads for inversion and presumming (0 to do it in the RX thread)
+int rx_queue_depth; // Number of presum groups that may be in flight in the worker pool
+ThreadPlacement uhd_placement;    // UHD transport threads (created while the USRP is set up)
+ThreadPlacement rx_placement;     // Main RX loop
+ThreadPlacement tx_placement;     // TX scheduler thread
+ThreadPlacement rx_cmd_placement; // RX command scheduler thread
+ThreadPlacement worker_placement; // RX worker pool threads
+ThreadPlacement writer_placement; // RX worker pool writer thread
+ThreadPlacement tx_async_placement; // TX async message monitor thread
 
 // Calculated Parameters
 double tr_off_delay; // Time before turning off GPIO
 size_t num_tx_samps; // Total samples to transmit per chirp
 size_t num_rx_samps; // Total samples to receive per chirp
+double rx_time_tolerance; // [s] Largest difference between a pulse's RX timestamp and its scheduled time
+aligned_sample_vector tx_chirp; // Chirp samples before any phase modulation (read while the device starts up)
+
+// Global state (shared between the RX loop and the scheduler threads)
+atomic<long int> pulses_scheduled(0); // Number of RX commands issued
+atomic<long int> pulses_sent(0);      // Number of TX bursts sent
+atomic<long int> pulses_received(0);
+atomic<long int> error_count(0);
+atomic<long int> last_pulse_num_written(0); // Index number (pulses_received - error_count) of last sample written to outfile
+atomic<bool> rx_loop_done(false);     // Set once the RX loop exits, so scheduler threads never wait for pulses that won't come
+atomic<long int> fragmented_pulses(0); // Pulses that took more than one recv() call (RX threads)
+
+// Parameters that can change while running (see CONTROL). Each is only changed by the thread that applies it.
+atomic<int> num_presums;              // Pulses averaged into the trace currently being collected (RX thread)
+atomic<double> current_rx_gain;       // [dB] (RX command thread, or the AGC through it)
+atomic<double> current_tx_gain;       // [dB] (RX command thread)
+atomic<double> current_freq;          // [Hz] (RX command thread, changed by stepped-frequency schedules only)
+atomic<bool> transmit_enabled;        // (TX thread)
+unique_ptr<ChangeLog> change_log;     // Record of runtime changes (null if the control socket is disabled)
+unique_ptr<TxEventLog> tx_events;     // TX underflows and late bursts by pulse (null if not transmitting)
 
-// Global state
-long int pulses_scheduled = 0;
-long int pulses_received = 0;
-long int error_count = 0;
-long int last_pulse_num_written = -1; // Index number (pulses_received - error_count) of last sample written to outfile
-
-// Cout mutex
-std::mutex cout_mutex;
 
+/**
+ * @brief Receives one pulse into the RX buffers, from as many recv() calls as it takes
+ *
+ * Transport frames can be much smaller than the RX window: the pulse is assembled from fragments, each
+ * of which must continue the previous one's time_spec (see assemble_pulse()).
+ * @param sdr Sdr object used to receive samples
+ * @param rx_stream Streamer to receive from (every channel of the device, or those of one motherboard)
+ * @param buffs Start of the pulse buffer of each channel of the streamer
+ * @param fragment_buffs Scratch pointers, one per channel, allocated once by the caller
+ * @param num_samps Number of samples in the pulse
+ * @param rx_md Metadata of the pulse
+ * @return Number of samples received without a gap in the timestamps
+ */
+size_t receivePulse(Sdr& sdr, const rx_streamer::sptr& rx_stream, const vector<void *>& buffs, vector<void *>& fragment_buffs,
+                    size_t num_samps, rx_metadata_t& rx_md) {
+  size_t bytes_per_samp = convert::get_bytes_per_item(sdr.getCpuFormat());
+  auto recv_fragment = [&](size_t offset, size_t max_samps, rx_metadata_t& md) {
+    for (size_t ch = 0; ch < buffs.size(); ch++) {
+      fragment_buffs[ch] = (char *) buffs[ch] + offset * bytes_per_samp;
+    }
+    return rx_stream->recv(fragment_buffs, max_samps, md, 60.0, false); // TODO: Think about timeout
+  };
+  RxAssembly assembly = assemble_pulse(recv_fragment, num_samps, sdr.getRxRate(), rx_time_tolerance, rx_md);
+  if (assembly.num_fragments > 1) {
+    fragmented_pulses++;
+  }
+  return assembly.contiguous_samps;
+}
 
 /**
- * @brief Checks for errors in the RX buffer and adds the errors to a counter, before using transform() on the incoming pulse
+ * @brief Checks for errors in the RX buffer
  * 
- * checks for assorted unknown errors related to RX, checks for unexpected number of samples in the RX buffer, and then uses the transform() function if no errors are found
+ * checks for assorted unknown errors related to RX and for an unexpected number of samples in the RX buffer,
+ * printing a message for any error found. Does not update any counters.
  * @param n_samps_in_rx_buff Number of samples in the RX buffer
+ * @param expected_samps Number of samples requested for this pulse
+ * @param expected_time [s] Device time the pulse was scheduled for
  * @param rx_md Metadata from the RX stream
- * @param chirp Chirp object containing parameters for the chirp
- * @param buff Buffer for individual RX samples
- * @param sample_sum Sum error-free RX pulses
- * @param inversion_phase Phase to use for phase inversion of this chirp
+ * @return Returns true if the pulse is error-free, false otherwise
  */
-void handleRxBuffer(size_t n_samps_in_rx_buff, rx_metadata_t& rx_md, Chirp& chirp, vector<complex<float>>& buff, vector<complex<float>>& sample_sum, float& inversion_phase) {
-  if (chirp.getPhaseDither()) {
-    inversion_phase = -1.0 * get_next_phase(false); // Get next phase from the generator each time to keep in sequence with TX
-  }
-
+bool checkRxErrors(size_t n_samps_in_rx_buff, size_t expected_samps, double expected_time, rx_metadata_t& rx_md) {
+  int tx_event_codes = tx_events ? tx_events->claimPulse(pulses_received) : 0;
   if (rx_md.error_code != rx_metadata_t::ERROR_CODE_NONE){
     // Note: This print statement is used by automated post-processing code. Please be careful about changing the format.
     cout_mutex.lock();
     cout << "[ERROR] (Chirp " << pulses_received << ") Receiver error: " << rx_md.strerror() << "\n";
     cout_mutex.unlock();
-    
-    pulses_received++;
-    error_count++;
-  } else if (n_samps_in_rx_buff != num_rx_samps) {
+    return false;
+  } else if (n_samps_in_rx_buff != expected_samps) {
     // Unexpected number of samples received in buffer!
     // Note: This print statement is used by automated post-processing code. Please be careful about changing the format.
     cout_mutex.lock();
     cout << "[ERROR] (Chirp " << pulses_received << ") Unexpected number of samples in the RX buffer.";
-    cout << " Got: " << n_samps_in_rx_buff << " Expected: " << num_rx_samps << endl;
-    cout << "Note: rx_stream->recv can return less than the expected number of samples in some situations, ";
-    cout << "but it's not currently supported by this code." << endl;
+    cout << " Got: " << n_samps_in_rx_buff << " Expected: " << expected_samps << endl;
+    cout_mutex.unlock();
+    // Pulses are assembled from as many recv() calls as it takes (see receivePulse()), so this means the burst ended
+    // early, recv() timed out, or the fragments' timestamps had a gap (only the samples before it are counted).
+    // tune_transport measures which transport parameters work for this configuration and device.
+    return false;
+  } else if (rx_md.has_time_spec && fabs(rx_md.time_spec.get_real_secs() - expected_time) > rx_time_tolerance) {
+    // The samples don't belong to the pulse we think they do, so they can't be presummed with it
+    // Note: This print statement is used by automated post-processing code. Please be careful about changing the format.
+    cout_mutex.lock();
+    cout << "[ERROR] (Chirp " << pulses_received << ") Unexpected RX timestamp.";
+    cout << " Got: " << setprecision(12) << rx_md.time_spec.get_real_secs() << " Expected: " << expected_time << setprecision(6) << endl;
+    cout_mutex.unlock();
+    return false;
+  } else if (tx_event_codes != 0) {
+    // The transmitted chirp was corrupted (or not sent on time), so the echoes in this window are too
+    // Note: This print statement is used by automated post-processing code. Please be careful about changing the format.
+    cout_mutex.lock();
+    cout << "[ERROR] (Chirp " << pulses_received << ") Transmitter error: " << async_event_name(tx_event_codes) << endl;
     cout_mutex.unlock();
-    // If you encounter this error, one possible reason is that the buffer sizes set in your transport parameters are too small.
-    // For libUSB-based transport, recv_frame_size should be at least the size of num_rx_samps.
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Checks for errors in the RX buffer and adds the errors to a counter, before using transform() on the incoming pulse
+ * 
+ * checks for assorted unknown errors related to RX, checks for unexpected number of samples in the RX buffer, and then uses the transform() function if no errors are found
+ * @param n_samps_in_rx_buff Number of samples in the RX buffer
+ * @param rx_md Metadata from the RX stream
+ * @param expected_time [s] Device time the pulse was scheduled for
+ * @param chirp Chirp object containing parameters for the chirp
+ * @param buff Buffer for individual RX samples
+ * @param sample_sum Sum error-free RX pulses
+ * @param inversion_phase Phase to use for phase inversion of this chirp
+ */
+void handleRxBuffer(size_t n_samps_in_rx_buff, rx_metadata_t& rx_md, double expected_time, Chirp& chirp, complex<float>* buff, complex<float>* sample_sum, float& inversion_phase) {
+  if (chirp.getPhaseDither()) {
+    inversion_phase = -1.0 * get_next_phase(false); // Get next phase from the generator each time to keep in sequence with TX
+  }
 
+  if (!checkRxErrors(n_samps_in_rx_buff, num_rx_samps, expected_time, rx_md)) {
     pulses_received++;
     error_count++;
   } else {
     pulses_received++;
 
-    if (chirp.getPhaseDither()) {
-      // Undo phase modulation and divide by num_presums in one go
-      transform(buff.begin(), buff.end(), buff.begin(), std::bind1st(std::multiplies<complex<float>>(), polar((float) 1.0/chirp.getNumPresums(), inversion_phase)));
-    } else if (chirp.getNumPresums() != 1) {
-      // Only divide by num_presums
-      transform(buff.begin(), buff.end(), buff.begin(), std::bind1st(std::multiplies<complex<float>>(), 1.0/chirp.getNumPresums()));
-    }
+    // Undo phase modulation, divide by num_presums and add to sample_sum
+    presum_pulse(buff, sample_sum, num_rx_samps, num_presums, chirp.getPhaseDither(), inversion_phase);
+  }
+}
+
+/**
+ * @brief Writes a received pulse to file without any processing (raw capture mode)
+ * 
+ * Error accounting is the same as handleRxBuffer(), but instead of inverting and summing, error-free pulses
+ * are written straight from the RX buffer. A RawPulseRecord is written to the metadata file for every pulse
+ * (including error pulses) so that offline_presum can rebuild the dither sequence afterwards.
+ * @param n_samps_in_rx_buff Number of samples in the RX buffer
+ * @param rx_md Metadata from the RX stream
+ * @param expected_time [s] Device time the pulse was scheduled for
+ * @param buff Buffer for individual RX samples
+ * @param outfile Output file stream to write the raw RX data
+ * @param metafile Output file stream to write the pulse metadata
+ * @return Returns true if the data was successfully written to the file, false otherwise signaling error
+ */
+bool writeRawPulse(size_t n_samps_in_rx_buff, rx_metadata_t& rx_md, double expected_time, const complex<float>* buff, ofstream& outfile, ofstream& metafile) {
+  RawPulseRecord record;
+  record.pulse_index = pulses_received;
+  record.num_samps = n_samps_in_rx_buff;
+  record.rx_time = rx_md.has_time_spec ? rx_md.time_spec.get_real_secs() : 0.0;
+
+  bool pulse_ok = checkRxErrors(n_samps_in_rx_buff, num_rx_samps, expected_time, rx_md);
+  if (pulse_ok) {
+    record.error_code = RAW_ERROR_NONE;
+  } else if (rx_md.error_code != rx_metadata_t::ERROR_CODE_NONE) {
+    record.error_code = rx_md.error_code;
+  } else if (n_samps_in_rx_buff == num_rx_samps && tx_events && tx_events->getPulseEvents(pulses_received) != 0) {
+    record.error_code = RAW_ERROR_TX;
+  } else {
+    record.error_code = RAW_ERROR_SHORT_RECV;
+  }
+
+  pulses_received++;
+  if (!pulse_ok) {
+    error_count++;
+  }
+
+  if (!outfile.is_open() || !metafile.is_open()) {
+    cout_mutex.lock();
+    cout << "Cannot write to outfile!" << endl;
+    cout_mutex.unlock();
+    return false; // Error writing to file
+  }
+  metafile.write((const char*) &record, sizeof(RawPulseRecord));
+  if (pulse_ok) {
+    outfile.write((const char*) buff, num_rx_samps * sizeof(complex<float>));
+    last_pulse_num_written = pulses_received - error_count;
+  }
+  return true;
+}
 
-    // Add to sample_sum
-    transform(sample_sum.begin(), sample_sum.end(), buff.begin(), sample_sum.begin(), plus<complex<float>>());
+/**
+ * @brief Hands a finished trace to the live monitoring features (publisher, quicklook, noise statistics, direct path,
+ * altimetry)
+ *
+ * @param trace num_rx_samps presummed samples
+ * @param pulse_num Number of error-free pulses received up to and including this trace
+ * @param trace_presums Number of pulses averaged into the trace
+ */
+void monitorTrace(const complex<float>* trace, long int pulse_num, int trace_presums) {
+  if (trace_publisher) {
+    trace_publisher->publish(trace, pulse_num, error_count, trace_presums);
+  }
+  if (quicklook) {
+    quicklook->addTrace(trace);
+  }
+  if (noise_stats && noise_stats->addTrace(trace)) {
+    printNoiseStats();
+  }
+  if (direct_path && direct_path->addTrace(trace)) {
+    printDirectPath();
+  }
+  if (altimeter) {
+    altimeter->offer(trace, pulse_num);
+  }
+  if (loopback_cal) {
+    loopback_cal->addTrace(trace);
   }
 }
 
@@ -97,12 +299,12 @@ void handleRxBuffer(size_t n_samps_in_rx_buff, rx_metadata_t& rx_md, Chirp& chir
  * @param outfile Output file stream to write the RX data
  * @return Returns true if the data was successfully written to the file, false otherwise signaling error
  */
-bool checkForFullSampleSum(Chirp& chirp, vector<complex<float>>& sample_sum, ofstream& outfile) {
-  if (((pulses_received - error_count) > last_pulse_num_written) && ((pulses_received - error_count) % chirp.getNumPresums() == 0)) {
+bool checkForFullSampleSum(Chirp& chirp, complex<float>* sample_sum, ofstream& outfile) {
+  if ((pulses_received - error_count) - last_pulse_num_written == num_presums) {
     // As each sample is added, it has phase inversion applied and is divided by # presums, so no additional work to do here.
     // write RX data to file
     if (outfile.is_open()) {
-      outfile.write((const char*)&sample_sum.front(), 
+      outfile.write((const char*)sample_sum, 
         num_rx_samps * sizeof(complex<float>));
     } else {
       cout_mutex.lock();
@@ -110,12 +312,312 @@ bool checkForFullSampleSum(Chirp& chirp, vector<complex<float>>& sample_sum, ofs
       cout_mutex.unlock();
       return false; // Error writing to file
     }
-    fill(sample_sum.begin(), sample_sum.end(), complex<float>(0,0)); // Zero out sum for next time
+    monitorTrace(sample_sum, pulses_received - error_count, num_presums);
+    fill(sample_sum, sample_sum + num_rx_samps, complex<float>(0,0)); // Zero out sum for next time
     last_pulse_num_written = pulses_received - error_count;
   }
   return true;
 }
 
+/**
+ * @brief RX loop used when inversion and presumming are done by a worker pool
+ * 
+ * recv() writes each pulse straight into the current presum group, and the only per-pulse work left on this
+ * thread is error checking and drawing the next inversion phase from the RX dither sequence (which must stay
+ * sequential). Error pulses are simply overwritten by the next pulse. Once a group holds num_presums
+ * error-free pulses it is handed to the workers. Traces are written by the pool's writer thread.
+ * Only a single RX channel is supported (several channels use multiChannelRxLoop()).
+ * @param sdr Sdr object used to receive samples
+ * @param chirp Chirp object containing parameters for the chirp
+ * @param rx_pool Worker pool to hand full presum groups to
+ * @param timeline Pulse timeline (for runtime num_presums changes)
+ */
+void pooledRxLoop(Sdr& sdr, Chirp& chirp, RxWorkerPool& rx_pool, PulseTimeline& timeline) {
+  if (sdr.getRxStream()->get_num_channels() != 1) {
+    throw std::invalid_argument("The RX worker pool only supports a single RX channel.");
+  }
+  vector<void *> buffs(1);
+  vector<void *> fragment_buffs(buffs.size());
+  size_t n_samps_in_rx_buff;
+  rx_metadata_t rx_md;
+  float inversion_phase = 0;
+  long int pulses_submitted = 0;
+  PresumGroup* group = nullptr;
+
+  while ((chirp.getNumPulses() < 0) || (pulses_submitted < chirp.getNumPulses())) {
+    if (group == nullptr) {
+      if (change_log) {
+        applyPresumChange(timeline);
+      }
+      group = rx_pool.acquire();
+    }
+    buffs[0] = group->pulse(group->num_pulses);
+
+    n_samps_in_rx_buff = receivePulse(sdr, sdr.getRxStream(), buffs, fragment_buffs, num_rx_samps, rx_md);
+
+    if (chirp.getPhaseDither()) {
+      inversion_phase = -1.0 * get_next_phase(false); // Get next phase from the generator each time to keep in sequence with TX
+    }
+
+    if (!checkRxErrors(n_samps_in_rx_buff, num_rx_samps, timeline.getScheduledTime(pulses_received), rx_md)) {
+      pulses_received++;
+      error_count++;
+    } else {
+      pulses_received++;
+      group->inversion_phases[group->num_pulses++] = inversion_phase;
+      // Gain control looks at the first pulse of each presum group
+      if (agc && group->num_pulses == 1) {
+        agc->addMetrics(compute_trace_metrics(group->pulse(0), num_rx_samps, agc_settings.clip_level, pulses_received - 1));
+      }
+      if (group->num_pulses == num_presums) {
+        rx_pool.submit(group);
+        pulses_submitted += num_presums;
+        group = nullptr;
+      }
+    }
+
+    if (!rx_pool.ok()) {exit(1);};
+
+    // check if someone wants to stop
+    if (stop_signal_called) {
+      cout_mutex.lock();
+      cout << "[RX] Reached stop signal handling for outer RX loop -> break" << endl;
+      cout_mutex.unlock();
+      break;
+    }
+  }
+
+  // A partial group at the end is dropped, just like a partial sample_sum in the single-threaded loop
+  if (group != nullptr) {
+    rx_pool.release(group);
+  }
+}
+
+/**
+ * @brief RX loop used with a waveform-agile pulse schedule
+ *
+ * Each pulse is received with its waveform's RX window into the same (largest) buffer, then inverted and
+ * added into that waveform's stream, which writes its own file. The loop ends after num_pulses error-free
+ * pulses of any waveform, dropping unfinished traces. Live monitoring and gain control follow the first
+ * waveform of the schedule. Only a single RX channel is supported.
+ * @param sdr Sdr object used to receive samples
+ * @param chirp Chirp object containing parameters for the chirp
+ * @param buff Buffer holding at least the longest RX window
+ * @param streams One trace stream per waveform of the schedule
+ * @param timeline Pulse timeline (for the time each pulse was scheduled for)
+ */
+void scheduledRxLoop(Sdr& sdr, Chirp& chirp, complex<float>* buff, vector<unique_ptr<TraceStream>>& streams, PulseTimeline& timeline) {
+  if (sdr.getRxStream()->get_num_channels() != 1) {
+    throw std::invalid_argument("A waveform schedule only supports a single RX channel.");
+  }
+  vector<void *> buffs(1, buff);
+  vector<void *> fragment_buffs(buffs.size());
+  size_t n_samps_in_rx_buff;
+  rx_metadata_t rx_md;
+  float inversion_phase = 0;
+
+  while ((chirp.getNumPulses() < 0) || ((pulses_received - error_count) < chirp.getNumPulses())) {
+    size_t waveform_index = schedule->getWaveformIndex(pulses_received);
+    TraceStream& stream = *streams[waveform_index];
+
+    n_samps_in_rx_buff = receivePulse(sdr, sdr.getRxStream(), buffs, fragment_buffs, stream.getSamps(), rx_md);
+
+    if (chirp.getPhaseDither()) {
+      inversion_phase = -1.0 * get_next_phase(false); // Get next phase from the generator each time to keep in sequence with TX
+    }
+
+    if (!checkRxErrors(n_samps_in_rx_buff, stream.getSamps(), timeline.getScheduledTime(pulses_received), rx_md)) {
+      pulses_received++;
+      error_count++;
+    } else {
+      pulses_received++;
+      // Gain control looks at the first pulse of each presum group of the first waveform
+      if (agc && waveform_index == 0 && stream.getPulsesPending() == 0) {
+        agc->addMetrics(compute_trace_metrics(buff, num_rx_samps, agc_settings.clip_level, pulses_received - 1));
+      }
+      if (stream.addPulse(buff, chirp.getPhaseDither(), inversion_phase)) {
+        if (!stream.good()) {
+          cout_mutex.lock();
+          cout << "Cannot write to outfile!" << endl;
+          cout_mutex.unlock();
+          exit(1);
+        }
+        int trace_presums = schedule->getWaveform(waveform_index).num_presums;
+        last_pulse_num_written += trace_presums;
+        if (waveform_index == 0) {
+          monitorTrace(stream.getTrace(), last_pulse_num_written, trace_presums);
+        }
+      }
+    }
+
+    // check if someone wants to stop
+    if (stop_signal_called) {
+      cout_mutex.lock();
+      cout << "[RX] Reached stop signal handling for outer RX loop -> break" << endl;
+      cout_mutex.unlock();
+      break;
+    }
+  }
+
+  for (auto& stream : streams) {
+    if (stream->getPulsesPending() > 0) {
+      cout << "[RX] Dropped " << stream->getPulsesPending() << " pulses of an unfinished trace in " << stream->getFilename() << endl;
+    }
+    stream->close();
+    // Note: This print statement is used by automated post-processing code. Please be careful about changing the format.
+    cout << "[CLOSE FILE] " << stream->getFilename() << " (" << stream->getTracesWritten() << " traces)" << endl;
+  }
+}
+
+/**
+ * @brief RX loop used with several RX channels, on one or more motherboards
+ *
+ * Each RX streamer (one per motherboard) is received on its own thread (see StreamReceiver), so the
+ * transports of the boards are drained in parallel. The loop takes the pulses of all streamers in lockstep:
+ * a pulse is only used if every board received it without errors. Each channel is then inverted and added
+ * into its own stream, which writes its own file. With phase codes, each channel is decoded into one stream
+ * per TX channel instead. Live monitoring and gain control follow channel 0 (and TX channel 0).
+ * @param sdr Sdr object used to receive samples
+ * @param chirp Chirp object containing parameters for the chirp
+ * @param streams One trace stream per RX channel, or per RX and TX channel with phase codes
+ * @param timeline Pulse timeline (for the time each pulse was scheduled for)
+ */
+void multiChannelRxLoop(Sdr& sdr, Chirp& chirp, vector<unique_ptr<TraceStream>>& streams, PulseTimeline& timeline) {
+  vector<unique_ptr<StreamReceiver>> receivers;
+  for (const rx_streamer::sptr& rx_stream : sdr.getRxStreams()) {
+    vector<void *> fragment_buffs(rx_stream->get_num_channels());
+    auto recv_pulse = [&sdr, rx_stream, fragment_buffs](long int pulse, const vector<void *>& buffs, rx_metadata_t& md,
+                                                        const atomic<bool>& stopping) mutable -> size_t {
+      // Only wait in recv() for pulses that have been commanded, so the thread can stop at the end of the run
+      while (pulse >= pulses_scheduled) {
+        if (stopping) {
+          return 0;
+        }
+        this_thread::sleep_for(chrono::microseconds(100));
+      }
+      return receivePulse(sdr, rx_stream, buffs, fragment_buffs, num_rx_samps, md);
+    };
+    receivers.emplace_back(new StreamReceiver(rx_stream->get_num_channels(), num_rx_samps, chirp.getRxLookahead() + 2, recv_pulse,
+                                              []() { apply_thread_placement(rx_placement); }));
+  }
+  vector<vector<size_t>>& stream_channels = sdr.getRxStreamChannels();
+  vector<ReceivedPulse*> pulses(receivers.size());
+  float inversion_phase = 0;
+
+  // With phase codes, RX channel k has one stream per TX channel (streams[k * num_codes + t])
+  size_t num_codes = phase_codes ? phase_codes->getNumCodes() : 1;
+  vector<CodedTraceStreams> coded_streams;
+  for (size_t k = 0; k < streams.size() / num_codes; k++) {
+    vector<TraceStream*> channel_streams;
+    for (size_t t = 0; t < num_codes; t++) {
+      channel_streams.push_back(streams[k * num_codes + t].get());
+    }
+    coded_streams.emplace_back(channel_streams);
+  }
+  vector<complex<float>> decoders(num_codes);
+  // The codes only cancel if a trace holds every pulse of a code period equally often. An RX error drops a
+  // pulse from the trace, so such traces are counted and reported (unless num_presums already rules it out,
+  // which is warned about at startup).
+  size_t code_period = phase_codes ? phase_codes->getPeriod() : 0;
+  if (code_period > 0 && num_presums % code_period != 0) {
+    code_period = 0;
+  }
+  vector<int> period_counts(code_period, 0); // Pulses of the current trace at each position in the code period
+  long int crosstalk_traces = 0;
+
+  while ((chirp.getNumPulses() < 0) || ((pulses_received - error_count) < chirp.getNumPulses())) {
+    for (size_t s = 0; s < receivers.size(); s++) {
+      pulses[s] = receivers[s]->next();
+    }
+
+    if (chirp.getPhaseDither()) {
+      inversion_phase = -1.0 * get_next_phase(false); // Get next phase from the generator each time to keep in sequence with TX
+    }
+
+    bool pulse_ok = true;
+    for (size_t s = 0; s < receivers.size() && pulse_ok; s++) {
+      pulse_ok = checkRxErrors(pulses[s]->num_samps, num_rx_samps, timeline.getScheduledTime(pulses_received), pulses[s]->md);
+    }
+    pulses_received++;
+    if (!pulse_ok) {
+      error_count++;
+    } else {
+      // Gain control looks at the first pulse of each presum group of channel 0
+      if (agc && streams[0]->getPulsesPending() == 0) {
+        agc->addMetrics(compute_trace_metrics(pulses[0]->channels[0].data(), num_rx_samps, agc_settings.clip_level, pulses_received - 1));
+      }
+      if (phase_codes) {
+        // The phasors are combined rather than the phases, which would be lost next to a large dither phase
+        for (size_t t = 0; t < num_codes; t++) {
+          decoders[t] = polar(1.0f, chirp.getPhaseDither() ? inversion_phase : 0.0f) * polar(1.0f, -phase_codes->getPhase(t, pulses_received - 1));
+        }
+        if (code_period > 0) {
+          period_counts[(pulses_received - 1) % code_period]++;
+        }
+      }
+      bool trace_done = false;
+      for (size_t s = 0; s < receivers.size(); s++) {
+        for (size_t c = 0; c < stream_channels[s].size(); c++) {
+          if (phase_codes) {
+            trace_done = coded_streams[stream_channels[s][c]].addPulse(pulses[s]->channels[c].data(), decoders);
+          } else {
+            trace_done = streams[stream_channels[s][c]]->addPulse(pulses[s]->channels[c].data(), chirp.getPhaseDither(), inversion_phase);
+          }
+        }
+      }
+      if (trace_done) {
+        for (auto& stream : streams) {
+          if (!stream->good()) {
+            cout_mutex.lock();
+            cout << "Cannot write to outfile!" << endl;
+            cout_mutex.unlock();
+            exit(1);
+          }
+        }
+        last_pulse_num_written += num_presums;
+        monitorTrace(streams[0]->getTrace(), last_pulse_num_written, num_presums);
+        if (code_period > 0) {
+          if (*min_element(period_counts.begin(), period_counts.end()) != *max_element(period_counts.begin(), period_counts.end())) {
+            crosstalk_traces++;
+            cout_mutex.lock();
+            // Note: This print statement is used by automated post-processing code. Please be careful about changing the format.
+            cout << "[CODES] Trace " << streams[0]->getTracesWritten() - 1 << " does not cover whole code periods (RX errors): crosstalk between TX channels" << endl;
+            cout_mutex.unlock();
+          }
+          fill(period_counts.begin(), period_counts.end(), 0);
+        }
+      }
+    }
+
+    for (auto& receiver : receivers) {
+      receiver->release();
+    }
+
+    // check if someone wants to stop
+    if (stop_signal_called) {
+      cout_mutex.lock();
+      cout << "[RX] Reached stop signal handling for outer RX loop -> break" << endl;
+      cout_mutex.unlock();
+      break;
+    }
+  }
+
+  for (auto& receiver : receivers) {
+    receiver->stop();
+  }
+  if (crosstalk_traces > 0) {
+    cout << "[CODES] " << crosstalk_traces << " of " << streams[0]->getTracesWritten() << " traces have crosstalk between TX channels" << endl;
+  }
+  for (auto& stream : streams) {
+    if (stream->getPulsesPending() > 0) {
+      cout << "[RX] Dropped " << stream->getPulsesPending() << " pulses of an unfinished trace in " << stream->getFilename() << endl;
+    }
+    stream->close();
+    // Note: This print statement is used by automated post-processing code. Please be careful about changing the format.
+    cout << "[CLOSE FILE] " << stream->getFilename() << " (" << stream->getTracesWritten() << " traces)" << endl;
+  }
+}
+
 // Split output files based on number of chirps
 
 /**
@@ -159,24 +661,44 @@ void splitOutputFiles(Chirp& chirp, ofstream& outfile, string& current_filename,
  * @param error_count Total number of errors encountered during the RX process
  * @param last_pulse_num_written Last pulse number written to the file
  * @param pulses_received Total number of pulses received during the RX process
- * @param transmit_thread Thread group for the transmit worker
+ * @param scheduler_threads Thread group for the TX and RX command scheduler threads
  */
-void wrapUp(boost::asio::posix::stream_descriptor& gps_stream, ofstream& outfile, string& current_filename, boost::thread_group& transmit_thread) {
-  cout << "[RX] Closing output file." << endl;
-  outfile.close();
-  cout << "[CLOSE FILE] " << current_filename << endl;
+void wrapUp(boost::asio::posix::stream_descriptor& gps_stream, ofstream& outfile, string& current_filename, boost::thread_group& scheduler_threads) {
+  if (!schedule && !multi_channel) { // Per-waveform and per-channel streams are closed by their RX loop
+    cout << "[RX] Closing output file." << endl;
+    outfile.close();
+    cout << "[CLOSE FILE] " << current_filename << endl;
+  }
 
   gps_stream.close();
 
   cout << "[RX] Error count: " << error_count << endl;
   cout << "[RX] Total pulses written: " << last_pulse_num_written << endl;
   cout << "[RX] Total pulses attempted: " << pulses_received << endl;
+  cout << "[RX] Pulses received in several fragments: " << fragmented_pulses << endl;
   
-  cout << "[RX] Done. Calling join_all() on transmit thread group." << endl;
+  cout << "[RX] Done. Calling join_all() on scheduler thread group." << endl;
 
-  transmit_thread.join_all();
+  rx_loop_done = true;
+  scheduler_threads.join_all();
 
-  cout << "[RX] transmit_thread.join_all() complete." << endl << endl;
+  cout << "[RX] scheduler_threads.join_all() complete." << endl << endl;
+  if (tx_events) {
+    cout << "[TX ASYNC] Events: " << tx_events->getNumEvents() << " (underflows: " << tx_events->getNumEvents(async_metadata_t::EVENT_CODE_UNDERFLOW);
+    cout << ", sequence errors: " << tx_events->getNumEvents(async_metadata_t::EVENT_CODE_SEQ_ERROR);
+    cout << ", late bursts: " << tx_events->getNumEvents(async_metadata_t::EVENT_CODE_TIME_ERROR) << "), ";
+    cout << tx_events->getNumLateEvents() << " reported too late to drop their pulse" << endl;
+  }
+  if (pulse_time_file.is_open()) {
+    pulse_time_file.close(); // Written by the RX command thread
+  }
+  if (altimeter) {
+    altimeter->stop();
+    cout << "[ALT] Picks: " << altimeter->getNumPicks() << endl;
+  }
+  if (loopback_cal) {
+    saveLoopbackCalibration();
+  }
 }
 
 /* 
@@ -197,8 +719,42 @@ int UHD_SAFE_MAIN(int argc, char *argv[]) {
   Sdr sdr(yaml_filename);
   Chirp chirp(yaml_filename);
   YAML::Node config = YAML::LoadFile(yaml_filename);
-  sdr.createUsrp();
-  sdr.setupUsrp();
+
+  YAML::Node threads = config["THREADS"];
+  num_rx_workers = threads["num_rx_workers"].as<int>(0);
+  rx_queue_depth = threads["rx_queue_depth"].as<int>(2 * num_rx_workers + 2);
+  if (num_rx_workers < 0 || (num_rx_workers > 0 && rx_queue_depth < 1)) {
+    throw std::invalid_argument("num_rx_workers must be >= 0 and rx_queue_depth must be >= 1.");
+  }
+  auto read_placement = [&threads](const string& name) {
+    return parse_thread_placement(name, threads[name + "_cores"].as<string>(""), threads[name + "_priority"].as<int>(0));
+  };
+  uhd_placement = read_placement("uhd");
+  rx_placement = read_placement("rx");
+  tx_placement = read_placement("tx");
+  rx_cmd_placement = read_placement("rx_cmd");
+  worker_placement = read_placement("worker");
+  writer_placement = read_placement("writer");
+  tx_async_placement = read_placement("tx_async");
+  print_thread_placement({uhd_placement, rx_placement, tx_placement, rx_cmd_placement, worker_placement, writer_placement, tx_async_placement});
+
+  // The device is brought up in the background while the output files and TX waveform are prepared below.
+  // UHD starts its transport threads while the USRP and streamers are set up, and they inherit
+  // the CPU set of the thread doing it, so that thread gets the uhd placement.
+  if (sdr.getCpuFormat() != "fc32") {
+    cout << "Only cpu_format 'fc32' is supported for now." << endl;
+    // This is because we actually need chirp_unmodulated to have the correct
+    // data type to facilitate phase modulation. In the future, this could be
+    // fixed up so that it can work with any supported cpu_format, but it
+    // seems unnecessary right now.
+    exit(1);
+  }
+  StartupTimer& startup_timer = sdr.getStartupTimer();
+  future<void> device_setup = async(launch::async, [&sdr]() {
+    apply_thread_placement(uhd_placement);
+    sdr.createUsrp();
+    sdr.setupUsrp();
+  });
 
   //YAML::Node rf0 = config["RF0"];
  // YAML::Node rf1 = config["RF1"];
@@ -209,16 +765,161 @@ int UHD_SAFE_MAIN(int argc, char *argv[]) {
   save_loc = files["save_loc"].as<string>();
   gps_save_loc = files["gps_loc"].as<string>();
   chirp.setMaxChirpsPerFile(files["max_chirps_per_file"].as<int>());
+  raw_capture = files["raw_capture"].as<bool>(false);
+  meta_save_loc = files["meta_loc"].as<string>("rx_meta.bin");
+  pulse_times_loc = files["pulse_times_loc"].as<string>("");
+
+  // Staggered and/or jittered pulse spacing (uniform by default)
+  YAML::Node chirp_config = config["CHIRP"];
+  PriSequence pri_sequence(chirp_config["pri_stagger"].as<vector<double>>(vector<double>()),
+                           chirp_config["pri_jitter"].as<double>(0), chirp_config["pri_jitter_seed"].as<uint64_t>(0));
+
+  bool use_schedule = config["SCHEDULE"]["enabled"].as<bool>(false);
+  if (use_schedule && raw_capture) {
+    throw std::invalid_argument("A waveform schedule can't be used in raw capture mode.");
+  }
+
+  // With several RX channels (e.g. channels of several motherboards) each channel gets its own file
+  vector<string> rx_channel_list;
+  boost::split(rx_channel_list, sdr.getRxChannels(), boost::is_any_of("\"',"));
+  multi_channel = (rx_channel_list.size() > 1);
+  if (multi_channel && (use_schedule || raw_capture)) {
+    throw std::invalid_argument("Several RX channels can't be used with a waveform schedule or in raw capture mode.");
+  }
+
+  // Phase codes that let each RX channel separate the TX channels (one code per TX channel)
+  string phase_code_family = chirp_config["tx_phase_codes"].as<string>("");
+  if (!phase_code_family.empty()) {
+    vector<string> tx_channel_list;
+    boost::split(tx_channel_list, sdr.getTxChannels(), boost::is_any_of("\"',"));
+    if (!multi_channel || tx_channel_list.size() < 2 || !sdr.getTransmit()) {
+      throw std::invalid_argument("tx_phase_codes needs several TX and RX channels with transmit enabled.");
+    }
+    phase_codes.reset(new PhaseCodes(parse_phase_code_family(phase_code_family), tx_channel_list.size(),
+                                     chirp_config["tx_phase_code_seed"].as<uint64_t>(0)));
+  }
+
+  YAML::Node buffers = config["BUFFERS"];
+  use_huge_pages = buffers["huge_pages"].as<bool>(false);
+  numa_node = buffers["numa_node"].as<int>(-1);
+  string numa_device = buffers["numa_device"].as<string>("");
+  if (!numa_device.empty()) {
+    numa_node = numa_node_of_device(numa_device);
+    if (numa_node < 0) {
+      cout << "WARNING: Could not find the NUMA node of " << numa_device << ". RX buffers will not be bound to a node." << endl;
+    }
+  }
 
-  //Merge save_loc and gps_save_loc with output_dir
+  //Merge save_loc, gps_save_loc and meta_save_loc with output_dir
   save_loc = std::filesystem::path(output_dir).string() + "/" + save_loc;
   gps_save_loc = std::filesystem::path(output_dir).string() + "/" + gps_save_loc;
+  meta_save_loc = std::filesystem::path(output_dir).string() + "/" + meta_save_loc;
+  if (!pulse_times_loc.empty()) {
+    pulse_times_loc = std::filesystem::path(output_dir).string() + "/" + pulse_times_loc;
+  }
 
   // Calculated parameters
 
   tr_off_delay = chirp.getTxDuration() + chirp.getTrOffTrail(); // Time before turning off GPIO
+  num_presums = chirp.getNumPresums();
+  current_rx_gain = sdr.getAppliedRxGain();
+  current_tx_gain = sdr.getAppliedTxGain();
+  base_freq = config["RF0"]["freq"].as<double>();
+  lo_offset = config["RF0"]["lo_offset"].as<double>(0.0);
+  tuning_args = config["RF0"]["tuning_args"].as<string>("");
+  current_freq = base_freq;
+  transmit_enabled = sdr.getTransmit();
   num_tx_samps = sdr.getTxRate() * chirp.getTxDuration(); // Total samples to transmit per chirp // TODO: Should use ["GENERATE"]["sample_rate"] instead!
   num_rx_samps = sdr.getRxRate() * chirp.getRxDuration(); // Total samples to receive per chirp // TODO: Should use ["GENERATE"]["sample_rate"] instead!
+  rx_time_tolerance = 1.0 / sdr.getRxRate(); // Commanded times are rounded to device clock ticks
+
+  /*** HOST PREPARATION (while the device starts up) ***/
+  // Nothing here may use the device or print (the setup thread is printing). Errors are thrown instead: the
+  // exception only reaches UHD_SAFE_MAIN once device_setup's destructor has waited for the setup thread.
+  double host_start_time = startup_timer.elapsed();
+
+  if (save_loc[0] != '/') {
+    save_loc = "../../" + save_loc;
+  }
+  if (gps_save_loc[0] != '/') {
+    gps_save_loc = "../../" + gps_save_loc;
+  }
+  if (meta_save_loc[0] != '/') {
+    meta_save_loc = "../../" + meta_save_loc;
+  }
+  if (!pulse_times_loc.empty() && pulse_times_loc[0] != '/') {
+    pulse_times_loc = "../../" + pulse_times_loc;
+  }
+
+  // Generate every waveform of the schedule. Monitoring features (publisher, quicklook, noise statistics, AGC)
+  // follow the first waveform.
+  if (use_schedule) {
+    schedule.reset(new PulseSchedule(config, sdr.getTxRate(), sdr.getRxRate()));
+    num_rx_samps = schedule->getWaveform(0).num_rx_samps;
+  }
+
+  // open file for writing rx samples (one per waveform with a schedule, one per channel with several RX channels)
+  ofstream outfile;
+  int save_file_index = 0;
+  string current_filename = save_loc;
+  vector<unique_ptr<TraceStream>> trace_streams;
+  if (schedule) {
+    for (size_t i = 0; i < schedule->getNumWaveforms(); i++) {
+      const Waveform& waveform = schedule->getWaveform(i);
+      trace_streams.emplace_back(new TraceStream(stream_filename(save_loc, waveform.name), waveform.num_rx_samps, waveform.num_presums));
+      if (chirp.getNumPulses() > 0) {
+        long int pulses_in_file = chirp.getNumPulses() * schedule->getSequenceCount(i) / schedule->getSequenceLength();
+        preallocate_file(trace_streams.back()->getFilename(), (pulses_in_file / waveform.num_presums) * waveform.num_rx_samps * sizeof(complex<float>));
+      }
+    }
+  } else if (multi_channel) {
+    for (size_t k = 0; k < rx_channel_list.size(); k++) {
+      for (size_t t = 0; t < (phase_codes ? phase_codes->getNumCodes() : 1); t++) {
+        string name = "ch" + to_string(k) + (phase_codes ? "_tx" + to_string(t) : "");
+        trace_streams.emplace_back(new TraceStream(stream_filename(save_loc, name), num_rx_samps, num_presums));
+        if (chirp.getNumPulses() > 0) {
+          preallocate_file(trace_streams.back()->getFilename(), (chirp.getNumPulses() / num_presums) * num_rx_samps * sizeof(complex<float>));
+        }
+      }
+    }
+  } else if (chirp.getMaxChirpsPerFile() > 0) {
+    // Breaking into multiple files is enabled
+    current_filename = current_filename + "." + to_string(save_file_index);
+  }
+  if (trace_streams.empty()) {
+    outfile.open(current_filename, ofstream::binary);
+  }
+
+  // Reserve disk space for the first file, so the writer doesn't allocate blocks while recording
+  if (trace_streams.empty() && chirp.getNumPulses() > 0) {
+    long int pulses_in_file = chirp.getNumPulses();
+    if (chirp.getMaxChirpsPerFile() > 0) {
+      pulses_in_file = min(pulses_in_file, (long int) chirp.getMaxChirpsPerFile());
+    }
+    long int traces_in_file = raw_capture ? pulses_in_file : pulses_in_file / chirp.getNumPresums();
+    preallocate_file(current_filename, traces_in_file * num_rx_samps * sizeof(complex<float>));
+  }
+
+  // open file for writing pulse metadata (raw capture mode only)
+  ofstream metafile;
+  if (raw_capture) {
+    metafile.open(meta_save_loc, ofstream::binary);
+  }
+
+  // open file for the time of every pulse, as scheduled by the RX command thread
+  if (!pulse_times_loc.empty()) {
+    pulse_time_file.open(pulse_times_loc, ofstream::binary);
+  }
+
+  if (sdr.getTransmit() && !schedule) {
+    tx_chirp = loadTxChirp(sdr, config["GENERATE"]);
+  }
+  startup_timer.record("files and TX waveform", host_start_time);
+
+  double wait_start_time = startup_timer.elapsed();
+  device_setup.get();
+  startup_timer.record("wait for device", wait_start_time);
+  startup_timer.print();
 
 
   /** Thread, interrupt setup **/
@@ -234,40 +935,123 @@ int UHD_SAFE_MAIN(int argc, char *argv[]) {
                                      //                  Second number: Increment for any changes that you expect to matter to post-processing
                                      //                  Third number:  Increment for any change
   // Human-readable notes -- explain notable behavior for humans
-  cout << "Note: Phase inversion is performed in this code." << endl;
-  cout << "Note: Pre-summing is supported. If used, each sample written will have num_presums error-free samples averaged in." << endl;
+  if (raw_capture) {
+    cout << "Note: Raw capture mode. Phase inversion and pre-summing are NOT performed in this code." << endl;
+    cout << "Note: Each error-free pulse is written as received. Pulse metadata is written to " << meta_save_loc << endl;
+    cout << "Note: Use offline_presum to produce the same output as a normal run." << endl;
+  } else {
+    cout << "Note: Phase inversion is performed in this code." << endl;
+    cout << "Note: Pre-summing is supported. If used, each sample written will have num_presums error-free samples averaged in." << endl;
+  }
   cout << "Note: Nothing is written to the file for error pulses." << endl;
   cout << "Note: A full num_pulses of error-free chirp data will be collected. ";
   cout << "(Total number of TX chirps will be num_pulses + # errors)" << endl; 
   
-  cout << "INFO: Number of TX samples: " << num_tx_samps << endl;  //needs to be after chirp and sdr object are both made
-  cout << "INFO: Number of RX samples: " << num_rx_samps << endl << endl;  //needs to be after chirp and sdr object are both made
+  if (schedule) {
+    cout << "Note: Waveform schedule. Pulses cycle through " << schedule->getSequenceLength() << " slots, and the traces of each waveform are written to their own file." << endl;
+    cout << "Note: num_pulses counts error-free pulses of all waveforms. Monitoring and gain control follow waveform '" << schedule->getWaveform(0).name << "'." << endl;
+    for (size_t i = 0; i < schedule->getNumWaveforms(); i++) {
+      const Waveform& waveform = schedule->getWaveform(i);
+      cout << "INFO: Waveform '" << waveform.name << "': " << waveform.num_tx_samps << " TX samples, " << waveform.num_rx_samps;
+      cout << " RX samples, " << waveform.num_presums << " presums, " << schedule->getSequenceCount(i) << " of every ";
+      cout << schedule->getSequenceLength() << " pulses";
+      cout << ", RX gain " << (isnan(waveform.rx_gain) ? sdr.getAppliedRxGain() : waveform.rx_gain) << " dB";
+      cout << ", TX gain " << (isnan(waveform.tx_gain) ? sdr.getAppliedTxGain() : waveform.tx_gain) << " dB";
+      cout << ", " << (isnan(waveform.freq) ? base_freq : waveform.freq) / 1e6 << " MHz" << endl;
+    }
+    if (chirp.getMaxChirpsPerFile() > 0) {
+      cout << "WARNING: max_chirps_per_file is ignored with a waveform schedule." << endl;
+    }
+    if (num_rx_workers > 0) {
+      cout << "WARNING: The RX worker pool is not used with a waveform schedule." << endl;
+    }
+    cout << endl;
+  } else {
+    if (multi_channel) {
+      cout << "Note: " << rx_channel_list.size() << " RX channels, each written to its own file. A pulse is dropped on every channel if any channel has an error." << endl;
+      cout << "Note: Monitoring and gain control follow channel 0." << endl;
+      if (phase_codes) {
+        cout << "Note: Each TX channel adds its own " << phase_code_family << " phase code. Each RX channel is decoded into one file per TX channel." << endl;
+        if (phase_codes->getPeriod() > 0 && num_presums % phase_codes->getPeriod() != 0) {
+          cout << "WARNING: num_presums is not a multiple of the " << phase_codes->getPeriod() << " pulses the phase codes are orthogonal over. Every trace will have crosstalk between TX channels." << endl;
+        } else if (phase_codes->getPeriod() > 0) {
+          cout << "Note: Traces that lose a pulse to an RX error don't cover whole code periods and are reported with [CODES]." << endl;
+        }
+      }
+      if (chirp.getMaxChirpsPerFile() > 0) {
+        cout << "WARNING: max_chirps_per_file is ignored with several RX channels." << endl;
+      }
+      if (num_rx_workers > 0) {
+        cout << "WARNING: The RX worker pool is not used with several RX channels." << endl;
+      }
+    }
+    cout << "INFO: Number of TX samples: " << num_tx_samps << endl;  //needs to be after chirp and sdr object are both made
+    cout << "INFO: Number of RX samples: " << num_rx_samps << endl << endl;  //needs to be after chirp and sdr object are both made
+  }
 
  
   // update the offset time for start of streaming to be offset from the current usrp time
   chirp.setTimeOffset(chirp.getTimeOffset() + time_spec_t(sdr.getUsrp()->get_time_now()).get_real_secs());  //needs to be after chirp and sdr object are both made
 
-  /*** SPAWN THE TX THREAD ***/
-  boost::thread_group transmit_thread;
-  transmit_thread.create_thread(boost::bind(&transmit_worker, sdr.getTxStream(), sdr.getRxStream(), boost::ref(chirp), boost::ref(sdr)));
-  
-  if (!sdr.getTransmit()) {
-    cout << "WARNING: Transmit disabled by configuration file!" << endl;
-  }
-
+  /*** AUTOMATIC GAIN CONTROL ***/
+  YAML::Node agc_config = config["AGC"];
+  if (agc_config["enabled"].as<bool>(false)) {
+    if (raw_capture) {
+      cout << "WARNING: Automatic gain control is not available in raw capture mode." << endl;
+    } else if (schedule && schedule->stagesRxGain()) {
+      cout << "WARNING: Automatic gain control is not available with RX gain staging." << endl;
+    } else {
+      gain_range_t gain_range = sdr.getUsrp()->get_rx_gain_range(sdr.getRxChannelNums().front());
+      agc_settings.target_peak = agc_config["target_peak"].as<double>(0.3);
+      agc_settings.max_clip_fraction = agc_config["max_clip_fraction"].as<double>(1e-4);
+      agc_settings.clip_level = agc_config["clip_level"].as<float>(0.95);
+      agc_settings.max_step = agc_config["max_step"].as<double>(3);
+      agc_settings.hysteresis = agc_config["hysteresis"].as<double>(1);
+      agc_settings.min_gain = agc_config["min_gain"].as<double>(gain_range.start());
+      agc_settings.max_gain = agc_config["max_gain"].as<double>(gain_range.stop());
+      agc_settings.window = agc_config["window"].as<int>(8);
+      if (agc_settings.target_peak <= 0 || agc_settings.target_peak > 1 || agc_settings.max_step <= 0 ||
+          agc_settings.min_gain > agc_settings.max_gain || agc_settings.window < 1) {
+        throw std::invalid_argument("Invalid AGC settings.");
+      }
+      string gain_log_loc = std::filesystem::path(output_dir).string() + "/" + agc_config["log"].as<string>("gain_log.csv");
+      agc.reset(new AgcController(agc_settings, sdr.getAppliedRxGain(), gain_log_loc));
+      cout << "INFO: Automatic gain control between " << agc_settings.min_gain << " and " << agc_settings.max_gain;
+      cout << " dB, gain changes logged to " << gain_log_loc << endl;
+    }
+  }
+
+  /*** SPAWN THE SCHEDULER THREADS ***/
+  // Both threads take pulse times from the same timeline. The TX thread keeps the TX burst queue full
+  // and the RX command thread issues timed RX commands, so a blocking send() never delays an RX command.
+  if (!(pri_sequence.getMinSpacing(chirp.getPulseRepInt()) > requiredPulseSpacing(chirp))) {
+    throw std::invalid_argument("Pulses can be " + to_string(pri_sequence.getMinSpacing(chirp.getPulseRepInt())) + " s apart (pulse_rep_int, pri_stagger, " +
+                                "pri_jitter), but TX/RX windows and gain settling need more than " + to_string(requiredPulseSpacing(chirp)) + " s.");
+  }
+  if (!pri_sequence.isUniform()) {
+    cout << "INFO: Staggered/jittered pulse spacing, shortest " << pri_sequence.getMinSpacing(chirp.getPulseRepInt()) << " s" << endl;
+  }
+  PulseTimeline timeline(chirp.getTimeOffset(), chirp.getPulseRepInt(), pri_sequence);
+  usrp::multi_usrp::sptr usrp = sdr.getUsrp();
+  DeviceClock device_clock([usrp]() { return usrp->get_time_now().get_real_secs(); });
+  LatenessStats tx_lateness("[TX]");
+  LatenessStats rx_cmd_lateness("[RX CMD]");
+
+  boost::thread_group scheduler_threads;
+  scheduler_threads.create_thread(boost::bind(&rx_command_worker, boost::ref(chirp), boost::ref(sdr), boost::ref(timeline), boost::ref(device_clock), boost::ref(rx_cmd_lateness)));
+  if (sdr.getTransmit()) {
+    tx_events.reset(new TxEventLog());
+    scheduler_threads.create_thread(boost::bind(&tx_worker, sdr.getTxStream(), boost::ref(chirp), boost::ref(sdr), boost::ref(timeline), boost::ref(device_clock), boost::ref(tx_lateness)));
+    scheduler_threads.create_thread(boost::bind(&tx_async_worker, sdr.getTxStream(), boost::ref(chirp), boost::ref(timeline)));
+  } else {
+    cout << "WARNING: Transmit disabled by configuration file!" << endl;
+  }
+
   //////////////////////////////////////////////////////////////////////////////////////////
 
   /*** FILE WRITE SETUP ***/
   boost::asio::io_service ioservice;
 
-  
-  if (save_loc[0] != '/') {
-    save_loc = "../../" + save_loc;
-  }
-  if (gps_save_loc[0] != '/') {
-    gps_save_loc = "../../" + gps_save_loc;
-  }
-
   int gps_file = open(gps_save_loc.c_str(), O_CREAT | O_WRONLY | O_TRUNC, S_IRWXU);
   if (gps_file == -1) {
       throw std::runtime_error("Failed to open GPS file: " + gps_save_loc);
@@ -284,18 +1068,15 @@ int UHD_SAFE_MAIN(int argc, char *argv[]) {
 
   
 
-  // open file for writing rx samples
-  ofstream outfile;
-  int save_file_index = 0;
-  string current_filename = save_loc;
-  if (chirp.getMaxChirpsPerFile() > 0) {
-    // Breaking into multiple files is enabled
-    current_filename = current_filename + "." + to_string(save_file_index);
-  }
-
+  // The first output file was opened during startup
   // Note: This print statement is used by automated post-processing code. Please be careful about changing the format.
-  cout << "[OPEN FILE] " << current_filename << endl;
-  outfile.open(current_filename, ofstream::binary);
+  if (!trace_streams.empty()) {
+    for (auto& stream : trace_streams) {
+      cout << "[OPEN FILE] " << stream->getFilename() << endl;
+    }
+  } else {
+    cout << "[OPEN FILE] " << current_filename << endl;
+  }
 
   /*** RX LOOP AND SUM ***/
   if (chirp.getNumPulses() < 0) {
@@ -313,102 +1094,481 @@ int UHD_SAFE_MAIN(int argc, char *argv[]) {
     exit(1);
   }
 
-  // receive buffer
-  size_t bytes_per_sample = convert::get_bytes_per_item(sdr.getCpuFormat());
-  vector<complex<float>> sample_sum(num_rx_samps, 0); // Sum error-free RX pulses into this vector
+  // receive buffers
+  // All RX sample buffers come from one aligned region (optionally huge pages bound to the NUMA node of the
+  // SDR's NIC or USB controller) that is shared by the RX, processing and writer stages.
+  bool use_rx_pool = (num_rx_workers > 0 && !raw_capture && !schedule && !multi_channel);
+  size_t num_rx_buffers = use_rx_pool ? rx_queue_depth * (chirp.getNumPresums() + 1) : 2; // Runtime changes can only lower num_presums
+  size_t rx_buffer_samps = schedule ? schedule->getMaxRxSamps() : num_rx_samps; // Every RX window of the schedule fits
+  SampleBufferPool rx_buffers(rx_buffer_samps, num_rx_buffers, use_huge_pages, numa_node);
+  cout << "INFO: RX sample buffers: " << num_rx_buffers << " x " << rx_buffer_samps << " samples (";
+  cout << rx_buffers.getRegionBytes() / (1024 * 1024) << " MiB, " << rx_buffers.getPageType() << " pages, NUMA node ";
+  cout << rx_buffers.getNumaNode() << ")" << endl;
+
+  YAML::Node publish = config["PUBLISH"];
+  string shm_name = publish["shm_name"].as<string>("");
+  if (!shm_name.empty()) {
+    if (raw_capture) {
+      cout << "WARNING: Live traces are not published in raw capture mode." << endl;
+    } else {
+      int shm_slots = publish["shm_slots"].as<int>(64);
+      if (shm_slots < 1) {
+        throw std::invalid_argument("shm_slots must be >= 1.");
+      }
+      trace_publisher.reset(new TracePublisher(shm_name, num_rx_samps, shm_slots));
+      cout << "INFO: Publishing live traces to shared memory " << trace_publisher->getName() << " (";
+      cout << trace_publisher->getRegionBytes() / (1024 * 1024) << " MiB)" << endl;
+    }
+  }
+
+  // Time between the traces seen by the monitoring features
+  double trace_period = chirp.getPulseRepInt() * chirp.getNumPresums();
+  if (schedule) {
+    trace_period = chirp.getPulseRepInt() * schedule->getWaveform(0).num_presums * schedule->getSequenceLength() / schedule->getSequenceCount(0);
+  }
+
+  YAML::Node quicklook_config = config["QUICKLOOK"];
+  if (quicklook_config["enabled"].as<bool>(false) && !raw_capture) {
+    string quicklook_loc = quicklook_config["file"].as<string>("quicklook.bin");
+    if (std::filesystem::path(quicklook_loc).is_relative()) {
+      quicklook_loc = std::filesystem::path(output_dir).string() + "/" + quicklook_loc;
+    }
+    double row_rate = quicklook_config["row_rate"].as<double>(2);
+    int traces_per_row = max(1, (int) round(1.0 / (row_rate * trace_period)));
+    int width = min((int) num_rx_samps, quicklook_config["width"].as<int>(256));
+    int num_rows = quicklook_config["num_rows"].as<int>(1024);
+    if (row_rate <= 0 || width < 1 || num_rows < 1) {
+      throw std::invalid_argument("Quicklook row_rate, width and num_rows must be > 0.");
+    }
+    quicklook.reset(new Quicklook(quicklook_loc, num_rx_samps, width, num_rows, traces_per_row, traces_per_row * trace_period));
+    cout << "INFO: Quicklook: " << width << " range bins, " << traces_per_row << " traces per row (";
+    cout << 1.0 / (traces_per_row * trace_period) << " rows/s) written to " << quicklook_loc << endl;
+  }
+
+  YAML::Node noise_config = config["NOISE_STATS"];
+  if (noise_config["enabled"].as<bool>(false) && !raw_capture) {
+    string noise_loc = std::filesystem::path(output_dir).string() + "/" + noise_config["file"].as<string>("noise_stats.bin");
+    double interval = noise_config["interval"].as<double>(1.0);
+    int decimation = noise_config["decimation"].as<int>(1);
+    int traces_per_summary = max(2, (int) round(interval / trace_period));
+    if (interval <= 0 || decimation < 1) {
+      throw std::invalid_argument("Noise statistics interval must be > 0 and decimation must be >= 1.");
+    }
+    noise_stats.reset(new NoiseStats(noise_loc, num_rx_samps, decimation, traces_per_summary));
+    cout << "INFO: Noise statistics: every " << decimation << " samples, " << traces_per_summary;
+    cout << " traces per summary, written to " << noise_loc << endl;
+  }
+
+  // Loopback calibration (with the ideal chirp), then the reference every correlating feature below uses
+  YAML::Node cal_config = config["CALIBRATION"];
+  if (cal_config["loopback"].as<bool>(false) && !raw_capture) {
+    if (schedule || multi_channel || !sdr.getTransmit()) {
+      throw std::invalid_argument("Loopback calibration needs a single transmitted waveform on one RX channel (no SCHEDULE).");
+    }
+    loopback_cal_loc = cal_config["output"].as<string>("reference_chirp.bin");
+    if (std::filesystem::path(loopback_cal_loc).is_relative()) {
+      loopback_cal_loc = std::filesystem::path(output_dir).string() + "/" + loopback_cal_loc;
+    }
+    ChirpParams chirp_params = load_chirp_params(config["GENERATE"]);
+    cal_sample_rate = sdr.getRxRate();
+    cal_band_center = chirp_params.lo_offset_sw;
+    cal_bandwidth = chirp_params.chirp_bandwidth;
+    loopback_cal.reset(new LoopbackCalibrator(rxReferenceChirp(sdr, config["GENERATE"]), num_rx_samps, cal_sample_rate,
+                                              cal_band_center, cal_bandwidth));
+    cout << "INFO: Loopback calibration: averaging every trace of the run (loop TX back into RX through an attenuator), ";
+    cout << "reference chirp written to " << loopback_cal_loc << endl;
+  }
+  reference_chirp_loc = cal_config["reference"].as<string>("");
+  if (!reference_chirp_loc.empty()) {
+    if (std::filesystem::path(reference_chirp_loc).is_relative()) {
+      reference_chirp_loc = "../../" + reference_chirp_loc;
+    }
+    cout << "INFO: Correlating with the measured reference chirp " << reference_chirp_loc << endl;
+  }
+
+  YAML::Node direct_config = config["DIRECT_PATH"];
+  if (direct_config["enabled"].as<bool>(false) && !raw_capture) {
+    if (schedule || !sdr.getTransmit()) {
+      throw std::invalid_argument("The direct path tracker needs a single transmitted waveform (no SCHEDULE).");
+    }
+    string direct_loc = std::filesystem::path(output_dir).string() + "/" + direct_config["file"].as<string>("direct_path.bin");
+    double interval = direct_config["interval"].as<double>(0.5);
+    int window = direct_config["window"].as<int>(16);
+    direct_path_max_drift = direct_config["max_drift"].as<double>(0.25);
+    direct_path_max_drop = direct_config["max_amplitude_drop"].as<double>(6);
+    if (interval <= 0 || window < 1) {
+      throw std::invalid_argument("Direct path interval must be > 0 and window must be >= 1.");
+    }
+    vector<complex<float>> reference = rxReferenceChirp(sdr, config["GENERATE"]);
+    double expected_delay = direct_config["expected_delay"].as<double>(0) * sdr.getRxRate();
+    int traces_per_measurement = max(1, (int) round(interval / trace_period));
+    direct_path.reset(new DirectPathTracker(direct_loc, reference, num_rx_samps, expected_delay, window, traces_per_measurement));
+    cout << "INFO: Direct path tracker: +/- " << window << " samples around sample " << expected_delay << ", ";
+    cout << traces_per_measurement << " traces per measurement, written to " << direct_loc << endl;
+  }
+
+  YAML::Node altimetry_config = config["ALTIMETRY"];
+  if (altimetry_config["enabled"].as<bool>(false) && !raw_capture) {
+    if (schedule || !sdr.getTransmit()) {
+      throw std::invalid_argument("Altimetry needs a single transmitted waveform (no SCHEDULE).");
+    }
+    string altimetry_loc = std::filesystem::path(output_dir).string() + "/" + altimetry_config["file"].as<string>("altimetry.bin");
+    double rx_rate = sdr.getRxRate();
+    EchoPickerSettings settings;
+    settings.method = parse_picker_method(altimetry_config["method"].as<string>("threshold"));
+    settings.threshold = altimetry_config["threshold"].as<double>(15);
+    settings.cfar_guard = altimetry_config["cfar_guard"].as<size_t>(4);
+    settings.cfar_train = altimetry_config["cfar_train"].as<size_t>(16);
+    settings.direct_window = round(altimetry_config["direct_window"].as<double>(2e-6) * rx_rate);
+    settings.surface_min_delay = round(altimetry_config["surface_min_delay"].as<double>(1e-6) * rx_rate);
+    settings.bed_min_delay = round(altimetry_config["bed_min_delay"].as<double>(1e-6) * rx_rate);
+    double pick_rate = altimetry_config["pick_rate"].as<double>(1);
+    int udp_port = altimetry_config["udp_port"].as<int>(0);
+    if (pick_rate <= 0 || udp_port < 0 || udp_port > 65535) {
+      throw std::invalid_argument("Altimetry pick_rate must be > 0 and udp_port between 0 and 65535.");
+    }
+    altimeter.reset(new Altimeter(altimetry_loc, udp_port, rxReferenceChirp(sdr, config["GENERATE"]), num_rx_samps, settings,
+                                  rx_rate, altimetry_config["ice_velocity"].as<double>(1.685e8), 1.0 / pick_rate));
+    cout << "INFO: Altimetry: " << altimetry_config["method"].as<string>("threshold") << " picker at up to " << pick_rate;
+    cout << " traces/s, written to " << altimetry_loc;
+    if (udp_port > 0) {
+      cout << " and UDP port " << udp_port;
+    }
+    cout << endl;
+  }
 
-  vector<complex<float>> buff(num_rx_samps); // Buffer sized for one pulse at a time
+  complex<float>* buff = nullptr;       // Buffer sized for one pulse at a time
+  complex<float>* sample_sum = nullptr; // Sum error-free RX pulses into this buffer
+  if (!use_rx_pool) {
+    buff = rx_buffers.acquire();
+    sample_sum = rx_buffers.acquire();
+    fill(sample_sum, sample_sum + num_rx_samps, complex<float>(0,0));
+  }
   vector<void *> buffs;
-  for (size_t ch = 0; ch < sdr.getRxStream()->get_num_channels(); ch++) {
-    buffs.push_back(&buff.front()); // TODO: I don't think this actually works for num_channels > 1
+  for (size_t ch = 0; ch < sdr.getRxChannelNums().size(); ch++) {
+    buffs.push_back(buff); // TODO: I don't think this actually works for num_channels > 1
   }
+  vector<void *> fragment_buffs(buffs.size());
   size_t n_samps_in_rx_buff;
   rx_metadata_t rx_md; // Captures metadata from rx_stream->recv() -- specifically primarily timeouts and other errors
 
   float inversion_phase; // Store phase to use for phase inversion of this chirp
 
+  // Optional pool of worker threads for inversion and presumming (not needed in raw capture mode)
+  unique_ptr<RxWorkerPool> rx_pool;
+  if (use_rx_pool) {
+    auto write_trace = [&](const complex<float>* trace, int trace_presums) {
+      if (!outfile.is_open()) {
+        cout_mutex.lock();
+        cout << "Cannot write to outfile!" << endl;
+        cout_mutex.unlock();
+        return false; // Error writing to file
+      }
+      outfile.write((const char*)trace, num_rx_samps * sizeof(complex<float>));
+      last_pulse_num_written += trace_presums;
+      monitorTrace(trace, last_pulse_num_written, trace_presums);
+      splitOutputFiles(chirp, outfile, current_filename, save_file_index);
+      return true;
+    };
+    auto thread_init = [](const string& role) {
+      apply_thread_placement(role == "writer" ? writer_placement : worker_placement);
+    };
+    rx_pool.reset(new RxWorkerPool(rx_buffers, chirp.getNumPresums(), chirp.getPhaseDither(), num_rx_workers, rx_queue_depth,
+                                   write_trace, thread_init));
+    cout << "INFO: RX worker pool: " << num_rx_workers << " workers, " << rx_queue_depth << " presum groups" << endl;
+  }
+
+  /*** RUNTIME CONTROL SOCKET ***/
+  unique_ptr<ControlServer> control_server;
+  YAML::Node control_config = config["CONTROL"];
+  string socket_path = control_config["socket_path"].as<string>("");
+  if (!socket_path.empty()) {
+    string change_log_loc = std::filesystem::path(output_dir).string() + "/" + control_config["log"].as<string>("control_log.csv");
+    change_log.reset(new ChangeLog(change_log_loc));
+    int max_presums = rx_pool ? rx_pool->getMaxPresums() : numeric_limits<int>::max();
+    auto set_parameter = [&sdr, &chirp, &timeline, max_presums](const string& parameter, double value) {
+      string error = validateParameterChange(sdr, chirp, timeline, parameter, value, max_presums);
+      if (!error.empty()) {
+        return "ERROR " + error;
+      }
+      return "OK " + to_string(timeline.scheduleChange(parameter, value, num_presums, error_count));
+    };
+    auto get_status = [&timeline]() {
+      stringstream status;
+      status << "pulses_received=" << pulses_received << " error_count=" << error_count;
+      status << " rx_gain=" << current_rx_gain << " tx_gain=" << current_tx_gain << " freq=" << current_freq;
+      status << " pulse_rep_int=" << timeline.getPulseRepInt(pulses_received) << " num_presums=" << num_presums;
+      status << " transmit=" << transmit_enabled;
+      return status.str();
+    };
+    control_server.reset(new ControlServer(socket_path, set_parameter, get_status));
+    cout << "INFO: Listening for parameter changes on " << socket_path << ", changes logged to " << change_log_loc << endl;
+  }
+
+  // Pin the RX loop last, so every thread spawned above starts on the default CPU set
+  apply_thread_placement(rx_placement);
+
   // Note: This print statement is used by automated post-processing code. Please be careful about changing the format.
   cout << "[START] Beginning main loop" << endl;
 
-  while ((chirp.getNumPulses() < 0) || (last_pulse_num_written < chirp.getNumPulses())) {
+  if (rx_pool) {
+    // recv() only hands full groups to the worker pool, which writes the traces in order
+    pooledRxLoop(sdr, chirp, *rx_pool, timeline);
+    if (!rx_pool->finish()) {exit(1);};
+  } else if (schedule) {
+    scheduledRxLoop(sdr, chirp, buff, trace_streams, timeline);
+  } else if (multi_channel) {
+    multiChannelRxLoop(sdr, chirp, trace_streams, timeline);
+  } else {
+    while ((chirp.getNumPulses() < 0) || (last_pulse_num_written < chirp.getNumPulses())) {
 
-    n_samps_in_rx_buff = sdr.getRxStream()->recv(buffs, num_rx_samps, rx_md, 60.0, false); // TODO: Think about timeout
+      // num_presums only changes between traces
+      if (change_log && !raw_capture && (pulses_received - error_count) == last_pulse_num_written) {
+        applyPresumChange(timeline);
+      }
 
-    // Check for errors in the RX buffer
-    handleRxBuffer(n_samps_in_rx_buff, rx_md, chirp, buff, sample_sum, inversion_phase);
-    // Check if we have a full sample_sum ready to write to file
-    if (!checkForFullSampleSum(chirp, sample_sum, outfile)) {exit(1);};
+      n_samps_in_rx_buff = receivePulse(sdr, sdr.getRxStream(), buffs, fragment_buffs, num_rx_samps, rx_md);
+
+      if (raw_capture) {
+        // Write the pulse and its metadata as received
+        if (!writeRawPulse(n_samps_in_rx_buff, rx_md, timeline.getScheduledTime(pulses_received), buff, outfile, metafile)) {exit(1);};
+      } else {
+        // Check for errors in the RX buffer
+        long int errors_before = error_count;
+        handleRxBuffer(n_samps_in_rx_buff, rx_md, timeline.getScheduledTime(pulses_received), chirp, buff, sample_sum, inversion_phase);
+        // Gain control looks at the first pulse of each presum group
+        if (agc && error_count == errors_before && (pulses_received - error_count) - last_pulse_num_written == 1) {
+          agc->addMetrics(compute_trace_metrics(buff, num_rx_samps, agc_settings.clip_level, pulses_received - 1));
+        }
+        // Check if we have a full sample_sum ready to write to file
+        if (!checkForFullSampleSum(chirp, sample_sum, outfile)) {exit(1);};
+      }
 
 
-    // get gps data
-    /*if (sdr.getClkRef() == "gpsdo" && ((pulses_received % 100000) == 0)) {
-      gps_data = sdr.getUsrp()->get_mboard_sensor("gps_gprmc").to_pp_string();
-      //cout << gps_data << endl;
-    }*/
+      // get gps data
+      /*if (sdr.getClkRef() == "gpsdo" && ((pulses_received % 100000) == 0)) {
+        gps_data = sdr.getUsrp()->get_mboard_sensor("gps_gprmc").to_pp_string();
+        //cout << gps_data << endl;
+      }*/
 
-    // check if someone wants to stop
-    if (stop_signal_called) {
-      cout_mutex.lock();
-      cout << "[RX] Reached stop signal handling for outer RX loop -> break" << endl;
-      cout_mutex.unlock();
-      break;
-    }
+      // check if someone wants to stop
+      if (stop_signal_called) {
+        cout_mutex.lock();
+        cout << "[RX] Reached stop signal handling for outer RX loop -> break" << endl;
+        cout_mutex.unlock();
+        break;
+      }
 
-    // write gps string to file
-    /*if (sdr.getClkRef() == "gpsdo") {
-      boost::asio::async_write(gps_stream, boost::asio::buffer(gps_data + "\n"), gps_asio_handler);
-    }*/
+      // write gps string to file
+      /*if (sdr.getClkRef() == "gpsdo") {
+        boost::asio::async_write(gps_stream, boost::asio::buffer(gps_data + "\n"), gps_asio_handler);
+      }*/
 
-    // split output files based on number of chirps
-    splitOutputFiles(chirp, outfile, current_filename, save_file_index);
+      // split output files based on number of chirps
+      splitOutputFiles(chirp, outfile, current_filename, save_file_index);
     
-    // // clear the matrices holding the sums
-    // fill(sample_sum.begin(), sample_sum.end(), complex<int16_t>(0,0));
+      // // clear the matrices holding the sums
+      // fill(sample_sum.begin(), sample_sum.end(), complex<int16_t>(0,0));
+    }
   }
 
   /*** WRAP UP ***/
-  wrapUp(gps_stream, outfile, current_filename, transmit_thread);
+  if (control_server) {
+    control_server->stop();
+  }
+  if (raw_capture) {
+    cout << "[RX] Closing metadata file." << endl;
+    metafile.close();
+  }
+  wrapUp(gps_stream, outfile, current_filename, scheduler_threads);
+
+  rx_cmd_lateness.print();
+  if (sdr.getTransmit()) {
+    tx_lateness.print();
+  }
+  if (agc) {
+    agc->stop();
+    cout << "[AGC] " << agc->getNumChanges() << " gain changes, final RX gain " << agc->getGain() << " dB" << endl;
+  }
 
   return EXIT_SUCCESS;
   
 }
 
-/*
- * TRANSMIT_WORKER
+/**
+ * @brief Prints a one-line summary of the latest noise statistics window
+ *
+ * Called from whichever thread writes traces, after a summary was completed.
+ * SNR is the coherent power |mean|^2 of a range bin relative to the noise floor.
  */
+void printNoiseStats() {
+  const vector<NoiseBinStats>& bins = noise_stats->getLastSummary();
+  double noise_floor = noise_stats->getLastNoiseFloor();
+  size_t peak_bin = 0;
+  double peak_power = 0;
+  for (size_t b = 0; b < bins.size(); b++) {
+    double coherent_power = bins[b].mean_re * bins[b].mean_re + bins[b].mean_im * bins[b].mean_im;
+    if (coherent_power > peak_power) {
+      peak_power = coherent_power;
+      peak_bin = b;
+    }
+  }
+  lock_guard<mutex> lock(cout_mutex);
+  cout << "[NOISE] Noise floor: " << 10 * log10(max(noise_floor, 1e-30)) << " dB, peak SNR: ";
+  cout << 10 * log10(max(peak_power, 1e-30) / max(noise_floor, 1e-30)) << " dB at range bin " << peak_bin << endl;
+}
 
-void transmit_worker(tx_streamer::sptr& tx_stream, rx_streamer::sptr& rx_stream, Chirp& chirp, Sdr& sdr){
-  set_thread_priority_safe(1.0, true);
+/**
+ * @brief Prints the latest direct path measurement, with warnings if it moved away from the first one
+ *
+ * Called from whichever thread writes traces, after a measurement was made. A drifting delay points at
+ * timing problems, a drifting phase at the LO, and a collapsing amplitude at wrong phase inversion.
+ */
+void printDirectPath() {
+  const DirectPathPeak& peak = direct_path->getLastPeak();
+  const DirectPathPeak& first = direct_path->getFirstPeak();
+  double drift = peak.delay - first.delay;
+  double drop = 20 * log10(max(first.amplitude, 1e-30) / max(peak.amplitude, 1e-30));
+  double phase_change = remainder(peak.phase - first.phase, 2 * M_PI);
+  lock_guard<mutex> lock(cout_mutex);
+  cout << "[DIRECT] Delay: " << peak.delay << " samples (" << showpos << drift << noshowpos << "), amplitude: ";
+  cout << 20 * log10(max(peak.amplitude, 1e-30)) << " dB, phase: " << peak.phase * 180 / M_PI << " deg (";
+  cout << showpos << phase_change * 180 / M_PI << noshowpos << ")";
+  if (peak.at_edge) {
+    cout << " WARNING: peak at the edge of the search window";
+  } else if (fabs(drift) > direct_path_max_drift) {
+    cout << " WARNING: delay drift";
+  }
+  if (drop > direct_path_max_drop) {
+    cout << " WARNING: amplitude dropped by " << drop << " dB";
+  }
+  cout << endl;
+}
+
+/**
+ * @brief Estimates the loopback calibration from the averaged traces, saves it and prints a summary
+ *
+ * Called from wrapUp() at the end of a loopback calibration run. A failed calibration is reported but
+ * doesn't throw, so the run still ends normally.
+ */
+void saveLoopbackCalibration() {
+  LoopbackCalibration cal;
+  try {
+    cal = loopback_cal->calibrate();
+  } catch (const runtime_error& e) {
+    lock_guard<mutex> lock(cout_mutex);
+    cout << "[CAL] ERROR: Loopback calibration failed: " << e.what() << endl;
+    return;
+  }
+  bool saved = save_loopback_calibration(loopback_cal_loc, cal, cal_sample_rate, cal_band_center, cal_bandwidth);
+  lock_guard<mutex> lock(cout_mutex);
+  cout << "[CAL] Loopback calibration from " << cal.num_traces << " traces, SNR " << cal.snr << " dB" << endl;
+  cout << "[CAL] Delay: " << cal.delay << " samples (" << cal.delay / cal_sample_rate * 1e9 << " ns), gain: ";
+  cout << 20 * log10(max(abs(cal.gain), 1e-15)) << " dB, phase: " << arg(cal.gain) * 180 / M_PI << " deg" << endl;
+  cout << "[CAL] Transfer function in band: max ripple " << cal.max_ripple << " dB, RMS phase ";
+  cout << cal.rms_phase * 180 / M_PI << " deg" << endl;
+  if (saved) {
+    cout << "[CAL] Measured reference chirp written to " << loopback_cal_loc << " (use it with CALIBRATION:reference)" << endl;
+  } else {
+    cout << "[CAL] ERROR: Could not write the calibration to " << loopback_cal_loc << endl;
+  }
+}
+
+/**
+ * @brief Waits until a scheduler thread is allowed to work on its next pulse
+ *
+ * The idea here is to schedule a handful of chirps ahead to let
+ * the transport layer (i.e. libUSB or whatever it is for ethernet)
+ * buffering actually do its job.
+ *
+ * In practice, letting this schedule 10s of pulses ahead seems to
+ * perform well. According to the documentation, however, the maximum
+ * queue depth is 8 for both the B20x-mini and X310. (And each pulse
+ * is two commands -- TX and RX.) So if we're following that, then
+ * we should only schedule 6 pulses ahead.
+ * @param next_pulse Index of the next pulse the calling thread will schedule
+ * @param lookahead Max. number of pulses the calling thread may be ahead of the last received pulse
+ * @param tag Tag used when printing, e.g. "[TX]"
+ * @return Returns false if the thread should stop instead
+ */
+bool waitForLookahead(long int next_pulse, int lookahead, const string& tag) {
+  while (((next_pulse - lookahead) > pulses_received) && !stop_signal_called && !rx_loop_done) {
+    boost::this_thread::sleep_for(boost::chrono::nanoseconds(10));
+  }
+  if (stop_signal_called || rx_loop_done) {
+    cout_mutex.lock();
+    cout << tag << " stop signal called -> break" << endl;
+    cout_mutex.unlock();
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Generates the chirp to transmit from the GENERATE block, or reads it from chirp_loc
+ *
+ * Called while the device is set up in the background, so it never prints: throws runtime_error if the
+ * file can't be opened (or invalid_argument for invalid GENERATE parameters). The cpu_format is checked
+ * before the device setup starts.
+ * @param sdr Sdr object
+ * @param generate GENERATE node of the configuration file
+ * @return num_tx_samps chirp samples before any phase modulation
+ */
+aligned_sample_vector loadTxChirp(Sdr& sdr, const YAML::Node& generate) {
+  if (generate["in_radar"].as<bool>(false)) {
+    // Same samples as generate_chirp.py writes, without the file. Throws for invalid parameters.
+    aligned_sample_vector chirp_unmodulated = generate_chirp(load_chirp_params(generate));
+    chirp_unmodulated.resize(num_tx_samps, complex<float>(0, 0));
+    return chirp_unmodulated;
+  }
 
   // open file to stream from
   ifstream infile("../../" + output_dir + "/" + chirp_loc, ifstream::binary);
 
-  if (!infile.is_open())
-  {
-    cout << endl
-         << "!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!" << endl;
-    cout << "ERROR! Failed to open chirp.bin input file" << endl;
-    cout << "!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!" << endl
-         << endl;
-    exit(1);
+  if (!infile.is_open()) {
+    throw std::runtime_error("Failed to open chirp input file " + output_dir + "/" + chirp_loc);
   }
 
-  // Transmit buffers
+  aligned_sample_vector chirp_unmodulated(num_tx_samps);
+  infile.read((char *)&chirp_unmodulated.front(), num_tx_samps * convert::get_bytes_per_item(sdr.getCpuFormat()));
+  return chirp_unmodulated;
+}
 
-  if (sdr.getCpuFormat() != "fc32") {
-    cout << "Only cpu_format 'fc32' is supported for now." << endl;
-    // This is because we actually need chirp_unmodulated to have the correct
-    // data type to facilitate phase modulation. In the future, this could be
-    // fixed up so that it can work with any supported cpu_format, but it
-    // seems unnecessary right now.
-    exit(1);
+/**
+ * @brief Returns the transmitted chirp at the RX sample rate, for correlating with received traces
+ *
+ * This is the measured reference chirp of a loopback calibration if CALIBRATION:reference is set,
+ * otherwise the chirp actually transmitted if the TX and RX rates match, otherwise it is generated again
+ * from the GENERATE block at the RX rate.
+ * @param sdr Sdr object
+ * @param generate GENERATE node of the configuration file
+ * @return Chirp samples (including zero padding)
+ */
+vector<complex<float>> rxReferenceChirp(Sdr& sdr, const YAML::Node& generate) {
+  if (!reference_chirp_loc.empty()) {
+    return load_reference_chirp(reference_chirp_loc);
   }
+  if (sdr.getTxRate() == sdr.getRxRate()) {
+    return vector<complex<float>>(tx_chirp.begin(), tx_chirp.end());
+  }
+  ChirpParams params = load_chirp_params(generate);
+  params.sample_rate = sdr.getRxRate();
+  aligned_sample_vector generated = generate_chirp(params);
+  return vector<complex<float>>(generated.begin(), generated.end());
+}
 
-  vector<std::complex<float>> tx_buff(num_tx_samps); // Ready-to-transmit samples
-  vector<std::complex<float>> chirp_unmodulated(num_tx_samps); // Chirp samples before any phase modulation
+/*
+ * TX_WORKER
+ */
 
-  infile.read((char *)&chirp_unmodulated.front(), num_tx_samps * convert::get_bytes_per_item(sdr.getCpuFormat()));
-  tx_buff = chirp_unmodulated;
+void tx_worker(tx_streamer::sptr& tx_stream, Chirp& chirp, Sdr& sdr, PulseTimeline& timeline, DeviceClock& device_clock, LatenessStats& lateness){
+  set_thread_priority_safe(1.0, true);
+  apply_thread_placement(tx_placement);
+
+  // Transmit buffer for phase-modulated samples, large enough for every waveform
+  aligned_sample_vector tx_buff(schedule ? schedule->getMaxTxSamps() : num_tx_samps);
+  tx_streamer::buffs_type tx_buffs(tx_stream->get_num_channels()); // Every TX channel sends the same samples...
+  vector<aligned_sample_vector> tx_code_buffs(phase_codes ? tx_buffs.size() : 0, aligned_sample_vector(tx_buff.size())); // ... unless phase coded
 
   // Transmit metadata structure
   tx_metadata_t tx_md;
@@ -416,76 +1576,385 @@ void transmit_worker(tx_streamer::sptr& tx_stream, rx_streamer::sptr& rx_stream,
   tx_md.end_of_burst = true;
   tx_md.has_time_spec = true;
 
-  // Receive command structure
-  stream_cmd_t stream_cmd(stream_cmd_t::STREAM_MODE_NUM_SAMPS_AND_DONE);
-  stream_cmd.num_samps = num_rx_samps;
-  stream_cmd.stream_now = false;
+  double tx_time;
 
-  int chirps_sent = 0;
-  double rx_time;
-  size_t n_samp_tx;
-
-  long int last_error_count = 0;
-  double error_delay = 0;
-
-  while ((chirp.getNumPulses() < 0) || ((pulses_scheduled - error_count) < chirp.getNumPulses()))
+  while ((chirp.getNumPulses() < 0) || ((pulses_sent - error_count) < chirp.getNumPulses()))
   {
     // Setup next chirp for modulation
+    const aligned_sample_vector& chirp_unmodulated = schedule ? schedule->getPulseWaveform(pulses_sent).tx_chirp : tx_chirp;
+    const complex<float>* tx_samps = chirp_unmodulated.data(); // Ready-to-transmit samples
     if (chirp.getPhaseDither()) {
-      transform(chirp_unmodulated.begin(), chirp_unmodulated.end(), tx_buff.begin(), std::bind1st(std::multiplies<complex<float>>(), polar((float) 1.0, get_next_phase(true))));
+      complex<float> phase = polar((float) 1.0, get_next_phase(true));
+      transform(chirp_unmodulated.begin(), chirp_unmodulated.end(), tx_buff.begin(), [&](complex<float> s) { return phase * s; });
+      tx_samps = tx_buff.data();
     }
 
-    /*
-    The idea here is scheduler a handful of chirps ahead to let
-    the transport layer (i.e. libUSB or whatever it is for ethernet)
-    buffering actually do its job.
-    
-    In practice, letting this schedule 10s of pulses ahead seems to
-    perform well. According to the documentation, however, the maximum
-    queue depth is 8 for both the B20x-mini and X310. (And each pulse
-    is two commands -- TX and RX.) So if we're following that, then
-    we should only schedule 6 pulses ahead.
-    */
-    while ((pulses_scheduled - 6) > pulses_received) { // TODO: hardcoded
-      if (stop_signal_called) {
-        cout << "[TX] stop signal called while scheduler thread waiting -> break" << endl;
-        break;
+    if (!waitForLookahead(pulses_sent, chirp.getTxLookahead(), "[TX]")) {
+      break;
+    }
+
+    tx_time = timeline.getRxTime(pulses_sent, timelineErrorCount()) - chirp.getTxLead();
+    if (change_log) {
+      ScheduledChange change;
+      while (timeline.takeChange("transmit", pulses_sent, change)) {
+        change_log->record(pulses_sent, tx_time + chirp.getTxLead(), "transmit", transmit_enabled, change.value);
+        transmit_enabled = (change.value != 0);
+      }
+    }
+    // With transmit switched off at runtime the pulse is still scheduled (and the dither sequence advanced), just not sent
+    if (transmit_enabled) {
+      tx_md.time_spec = time_spec_t(tx_time);
+      fill(tx_buffs.begin(), tx_buffs.end(), tx_samps);
+      for (size_t t = 0; t < tx_code_buffs.size(); t++) {
+        complex<float> code = polar(1.0f, phase_codes->getPhase(t, pulses_sent));
+        transform(tx_samps, tx_samps + chirp_unmodulated.size(), tx_code_buffs[t].begin(), [code](complex<float> x) { return x * code; });
+        tx_buffs[t] = tx_code_buffs[t].data();
       }
-      boost::this_thread::sleep_for(boost::chrono::nanoseconds(10));
+      tx_stream->send(tx_buffs, chirp_unmodulated.size(), tx_md, 60); // TODO: Think about timeout
+      lateness.record(tx_time - device_clock.now());
     }
 
-    if (error_count > last_error_count) {
-      error_delay = (error_count - last_error_count) * 2 * chirp.getPulseRepInt();
-      chirp.setTimeOffset(chirp.getTimeOffset() + error_delay);
-      cout_mutex.lock();
-      cout << "[TX] (Chirp " << pulses_scheduled << ") time_offset increased by " << error_delay << endl;
-      cout_mutex.unlock();
-      last_error_count = error_count;
+    pulses_sent++;
+  }
+
+  cout_mutex.lock();
+  cout << "[TX] Done." << endl;
+  cout_mutex.unlock();
+}
+
+/*
+ * TX_ASYNC_WORKER
+ */
+
+/**
+ * @brief Drains the TX async messages and attributes every error event to a pulse
+ *
+ * Burst ACKs are ignored. An event's timestamp (plus tx_lead, since bursts start before their RX window)
+ * is mapped to the pulse it happened in, which the RX loop then drops. Runs until the RX loop is done.
+ * @param tx_stream TX streamer to read async messages from
+ * @param chirp Chirp object containing parameters for the chirp
+ * @param timeline Pulse timeline
+ */
+void tx_async_worker(tx_streamer::sptr& tx_stream, Chirp& chirp, PulseTimeline& timeline) {
+  apply_thread_placement(tx_async_placement);
+
+  async_metadata_t async_md;
+  while (!rx_loop_done) {
+    if (!tx_stream->recv_async_msg(async_md, 0.1) || async_md.event_code == async_metadata_t::EVENT_CODE_BURST_ACK) {
+      continue;
+    }
+    long int pulse = async_md.has_time_spec ? timeline.getPulseAt(async_md.time_spec.get_real_secs() + chirp.getTxLead()) : -1;
+    bool dropped = tx_events->record(pulse, async_md.event_code);
+    cout_mutex.lock();
+    cout << "[TX ASYNC] (Chirp " << pulse << ") " << async_event_name(async_md.event_code);
+    if (async_md.has_time_spec) {
+      cout << " at " << setprecision(12) << async_md.time_spec.get_real_secs() << setprecision(6);
+    }
+    if (!dropped) {
+      cout << " (pulse already received, not dropped)";
+    }
+    cout << endl;
+    cout_mutex.unlock();
+  }
+}
+
+/**
+ * @brief Returns the error count the pulse timeline inserts delays for
+ *
+ * These are the RX errors (which include pulses dropped for a TX event) plus the TX events that came too
+ * late to drop their pulse, so TX-side trouble also gives the transport time to catch up.
+ * @return Number of errors so far
+ */
+long int timelineErrorCount() {
+  return error_count + (tx_events ? tx_events->getNumLateEvents() : 0);
+}
+
+/**
+ * @brief Returns the time for a timed command that must take effect before a pulse
+ *
+ * This is halfway between the end of the previous RX window and the start of this one, so
+ * the command affects every sample of this pulse and none of the previous one. Pulses are
+ * assigned times in order, so the previous pulse's time is already fixed.
+ * @param timeline Pulse timeline
+ * @param chirp Chirp object containing parameters for the chirp
+ * @param pulse Pulse index
+ * @param rx_time [s] Device time of that pulse's RX window
+ * @return [s] Device time for the command
+ */
+double commandTimeBefore(PulseTimeline& timeline, Chirp& chirp, long int pulse, double rx_time) {
+  double gap = (pulse > 0) ? rx_time - timeline.getScheduledTime(pulse - 1) : timeline.getPulseRepInt(0);
+  double rx_duration = schedule ? schedule->getPulseWaveform(max(pulse - 1, 0L)).rx_duration : chirp.getRxDuration();
+  return rx_time - (gap - rx_duration) / 2;
+}
+
+/**
+ * @brief Applies a gain change decided by the AGC controller, if there is one, in front of a pulse
+ *
+ * @param sdr Sdr object
+ * @param command_time [s] Device time to change the gain at (see commandTimeBefore())
+ * @param pulse Index of the first pulse to receive with the new gain
+ * @param rx_time [s] Device time of that pulse's RX window
+ */
+void applyGainChange(Sdr& sdr, double command_time, long int pulse, double rx_time) {
+  double gain;
+  if (!agc->takeGainChange(gain)) {
+    return;
+  }
+  sdr.getUsrp()->set_command_time(time_spec_t(command_time));
+  for (size_t ch : sdr.getRxChannelNums()) {
+    sdr.getUsrp()->set_rx_gain(gain, ch);
+  }
+  sdr.getUsrp()->clear_command_time();
+  agc->confirmGainChange(pulse, rx_time, gain);
+  current_rx_gain = gain;
+}
+
+/**
+ * @brief Applies the device settings changed through the control socket that take effect at a pulse
+ *
+ * Gains are set with timed commands. pulse_rep_int changes are already part of the timeline and are only
+ * recorded here.
+ * @param sdr Sdr object
+ * @param timeline Pulse timeline holding the scheduled changes
+ * @param command_time [s] Device time to change settings at (see commandTimeBefore())
+ * @param pulse Pulse the RX command thread is about to schedule
+ * @param rx_time [s] Device time of that pulse's RX window
+ */
+void applyDeviceChanges(Sdr& sdr, PulseTimeline& timeline, double command_time, long int pulse, double rx_time) {
+  ScheduledChange change;
+  while (timeline.takeChange("rx_gain", pulse, change)) {
+    sdr.getUsrp()->set_command_time(time_spec_t(command_time));
+    for (size_t ch : sdr.getRxChannelNums()) {
+      sdr.getUsrp()->set_rx_gain(change.value, ch);
+    }
+    sdr.getUsrp()->clear_command_time();
+    change_log->record(pulse, rx_time, "rx_gain", current_rx_gain, change.value);
+    current_rx_gain = change.value;
+  }
+  while (timeline.takeChange("tx_gain", pulse, change)) {
+    sdr.getUsrp()->set_command_time(time_spec_t(command_time));
+    for (size_t ch : sdr.getTxChannelNums()) {
+      sdr.getUsrp()->set_tx_gain(change.value, ch);
+    }
+    sdr.getUsrp()->clear_command_time();
+    change_log->record(pulse, rx_time, "tx_gain", current_tx_gain, change.value);
+    current_tx_gain = change.value;
+  }
+  while (timeline.takeChange("pulse_rep_int", pulse, change)) {
+    change_log->record(pulse, rx_time, "pulse_rep_int", timeline.getPulseRepInt(pulse - 1), change.value);
+  }
+}
+
+/**
+ * @brief Sets the gains and center frequency of the pulse's waveform, if they differ from the previous pulse's
+ *
+ * Gains are changed with timed commands at least gain_settle_time, and the frequency at least lo_settle_time,
+ * before the RX window (TX burst for TX settings) they apply to. Waveforms without their own setting use the
+ * configured one (RF0, as applied at startup).
+ * @param sdr Sdr object
+ * @param chirp Chirp object containing parameters for the chirp
+ * @param command_time [s] Device time to change settings at (see commandTimeBefore())
+ * @param pulse Pulse the RX command thread is about to schedule
+ * @param rx_time [s] Device time of that pulse's RX window
+ */
+void applyWaveformSettings(Sdr& sdr, Chirp& chirp, double command_time, long int pulse, double rx_time) {
+  const Waveform& waveform = schedule->getPulseWaveform(pulse);
+  double stage_time = min(command_time, rx_time - schedule->getGainSettleTime());
+  double rx_gain = isnan(waveform.rx_gain) ? sdr.getAppliedRxGain() : waveform.rx_gain;
+  if (rx_gain != current_rx_gain) {
+    sdr.getUsrp()->set_command_time(time_spec_t(stage_time));
+    for (size_t ch : sdr.getRxChannelNums()) {
+      sdr.getUsrp()->set_rx_gain(rx_gain, ch);
+    }
+    sdr.getUsrp()->clear_command_time();
+    current_rx_gain = rx_gain;
+  }
+  double tx_gain = isnan(waveform.tx_gain) ? sdr.getAppliedTxGain() : waveform.tx_gain;
+  if (sdr.getTransmit() && tx_gain != current_tx_gain) {
+    sdr.getUsrp()->set_command_time(time_spec_t(stage_time - chirp.getTxLead()));
+    for (size_t ch : sdr.getTxChannelNums()) {
+      sdr.getUsrp()->set_tx_gain(tx_gain, ch);
+    }
+    sdr.getUsrp()->clear_command_time();
+    current_tx_gain = tx_gain;
+  }
+  double freq = isnan(waveform.freq) ? base_freq : waveform.freq;
+  if (freq != current_freq) {
+    double step_time = min(command_time, rx_time - schedule->getLoSettleTime());
+    tune_request_t tune_request(freq, lo_offset);
+    tune_request.args = device_addr_t(tuning_args);
+    sdr.getUsrp()->set_command_time(time_spec_t(step_time));
+    for (size_t ch : sdr.getRxChannelNums()) {
+      sdr.getUsrp()->set_rx_freq(tune_request, ch);
     }
-    // TX
-    rx_time = chirp.getTimeOffset() + (chirp.getPulseRepInt() * pulses_scheduled); // TODO: How do we track timing
-    tx_md.time_spec = time_spec_t(rx_time - chirp.getTxLead());
-    
     if (sdr.getTransmit()) {
-      n_samp_tx = tx_stream->send(&tx_buff.front(), num_tx_samps, tx_md, 60); // TODO: Think about timeout
+      sdr.getUsrp()->set_command_time(time_spec_t(step_time - chirp.getTxLead()));
+      for (size_t ch : sdr.getTxChannelNums()) {
+        sdr.getUsrp()->set_tx_freq(tune_request, ch);
+      }
     }
+    sdr.getUsrp()->clear_command_time();
+    current_freq = freq;
+  }
+}
 
-    // RX
-    stream_cmd.time_spec = time_spec_t(rx_time);
-    rx_stream->issue_stream_cmd(stream_cmd);
+/**
+ * @brief Switches to a new num_presums requested through the control socket, if one is due
+ *
+ * Called by the RX loop before the first pulse of a new trace.
+ * @param timeline Pulse timeline holding the scheduled changes
+ */
+void applyPresumChange(PulseTimeline& timeline) {
+  ScheduledChange change;
+  while (timeline.takeChange("num_presums", pulses_received, change)) {
+    change_log->record(pulses_received, 0, "num_presums", num_presums, change.value);
+    num_presums = (int) change.value;
+  }
+}
 
-    //cout << "[TX] Scheduled pulse " << pulses_scheduled << " at " << rx_time << " (n_samp_tx = " << n_samp_tx << ")" << endl;
+/**
+ * @brief Returns the shortest time between pulses that fits every TX and RX window
+ *
+ * @param chirp Chirp object containing parameters for the chirp
+ * @return [s] Pulses must start more than this far apart
+ */
+double requiredPulseSpacing(Chirp& chirp) {
+  double min_spacing = max(chirp.getRxDuration(), chirp.getTxLead() + chirp.getTxDuration() + chirp.getTrOffTrail());
+  for (size_t i = 0; schedule && i < schedule->getNumWaveforms(); i++) {
+    const Waveform& waveform = schedule->getWaveform(i);
+    min_spacing = max(min_spacing, max(waveform.rx_duration, chirp.getTxLead() + waveform.tx_duration + chirp.getTrOffTrail()));
+    // Staged gain changes must settle between the windows
+    if (schedule->stagesRxGain()) {
+      min_spacing = max(min_spacing, waveform.rx_duration + schedule->getGainSettleTime());
+    }
+    if (schedule->stagesTxGain()) {
+      min_spacing = max(min_spacing, chirp.getTxLead() + waveform.tx_duration + chirp.getTrOffTrail() + schedule->getGainSettleTime());
+    }
+    // ... and so must the LO after a frequency step
+    if (schedule->stepsFreq()) {
+      min_spacing = max(min_spacing, max(waveform.rx_duration, chirp.getTxLead() + waveform.tx_duration + chirp.getTrOffTrail()) +
+                                     schedule->getLoSettleTime());
+    }
+  }
+  return min_spacing;
+}
 
-    pulses_scheduled++;
+/**
+ * @brief Checks a parameter change requested through the control socket
+ *
+ * @param sdr Sdr object
+ * @param chirp Chirp object containing parameters for the chirp
+ * @param timeline Pulse timeline (for the spacing of the pulses)
+ * @param parameter Name of the parameter
+ * @param value Requested value
+ * @param max_presums Largest num_presums the RX buffers allow
+ * @return Empty string if the change is allowed, otherwise the reason it isn't
+ */
+string validateParameterChange(Sdr& sdr, Chirp& chirp, PulseTimeline& timeline, const string& parameter, double value, int max_presums) {
+  if (parameter == "rx_gain") {
+    if (agc) {
+      return "rx_gain is controlled by the AGC";
+    }
+    if (schedule && schedule->stagesRxGain()) {
+      return "rx_gain is set per waveform by the schedule";
+    }
+    gain_range_t range = sdr.getUsrp()->get_rx_gain_range(sdr.getRxChannelNums().front());
+    if (value < range.start() || value > range.stop()) {
+      return "rx_gain must be between " + to_string(range.start()) + " and " + to_string(range.stop());
+    }
+  } else if (parameter == "tx_gain") {
+    if (!sdr.getTransmit()) {
+      return "transmit is disabled in the configuration file";
+    }
+    if (schedule && schedule->stagesTxGain()) {
+      return "tx_gain is set per waveform by the schedule";
+    }
+    gain_range_t range = sdr.getUsrp()->get_tx_gain_range(sdr.getTxChannelNums().front());
+    if (value < range.start() || value > range.stop()) {
+      return "tx_gain must be between " + to_string(range.start()) + " and " + to_string(range.stop());
+    }
+  } else if (parameter == "pulse_rep_int") {
+    if (!(timeline.getPriSequence().getMinSpacing(value) > requiredPulseSpacing(chirp))) {
+      return "pulse_rep_int is too short: pulses would be " + to_string(timeline.getPriSequence().getMinSpacing(value)) +
+             " s apart, but need more than " + to_string(requiredPulseSpacing(chirp)) + " s";
+    }
+  } else if (parameter == "num_presums") {
+    if (raw_capture) {
+      return "num_presums can't be changed in raw capture mode";
+    }
+    if (schedule) {
+      return "num_presums is set per waveform by the schedule";
+    }
+    if (multi_channel) {
+      return "num_presums can't be changed with several RX channels";
+    }
+    if (value != floor(value) || value < 1 || value > max_presums) {
+      return "num_presums must be an integer between 1 and " + to_string(max_presums);
+    }
+  } else if (parameter == "transmit") {
+    if (!sdr.getTransmit()) {
+      return "transmit is disabled in the configuration file";
+    }
+    if (value != 0 && value != 1) {
+      return "transmit must be 0 or 1";
+    }
+  } else {
+    return "unknown parameter '" + parameter + "' (rx_gain, tx_gain, pulse_rep_int, num_presums, transmit)";
+  }
+  return "";
+}
 
-    if (stop_signal_called) {
-      cout << "[TX] stop signal called -> break" << endl;
+/*
+ * RX_COMMAND_WORKER
+ */
+
+void rx_command_worker(Chirp& chirp, Sdr& sdr, PulseTimeline& timeline, DeviceClock& device_clock, LatenessStats& lateness){
+  set_thread_priority_safe(1.0, true);
+  apply_thread_placement(rx_cmd_placement);
+
+  // Receive command structure
+  stream_cmd_t stream_cmd(stream_cmd_t::STREAM_MODE_NUM_SAMPS_AND_DONE);
+  stream_cmd.num_samps = num_rx_samps;
+  stream_cmd.stream_now = false;
+
+  double rx_time;
+
+  while ((chirp.getNumPulses() < 0) || ((pulses_scheduled - error_count) < chirp.getNumPulses()))
+  {
+    if (!waitForLookahead(pulses_scheduled, chirp.getRxLookahead(), "[RX CMD]")) {
       break;
     }
-  }
 
-  cout << "[TX] Closing file" << endl;
-  infile.close();
-  cout << "[TX] Done." << endl;
+    rx_time = timeline.getRxTime(pulses_scheduled, timelineErrorCount());
+    double command_time = commandTimeBefore(timeline, chirp, pulses_scheduled, rx_time);
+    // AGC gain changes only take effect at the start of a presum group (as far as the errors so far tell)
+    if (agc && (pulses_scheduled - error_count) % num_presums == 0) {
+      applyGainChange(sdr, command_time, pulses_scheduled, rx_time);
+    }
+    if (change_log) {
+      applyDeviceChanges(sdr, timeline, command_time, pulses_scheduled, rx_time);
+    }
+    if (schedule && (schedule->stagesRxGain() || schedule->stagesTxGain() || schedule->stepsFreq())) {
+      applyWaveformSettings(sdr, chirp, command_time, pulses_scheduled, rx_time);
+    }
+    if (schedule) {
+      stream_cmd.num_samps = schedule->getPulseWaveform(pulses_scheduled).num_rx_samps;
+    }
+    stream_cmd.time_spec = time_spec_t(rx_time);
+    // Every motherboard's streamer gets the same timed command, so the boards receive the same window
+    for (const rx_streamer::sptr& rx_stream : sdr.getRxStreams()) {
+      rx_stream->issue_stream_cmd(stream_cmd);
+    }
+    lateness.record(rx_time - device_clock.now());
+    if (pulse_time_file.is_open()) {
+      PulseTimeRecord record = {pulses_scheduled, rx_time};
+      pulse_time_file.write((const char*) &record, sizeof(PulseTimeRecord));
+    }
+
+    pulses_scheduled++;
+  }
 
+  cout_mutex.lock();
+  cout << "[RX CMD] Done." << endl;
+  cout_mutex.unlock();
 }
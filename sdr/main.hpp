@@ -10,9 +10,12 @@
 #include <boost/chrono.hpp>
 #include <boost/thread/barrier.hpp>
 #include <fstream>
+#include <iomanip>
 #include <csignal>
 #include <complex>
 #include <mutex>
+#include <atomic>
+#include <future>
 #include <cstdlib>
 #include <filesystem>
 #include <boost/asio/io_service.hpp>
@@ -25,10 +28,51 @@
 #include "utils.hpp"
 #include "sdr.hpp"
 #include "chirp.hpp"
+#include "presum.hpp"
+#include "raw_capture.hpp"
+#include "scheduler.hpp"
+#include "rx_pipeline.hpp"
+#include "buffer_pool.hpp"
+#include "thread_placement.hpp"
+#include "trace_ring.hpp"
+#include "quicklook.hpp"
+#include "noise_stats.hpp"
+#include "direct_path.hpp"
+#include "altimetry.hpp"
+#include "loopback_cal.hpp"
+#include "agc.hpp"
+#include "control_socket.hpp"
+#include "startup.hpp"
+#include "chirp_generator.hpp"
+#include "pulse_schedule.hpp"
 #include "common.hpp"
 
-void transmit_worker(tx_streamer::sptr& tx_stream, rx_streamer::sptr& rx_stream, Chirp& chirp, Sdr& sdr);
-void handleRxBuffer(size_t n_samps_in_rx_buff, rx_metadata_t& rx_md, Chirp& chirp, vector<complex<float>>& buff, vector<complex<float>>& sample_sum, float& inversion_phase);
-bool checkForFullSampleSum(Chirp& chirp, vector<complex<float>>& sample_sum, ofstream& outfile);
+bool waitForLookahead(long int next_pulse, int lookahead, const string& tag);
+aligned_sample_vector loadTxChirp(Sdr& sdr, const YAML::Node& generate);
+vector<complex<float>> rxReferenceChirp(Sdr& sdr, const YAML::Node& generate);
+void tx_worker(tx_streamer::sptr& tx_stream, Chirp& chirp, Sdr& sdr, PulseTimeline& timeline, DeviceClock& device_clock, LatenessStats& lateness);
+void tx_async_worker(tx_streamer::sptr& tx_stream, Chirp& chirp, PulseTimeline& timeline);
+long int timelineErrorCount();
+double commandTimeBefore(PulseTimeline& timeline, Chirp& chirp, long int pulse, double rx_time);
+void applyGainChange(Sdr& sdr, double command_time, long int pulse, double rx_time);
+void applyDeviceChanges(Sdr& sdr, PulseTimeline& timeline, double command_time, long int pulse, double rx_time);
+void applyWaveformSettings(Sdr& sdr, Chirp& chirp, double command_time, long int pulse, double rx_time);
+void applyPresumChange(PulseTimeline& timeline);
+double requiredPulseSpacing(Chirp& chirp);
+string validateParameterChange(Sdr& sdr, Chirp& chirp, PulseTimeline& timeline, const string& parameter, double value, int max_presums);
+void rx_command_worker(Chirp& chirp, Sdr& sdr, PulseTimeline& timeline, DeviceClock& device_clock, LatenessStats& lateness);
+size_t receivePulse(Sdr& sdr, const rx_streamer::sptr& rx_stream, const vector<void *>& buffs, vector<void *>& fragment_buffs,
+                    size_t num_samps, rx_metadata_t& rx_md);
+bool checkRxErrors(size_t n_samps_in_rx_buff, size_t expected_samps, double expected_time, rx_metadata_t& rx_md);
+void handleRxBuffer(size_t n_samps_in_rx_buff, rx_metadata_t& rx_md, double expected_time, Chirp& chirp, complex<float>* buff, complex<float>* sample_sum, float& inversion_phase);
+bool writeRawPulse(size_t n_samps_in_rx_buff, rx_metadata_t& rx_md, double expected_time, const complex<float>* buff, ofstream& outfile, ofstream& metafile);
+void pooledRxLoop(Sdr& sdr, Chirp& chirp, RxWorkerPool& rx_pool, PulseTimeline& timeline);
+void multiChannelRxLoop(Sdr& sdr, Chirp& chirp, vector<unique_ptr<TraceStream>>& streams, PulseTimeline& timeline);
+void scheduledRxLoop(Sdr& sdr, Chirp& chirp, complex<float>* buff, vector<unique_ptr<TraceStream>>& streams, PulseTimeline& timeline);
+void printNoiseStats();
+void printDirectPath();
+void saveLoopbackCalibration();
+void monitorTrace(const complex<float>* trace, long int pulse_num, int trace_presums);
+bool checkForFullSampleSum(Chirp& chirp, complex<float>* sample_sum, ofstream& outfile);
 void splitOutputFiles(Chirp& chirp, ofstream& outfile, string& current_filename, int& save_file_index);
-void wrapUp(boost::asio::posix::stream_descriptor& gps_stream, ofstream& outfile, string& current_filename, boost::thread_group& transmit_thread);
+void wrapUp(boost::asio::posix::stream_descriptor& gps_stream, ofstream& outfile, string& current_filename, boost::thread_group& scheduler_threads);
@@ -0,0 +1,46 @@
+#include <chrono>
+#include "file_merge.hpp"
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        cout << "Usage: " << argv[0] << " [--no-verify] [--chunk-mb N] <output.bin> <input.bin>..." << endl;
+        cout << "Concatenates split output files (e.g. rx_samps.bin.0, rx_samps.bin.1, ...) in the given order." << endl;
+        cout << "Data is shared (reflink) or copied in the kernel where the filesystem supports it, and every" << endl;
+        cout << "chunk of the output is checked against the input unless --no-verify is given." << endl;
+        cout << "The output must not exist yet." << endl;
+        return 1;
+    }
+
+    int arg = 1;
+    bool verify = true;
+    size_t chunk_size = 64 << 20;
+    while (arg < argc && string(argv[arg]).rfind("--", 0) == 0) {
+        string option = argv[arg++];
+        if (option == "--no-verify") {
+            verify = false;
+        } else if (option == "--chunk-mb" && arg < argc) {
+            chunk_size = stoul(argv[arg++]) << 20;
+        } else {
+            cout << "ERROR: Unknown option " << option << endl;
+            return 1;
+        }
+    }
+    if (argc - arg < 2) {
+        cout << "ERROR: Give an output file and at least one input file." << endl;
+        return 1;
+    }
+
+    try {
+        string output_filename = argv[arg++];
+        vector<string> inputs(argv + arg, argv + argc);
+        auto start = chrono::steady_clock::now();
+        MergeStats stats = merge_files(inputs, output_filename, chunk_size, verify);
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "[MERGE] " << inputs.size() << " files to " << output_filename << ": " << stats.summary() << endl;
+        cout << "[MERGE] " << elapsed << " s (" << stats.bytes / 1e6 / max(elapsed, 1e-9) << " MB/s)" << endl;
+    } catch (const exception& e) {
+        cout << "ERROR: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include "noise_stats.hpp"
+
+/**
+ * @brief Creates the statistics file
+ *
+ * Throws runtime_error if the file can't be created.
+ * @param filename File the summaries are appended to
+ * @param samps_per_trace Number of samples in each trace
+ * @param decimation Keep statistics for every decimation-th RX sample only
+ * @param traces_per_summary Number of traces in each summary window
+ */
+NoiseStats::NoiseStats(const string& filename, size_t samps_per_trace, uint32_t decimation, uint32_t traces_per_summary) :
+  decimation(decimation), traces_per_summary(traces_per_summary), num_traces(0), next_trace(0), last_noise_floor(0),
+  num_summaries(0) {
+  if (decimation < 1 || traces_per_summary < 2) {
+    throw invalid_argument("Noise statistics need decimation >= 1 and at least 2 traces per summary.");
+  }
+  outfile.open(filename, ofstream::binary);
+  if (!outfile.is_open()) {
+    throw runtime_error("Could not create noise statistics file " + filename);
+  }
+  size_t num_bins = (samps_per_trace + decimation - 1) / decimation;
+  mean.resize(num_bins, 0);
+  m2.resize(num_bins, 0);
+  power_sum.resize(num_bins, 0);
+  last_summary.resize(num_bins);
+}
+
+/**
+ * @brief Adds one presummed trace to the current window, writing a summary once the window is full
+ *
+ * @param trace samps_per_trace samples
+ * @return Returns true if this trace completed a summary
+ */
+bool NoiseStats::addTrace(const complex<float>* trace) {
+  num_traces++;
+  for (size_t b = 0; b < mean.size(); b++) {
+    complex<double> x = trace[b * decimation];
+    complex<double> delta = x - mean[b];
+    mean[b] += delta / (double) num_traces;
+    m2[b] += real(delta * conj(x - mean[b]));
+    power_sum[b] += norm(x);
+  }
+  next_trace++;
+
+  if (num_traces == traces_per_summary) {
+    writeSummary();
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Writes the statistics of the current window and starts a new one
+ */
+void NoiseStats::writeSummary() {
+  vector<float> variances(mean.size());
+  for (size_t b = 0; b < mean.size(); b++) {
+    NoiseBinStats& stats = last_summary[b];
+    stats.mean_re = real(mean[b]);
+    stats.mean_im = imag(mean[b]);
+    stats.variance = m2[b] / (num_traces - 1);
+    stats.power = power_sum[b] / num_traces;
+    variances[b] = stats.variance;
+  }
+  nth_element(variances.begin(), variances.begin() + variances.size() / 2, variances.end());
+  last_noise_floor = variances[variances.size() / 2];
+
+  NoiseSummaryHeader header;
+  header.magic = NOISE_STATS_MAGIC;
+  header.num_bins = mean.size();
+  header.decimation = decimation;
+  header.num_traces = num_traces;
+  header.first_trace = next_trace - num_traces;
+  header.noise_floor = last_noise_floor;
+  header.host_time = chrono::duration<double>(chrono::system_clock::now().time_since_epoch()).count();
+  outfile.write((const char*) &header, sizeof(header));
+  outfile.write((const char*) last_summary.data(), last_summary.size() * sizeof(NoiseBinStats));
+  outfile.flush();
+  num_summaries++;
+
+  fill(mean.begin(), mean.end(), 0);
+  fill(m2.begin(), m2.end(), 0);
+  fill(power_sum.begin(), power_sum.end(), 0);
+  num_traces = 0;
+}
+
+const vector<NoiseBinStats>& NoiseStats::getLastSummary() const {return last_summary;}
+double NoiseStats::getLastNoiseFloor() const {return last_noise_floor;}
+uint64_t NoiseStats::getNumSummaries() const {return num_summaries;}
@@ -0,0 +1,60 @@
+#ifndef NOISE_STATS_HPP
+#define NOISE_STATS_HPP
+
+#include <complex>
+#include <fstream>
+#include "common.hpp"
+
+// The noise statistics file is a sequence of summaries. Each summary is a NoiseSummaryHeader followed
+// by num_bins NoiseBinStats, one per range bin (RX sample index bin * decimation).
+const uint32_t NOISE_STATS_MAGIC = 0x54534e52; // "RNST"
+
+struct NoiseSummaryHeader {
+    uint32_t magic;
+    uint32_t num_bins;
+    uint32_t decimation;   // Range bin b is RX sample b * decimation
+    uint32_t num_traces;   // Presummed traces in this summary
+    int64_t first_trace;   // Index of the first trace in this summary
+    double noise_floor;    // Median variance over all range bins (same units as variance)
+    double host_time;      // [s] Host (UNIX) time the summary was written
+};
+
+struct NoiseBinStats {
+    float mean_re;  // Mean of the trace samples (coherent signal)
+    float mean_im;
+    float variance; // Variance around the mean (incoherent noise power)
+    float power;    // Mean power |x|^2 (signal + noise)
+};
+
+static_assert(sizeof(NoiseSummaryHeader) == 40, "NoiseSummaryHeader layout changed");
+static_assert(sizeof(NoiseBinStats) == 16, "NoiseBinStats layout changed");
+
+// Streaming per-range-bin statistics of the presummed traces (Welford's algorithm), written out as
+// one summary every traces_per_summary traces and then restarted, so each summary covers one window.
+class NoiseStats {
+  public:
+    NoiseStats(const string& filename, size_t samps_per_trace, uint32_t decimation, uint32_t traces_per_summary);
+
+    bool addTrace(const complex<float>* trace);
+
+    const vector<NoiseBinStats>& getLastSummary() const;
+    double getLastNoiseFloor() const;
+    uint64_t getNumSummaries() const;
+
+  private:
+    void writeSummary();
+
+    ofstream outfile;
+    uint32_t decimation;
+    uint32_t traces_per_summary;
+    vector<complex<double>> mean;
+    vector<double> m2;         // Sum of squared distances from the mean
+    vector<double> power_sum;
+    uint32_t num_traces;       // Traces in the current window
+    int64_t next_trace;        // Index of the next trace added
+    vector<NoiseBinStats> last_summary;
+    double last_noise_floor;
+    uint64_t num_summaries;
+};
+
+#endif // NOISE_STATS_HPP
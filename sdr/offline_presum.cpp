@@ -0,0 +1,39 @@
+#include <iostream>
+#include <string>
+#include "raw_capture.hpp"
+#include "chirp.hpp"
+
+using namespace std;
+
+int main(int argc, char *argv[]) {
+    if (argc < 5 || argc > 6) {
+        cout << "Usage: " << argv[0] << " <config.yaml> <raw_samps.bin> <raw_meta.bin> <output.bin> [num_threads]" << endl;
+        cout << "Applies phase inversion and presumming to data recorded with FILES:raw_capture enabled." << endl;
+        cout << "config.yaml must be the configuration file the capture was recorded with (num_presums and phase_dithering are read from it)." << endl;
+        cout << "If the capture was split into multiple files, merge them into raw_samps.bin first." << endl;
+        cout << "The output is identical to what the radar would have written with raw_capture disabled." << endl;
+        return 1;
+    }
+
+    unsigned int num_threads = thread::hardware_concurrency();
+    if (argc == 6) {
+        num_threads = atoi(argv[5]);
+    }
+    if (num_threads == 0) {
+        num_threads = 1;
+    }
+
+    Chirp chirp(argv[1]);
+    cout << "Presumming with num_presums = " << chirp.getNumPresums() << ", phase_dithering = " << chirp.getPhaseDither();
+    cout << " on " << num_threads << " threads" << endl;
+
+    try {
+        long int num_traces = presum_raw_capture(argv[2], argv[3], argv[4], chirp.getNumPresums(), chirp.getPhaseDither(), num_threads);
+        cout << num_traces << " traces written to " << argv[4] << endl;
+    } catch (const exception& e) {
+        cout << "ERROR: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
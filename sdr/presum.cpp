@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <functional>
+#include "presum.hpp"
+
+using namespace std;
+
+/**
+ * @brief Applies phase inversion and presum scaling to one pulse and adds it to the running sum
+ *
+ * This is the only place the per-pulse arithmetic is done, so that the inline RX loop and the
+ * offline raw capture processing produce byte-identical output. The pulse buffer is modified
+ * in place.
+ * @param buff Samples of one error-free pulse (modified in place)
+ * @param sample_sum Running sum of the current presum group
+ * @param n_samps Number of samples in buff and sample_sum
+ * @param num_presums Number of pulses averaged into each trace
+ * @param phase_dither True if phase dithering is enabled
+ * @param inversion_phase Phase to use for phase inversion of this pulse (ignored if phase_dither is false)
+ */
+void presum_pulse(complex<float>* buff, complex<float>* sample_sum, size_t n_samps,
+                  int num_presums, bool phase_dither, float inversion_phase) {
+  if (phase_dither) {
+    // Undo phase modulation and divide by num_presums in one go
+    complex<float> phase = polar((float) 1.0/num_presums, inversion_phase);
+    transform(buff, buff + n_samps, buff, [&](complex<float> s) { return phase * s; });
+  } else if (num_presums != 1) {
+    // Only divide by num_presums
+    complex<float> scale(1.0/num_presums);
+    transform(buff, buff + n_samps, buff, [&](complex<float> s) { return scale * s; });
+  }
+
+  // Add to sample_sum
+  transform(sample_sum, sample_sum + n_samps, buff, sample_sum, plus<complex<float>>());
+}
+
+/**
+ * @brief Adds one pulse into several running sums, each with its own complex weight
+ *
+ * Used to decode several transmitters' phase codes from the same pulse: the weight of each sum is
+ * polar(1/num_presums, decode phase). The pulse is read in blocks that stay in L1 cache while every
+ * sum is updated, so K codes cost about one pass over the pulse. The arithmetic is written out on the
+ * real and imaginary parts so the inner loop vectorizes. The pulse is not modified.
+ * @param buff Samples of one error-free pulse
+ * @param sums num_codes running sums of n_samps samples
+ * @param weights Weight of each sum
+ * @param num_codes Number of sums
+ * @param n_samps Number of samples in buff and each sum
+ */
+void presum_codes(const complex<float>* buff, complex<float>* const* sums, const complex<float>* weights,
+                  size_t num_codes, size_t n_samps) {
+  const size_t block = 1024; // 8 KiB of samples
+  const float* in = reinterpret_cast<const float*>(buff);
+  for (size_t start = 0; start < n_samps; start += block) {
+    size_t end = min(start + block, n_samps);
+    for (size_t k = 0; k < num_codes; k++) {
+      float* out = reinterpret_cast<float*>(sums[k]);
+      float wr = weights[k].real();
+      float wi = weights[k].imag();
+      for (size_t i = start; i < end; i++) {
+        float xr = in[2 * i];
+        float xi = in[2 * i + 1];
+        out[2 * i] += xr * wr - xi * wi;
+        out[2 * i + 1] += xr * wi + xi * wr;
+      }
+    }
+  }
+}
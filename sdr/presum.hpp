@@ -0,0 +1,15 @@
+#ifndef PRESUM_HPP
+#define PRESUM_HPP
+
+#include <complex>
+#include "common.hpp"
+
+// Undo phase modulation of one error-free pulse, scale by 1/num_presums, and add it into sample_sum
+void presum_pulse(complex<float>* buff, complex<float>* sample_sum, size_t n_samps,
+                  int num_presums, bool phase_dither, float inversion_phase);
+
+// Decode one pulse with several codes at once: sums[k] += buff * weights[k] (one pass over buff)
+void presum_codes(const complex<float>* buff, complex<float>* const* sums, const complex<float>* weights,
+                  size_t num_codes, size_t n_samps);
+
+#endif // PRESUM_HPP
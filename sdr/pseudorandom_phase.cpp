@@ -1,5 +1,8 @@
 #include <random>
+#include <cmath>
+#include <stdexcept>
 #include "pseudorandom_phase.hpp"
+#include "utils.hpp"
 
 using namespace std;
 
@@ -20,4 +23,68 @@ vector<float> get_next_n_phases(int n, bool transmit){
         ph[i] = get_next_phase(transmit);
     }
     return ph;
-}
\ No newline at end of file
+}
+
+// Restart the generator from the beginning of its sequence (used to rebuild the
+// dither sequence when processing a raw capture offline)
+void reset_phase_generator(bool transmit){
+    if (transmit) {
+        random_generator_tx.seed(PHASE_SEED);
+    } else {
+        random_generator_rx.seed(PHASE_SEED);
+    }
+}
+/**
+ * @brief Constructs a family of num_codes phase codes
+ *
+ * Phases are computed from the code and pulse index alone, so TX and RX threads (and offline
+ * processing) agree on every pulse without sharing a generator.
+ * @param family Kind of code
+ * @param num_codes Number of codes (= number of TX channels), at least 1
+ * @param seed Seed of the random codes (unused by DFT codes)
+ */
+PhaseCodes::PhaseCodes(PhaseCodeFamily family, size_t num_codes, uint64_t seed) :
+    family(family), num_codes(num_codes), seed(seed) {
+    if (num_codes < 1) {
+        throw invalid_argument("At least one phase code is needed.");
+    }
+}
+
+/**
+ * @brief Returns the phase of a code for a pulse
+ *
+ * Code 0 of the DFT family is all zeros, so the first TX channel is unchanged. Random codes are
+ * uniform in [0, 2*pi) and drawn from a splitmix64 hash of seed, code and pulse (like PRI jitter).
+ * @param code Code index (TX channel)
+ * @param pulse Pulse index
+ * @return [rad] Phase to add on TX (and subtract on RX)
+ */
+float PhaseCodes::getPhase(size_t code, long int pulse) const {
+    if (family == PHASE_CODE_DFT) {
+        return (float) (2 * M_PI * ((code * (uint64_t) pulse) % num_codes) / num_codes);
+    }
+    return (float) (2 * M_PI * splitmix64_uniform(seed + ((uint64_t) code << 40) + (uint64_t) pulse));
+}
+
+size_t PhaseCodes::getNumCodes() const {return num_codes;}
+
+/**
+ * @return Number of consecutive pulses over which the codes are exactly orthogonal (0 for random codes)
+ */
+size_t PhaseCodes::getPeriod() const {return (family == PHASE_CODE_DFT) ? num_codes : 0;}
+
+PhaseCodeFamily PhaseCodes::getFamily() const {return family;}
+
+/**
+ * @brief Parses a phase code family name ("dft" or "random")
+ *
+ * Throws invalid_argument for anything else.
+ */
+PhaseCodeFamily parse_phase_code_family(const string& name) {
+    if (name == "dft") {
+        return PHASE_CODE_DFT;
+    } else if (name == "random") {
+        return PHASE_CODE_RANDOM;
+    }
+    throw invalid_argument("Unknown phase code family '" + name + "' (dft, random).");
+}
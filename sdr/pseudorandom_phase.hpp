@@ -5,10 +5,35 @@
 
 // Random generators for phaase modulation
 // Seed is identical (and hard-coded) so they will each produce the same sequence
-inline mt19937 random_generator_tx(0); // Used on transmit for phase modulation
-inline mt19937 random_generator_rx(0); // Used on receive for inverting phase modulation
+const unsigned int PHASE_SEED = 0;
+inline mt19937 random_generator_tx(PHASE_SEED); // Used on transmit for phase modulation
+inline mt19937 random_generator_rx(PHASE_SEED); // Used on receive for inverting phase modulation
 
 float get_next_phase(bool transmit); // Return a single float generated from random_generator
 vector<float> get_next_n_phases(int n, bool transmit); // Return a vector of the next n phases from random_generator
+void reset_phase_generator(bool transmit); // Restart random_generator from the beginning of its sequence
+
+// Phase codes that tell simultaneous transmitters apart (one code per TX channel, see CHIRP:tx_phase_codes)
+enum PhaseCodeFamily {
+    PHASE_CODE_DFT,    // Code k advances by 2*pi*k/K per pulse: exactly orthogonal over every K consecutive pulses
+    PHASE_CODE_RANDOM  // Independent pseudo-random phases per code: orthogonal on average (cross-talk ~ 1/sqrt(presums))
+};
+
+class PhaseCodes {
+  public:
+    PhaseCodes(PhaseCodeFamily family, size_t num_codes, uint64_t seed = 0);
+
+    float getPhase(size_t code, long int pulse) const;
+    size_t getNumCodes() const;
+    size_t getPeriod() const;
+    PhaseCodeFamily getFamily() const;
+
+  private:
+    PhaseCodeFamily family;
+    size_t num_codes;
+    uint64_t seed;
+};
+
+PhaseCodeFamily parse_phase_code_family(const string& name);
 
 #endif // PSEUDORANDOM_PHASE_HPP
\ No newline at end of file
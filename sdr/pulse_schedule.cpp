@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <cmath>
+#include "presum.hpp"
+#include "pulse_schedule.hpp"
+
+/**
+ * @brief Builds the schedule from the SCHEDULE section of the configuration file
+ *
+ * Each waveform takes the GENERATE parameters, overridden by any GENERATE keys given with the waveform, and
+ * may set its own tx_duration (default: its pulse_length), rx_duration and num_presums (default: from CHIRP),
+ * rx_gain and tx_gain for gain staging (default: the configured gains) and freq for stepped-frequency
+ * operation (default: the configured center frequency).
+ * All TX chirps are generated here. Throws invalid_argument for an invalid schedule, including a waveform
+ * that doesn't fit in CHIRP:pulse_rep_int.
+ * @param config Configuration file
+ * @param tx_rate [Hz] TX sample rate
+ * @param rx_rate [Hz] RX sample rate
+ */
+PulseSchedule::PulseSchedule(const YAML::Node& config, double tx_rate, double rx_rate) {
+  YAML::Node schedule = config["SCHEDULE"];
+  YAML::Node waveform_list = schedule["waveforms"];
+  if (!waveform_list || !waveform_list.IsSequence() || waveform_list.size() == 0) {
+    throw invalid_argument("SCHEDULE:waveforms must list at least one waveform.");
+  }
+  gain_settle_time = schedule["gain_settle_time"].as<double>(0);
+  lo_settle_time = schedule["lo_settle_time"].as<double>(0);
+  if (gain_settle_time < 0 || lo_settle_time < 0) {
+    throw invalid_argument("SCHEDULE:gain_settle_time and lo_settle_time must be >= 0.");
+  }
+  YAML::Node chirp_config = config["CHIRP"];
+  double pulse_rep_int = chirp_config["pulse_rep_int"].as<double>();
+  double tx_lead = chirp_config["tx_lead"].as<double>();
+  double tr_off_trail = chirp_config["tr_off_trail"].as<double>();
+
+  for (const YAML::Node& node : waveform_list) {
+    Waveform waveform;
+    waveform.name = node["name"].as<string>();
+    for (const Waveform& other : waveforms) {
+      if (other.name == waveform.name) {
+        throw invalid_argument("Waveform '" + waveform.name + "' is defined twice.");
+      }
+    }
+    YAML::Node generate = YAML::Clone(config["GENERATE"]);
+    for (const auto& entry : node) {
+      string key = entry.first.as<string>();
+      if (key != "name" && key != "tx_duration" && key != "rx_duration" && key != "num_presums" &&
+          key != "rx_gain" && key != "tx_gain" && key != "freq") {
+        generate[key] = entry.second;
+      }
+    }
+    waveform.chirp = load_chirp_params(generate);
+    waveform.tx_duration = node["tx_duration"].as<double>(waveform.chirp.pulse_length);
+    waveform.rx_duration = node["rx_duration"].as<double>(chirp_config["rx_duration"].as<double>());
+    waveform.num_presums = node["num_presums"].as<int>(chirp_config["num_presums"].as<int>(1));
+    waveform.rx_gain = node["rx_gain"].as<double>(NAN);
+    waveform.tx_gain = node["tx_gain"].as<double>(NAN);
+    waveform.freq = node["freq"].as<double>(NAN);
+    waveform.num_tx_samps = tx_rate * waveform.tx_duration;
+    waveform.num_rx_samps = rx_rate * waveform.rx_duration;
+    if (waveform.num_tx_samps == 0 || waveform.num_rx_samps == 0 || waveform.num_presums < 1) {
+      throw invalid_argument("Waveform '" + waveform.name + "' has an empty TX or RX window or num_presums < 1.");
+    }
+    double min_pri = max(waveform.rx_duration, tx_lead + waveform.tx_duration + tr_off_trail);
+    if (!(pulse_rep_int > min_pri)) {
+      throw invalid_argument("Waveform '" + waveform.name + "' needs a pulse_rep_int longer than " + to_string(min_pri) + " s.");
+    }
+    waveform.tx_chirp = generate_chirp(waveform.chirp);
+    waveform.tx_chirp.resize(waveform.num_tx_samps, complex<float>(0, 0));
+    waveforms.push_back(waveform);
+  }
+
+  // The sequence defaults to each waveform once, in order
+  YAML::Node sequence_list = schedule["sequence"];
+  if (!sequence_list) {
+    for (size_t i = 0; i < waveforms.size(); i++) {
+      sequence.push_back(i);
+    }
+  }
+  for (const YAML::Node& entry : sequence_list) {
+    string name = entry.as<string>();
+    auto it = find_if(waveforms.begin(), waveforms.end(), [&](const Waveform& w) { return w.name == name; });
+    if (it == waveforms.end()) {
+      throw invalid_argument("SCHEDULE:sequence refers to unknown waveform '" + name + "'.");
+    }
+    sequence.push_back(it - waveforms.begin());
+  }
+  if (sequence.empty()) {
+    throw invalid_argument("SCHEDULE:sequence is empty.");
+  }
+}
+
+size_t PulseSchedule::getNumWaveforms() const {return waveforms.size();}
+const Waveform& PulseSchedule::getWaveform(size_t index) const {return waveforms[index];}
+size_t PulseSchedule::getSequenceLength() const {return sequence.size();}
+
+/**
+ * @param index Waveform index
+ * @return Number of pulses in one repetition of the sequence that use the waveform
+ */
+size_t PulseSchedule::getSequenceCount(size_t index) const {
+  return count(sequence.begin(), sequence.end(), index);
+}
+
+/**
+ * @param pulse Pulse index (including errored pulses)
+ * @return Index of the waveform used for the pulse
+ */
+size_t PulseSchedule::getWaveformIndex(long int pulse) const {
+  return sequence[pulse % sequence.size()];
+}
+
+const Waveform& PulseSchedule::getPulseWaveform(long int pulse) const {
+  return waveforms[getWaveformIndex(pulse)];
+}
+
+size_t PulseSchedule::getMaxTxSamps() const {
+  size_t max_samps = 0;
+  for (const Waveform& waveform : waveforms) {
+    max_samps = max(max_samps, waveform.num_tx_samps);
+  }
+  return max_samps;
+}
+
+size_t PulseSchedule::getMaxRxSamps() const {
+  size_t max_samps = 0;
+  for (const Waveform& waveform : waveforms) {
+    max_samps = max(max_samps, waveform.num_rx_samps);
+  }
+  return max_samps;
+}
+
+/**
+ * @return Returns true if any waveform sets its own RX gain
+ */
+bool PulseSchedule::stagesRxGain() const {
+  return any_of(waveforms.begin(), waveforms.end(), [](const Waveform& w) { return !isnan(w.rx_gain); });
+}
+
+/**
+ * @return Returns true if any waveform sets its own TX gain
+ */
+bool PulseSchedule::stagesTxGain() const {
+  return any_of(waveforms.begin(), waveforms.end(), [](const Waveform& w) { return !isnan(w.tx_gain); });
+}
+
+double PulseSchedule::getGainSettleTime() const {return gain_settle_time;}
+
+/**
+ * @return Returns true if any waveform sets its own center frequency
+ */
+bool PulseSchedule::stepsFreq() const {
+  return any_of(waveforms.begin(), waveforms.end(), [](const Waveform& w) { return !isnan(w.freq); });
+}
+
+double PulseSchedule::getLoSettleTime() const {return lo_settle_time;}
+
+/**
+ * @brief Opens the output file of a stream
+ *
+ * Throws runtime_error if the file can't be created.
+ * @param filename Output file (replaced)
+ * @param samps Samples per trace
+ * @param num_presums Pulses averaged into each trace
+ */
+TraceStream::TraceStream(const string& filename, size_t samps, int num_presums) :
+  filename(filename), sum(samps, complex<float>(0, 0)), last_trace(samps), num_presums(num_presums),
+  pulses_pending(0), traces_written(0) {
+  file.open(filename, ofstream::binary);
+  if (!file.is_open()) {
+    throw runtime_error("Could not create " + filename);
+  }
+}
+
+/**
+ * @brief Inverts and adds an error-free pulse, and writes the trace once num_presums pulses are in
+ *
+ * @param pulse getSamps() received samples (modified in place by the phase inversion)
+ * @param phase_dither True if phase dithering is enabled
+ * @param inversion_phase Phase to use for phase inversion of this pulse
+ * @return Returns true if the pulse completed a trace, which is then available from getTrace()
+ */
+bool TraceStream::addPulse(complex<float>* pulse, bool phase_dither, float inversion_phase) {
+  presum_pulse(pulse, sum.data(), sum.size(), num_presums, phase_dither, inversion_phase);
+  return completePulse();
+}
+
+/**
+ * @brief Counts a pulse that was added into sum, and writes the trace once num_presums pulses are in
+ *
+ * @return Returns true if the pulse completed a trace
+ */
+bool TraceStream::completePulse() {
+  if (++pulses_pending < num_presums) {
+    return false;
+  }
+  file.write((const char*) sum.data(), sum.size() * sizeof(complex<float>));
+  swap(sum, last_trace);
+  fill(sum.begin(), sum.end(), complex<float>(0, 0));
+  pulses_pending = 0;
+  traces_written++;
+  return true;
+}
+
+/**
+ * @brief Constructs the decoded streams of one RX channel
+ *
+ * @param streams One stream per code. Every stream must have the same number of samples and presums.
+ */
+CodedTraceStreams::CodedTraceStreams(const vector<TraceStream*>& streams) :
+  streams(streams), sums(streams.size()), weights(streams.size()) {}
+
+/**
+ * @brief Decodes an error-free pulse into one stream per code
+ *
+ * The pulse is multiplied by decoders[k] / num_presums and added into streams[k], in one pass over the
+ * pulse (see presum_codes()).
+ * @param pulse Received samples (not modified)
+ * @param decoders Unit phasor that undoes each code (and the phase dither) for this pulse
+ * @return Returns true if the pulse completed a trace in every stream
+ */
+bool CodedTraceStreams::addPulse(const complex<float>* pulse, const vector<complex<float>>& decoders) {
+  // The sum buffers trade places with the last trace when one is written, so they are looked up every pulse
+  for (size_t k = 0; k < streams.size(); k++) {
+    sums[k] = streams[k]->sum.data();
+    weights[k] = decoders[k] / (float) streams[k]->num_presums;
+  }
+  presum_codes(pulse, sums.data(), weights.data(), streams.size(), streams[0]->getSamps());
+  bool trace_done = true;
+  for (TraceStream* stream : streams) {
+    trace_done = stream->completePulse() && trace_done;
+  }
+  return trace_done;
+}
+
+const complex<float>* TraceStream::getTrace() const {return last_trace.data();}
+string TraceStream::getFilename() const {return filename;}
+size_t TraceStream::getSamps() const {return sum.size();}
+long int TraceStream::getTracesWritten() const {return traces_written;}
+int TraceStream::getPulsesPending() const {return pulses_pending;}
+bool TraceStream::good() const {return file.good();}
+void TraceStream::close() {file.close();}
+
+/**
+ * @brief Returns the output file of a named stream: save_loc with "_<name>" before the extension
+ *
+ * @param save_loc Output file of a normal run (e.g. "data/rx_samps.bin")
+ * @param name Stream name
+ * @return e.g. "data/rx_samps_near.bin"
+ */
+string stream_filename(const string& save_loc, const string& name) {
+  size_t slash = save_loc.find_last_of('/');
+  size_t dot = save_loc.find_last_of('.');
+  if (dot == string::npos || (slash != string::npos && dot < slash)) {
+    return save_loc + "_" + name;
+  }
+  return save_loc.substr(0, dot) + "_" + name + save_loc.substr(dot);
+}
@@ -0,0 +1,94 @@
+#ifndef PULSE_SCHEDULE_HPP
+#define PULSE_SCHEDULE_HPP
+
+#include <fstream>
+#include "yaml-cpp/yaml.h"
+#include "chirp_generator.hpp"
+#include "buffer_pool.hpp"
+#include "common.hpp"
+
+// One waveform of a waveform-agile schedule (SCHEDULE:waveforms)
+struct Waveform {
+    string name;
+    ChirpParams chirp;              // GENERATE parameters with this waveform's overrides
+    double tx_duration;             // [s] Transmitted length (chirp and zero padding)
+    double rx_duration;             // [s] RX window
+    size_t num_tx_samps;
+    size_t num_rx_samps;
+    int num_presums;                // Pulses of this waveform averaged into each of its traces
+    double rx_gain;                 // [dB] Gain staging: RX gain for this waveform (NAN to keep the configured gain)
+    double tx_gain;                 // [dB] Gain staging: TX gain for this waveform (NAN to keep the configured gain)
+    double freq;                    // [Hz] Stepped frequency: RF center frequency of this sub-band (NAN to keep the configured one)
+    aligned_sample_vector tx_chirp; // num_tx_samps samples before any phase modulation, generated once
+};
+
+// Repeating table of waveforms, indexed by pulse number. Errored pulses are counted too, so the
+// TX, RX command and RX threads always agree on the waveform of a pulse.
+class PulseSchedule {
+  public:
+    PulseSchedule(const YAML::Node& config, double tx_rate, double rx_rate);
+
+    size_t getNumWaveforms() const;
+    const Waveform& getWaveform(size_t index) const;
+    size_t getSequenceLength() const;
+    size_t getSequenceCount(size_t index) const;
+    size_t getWaveformIndex(long int pulse) const;
+    const Waveform& getPulseWaveform(long int pulse) const;
+    size_t getMaxTxSamps() const;
+    size_t getMaxRxSamps() const;
+    bool stagesRxGain() const;
+    bool stagesTxGain() const;
+    double getGainSettleTime() const;
+    bool stepsFreq() const;
+    double getLoSettleTime() const;
+
+  private:
+    vector<Waveform> waveforms;
+    vector<size_t> sequence; // Waveform index of each pulse in the table
+    double gain_settle_time; // [s] Time a staged gain change needs before the window it applies to
+    double lo_settle_time;   // [s] Time a frequency step needs before the window it applies to
+};
+
+// Presum accumulator and output file of one stream of traces (e.g. one waveform of a schedule)
+class TraceStream {
+  public:
+    TraceStream(const string& filename, size_t samps, int num_presums);
+
+    bool addPulse(complex<float>* pulse, bool phase_dither, float inversion_phase);
+    friend class CodedTraceStreams;
+    const complex<float>* getTrace() const;
+    string getFilename() const;
+    size_t getSamps() const;
+    long int getTracesWritten() const;
+    int getPulsesPending() const;
+    bool good() const;
+    void close();
+
+  private:
+    bool completePulse();
+
+    string filename;
+    ofstream file;
+    aligned_sample_vector sum; // Allocated once, zeroed after each trace is written
+    aligned_sample_vector last_trace;
+    int num_presums;
+    int pulses_pending;        // Pulses in sum so far
+    long int traces_written;
+};
+
+// The streams one RX channel is decoded into, one per code (e.g. per transmitter of a phase-coded capture)
+class CodedTraceStreams {
+  public:
+    CodedTraceStreams(const vector<TraceStream*>& streams);
+
+    bool addPulse(const complex<float>* pulse, const vector<complex<float>>& decoders);
+
+  private:
+    vector<TraceStream*> streams;
+    vector<complex<float>*> sums;   // presum_codes() arguments, sized once and refilled for every pulse
+    vector<complex<float>> weights;
+};
+
+string stream_filename(const string& save_loc, const string& name);
+
+#endif // PULSE_SCHEDULE_HPP
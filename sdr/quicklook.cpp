@@ -0,0 +1,98 @@
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+#include <fcntl.h>
+#include <unistd.h>
+#include "quicklook.hpp"
+
+/**
+ * @brief Creates (or truncates) the quicklook file
+ *
+ * Throws runtime_error if the file can't be created.
+ * @param filename Quicklook file to write. Put it on a tmpfs (e.g. /dev/shm) to keep it off the disk.
+ * @param samps_per_trace Number of samples in each trace
+ * @param width Number of range bins per row (at most samps_per_trace)
+ * @param num_rows Number of rows kept in the file
+ * @param traces_per_row Number of traces stacked into each row
+ * @param row_period [s] Nominal time between rows (only recorded in the header, for readers)
+ */
+Quicklook::Quicklook(const string& filename, size_t samps_per_trace, uint32_t width, uint32_t num_rows,
+                     uint32_t traces_per_row, double row_period) : traces_in_row(0) {
+  if (width < 1 || width > samps_per_trace || num_rows < 1 || traces_per_row < 1) {
+    throw invalid_argument("Quicklook width must be between 1 and the number of RX samples; rows and traces per row must be >= 1.");
+  }
+  fd = open(filename.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+  if (fd < 0) {
+    throw runtime_error("Could not create quicklook file " + filename + ": " + strerror(errno));
+  }
+
+  memset(&header, 0, sizeof(header));
+  header.magic = QUICKLOOK_MAGIC;
+  header.version = QUICKLOOK_VERSION;
+  header.width = width;
+  header.num_rows = num_rows;
+  header.traces_per_row = traces_per_row;
+  header.samps_per_trace = samps_per_trace;
+  header.row_period = row_period;
+
+  for (uint32_t b = 0; b <= width; b++) {
+    bin_edges.push_back((b * samps_per_trace) / width);
+  }
+  power_sum.resize(width, 0);
+  row.resize(width, 0);
+
+  // Write the header and an empty image, so the file has its final size from the start
+  if (pwrite(fd, &header, sizeof(header), 0) != sizeof(header) ||
+      ftruncate(fd, sizeof(header) + (off_t) num_rows * width * sizeof(float)) != 0) {
+    close(fd);
+    throw runtime_error("Could not write quicklook file " + filename + ": " + strerror(errno));
+  }
+}
+
+Quicklook::~Quicklook() {
+  close(fd);
+}
+
+/**
+ * @brief Adds one presummed trace to the current row, writing the row once it is complete
+ *
+ * @param trace samps_per_trace samples
+ */
+void Quicklook::addTrace(const complex<float>* trace) {
+  for (uint32_t b = 0; b < header.width; b++) {
+    float sum = 0;
+    for (size_t i = bin_edges[b]; i < bin_edges[b + 1]; i++) {
+      sum += norm(trace[i]);
+    }
+    power_sum[b] += sum;
+  }
+
+  if (++traces_in_row == header.traces_per_row) {
+    writeRow();
+  }
+}
+
+/**
+ * @brief Converts the accumulated power to dB and writes it as the next row
+ *
+ * Write errors are reported but not fatal: the quicklook is a convenience and must never stop a capture.
+ */
+void Quicklook::writeRow() {
+  for (uint32_t b = 0; b < header.width; b++) {
+    double mean_power = power_sum[b] / ((bin_edges[b + 1] - bin_edges[b]) * (double) traces_in_row);
+    row[b] = 10 * log10(max(mean_power, 1e-30));
+  }
+  fill(power_sum.begin(), power_sum.end(), 0);
+  traces_in_row = 0;
+
+  off_t offset = sizeof(header) + (off_t) (header.rows_written % header.num_rows) * header.width * sizeof(float);
+  size_t row_bytes = header.width * sizeof(float);
+  header.rows_written++;
+  if (pwrite(fd, row.data(), row_bytes, offset) != (ssize_t) row_bytes ||
+      pwrite(fd, &header.rows_written, sizeof(header.rows_written), offsetof(QuicklookHeader, rows_written)) != sizeof(header.rows_written)) {
+    lock_guard<mutex> lock(cout_mutex);
+    cout << "WARNING: Could not write quicklook row " << header.rows_written - 1 << endl;
+  }
+}
+
+uint64_t Quicklook::getRowsWritten() const {return header.rows_written;}
@@ -0,0 +1,51 @@
+#ifndef QUICKLOOK_HPP
+#define QUICKLOOK_HPP
+
+#include <complex>
+#include "common.hpp"
+
+// The quicklook file is a rolling radargram: a QuicklookHeader followed by num_rows rows of width
+// float32 values (log-power in dB). Row k is stored at slot k % num_rows, so the file never grows.
+// rows_written is updated after each row, so readers can tell which slots hold the newest rows.
+const uint32_t QUICKLOOK_MAGIC = 0x4b4c5152; // "RQLK"
+const uint32_t QUICKLOOK_VERSION = 1;
+
+struct QuicklookHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;           // Range bins per row
+    uint32_t num_rows;        // Rows kept in the file
+    uint64_t rows_written;    // Total rows written so far
+    uint32_t traces_per_row;  // Presummed traces stacked into each row
+    uint32_t samps_per_trace; // RX samples per trace (width bins cover all of them)
+    double row_period;        // [s] Nominal time between rows
+    uint8_t reserved[24];
+};
+
+static_assert(sizeof(QuicklookHeader) == 64, "QuicklookHeader layout changed");
+
+// Low-rate radargram for checking the data during a flight. Each trace costs one pass to accumulate
+// power into width range bins; every traces_per_row traces the bins are converted to dB and written
+// out as one row.
+class Quicklook {
+  public:
+    Quicklook(const string& filename, size_t samps_per_trace, uint32_t width, uint32_t num_rows,
+              uint32_t traces_per_row, double row_period);
+    ~Quicklook();
+
+    void addTrace(const complex<float>* trace);
+
+    uint64_t getRowsWritten() const;
+
+  private:
+    void writeRow();
+
+    int fd;
+    QuicklookHeader header;
+    vector<size_t> bin_edges;  // First sample of each range bin (width + 1 entries)
+    vector<double> power_sum;  // Accumulated power of the current row
+    vector<float> row;
+    uint32_t traces_in_row;
+};
+
+#endif // QUICKLOOK_HPP
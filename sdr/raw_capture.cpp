@@ -0,0 +1,127 @@
+#include <fstream>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+#include "raw_capture.hpp"
+#include "utils.hpp"
+#include "presum.hpp"
+#include "pseudorandom_phase.hpp"
+
+using namespace std;
+
+/**
+ * @brief Reads a complete raw capture metadata file
+ *
+ * @param meta_filename Path to the metadata file written by the radar in raw capture mode
+ * @return Vector of records, one per received pulse
+ */
+vector<RawPulseRecord> read_raw_records(const string& meta_filename) {
+  ifstream metafile(meta_filename, ifstream::binary | ifstream::ate);
+  if (!metafile.is_open()) {
+    throw runtime_error("Failed to open raw capture metadata file: " + meta_filename);
+  }
+
+  streamsize n_bytes = metafile.tellg();
+  if (n_bytes % sizeof(RawPulseRecord) != 0) {
+    cout << "WARNING: Metadata file does not contain a whole number of records. The last partial record is ignored." << endl;
+  }
+
+  vector<RawPulseRecord> records(n_bytes / sizeof(RawPulseRecord));
+  metafile.seekg(0);
+  metafile.read((char*) records.data(), records.size() * sizeof(RawPulseRecord));
+  return records;
+}
+
+/**
+ * @brief Applies phase inversion and presumming to a raw capture
+ *
+ * Rebuilds the RX dither sequence from the pulse indices in the metadata file (the RX generator
+ * advances once per received pulse, including error pulses), then splits the presum groups
+ * between worker threads. Each group is processed with presum_pulse() in the same order as the
+ * RX loop would have, so the output is byte-identical to a normal run with the same settings.
+ * Any trailing partial presum group is dropped, exactly as in a normal run.
+ * @param raw_filename Raw samples file (if the capture was split into multiple files, merge them first)
+ * @param meta_filename Metadata file written alongside the raw samples
+ * @param out_filename Path to write the presummed output to
+ * @param num_presums Number of pulses averaged into each trace
+ * @param phase_dither True if phase dithering was enabled for the capture
+ * @param num_threads Number of worker threads to use
+ * @return Number of presummed traces written
+ */
+long int presum_raw_capture(const string& raw_filename, const string& meta_filename, const string& out_filename,
+                            int num_presums, bool phase_dither, unsigned int num_threads) {
+  vector<RawPulseRecord> records = read_raw_records(meta_filename);
+
+  // Inversion phase of each error-free pulse, in the order they appear in the raw file
+  vector<float> inversion_phases;
+  size_t num_rx_samps = 0;
+  reset_phase_generator(false);
+  for (size_t i = 0; i < records.size(); i++) {
+    if (records[i].pulse_index != (int64_t) i) {
+      throw runtime_error("Raw capture metadata is not continuous at record " + to_string(i));
+    }
+    float inversion_phase = 0;
+    if (phase_dither) {
+      inversion_phase = -1.0 * get_next_phase(false); // Same expression as handleRxBuffer() to keep the output identical
+    }
+    if (records[i].error_code != RAW_ERROR_NONE) {
+      continue;
+    }
+    if (num_rx_samps == 0) {
+      num_rx_samps = records[i].num_samps;
+    } else if (records[i].num_samps != num_rx_samps) {
+      throw runtime_error("Raw capture contains pulses of different lengths at record " + to_string(i));
+    }
+    inversion_phases.push_back(inversion_phase);
+  }
+
+  long int num_traces = inversion_phases.size() / num_presums;
+  size_t bytes_per_pulse = num_rx_samps * sizeof(complex<float>);
+
+  int raw_fd = open(raw_filename.c_str(), O_RDONLY);
+  if (raw_fd == -1) {
+    throw runtime_error("Failed to open raw samples file: " + raw_filename);
+  }
+  int out_fd = open(out_filename.c_str(), O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if (out_fd == -1) {
+    close(raw_fd);
+    throw runtime_error("Failed to open output file: " + out_filename);
+  }
+
+  num_threads = max(1u, min(num_threads, (unsigned int) max(num_traces, 1L)));
+  atomic<bool> failed(false);
+  vector<thread> workers;
+  for (unsigned int t = 0; t < num_threads; t++) {
+    long int first_trace = num_traces * t / num_threads;
+    long int last_trace = num_traces * (t + 1) / num_threads;
+    workers.emplace_back([&, first_trace, last_trace]() {
+      vector<complex<float>> buff(num_rx_samps);
+      vector<complex<float>> sample_sum(num_rx_samps);
+      for (long int trace = first_trace; trace < last_trace && !failed; trace++) {
+        fill(sample_sum.begin(), sample_sum.end(), complex<float>(0,0));
+        for (int k = 0; k < num_presums; k++) {
+          size_t pulse = trace * num_presums + k;
+          if (!pread_all(raw_fd, buff.data(), bytes_per_pulse, pulse * bytes_per_pulse)) {
+            failed = true;
+            break;
+          }
+          presum_pulse(buff.data(), sample_sum.data(), num_rx_samps, num_presums, phase_dither, inversion_phases[pulse]);
+        }
+        if (!failed && !pwrite_all(out_fd, sample_sum.data(), bytes_per_pulse, trace * bytes_per_pulse)) {
+          failed = true;
+        }
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  close(raw_fd);
+  close(out_fd);
+
+  if (failed) {
+    throw runtime_error("I/O error while processing raw capture (is the raw samples file truncated?)");
+  }
+  return num_traces;
+}
@@ -0,0 +1,27 @@
+#ifndef RAW_CAPTURE_HPP
+#define RAW_CAPTURE_HPP
+
+#include "common.hpp"
+
+// Error codes stored in RawPulseRecord::error_code (in addition to rx_metadata_t::error_code_t values)
+const int32_t RAW_ERROR_NONE = 0;         // Error-free pulse, samples were written to the raw file
+const int32_t RAW_ERROR_SHORT_RECV = -1;  // recv() returned an unexpected number of samples (or timestamp)
+const int32_t RAW_ERROR_TX = -2;          // A TX async event (underflow, late burst, ...) hit the pulse
+
+// One record is written to the metadata file for every pulse received in raw capture mode.
+// Only error-free pulses are written to the raw samples file, in the same order as their records.
+struct RawPulseRecord {
+    int64_t pulse_index; // Value of pulses_received for this pulse (position in the RX dither sequence)
+    int32_t error_code;  // RAW_ERROR_NONE, RAW_ERROR_SHORT_RECV, RAW_ERROR_TX or an rx_metadata_t::error_code_t value
+    uint32_t num_samps;  // Number of samples returned by recv()
+    double rx_time;      // [s] Device time of the first sample (0 if recv() did not report a time)
+};
+
+// Read all pulse records from a raw capture metadata file
+vector<RawPulseRecord> read_raw_records(const string& meta_filename);
+
+// Apply phase inversion and presumming to a raw capture, producing the same file a normal run would have
+long int presum_raw_capture(const string& raw_filename, const string& meta_filename, const string& out_filename,
+                            int num_presums, bool phase_dither, unsigned int num_threads);
+
+#endif // RAW_CAPTURE_HPP
@@ -2,8 +2,11 @@
 
 #include <uhd/usrp/multi_usrp.hpp>
 #include <thread>
+#include <future>
+#include <map>
 #include "yaml-cpp/yaml.h"
 #include "rf_settings.hpp"
+#include "startup.hpp"
 
 using namespace std;
 using namespace uhd;
@@ -48,7 +51,8 @@ bool set_rf_params_single(usrp::multi_usrp::sptr usrp, YAML::Node rf0,
 
     // Set command time to current time + 0.1 seconds
     usrp->clear_command_time();
-    usrp->set_command_time(usrp->get_time_now() + time_spec_t(0.1));
+    time_spec_t tune_time = usrp->get_time_now() + time_spec_t(0.1);
+    usrp->set_command_time(tune_time);
 
     // Set the center frequency and LO offset.
     
@@ -73,8 +77,8 @@ bool set_rf_params_single(usrp::multi_usrp::sptr usrp, YAML::Node rf0,
         cout << "TX:\n" << tune_result_tx.to_pp_string() << endl;
     }
 
-    // sleep 100ms (~10ms after retune occurs) to allow LO to lock
-    this_thread::sleep_for(chrono::milliseconds(110)); 
+    // wait for the retune to happen (the LO lock is checked later, see Sdr::refLoLockDetect())
+    poll_until([&]() { return !(usrp->get_time_now() < tune_time); }, 0.2, 0.005);
     usrp->clear_command_time();
 
     // set the rf gain
@@ -102,95 +106,153 @@ bool set_rf_params_single(usrp::multi_usrp::sptr usrp, YAML::Node rf0,
 }
 
 /**
- * Set USRP RF parameters for multi channel operation. Right now this only works
- * for a two channel set up (will not work with multiple USRP devices configured
- * in one multi-usrp set up). See the following links for more information:
- * https://files.ettus.com/manual/page_configuration.html
+ * Set USRP RF parameters for any number of channels, which may be spread over
+ * several motherboards of one multi_usrp (e.g. two X310s sharing a 10 MHz
+ * reference and PPS). Channel k uses section RFk, so there must be a section
+ * for every channel (see Sdr::setRFParams()). All channels are retuned with
+ * the same timed command, so their LOs
+ * change at the same device time, and the boards are set up in parallel (one
+ * thread per motherboard). See:
  * https://files.ettus.com/manual/page_multiple.html
- * 
+ * https://files.ettus.com/manual/page_sync.html
+ *
  * Inputs: usrp - sptr to a USRP device
- *         rf0 - YAML node describing the RF parameters to be set up for channel 0,
- *               specific parameters are set in the config file
- *         rf1 - YAML node describing the RF parameters to be set up for channel 1,
- *               specific parameters are set in the config file
- * Outputs: returns true if all RF parameters were successfully set, 
+ *         rf_sections - YAML nodes RF0, RF1, ... (see load_rf_sections())
+ *         rx_channels - RX channel numbers of the multi_usrp
+ *         tx_channels - TX channel numbers (TX is enabled by RF0's transmit)
+ * Outputs: returns true if all RF parameters were successfully set,
  * otherwise returns false
  */
-bool set_rf_params_multi(usrp::multi_usrp::sptr usrp, YAML::Node rf0, YAML::Node rf1, 
-                         vector<size_t> rx_channels, vector<size_t> tx_channels)
+bool set_rf_params_channels(usrp::multi_usrp::sptr usrp, const vector<YAML::Node>& rf_sections,
+                            vector<size_t> rx_channels, vector<size_t> tx_channels)
 {
-    // get first block of rf parameters (for channel 0)
-    double rx_rate0 = rf0["rx_rate"].as<double>();
-    double tx_rate0 = rf0["tx_rate"].as<double>();
-    double fc0 = rf0["freq"].as<double>();
-    double rx_gain0 = rf0["rx_gain"].as<double>();
-    double tx_gain0 = rf0["tx_gain"].as<double>();
-    double bw0 = rf0["bw"].as<double>();
-    string tx_ant0 = rf0["tx_ant"].as<string>();
-    string rx_ant0 = rf0["rx_ant"].as<string>();
-
-    // get first block of rf parameters (for channel 1)
-    double rx_rate1 = rf1["rx_rate"].as<double>();
-    double tx_rate1 = rf1["tx_rate"].as<double>();
-    double fc1 = rf1["freq"].as<double>();
-    double rx_gain1 = rf1["rx_gain"].as<double>();
-    double tx_gain1 = rf1["tx_gain"].as<double>();
-    double bw1 = rf1["bw"].as<double>();
-    string tx_ant1 = rf1["tx_ant"].as<string>();
-    string rx_ant1 = rf1["rx_ant"].as<string>();
-
-    // check if tx and rx channel lists are the same
-    if (!(rx_channels.size() == tx_channels.size())) {
+    bool transmit = rf_sections[0]["transmit"].as<bool>(true);
+    if (transmit && !(rx_channels.size() == tx_channels.size())) {
         throw std::runtime_error("Different TX and RX channel list lengths are not currently supported.");
-    } 
+    }
+
+    // group the channels (by index into the channel lists) by the motherboard they are on
+    map<size_t, vector<size_t>> board_channels;
+    for (size_t k = 0; k < rx_channels.size(); k++) {
+        board_channels[channel_mboard(usrp, rx_channels[k], false)].push_back(k);
+    }
+    if (transmit) {
+        for (size_t k = 0; k < tx_channels.size(); k++) {
+            if (channel_mboard(usrp, tx_channels[k], true) != channel_mboard(usrp, rx_channels[k], false)) {
+                throw std::runtime_error("TX channel " + to_string(tx_channels[k]) + " and RX channel " +
+                                         to_string(rx_channels[k]) + " are on different motherboards.");
+            }
+        }
+    }
+
+    // runs set_channel(k) for every channel, with one thread per motherboard
+    auto for_each_board = [&](function<void(size_t)> set_channel) {
+        vector<future<void>> boards;
+        for (auto& board : board_channels) {
+            const vector<size_t>& channels = board.second;
+            boards.push_back(async(launch::async, [&set_channel, &channels]() {
+                for (size_t k : channels) {
+                    set_channel(k);
+                }
+            }));
+        }
+        for (auto& board : boards) {
+            board.get(); // rethrows anything a board thread threw
+        }
+    };
 
     // set the sample rates
-    cout << "Setting the sample rates in set_rf_params_multi()" << endl;
-    usrp->set_tx_rate(tx_rate0, tx_channels[0]);
-    usrp->set_rx_rate(rx_rate0, rx_channels[0]);
-    usrp->set_tx_rate(tx_rate1, tx_channels[1]);
-    usrp->set_rx_rate(rx_rate1, rx_channels[1]);
+    for_each_board([&](size_t k) {
+        usrp->set_rx_rate(rf_sections[k]["rx_rate"].as<double>(), rx_channels[k]);
+        if (transmit) {
+            usrp->set_tx_rate(rf_sections[k]["tx_rate"].as<double>(), tx_channels[k]);
+        }
+    });
 
-    // set center frequency at same time for both daughterboards
+    // set the center frequencies of every channel (and every motherboard) at the same time,
+    // leaving each extra board some time to receive its tune requests
     usrp->clear_command_time();
-    usrp->set_command_time(usrp->get_time_now() + time_spec_t(0.1));
-
-    tune_request_t tune_request0(fc0);
-    tune_request_t tune_request1(fc1);
-    usrp->set_tx_freq(tune_request0, tx_channels[0]);
-    usrp->set_rx_freq(tune_request0, rx_channels[0]);
-    usrp->set_tx_freq(tune_request1, tx_channels[1]);
-    usrp->set_rx_freq(tune_request1, rx_channels[1]);
+    time_spec_t tune_time = usrp->get_time_now() + time_spec_t(0.1 + 0.05 * board_channels.size());
+    usrp->set_command_time(tune_time);
+
+    for_each_board([&](size_t k) {
+        tune_request_t tune_request(rf_sections[k]["freq"].as<double>(), rf_sections[k]["lo_offset"].as<double>(0.0));
+        tune_request.args = device_addr_t(rf_sections[k]["tuning_args"].as<string>(""));
+        usrp->set_rx_freq(tune_request, rx_channels[k]);
+        if (transmit) {
+            usrp->set_tx_freq(tune_request, tx_channels[k]);
+        }
+    });
 
-    // sleep 100ms (~10ms after retune occurs) to allow LO to lock
-    this_thread::sleep_for(chrono::milliseconds(110)); 
+    // wait for the retune to happen (the LO lock is checked later, see Sdr::refLoLockDetect())
+    poll_until([&]() { return !(usrp->get_time_now() < tune_time); }, 0.2 + 0.05 * board_channels.size(), 0.005);
     usrp->clear_command_time();
 
-    // set the rf gain
-    usrp->set_rx_gain(rx_gain0, rx_channels[0]);
-    usrp->set_tx_gain(tx_gain0, tx_channels[0]);
-    usrp->set_rx_gain(rx_gain1, rx_channels[1]);
-    usrp->set_tx_gain(tx_gain1, tx_channels[1]);
+    // set the rf gain, IF filter bandwidth and antennas
+    for_each_board([&](size_t k) {
+        usrp->set_rx_gain(rf_sections[k]["rx_gain"].as<double>(), rx_channels[k]);
+        double bw = rf_sections[k]["bw"].as<double>();
+        if (bw != 0) {
+            usrp->set_rx_bandwidth(bw, rx_channels[k]);
+        }
+        usrp->set_rx_antenna(rf_sections[k]["rx_ant"].as<string>(), rx_channels[k]);
+        if (transmit) {
+            usrp->set_tx_gain(rf_sections[k]["tx_gain"].as<double>(), tx_channels[k]);
+            usrp->set_tx_antenna(rf_sections[k]["tx_ant"].as<string>(), tx_channels[k]);
+        }
+    });
 
-    // set the IF filter bandwidth
-    if (bw0 != 0) {
-        usrp->set_rx_bandwidth(bw0, rx_channels[0]);
-    }
-    if (bw1 != 0) {
-        usrp->set_rx_bandwidth(bw1, rx_channels[1]);
+    // sanity check actual values against requested values
+    bool mismatch = false;
+    for (size_t k = 0; k < rx_channels.size(); k++) {
+        YAML::Node requested = YAML::Clone(rf_sections[k]);
+        requested["transmit"] = transmit; // TX is set up for every channel or none
+        mismatch = rf_error_check(usrp, requested, transmit ? tx_channels[k] : 0, rx_channels[k]) || mismatch;
     }
 
-    // set the antenna
-    usrp->set_rx_antenna(rx_ant0, rx_channels[0]);
-    usrp->set_tx_antenna(tx_ant0, tx_channels[0]);
-    usrp->set_rx_antenna(rx_ant1, rx_channels[1]);
-    usrp->set_tx_antenna(tx_ant1, tx_channels[1]);
+    return !mismatch;
+}
 
-    // sanity check actual values against requested values
-    bool mismatch = rf_error_check(usrp, rf0, tx_channels[0], rx_channels[0]);
-    mismatch = mismatch || rf_error_check(usrp, rf1, tx_channels[1], rx_channels[1]); 
+/**
+ * Read the RF sections of the configuration: RF0, RF1, ... up to the first
+ * number that is missing.
+ *
+ * Inputs: config - the whole configuration
+ * Outputs: returns the sections in order (RF0 must exist)
+ */
+vector<YAML::Node> load_rf_sections(const YAML::Node& config)
+{
+    vector<YAML::Node> sections;
+    while (config["RF" + to_string(sections.size())]) {
+        sections.push_back(config["RF" + to_string(sections.size())]);
+    }
+    if (sections.empty()) {
+        throw std::invalid_argument("The configuration has no RF0 section.");
+    }
+    return sections;
+}
 
-    return !mismatch;
+/**
+ * Find the motherboard a channel of a multi_usrp belongs to. Channels are
+ * numbered across the motherboards in order, each with as many channels as
+ * its subdevice specification has entries.
+ *
+ * Inputs: usrp - sptr to a USRP device (with the subdevices already selected)
+ *         channel - TX or RX channel number
+ *         tx - true for a TX channel, false for an RX channel
+ * Outputs: returns the motherboard index
+ */
+size_t channel_mboard(usrp::multi_usrp::sptr usrp, size_t channel, bool tx)
+{
+    size_t first_channel = 0;
+    for (size_t mb = 0; mb < usrp->get_num_mboards(); mb++) {
+        size_t board_channels = tx ? usrp->get_tx_subdev_spec(mb).size() : usrp->get_rx_subdev_spec(mb).size();
+        if (channel < first_channel + board_channels) {
+            return mb;
+        }
+        first_channel += board_channels;
+    }
+    throw std::runtime_error("Channel " + to_string(channel) + " is not on any motherboard.");
 }
 
 /** 
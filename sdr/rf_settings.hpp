@@ -10,9 +10,15 @@
 bool set_rf_params_single(usrp::multi_usrp::sptr usrp, YAML::Node rf0, 
                           vector<size_t> rx_channels, vector<size_t> tx_channels);
 
-// Set USRP RF parameters for multi channel operation
-bool set_rf_params_multi(usrp::multi_usrp::sptr usrp, YAML::Node rf0, YAML::Node rf1, 
-                         vector<size_t> rx_channels, vector<size_t> tx_channels);
+// Set USRP RF parameters for any number of channels, on one or more motherboards
+bool set_rf_params_channels(usrp::multi_usrp::sptr usrp, const vector<YAML::Node>& rf_sections,
+                            vector<size_t> rx_channels, vector<size_t> tx_channels);
+
+// Read the consecutive RF0, RF1, ... sections of the configuration
+vector<YAML::Node> load_rf_sections(const YAML::Node& config);
+
+// Find the motherboard a channel of a multi_usrp belongs to
+size_t channel_mboard(usrp::multi_usrp::sptr usrp, size_t channel, bool tx);
 
 // Check whether requested RF parameters are equal to the reported values
 bool rf_error_check(usrp::multi_usrp::sptr usrp, YAML::Node rf, size_t tx_channel,
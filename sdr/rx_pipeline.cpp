@@ -0,0 +1,284 @@
+#include <cmath>
+#include "rx_pipeline.hpp"
+#include "presum.hpp"
+
+complex<float>* PresumGroup::pulse(int k) {
+  return pulses[k];
+}
+
+/**
+ * @brief Constructs a new RxWorkerPool and starts its threads
+ *
+ * All group buffers are taken from the shared buffer pool here, so nothing is allocated per pulse while running.
+ * They are returned to the pool when the RxWorkerPool is destroyed.
+ * @param buffers Pool of pulse-sized buffers. Must hold at least queue_depth * (max_presums + 1) free buffers.
+ * @param max_presums Largest number of pulses that can be averaged into one trace
+ * @param phase_dither True if phase dithering is enabled
+ * @param num_workers Number of worker threads
+ * @param queue_depth Number of group buffers (limits how many groups can be in flight at once)
+ * @param write_trace Called from the writer thread with each finished trace (num_rx_samps samples) and its
+ *                    number of presums, in order. Returns false on error.
+ * @param thread_init Optional. Called at the start of each pool thread with its role ("worker" or "writer"),
+ *                    e.g. to pin it to its cores.
+ */
+RxWorkerPool::RxWorkerPool(SampleBufferPool& buffers, int max_presums, bool phase_dither, int num_workers, int queue_depth,
+                           function<bool(const complex<float>*, int)> write_trace,
+                           function<void(const string&)> thread_init) :
+  buffers(buffers), num_rx_samps(buffers.getSampsPerBuffer()), max_presums(max_presums), phase_dither(phase_dither),
+  write_trace(write_trace), thread_init(thread_init), next_index(0), next_index_to_write(0), stopping(false), write_failed(false) {
+  for (int i = 0; i < queue_depth; i++) {
+    unique_ptr<PresumGroup> group(new PresumGroup);
+    for (int k = 0; k < max_presums; k++) {
+      group->pulses.push_back(buffers.acquire());
+    }
+    group->inversion_phases.resize(max_presums);
+    group->sample_sum = buffers.acquire();
+    free_groups.push_back(group.get());
+    groups.push_back(move(group));
+  }
+
+  for (int i = 0; i < num_workers; i++) {
+    workers.emplace_back(&RxWorkerPool::worker, this);
+  }
+  writer_thread = thread(&RxWorkerPool::writer, this);
+}
+
+RxWorkerPool::~RxWorkerPool() {
+  finish();
+  for (auto& group : groups) {
+    for (auto pulse : group->pulses) {
+      buffers.release(pulse);
+    }
+    buffers.release(group->sample_sum);
+  }
+}
+
+/**
+ * @brief Returns an empty group to receive pulses into
+ *
+ * Blocks while every group is in use, i.e. while the workers or the writer are falling behind.
+ * @return Pointer to an empty group
+ */
+PresumGroup* RxWorkerPool::acquire() {
+  unique_lock<mutex> lock(pool_mutex);
+  free_cv.wait(lock, [this]() { return !free_groups.empty(); });
+  PresumGroup* group = free_groups.front();
+  free_groups.pop_front();
+  group->num_pulses = 0;
+  return group;
+}
+
+/**
+ * @brief Hands a full group (num_pulses error-free pulses, at most max_presums) to the workers
+ *
+ * @param group Group previously returned by acquire()
+ */
+void RxWorkerPool::submit(PresumGroup* group) {
+  {
+    lock_guard<mutex> lock(pool_mutex);
+    group->index = next_index++;
+    work_queue.push_back(group);
+  }
+  work_cv.notify_one();
+}
+
+/**
+ * @brief Returns a group to the pool without processing it (e.g. a partial group at the end of a run)
+ *
+ * @param group Group previously returned by acquire()
+ */
+void RxWorkerPool::release(PresumGroup* group) {
+  {
+    lock_guard<mutex> lock(pool_mutex);
+    free_groups.push_back(group);
+  }
+  free_cv.notify_one();
+}
+
+/**
+ * @brief Waits until every submitted group has been written, then stops all threads
+ *
+ * @return Returns false if writing any trace failed
+ */
+bool RxWorkerPool::finish() {
+  {
+    lock_guard<mutex> lock(pool_mutex);
+    stopping = true;
+  }
+  work_cv.notify_all();
+  done_cv.notify_all();
+
+  for (auto& w : workers) {
+    if (w.joinable()) {
+      w.join();
+    }
+  }
+  if (writer_thread.joinable()) {
+    writer_thread.join();
+  }
+  return ok();
+}
+
+int RxWorkerPool::getMaxPresums() const {
+  return max_presums;
+}
+
+bool RxWorkerPool::ok() const {
+  return !write_failed;
+}
+
+// Worker thread: invert and presum whole groups using the same arithmetic as the single-threaded RX loop
+void RxWorkerPool::worker() {
+  if (thread_init) {
+    thread_init("worker");
+  }
+  while (true) {
+    PresumGroup* group;
+    {
+      unique_lock<mutex> lock(pool_mutex);
+      work_cv.wait(lock, [this]() { return stopping || !work_queue.empty(); });
+      if (work_queue.empty()) {
+        return; // stopping and nothing left to do
+      }
+      group = work_queue.front();
+      work_queue.pop_front();
+    }
+
+    fill(group->sample_sum, group->sample_sum + num_rx_samps, complex<float>(0,0));
+    for (int k = 0; k < group->num_pulses; k++) {
+      presum_pulse(group->pulse(k), group->sample_sum, num_rx_samps, group->num_pulses, phase_dither, group->inversion_phases[k]);
+    }
+
+    {
+      lock_guard<mutex> lock(pool_mutex);
+      done_groups[group->index] = group;
+    }
+    done_cv.notify_one();
+  }
+}
+
+// Writer thread: emit finished traces strictly in submission order
+void RxWorkerPool::writer() {
+  if (thread_init) {
+    thread_init("writer");
+  }
+  while (true) {
+    PresumGroup* group;
+    {
+      unique_lock<mutex> lock(pool_mutex);
+      done_cv.wait(lock, [this]() {
+        return done_groups.count(next_index_to_write) || (stopping && next_index_to_write == next_index);
+      });
+      if (!done_groups.count(next_index_to_write)) {
+        return; // stopping and everything submitted has been written
+      }
+      group = done_groups[next_index_to_write];
+      done_groups.erase(next_index_to_write);
+    }
+
+    if (!write_failed && !write_trace(group->sample_sum, group->num_pulses)) {
+      write_failed = true;
+    }
+
+    {
+      lock_guard<mutex> lock(pool_mutex);
+      next_index_to_write++;
+      free_groups.push_back(group);
+    }
+    free_cv.notify_one();
+  }
+}
+
+/**
+ * @brief Constructs a new StreamReceiver and starts its receive thread
+ *
+ * @param num_channels Number of channels of the streamer
+ * @param num_samps Samples per pulse and channel
+ * @param num_slots Number of pulses that can be received ahead of the consumer (at least 1)
+ * @param recv_pulse Called from the receive thread for pulses 0, 1, 2, ... in order
+ * @param thread_init Optional. Called at the start of the receive thread, e.g. to pin it to its cores.
+ */
+StreamReceiver::StreamReceiver(size_t num_channels, size_t num_samps, int num_slots, RecvPulse recv_pulse,
+                               function<void()> thread_init) :
+  recv_pulse(recv_pulse), thread_init(thread_init), slots(max(num_slots, 1)), num_received(0), num_taken(0),
+  num_released(0), stopping(false) {
+  for (ReceivedPulse& slot : slots) {
+    slot.channels.assign(num_channels, aligned_sample_vector(num_samps));
+  }
+  receive_thread = thread(&StreamReceiver::receive, this);
+}
+
+StreamReceiver::~StreamReceiver() {
+  stop();
+}
+
+/**
+ * @brief Returns the next pulse in order, blocking until it has been received
+ *
+ * The pulse stays valid until release() is called for it.
+ * @return Pointer to the pulse, or nullptr once the receiver is stopped
+ */
+ReceivedPulse* StreamReceiver::next() {
+  unique_lock<mutex> lock(ring_mutex);
+  ring_cv.wait(lock, [this]() { return num_taken < num_received || stopping; });
+  if (num_taken == num_received) {
+    return nullptr;
+  }
+  return &slots[num_taken++ % slots.size()];
+}
+
+/**
+ * @brief Hands the oldest pulse returned by next() back to the receive thread
+ */
+void StreamReceiver::release() {
+  {
+    lock_guard<mutex> lock(ring_mutex);
+    num_released++;
+  }
+  ring_cv.notify_all();
+}
+
+/**
+ * @brief Stops the receive thread (after the pulse it is receiving, if any) and waits for it
+ */
+void StreamReceiver::stop() {
+  {
+    lock_guard<mutex> lock(ring_mutex);
+    stopping = true;
+  }
+  ring_cv.notify_all();
+  if (receive_thread.joinable()) {
+    receive_thread.join();
+  }
+}
+
+void StreamReceiver::receive() {
+  if (thread_init) {
+    thread_init();
+  }
+  vector<void *> buffs(slots[0].channels.size());
+  for (long int pulse = 0; ; pulse++) {
+    {
+      unique_lock<mutex> lock(ring_mutex);
+      ring_cv.wait(lock, [this]() { return num_received - num_released < (long int) slots.size() || stopping; });
+      if (stopping) {
+        return;
+      }
+    }
+    // The slot is not seen by the consumer until num_received is incremented
+    ReceivedPulse& slot = slots[pulse % slots.size()];
+    for (size_t ch = 0; ch < buffs.size(); ch++) {
+      buffs[ch] = slot.channels[ch].data();
+    }
+    slot.index = pulse;
+    slot.num_samps = recv_pulse(pulse, buffs, slot.md, stopping);
+    {
+      lock_guard<mutex> lock(ring_mutex);
+      if (stopping) {
+        return;
+      }
+      num_received++;
+    }
+    ring_cv.notify_all();
+  }
+}
@@ -0,0 +1,167 @@
+#ifndef RX_PIPELINE_HPP
+#define RX_PIPELINE_HPP
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <complex>
+#include "buffer_pool.hpp"
+#include "common.hpp"
+
+// Storage for one presum group: the RX thread receives num_pulses error-free pulses straight
+// into it, then a worker turns it into one trace.
+struct PresumGroup {
+    long int index;                       // Sequence number of this group (= index of the trace it produces)
+    int num_pulses;                       // Number of error-free pulses received into this group so far
+                                          //   (= number of presums of the trace once submitted)
+    vector<complex<float>*> pulses;       // max_presums pulse buffers (from the shared SampleBufferPool)
+    vector<float> inversion_phases;       // Inversion phase of each pulse (from the RX dither sequence)
+    complex<float>* sample_sum;           // Output trace (from the shared SampleBufferPool)
+
+    complex<float>* pulse(int k);
+};
+
+// Pool of worker threads that invert and presum whole groups in parallel. A writer thread
+// reorders the finished traces and hands them to write_trace in sequence order.
+class RxWorkerPool {
+  public:
+    RxWorkerPool(SampleBufferPool& buffers, int max_presums, bool phase_dither, int num_workers, int queue_depth,
+                 function<bool(const complex<float>*, int)> write_trace,
+                 function<void(const string&)> thread_init = nullptr);
+    ~RxWorkerPool();
+
+    PresumGroup* acquire();
+    void submit(PresumGroup* group);
+    void release(PresumGroup* group);
+    bool finish();
+    bool ok() const;
+    int getMaxPresums() const;
+
+  private:
+    void worker();
+    void writer();
+
+    SampleBufferPool& buffers;
+    size_t num_rx_samps;
+    int max_presums;
+    bool phase_dither;
+    function<bool(const complex<float>*, int)> write_trace;
+    function<void(const string&)> thread_init;
+
+    mutex pool_mutex;
+    condition_variable free_cv;  // Signalled when a group is returned to free_groups
+    condition_variable work_cv;  // Signalled when a group is added to work_queue
+    condition_variable done_cv;  // Signalled when a group is added to done_groups
+    vector<unique_ptr<PresumGroup>> groups;
+    deque<PresumGroup*> free_groups;
+    deque<PresumGroup*> work_queue;
+    map<long int, PresumGroup*> done_groups; // Finished groups waiting to be written, by index
+    long int next_index;          // Index given to the next submitted group
+    long int next_index_to_write;
+    bool stopping;
+    atomic<bool> write_failed;
+
+    vector<thread> workers;
+    thread writer_thread;
+};
+
+// One pulse received with as many recv() calls as it takes (e.g. with transport frames smaller than the RX window)
+struct RxAssembly {
+    size_t num_samps;        // Samples written to the buffer
+    size_t contiguous_samps; // Samples before the first fragment whose time_spec doesn't follow on
+    int num_fragments;       // recv() calls that returned samples
+};
+
+/**
+ * @brief Receives one pulse from as many recv() calls as it takes
+ *
+ * Fragments are received back to back into the buffer until num_samps samples have arrived, the burst ends,
+ * recv() times out or reports an error. Reading up to the end of the burst keeps the next pulse aligned even
+ * if this one is short. Each fragment's time_spec must continue where the previous one ended; samples from
+ * the first one that doesn't are excluded from contiguous_samps, so the pulse fails the sample count check.
+ * @param recv_fragment Callable size_t(size_t offset, size_t max_samps, rx_metadata_t& md) that receives up to
+ *                      max_samps samples at sample offset into the pulse buffer. It is called directly, so
+ *                      passing a lambda allocates nothing per pulse.
+ * @param num_samps Number of samples in the pulse
+ * @param rx_rate [Hz] RX sample rate
+ * @param tolerance [s] Largest allowed difference between a fragment's time_spec and where the previous one ended
+ * @param rx_md Set to the metadata of the first fragment, with the error code of the first failing one and
+ *              the end_of_burst flag of the last one
+ * @return Sample and fragment counts
+ */
+template <typename RecvFragment>
+RxAssembly assemble_pulse(const RecvFragment& recv_fragment, size_t num_samps, double rx_rate, double tolerance, rx_metadata_t& rx_md) {
+    RxAssembly assembly = {0, 0, 0};
+    bool continuous = true;
+    rx_metadata_t fragment_md;
+    while (assembly.num_samps < num_samps) {
+        size_t n = recv_fragment(assembly.num_samps, num_samps - assembly.num_samps, fragment_md);
+        if (assembly.num_fragments == 0) {
+            rx_md = fragment_md; // The first fragment carries the time of the pulse
+        } else if (n > 0 && fragment_md.has_time_spec && rx_md.has_time_spec) {
+            double expected_time = rx_md.time_spec.get_real_secs() + assembly.num_samps / rx_rate;
+            continuous = continuous && fabs(fragment_md.time_spec.get_real_secs() - expected_time) <= tolerance;
+        }
+        if (n > 0) {
+            assembly.num_fragments++;
+            assembly.num_samps += n;
+            if (continuous) {
+                assembly.contiguous_samps = assembly.num_samps;
+            }
+        }
+        if (fragment_md.error_code != rx_metadata_t::ERROR_CODE_NONE) {
+            rx_md.error_code = fragment_md.error_code;
+            break;
+        }
+        if (n == 0 || fragment_md.end_of_burst) {
+            break;
+        }
+    }
+    rx_md.end_of_burst = fragment_md.end_of_burst;
+    return assembly;
+}
+
+// One pulse of every channel of a streamer
+struct ReceivedPulse {
+    long int index;                          // Pulse index
+    vector<aligned_sample_vector> channels;  // num_samps samples per channel
+    size_t num_samps;                        // Samples received without a gap (see assemble_pulse())
+    rx_metadata_t md;
+};
+
+// Receives every pulse of one streamer (e.g. the channels of one motherboard) on its own thread, into a ring
+// of pulse slots. Several receivers read the motherboards of a device in parallel and are consumed in lockstep.
+class StreamReceiver {
+  public:
+    // Receives a pulse into the buffers (one per channel) and returns the number of samples received without
+    // a gap. Should return early with stopping set, e.g. rather than wait for a pulse that won't be commanded.
+    typedef function<size_t(long int pulse, const vector<void *>& buffs, rx_metadata_t& md, const atomic<bool>& stopping)> RecvPulse;
+
+    StreamReceiver(size_t num_channels, size_t num_samps, int num_slots, RecvPulse recv_pulse,
+                   function<void()> thread_init = nullptr);
+    ~StreamReceiver();
+
+    ReceivedPulse* next();
+    void release();
+    void stop();
+
+  private:
+    void receive();
+
+    RecvPulse recv_pulse;
+    function<void()> thread_init;
+    vector<ReceivedPulse> slots;
+
+    mutex ring_mutex;
+    condition_variable ring_cv; // Signalled when a pulse is received or released, and on stop
+    long int num_received;      // Pulses received so far (by the receive thread)
+    long int num_taken;         // Pulses returned by next()
+    long int num_released;      // Pulses the consumer is done with
+    atomic<bool> stopping;
+    thread receive_thread;
+};
+
+#endif // RX_PIPELINE_HPP
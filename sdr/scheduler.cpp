@@ -0,0 +1,407 @@
+#include <algorithm>
+#include "scheduler.hpp"
+#include "utils.hpp"
+
+/**
+ * @brief Constructs a new PriSequence
+ *
+ * The stagger pattern is scaled so its mean is 1, so the pulse period stays the average time between pulses.
+ * Throws invalid_argument for a negative jitter or a pattern with a period <= 0.
+ * @param stagger Periods of a repeating pattern, relative to the pulse period (empty for uniform spacing)
+ * @param jitter [s] Largest pseudo-random offset of a pulse from its staggered time (0 to disable)
+ * @param seed Seed of the jitter sequence
+ */
+PriSequence::PriSequence(const vector<double>& stagger, double jitter, uint64_t seed) :
+  min_stagger(1), jitter(jitter), seed(seed) {
+  if (jitter < 0) {
+    throw invalid_argument("PRI jitter must be >= 0.");
+  }
+  cumulative.push_back(0);
+  if (stagger.empty()) {
+    cumulative.push_back(1);
+    return;
+  }
+  double total = 0;
+  for (double period : stagger) {
+    if (!(period > 0)) {
+      throw invalid_argument("PRI stagger periods must be > 0.");
+    }
+    total += period;
+  }
+  double scale = stagger.size() / total;
+  min_stagger = *min_element(stagger.begin(), stagger.end()) * scale;
+  for (double period : stagger) {
+    cumulative.push_back(cumulative.back() + period * scale);
+  }
+}
+
+/**
+ * @brief Returns the start of a pulse relative to pulse 0, before jitter
+ *
+ * @param pulse Pulse index
+ * @return [pulse periods] Staggered position (equal to pulse without a stagger pattern)
+ */
+double PriSequence::getPosition(long int pulse) const {
+  long int cycle_length = cumulative.size() - 1;
+  return (pulse / cycle_length) * cumulative.back() + cumulative[pulse % cycle_length];
+}
+
+/**
+ * @brief Returns the pseudo-random offset of a pulse
+ *
+ * The offset is uniform in [-jitter, jitter) and drawn from a splitmix64 hash of seed + pulse.
+ * @param pulse Pulse index
+ * @return [s] Offset from the pulse's staggered time
+ */
+double PriSequence::getJitter(long int pulse) const {
+  if (jitter == 0) {
+    return 0;
+  }
+  return jitter * (2 * splitmix64_uniform(seed + (uint64_t) pulse) - 1);
+}
+
+/**
+ * @param pulse_rep_int [s] Pulse period
+ * @return [s] Shortest possible time between the starts of two consecutive pulses
+ */
+double PriSequence::getMinSpacing(double pulse_rep_int) const {
+  return pulse_rep_int * min_stagger - 2 * jitter;
+}
+
+bool PriSequence::isUniform() const {
+  return cumulative.size() == 2 && jitter == 0;
+}
+
+/**
+ * @brief Constructs a new PulseTimeline
+ *
+ * @param time_offset [s] Device time of the first pulse
+ * @param pulse_rep_int [s] Pulse period
+ * @param pri_sequence Spacing of the pulses within the pulse period (default: uniform)
+ */
+PulseTimeline::PulseTimeline(double time_offset, double pulse_rep_int, const PriSequence& pri_sequence) :
+  pri_sequence(pri_sequence), last_error_count(0), last_pulse_assigned(-1) {
+  segments.push_back({0, time_offset, pulse_rep_int});
+}
+
+/**
+ * @brief Returns the time the RX window of a pulse starts at
+ *
+ * Whenever the error count has increased since the last call, all pulses that haven't been
+ * handed out yet are delayed by 2 pulse periods per new error to let the transport catch up.
+ * A pulse's time never changes once it has been returned, so the TX and RX command threads
+ * always agree on it no matter which one asks first.
+ * @param pulse Pulse index
+ * @param error_count Current number of RX errors
+ * @return [s] Device time of the start of the RX window
+ */
+double PulseTimeline::getRxTime(long int pulse, long int error_count) {
+  lock_guard<mutex> lock(timeline_mutex);
+
+  if (error_count > last_error_count) {
+    double error_delay = (error_count - last_error_count) * 2 * segments.back().pulse_rep_int;
+    long int first_pulse = max(pulse, last_pulse_assigned + 1);
+    double total_delay = delays.empty() ? 0 : delays.back().second;
+    delays.push_back(make_pair(first_pulse, total_delay + error_delay));
+    cout_mutex.lock();
+    cout << "[TX] (Chirp " << first_pulse << ") time_offset increased by " << error_delay << endl;
+    cout_mutex.unlock();
+    last_error_count = error_count;
+  }
+  last_pulse_assigned = max(last_pulse_assigned, pulse);
+  return pulseTime(pulse);
+}
+
+/**
+ * @brief Returns the time of a pulse without checking for new errors
+ *
+ * For a pulse that has been handed out by getRxTime(), this is the time it was scheduled for
+ * (e.g. for the RX loop to check the timestamp of what it received).
+ * @param pulse Pulse index
+ * @return [s] Device time of the start of the RX window
+ */
+double PulseTimeline::getScheduledTime(long int pulse) {
+  lock_guard<mutex> lock(timeline_mutex);
+  return pulseTime(pulse);
+}
+
+const PriSequence& PulseTimeline::getPriSequence() const {return pri_sequence;}
+
+// Time of a pulse with the delays and segments so far (timeline_mutex must be held)
+double PulseTimeline::pulseTime(long int pulse) const {
+  // Both threads work close to the end of the list, so search backwards
+  double delay = 0;
+  for (auto it = delays.rbegin(); it != delays.rend(); it++) {
+    if (it->first <= pulse) {
+      delay = it->second;
+      break;
+    }
+  }
+  auto segment = segments.rbegin();
+  while (segment->first_pulse > pulse) {
+    segment++;
+  }
+  double position = pri_sequence.getPosition(pulse) - pri_sequence.getPosition(segment->first_pulse);
+  return segment->start_time + delay + (segment->pulse_rep_int * position) + pri_sequence.getJitter(pulse);
+}
+
+long int PulseTimeline::getLastPulseAssigned() {
+  lock_guard<mutex> lock(timeline_mutex);
+  return last_pulse_assigned;
+}
+
+/**
+ * @brief Returns the last pulse that starts at or before a device time
+ *
+ * Only pulses that have been handed out by getRxTime() are considered, since later pulses can still move.
+ * @param time [s] Device time
+ * @return Pulse index, or -1 if no pulse handed out so far starts at or before the time
+ */
+long int PulseTimeline::getPulseAt(double time) {
+  lock_guard<mutex> lock(timeline_mutex);
+  // Pulse times increase with the pulse index, so search for the first pulse after the time
+  long int low = 0;
+  long int high = last_pulse_assigned + 1;
+  while (low < high) {
+    long int mid = low + (high - low) / 2;
+    if (pulseTime(mid) <= time) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low - 1;
+}
+
+/**
+ * @brief Returns the pulse period in effect at a pulse
+ *
+ * @param pulse Pulse index
+ * @return [s] Pulse period
+ */
+double PulseTimeline::getPulseRepInt(long int pulse) {
+  lock_guard<mutex> lock(timeline_mutex);
+  auto segment = segments.rbegin();
+  while (segment->first_pulse > pulse) {
+    segment++;
+  }
+  return segment->pulse_rep_int;
+}
+
+/**
+ * @brief Schedules a parameter change at the next presum-group boundary no thread has reached yet
+ *
+ * The boundary is the first pulse after the last one handed out whose error-free index
+ * (pulse - error_count) is a multiple of group_size, i.e. where a new presum group will start
+ * unless more errors happen before then. A "pulse_rep_int" change is applied to the timeline
+ * right away; every change is also queued for takeChange().
+ * @param parameter Name of the parameter
+ * @param value New value
+ * @param group_size Number of pulses per presum group
+ * @param error_count Current number of RX errors
+ * @return Index of the first pulse the change applies to
+ */
+long int PulseTimeline::scheduleChange(const string& parameter, double value, int group_size, long int error_count) {
+  lock_guard<mutex> lock(timeline_mutex);
+  long int pulse = last_pulse_assigned + 1;
+  long int offset = (pulse - error_count) % group_size;
+  if (offset != 0) {
+    pulse += group_size - (offset < 0 ? offset + group_size : offset);
+  }
+  // Changes are kept in order, so a change is never scheduled before one that is already queued
+  if (!changes.empty()) {
+    pulse = max(pulse, changes.back().first_pulse);
+  }
+  pulse = max(pulse, segments.back().first_pulse);
+
+  if (parameter == "pulse_rep_int") {
+    const PriSegment& last = segments.back();
+    double start_time = last.start_time + last.pulse_rep_int * (pri_sequence.getPosition(pulse) - pri_sequence.getPosition(last.first_pulse));
+    if (last.first_pulse == pulse) {
+      segments.back().pulse_rep_int = value;
+    } else {
+      segments.push_back({pulse, start_time, value});
+    }
+  }
+  changes.push_back({pulse, parameter, value});
+  return pulse;
+}
+
+/**
+ * @brief Takes the oldest queued change of a parameter that applies to a pulse
+ *
+ * Each change is handed out once, so exactly one thread should take changes of each parameter.
+ * @param parameter Name of the parameter
+ * @param pulse Pulse the caller is working on
+ * @param change Set to the change, if there is one
+ * @return Returns true if a change with first_pulse <= pulse was found
+ */
+bool PulseTimeline::takeChange(const string& parameter, long int pulse, ScheduledChange& change) {
+  lock_guard<mutex> lock(timeline_mutex);
+  for (auto it = changes.begin(); it != changes.end() && it->first_pulse <= pulse; it++) {
+    if (it->parameter == parameter) {
+      change = *it;
+      changes.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+TxEventLog::TxEventLog() : next_unclaimed(0), num_events(0), num_late(0) {}
+
+/**
+ * @brief Records a TX async event
+ *
+ * @param pulse Pulse the event happened in (-1 if unknown)
+ * @param event_code async_metadata_t::event_code_t value
+ * @return Returns true if the RX loop hasn't checked the pulse yet, so it will be dropped
+ */
+bool TxEventLog::record(long int pulse, int event_code) {
+  lock_guard<mutex> lock(log_mutex);
+  num_events++;
+  event_counts[event_code]++;
+  if (pulse < next_unclaimed) {
+    num_late++;
+    return false;
+  }
+  pulse_events[pulse] |= event_code;
+  return true;
+}
+
+/**
+ * @brief Marks a pulse as checked by the RX loop
+ *
+ * Must be called once for every pulse, in order, whether or not the pulse had an RX error. The events of
+ * earlier pulses are forgotten, so the log only holds the pulse claimed last and those not yet claimed.
+ * @param pulse Pulse index
+ * @return OR of the event codes recorded for the pulse (0 if none)
+ */
+int TxEventLog::claimPulse(long int pulse) {
+  lock_guard<mutex> lock(log_mutex);
+  next_unclaimed = max(next_unclaimed, pulse + 1);
+  pulse_events.erase(pulse_events.begin(), pulse_events.lower_bound(pulse));
+  auto it = pulse_events.find(pulse);
+  return (it == pulse_events.end()) ? 0 : it->second;
+}
+
+/**
+ * @param pulse Pulse index (not yet claimed, or the one claimed last)
+ * @return OR of the event codes recorded for the pulse before it was claimed (0 if none)
+ */
+int TxEventLog::getPulseEvents(long int pulse) {
+  lock_guard<mutex> lock(log_mutex);
+  auto it = pulse_events.find(pulse);
+  return (it == pulse_events.end()) ? 0 : it->second;
+}
+
+long int TxEventLog::getNumEvents() {
+  lock_guard<mutex> lock(log_mutex);
+  return num_events;
+}
+
+long int TxEventLog::getNumLateEvents() {
+  lock_guard<mutex> lock(log_mutex);
+  return num_late;
+}
+
+long int TxEventLog::getNumEvents(int event_code) {
+  lock_guard<mutex> lock(log_mutex);
+  auto it = event_counts.find(event_code);
+  return (it == event_counts.end()) ? 0 : it->second;
+}
+
+/**
+ * @brief Returns the names of the event codes in a bitmask, in the style of rx_metadata_t::strerror()
+ *
+ * @param event_code One async_metadata_t::event_code_t value, or several ORed together
+ * @return Names separated by '|', e.g. "EVENT_CODE_UNDERFLOW"
+ */
+string async_event_name(int event_code) {
+  static const vector<pair<int, string>> names = {
+    {async_metadata_t::EVENT_CODE_BURST_ACK, "EVENT_CODE_BURST_ACK"},
+    {async_metadata_t::EVENT_CODE_UNDERFLOW, "EVENT_CODE_UNDERFLOW"},
+    {async_metadata_t::EVENT_CODE_SEQ_ERROR, "EVENT_CODE_SEQ_ERROR"},
+    {async_metadata_t::EVENT_CODE_TIME_ERROR, "EVENT_CODE_TIME_ERROR"},
+    {async_metadata_t::EVENT_CODE_UNDERFLOW_IN_PACKET, "EVENT_CODE_UNDERFLOW_IN_PACKET"},
+    {async_metadata_t::EVENT_CODE_SEQ_ERROR_IN_BURST, "EVENT_CODE_SEQ_ERROR_IN_BURST"},
+    {async_metadata_t::EVENT_CODE_USER_PAYLOAD, "EVENT_CODE_USER_PAYLOAD"}
+  };
+  string name;
+  for (const auto& code : names) {
+    if (event_code & code.first) {
+      name += (name.empty() ? "" : "|") + code.second;
+      event_code &= ~code.first;
+    }
+  }
+  if (event_code != 0 || name.empty()) {
+    name += (name.empty() ? "" : "|") + string("EVENT_CODE_UNKNOWN");
+  }
+  return name;
+}
+
+/**
+ * @brief Constructs a new DeviceClock
+ *
+ * @param query_device_time Function returning the current device time in seconds (e.g. from usrp->get_time_now())
+ * @param resync_interval [s] How often to re-read the device time. In between, the host steady clock is used.
+ */
+DeviceClock::DeviceClock(function<double()> query_device_time, double resync_interval) :
+  query_device_time(query_device_time), resync_interval(resync_interval) {
+  device_sync_time = query_device_time();
+  host_sync_time = chrono::steady_clock::now();
+}
+
+/**
+ * @brief Returns an estimate of the current device time
+ *
+ * @return [s] Estimated device time
+ */
+double DeviceClock::now() {
+  lock_guard<mutex> lock(clock_mutex);
+  double elapsed = chrono::duration<double>(chrono::steady_clock::now() - host_sync_time).count();
+  if (elapsed > resync_interval) {
+    device_sync_time = query_device_time();
+    host_sync_time = chrono::steady_clock::now();
+    elapsed = 0;
+  }
+  return device_sync_time + elapsed;
+}
+
+/**
+ * @brief Constructs a new LatenessStats
+ *
+ * @param name Tag used when printing, e.g. "[TX]"
+ */
+LatenessStats::LatenessStats(const string& name) :
+  name(name), count(0), num_late(0), sum_slack(0), min_slack(numeric_limits<double>::infinity()) {}
+
+/**
+ * @brief Records the slack of one command
+ *
+ * @param slack [s] Scheduled time of the command minus the device time when it was issued (negative if late)
+ */
+void LatenessStats::record(double slack) {
+  count++;
+  sum_slack += slack;
+  min_slack = min(min_slack, slack);
+  if (slack < 0) {
+    num_late++;
+  }
+}
+
+/**
+ * @brief Prints a one-line summary of the recorded slack
+ */
+void LatenessStats::print() const {
+  cout << name << " Commands issued: " << count << " Late: " << num_late;
+  if (count > 0) {
+    cout << " Min slack: " << min_slack * 1e3 << " ms Mean slack: " << getMeanSlack() * 1e3 << " ms";
+  }
+  cout << endl;
+}
+
+long int LatenessStats::getCount() const {return count;}
+long int LatenessStats::getNumLate() const {return num_late;}
+double LatenessStats::getMinSlack() const {return min_slack;}
+double LatenessStats::getMeanSlack() const {return count > 0 ? sum_slack / count : 0;}
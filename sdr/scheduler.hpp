@@ -0,0 +1,141 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <deque>
+#include <map>
+#include "common.hpp"
+
+// A parameter change requested while running, taking effect from first_pulse on
+struct ScheduledChange {
+    long int first_pulse;
+    string parameter;
+    double value;
+};
+
+// Spacing of the pulses within a pulse period: an optional repeating stagger pattern and a pseudo-random
+// jitter. Both are computed from the pulse index alone, so the time of any pulse can be reproduced
+// without replaying the sequence (see postprocessing/pulse_times.py).
+class PriSequence {
+  public:
+    PriSequence(const vector<double>& stagger = {}, double jitter = 0, uint64_t seed = 0);
+
+    double getPosition(long int pulse) const;
+    double getJitter(long int pulse) const;
+    double getMinSpacing(double pulse_rep_int) const;
+    bool isUniform() const;
+
+  private:
+    vector<double> cumulative; // [pulse periods] Start of each pulse of a stagger cycle, and the cycle length
+    double min_stagger;        // [pulse periods] Shortest period of the stagger pattern
+    double jitter;             // [s] Largest offset of a pulse from its staggered time
+    uint64_t seed;
+};
+
+// One record per pulse in the pulse time log (FILES:pulse_times_loc)
+struct PulseTimeRecord {
+    int64_t pulse_index; // Including errored pulses
+    double rx_time;      // [s] Device time the RX window was scheduled for
+};
+
+// Assigns a device time to every pulse index. Shared by the TX and RX command threads so that
+// both schedule each pulse for the same time, even though they run independently.
+// Runtime parameter changes are scheduled here too, so a change is always placed on a pulse that
+// no thread has started working on yet.
+class PulseTimeline {
+  public:
+    PulseTimeline(double time_offset, double pulse_rep_int, const PriSequence& pri_sequence = PriSequence());
+
+    double getRxTime(long int pulse, long int error_count);
+    double getScheduledTime(long int pulse);
+    const PriSequence& getPriSequence() const;
+    long int getLastPulseAssigned();
+    long int getPulseAt(double time);
+    double getPulseRepInt(long int pulse);
+
+    long int scheduleChange(const string& parameter, double value, int group_size, long int error_count);
+    bool takeChange(const string& parameter, long int pulse, ScheduledChange& change);
+
+  private:
+    double pulseTime(long int pulse) const;
+
+    // Pulses from first_pulse on follow the PRI sequence with period pulse_rep_int, starting at start_time (before error delays)
+    struct PriSegment {
+        long int first_pulse;
+        double start_time;
+        double pulse_rep_int;
+    };
+
+    mutex timeline_mutex;
+    PriSequence pri_sequence;
+    long int last_error_count;    // Error count when the last delay was inserted
+    long int last_pulse_assigned; // Highest pulse index a time has been handed out for
+    vector<pair<long int, double>> delays; // (First pulse affected, total delay [s] from that pulse onwards)
+    vector<PriSegment> segments;
+    deque<ScheduledChange> changes;        // Scheduled changes not yet taken, in order of first_pulse
+};
+
+// TX async events (underflows, sequence errors, late bursts), each attributed to the pulse it happened in.
+// The RX loop claims every pulse as it checks it, so an event that arrives before its pulse is claimed
+// drops that pulse like an RX error would. Later events (or ones without a time) can only be counted.
+class TxEventLog {
+  public:
+    TxEventLog();
+
+    bool record(long int pulse, int event_code);
+    int claimPulse(long int pulse);
+    int getPulseEvents(long int pulse);
+    long int getNumEvents();
+    long int getNumLateEvents();
+    long int getNumEvents(int event_code);
+
+  private:
+    mutex log_mutex;
+    long int next_unclaimed;          // Pulses before this one have been checked by the RX loop
+    map<long int, int> pulse_events;  // Pulse index -> OR of the event codes seen in it (from the last claimed pulse on)
+    map<int, long int> event_counts;  // Event code -> number of events
+    long int num_events;
+    long int num_late;                // Events that could not be attributed to an unclaimed pulse
+};
+
+string async_event_name(int event_code);
+
+// Estimate of the current device time that doesn't need a round trip to the USRP on every call
+class DeviceClock {
+  public:
+    DeviceClock(function<double()> query_device_time, double resync_interval = 1.0);
+
+    double now();
+
+  private:
+    mutex clock_mutex;
+    function<double()> query_device_time;
+    double resync_interval;                  // [s] How often to re-read the device time
+    chrono::steady_clock::time_point host_sync_time;
+    double device_sync_time;                 // [s] Device time at host_sync_time
+};
+
+// Per-thread record of how far ahead of its deadline each command was issued
+class LatenessStats {
+  public:
+    LatenessStats(const string& name);
+
+    void record(double slack);
+    void print() const;
+
+    long int getCount() const;
+    long int getNumLate() const;
+    double getMinSlack() const;
+    double getMeanSlack() const;
+
+  private:
+    string name;
+    long int count;
+    long int num_late; // Commands issued after their scheduled time
+    double sum_slack;  // [s]
+    double min_slack;  // [s]
+};
+
+#endif // SCHEDULER_HPP
@@ -1,3 +1,4 @@
+#include <uhd/device.hpp>
 #include "sdr.hpp"
 
 /**
@@ -8,7 +9,7 @@
 *
 * @param kYamlFile Path to the YAML configuration file (config/)
 */
-Sdr::Sdr(const string& kYamlFile) {
+Sdr::Sdr(const string& kYamlFile) : warm_start(false), time_synced(false) {
   loadConfigFromYaml(kYamlFile);
 }
 
@@ -34,6 +35,10 @@ void Sdr::loadConfigFromYaml(const string& kYamlFile) {
   rx_channels = dev_params["rx_channels"].as<string>();
   cpu_format = dev_params["cpu_format"].as<string>("fc32");
   otw_format = dev_params["otw_format"].as<string>();
+  lock_timeout = dev_params["lock_timeout"].as<double>(30.0);
+  lo_lock_timeout = dev_params["lo_lock_timeout"].as<double>(1.0);
+  state_cache = dev_params["state_cache"].as<string>("");
+  transport_cache = dev_params["transport_cache"].as<string>("");
 
   // GPIO
   YAML::Node gpio_params = config["GPIO"];
@@ -52,6 +57,7 @@ void Sdr::loadConfigFromYaml(const string& kYamlFile) {
   // RF
   rf0 = config["RF0"];
   rf1 = config["RF1"];
+  rf_sections = load_rf_sections(config);
   rx_rate = rf1["rx_rate"].as<double>();
   tx_rate = rf1["tx_rate"].as<double>();
   freq = rf1["freq"].as<double>();
@@ -60,6 +66,8 @@ void Sdr::loadConfigFromYaml(const string& kYamlFile) {
   bw = rf1["bw"].as<double>();
   tx_ant = rf1["tx_ant"].as<string>();
   rx_ant = rf1["rx_ant"].as<string>();
+  applied_rx_gain = rf0["rx_gain"].as<double>();
+  applied_tx_gain = rf0["tx_gain"].as<double>();
 
   transmit = rf0["transmit"].as<bool>(true); // True if transmission enabled
 
@@ -92,6 +100,8 @@ void Sdr::loadConfigFromYaml(const string& kYamlFile) {
 *
 */
 void Sdr::createUsrp(){
+  double start_time = startup_timer.elapsed();
+  applyTransportProfile();
   cout << endl;
   cout << boost::format("Creating the usrp device with: %s...")
     % device_args << endl; 
@@ -101,6 +111,8 @@ void Sdr::createUsrp(){
   // Lock mboard clocks
   usrp->set_clock_source(clk_ref);
   usrp->set_time_source(clk_ref);
+  startup_timer.record("create device", start_time);
+  loadDeviceState();
 }
 
 /**
@@ -110,17 +122,28 @@ void Sdr::createUsrp(){
 * specifications, master clock rate, and configures the RF parameters. checks
 * reference and LO locks, and initializes GPIO, transmit, and receive settings.
 *
+* Every wait polls the relevant sensor with a deadline instead of sleeping for a fixed time. The GPIO and
+* streamers are set up while the LOs settle, and the LO locks are checked last.
 */
 void Sdr::setupUsrp(){
+  double start_time = startup_timer.elapsed();
   if (clk_ref == "gpsdo") {
     check10MhzLock();
+    startup_timer.record("reference lock", start_time);
+    start_time = startup_timer.elapsed();
     gpsLock();
+    startup_timer.record("GPS lock", start_time);
+    start_time = startup_timer.elapsed();
     checkAndSetTime();
   }else{
-    // set the USRP time, let chill for a little bit to lock
+    // set the USRP time at the next PPS (the internal one, if the device has one)
+    int64_t last_pps = usrp->get_time_last_pps().get_full_secs();
     usrp->set_time_next_pps(time_spec_t(0.0));
-    this_thread::sleep_for((chrono::milliseconds(1000)));
+    poll_until([&]() { return usrp->get_time_last_pps().get_full_secs() != last_pps; }, 1.0);
   }
+  checkTimeAlignment();
+  startup_timer.record("set time", start_time);
+  start_time = startup_timer.elapsed();
   // always select the subdevice first, the channel mapping affects the
   // other settings
   if (transmit) {
@@ -132,19 +155,106 @@ void Sdr::setupUsrp(){
   usrp->set_master_clock_rate(clk_rate);
   detectChannels();
   setRFParams();
-  refLoLockDetect();
+  startup_timer.record("RF parameters", start_time);
+  start_time = startup_timer.elapsed();
   setupGpio();
   setupTx();
   setupRx();
+  startup_timer.record("GPIO and streamers", start_time);
+  start_time = startup_timer.elapsed();
+  refLoLockDetect();
+  startup_timer.record("LO lock", start_time);
+  saveDeviceState();
+}
+
+/*** @brief Returns the serial number of the (first) motherboard
+ */
+string Sdr::getSerial(){
+  return usrp->get_usrp_rx_info(0).get("mboard_serial", "");
+}
+
+/*** @brief Returns a summary of every setting that setupUsrp() applies to the device
+ *
+ * If two runs have the same fingerprint and device, the second one finds the device set up the same way.
+ */
+string Sdr::getFingerprint() const {
+  stringstream settings;
+  settings << device_args << "|" << subdev << "|" << clk_ref << "|" << clk_rate << "|" << tx_channels << "|" << rx_channels;
+  for (const YAML::Node& rf : rf_sections) {
+    settings << "|" << YAML::Dump(rf);
+  }
+  stringstream fingerprint;
+  fingerprint << hex << hash<string>()(settings.str());
+  return fingerprint.str();
+}
+
+/*** @brief Merges the cached transport parameters of the device into device_args
+ *
+ * The device is looked up (without opening it) to get its serial number. If tune_transport has
+ * cached a profile for it, its transport parameters replace the ones in the configuration.
+ */
+void Sdr::applyTransportProfile(){
+  if (transport_cache.empty()) {
+    return;
+  }
+  device_addrs_t found = device::find(device_addr_t(device_args));
+  if (found.empty() || !found[0].has_key("serial")) {
+    return;
+  }
+  string serial = found[0].get("serial");
+  TransportProfile profile;
+  if (!load_transport_profile(transport_cache, serial, profile)) {
+    cout << "INFO: No transport profile for device " << serial << " in " << transport_cache << " (see tune_transport)" << endl;
+    return;
+  }
+  device_args = merge_device_args(device_args, profile.device_args);
+  cout << "INFO: Using the transport parameters tuned for device " << serial << ": " << profile.device_args << endl;
+  if (profile.rx_rate != rx_rate) {
+    cout << "WARNING: The transport profile was tuned at " << profile.rx_rate / 1e6 << " MHz, not " << rx_rate / 1e6;
+    cout << " MHz. Run tune_transport again for this configuration." << endl;
+  }
+}
+
+/*** @brief Checks the device against the state cache written by the last run
+ *
+ * If the cache describes this device (by serial number) set up with the same settings,
+ * the checks that only confirm that state (e.g. re-synchronizing the device time to the GPSDO)
+ * are shortened. Anything that doesn't match is set up from scratch as usual.
+ */
+void Sdr::loadDeviceState(){
+  map<string, string> state;
+  if (state_cache.empty() || !load_device_state(state_cache, state)) {
+    return;
+  }
+  string serial = getSerial();
+  warm_start = (!serial.empty() && state["serial"] == serial && state["fingerprint"] == getFingerprint());
+  time_synced = warm_start && (state["time_synced"] == "1");
+  if (warm_start) {
+    cout << "INFO: Device " << serial << " matches the state cache " << state_cache << endl;
+  }
+}
+
+/*** @brief Writes the state the device was set up to, for the next run
+ */
+void Sdr::saveDeviceState(){
+  if (state_cache.empty()) {
+    return;
+  }
+  map<string, string> state;
+  state["serial"] = getSerial();
+  state["fingerprint"] = getFingerprint();
+  state["time_synced"] = time_synced ? "1" : "0";
+  if (!save_device_state(state_cache, state)) {
+    cout << "WARNING: Could not write the device state cache " << state_cache << endl;
+  }
 }
 
 /*** @brief Checks for 10 MHz reference lock
 *
 * This function checks if the USRP device has locked to the 10 MHz reference
 * signal. Retrieves the list of sensor names from the USRP device and checks
-* for the presence of the "ref_locked" sensor. If it exists, waits for
-* the reference lock to be established, printing a dot every second until
-* the lock is achieved or a timeout occurs. If the lock is successful, it
+* for the presence of the "ref_locked" sensor. If it exists, polls it until
+* the reference lock is established or lock_timeout passes. If the lock is successful, it
 * prints "LOCKED"; otherwise, it prints "FAILED" and exits the program.
 *
 */
@@ -153,14 +263,7 @@ void Sdr::check10MhzLock(){
     if (find(sensor_names.begin(), sensor_names.end(), "ref_locked")
         != sensor_names.end()) {
         cout << "Waiting for reference lock..." << flush;
-        bool ref_locked = false;
-        for (int i = 0; i < 30 and not ref_locked; i++) {
-            ref_locked = usrp->get_mboard_sensor("ref_locked", 0).to_bool();
-            if (not ref_locked) {
-                cout << "." << flush;
-                this_thread::sleep_for(chrono::seconds(1));
-            }
-        }
+        bool ref_locked = poll_until([&]() { return usrp->get_mboard_sensor("ref_locked", 0).to_bool(); }, lock_timeout);
         if (ref_locked) {
             cout << "LOCKED" << endl;
         } else {
@@ -186,17 +289,8 @@ void Sdr::check10MhzLock(){
 */
 void Sdr::gpsLock(){
   //wait for GPS lock
-  bool gps_locked = usrp->get_mboard_sensor("gps_locked", 0).to_bool();
-  size_t num_gps_locked = 0;
-  for (int i = 0; i < 30 and not gps_locked; i++) {
-    gps_locked = usrp->get_mboard_sensor("gps_locked", 0).to_bool();
-    if (not gps_locked) {
-          cout << "." << flush;
-          this_thread::sleep_for(chrono::seconds(1));
-      }
-    }
+  bool gps_locked = poll_until([&]() { return usrp->get_mboard_sensor("gps_locked", 0).to_bool(); }, lock_timeout, 0.1);
   if (gps_locked) {
-    num_gps_locked++;
     cout << boost::format("GPS Locked\n");
   } else {
       cerr
@@ -209,17 +303,29 @@ void Sdr::gpsLock(){
  * Retrieves the GPS time from the USRP device, compares it with last PPS time
  * from USRP device, and prints results. If the GPS time matches the last PPS time,
  * synchronization is indicated. If it doesn't match, an error message is printed.
+ * If the state cache says a previous run already synchronized this device and its time
+ * still matches the GPS time, the time is left as it is.
  */
 void Sdr::checkAndSetTime(){
-  //set GPS time
     time_spec_t gps_time = time_spec_t(int64_t(usrp->get_mboard_sensor("gps_time", 0).to_int()));
-    usrp->set_time_next_pps(gps_time + 1.0, 0);
+    if (time_synced && usrp->get_time_last_pps(0).get_full_secs() == gps_time.get_full_secs()) {
+      cout << "INFO: USRP time is still synchronized to GPS time from the last run" << endl;
+      return;
+    }
+
+  //set GPS time (on every motherboard, they share the PPS)
+    usrp->set_time_next_pps(gps_time + 1.0);
 
     // Wait for it to apply
-    // The wait is 2 seconds because N-Series has a known issue where
+    // This can take up to 2 PPS edges because N-Series has a known issue where
     // the time at the last PPS does not properly update at the PPS edge
     // when the time is actually set.
-    this_thread::sleep_for(chrono::seconds(2));
+    int64_t target = gps_time.get_full_secs() + 1;
+    poll_until([&]() {
+      return usrp->get_time_last_pps(0).get_full_secs() > target ||
+             (usrp->get_time_last_pps(0).get_full_secs() == target &&
+              usrp->get_mboard_sensor("gps_time", 0).to_int() == target);
+    }, 2.5, 0.05);
  gps_time = time_spec_t(int64_t(usrp->get_mboard_sensor("gps_time", 0).to_int()));
     time_spec_t time_last_pps = usrp->get_time_last_pps(0);
     cout << "USRP time: "
@@ -227,7 +333,8 @@ void Sdr::checkAndSetTime(){
               << endl;
     cout << "GPSDO time: "
               << (boost::format("%0.9f") % gps_time.get_real_secs()) << std::endl;
-    if (gps_time.get_real_secs() == time_last_pps.get_real_secs())
+    time_synced = (gps_time.get_real_secs() == time_last_pps.get_real_secs());
+    if (time_synced)
         cout << endl
                   << "SUCCESS: USRP time synchronized to GPS time" << endl
                   << endl;
@@ -238,6 +345,26 @@ void Sdr::checkAndSetTime(){
                   << endl;
 }
 
+/*** @brief Checks that the motherboards of a multi-motherboard device agree on the time
+ *
+ * Every motherboard was set to the same time at the same PPS edge, so timed commands and streams
+ * line up across the boards only if they share a PPS (and 10 MHz reference). Throws if the times
+ * don't match. Does nothing with a single motherboard.
+ */
+void Sdr::checkTimeAlignment(){
+  size_t num_mboards = usrp->get_num_mboards();
+  if (num_mboards < 2) {
+    return;
+  }
+  if (clk_ref == "internal") {
+    cout << "WARNING: " << num_mboards << " motherboards with clk_ref 'internal'. Their times only line up if they share an external PPS." << endl;
+  }
+  if (!poll_until([&]() { return usrp->get_time_synchronized(); }, 1.0, 0.05)) {
+    throw std::runtime_error("The times of the " + to_string(num_mboards) + " motherboards are not aligned. Check the shared PPS and reference.");
+  }
+  cout << "INFO: Times of " << num_mboards << " motherboards aligned" << endl;
+}
+
 /*** @brief Detects and validates TX and RX channels
  * 
  * Splits the specified TX and RX channel strings into individual channel numbers,
@@ -265,28 +392,25 @@ void Sdr::detectChannels(){
 /*** @brief Sets the RF parameters for the USRP device
  * 
  * Configures the RF parameters for the USRP device based on the number of
- * TX channels specified. If only one TX channel is specified, calls
- * `set_rf_params_single` function. If two TX channels specified, calls
- * `set_rf_params_multi`. If number of channels is not supported, throws a runtime
- * error. After setting RF parameters, allows for a setup time
- * to ensure the parameters are applied correctly.
+ * RX channels specified. A single channel is set up from RF0 by
+ * `set_rf_params_single`. Any other number of channels (on one or several
+ * motherboards) is set up by `set_rf_params_channels`, channel k from section
+ * RFk; throws a runtime error if the configuration has fewer RF sections than
+ * channels. The LOs settle while the rest of the device is set up (see refLoLockDetect()).
 */
 
 void Sdr::setRFParams(){
- // set the RF parameters based on 1 or 2 channel operation
-   if (tx_channel_nums.size() == 1) {
+ // set the RF parameters for one channel, or for each channel from its own section
+   if (rx_channel_nums.size() == 1) {
     set_rf_params_single(usrp, rf0, rx_channel_nums, tx_channel_nums);
-  } else if (tx_channel_nums.size() == 2) {
-    if (!transmit) {
-      throw std::runtime_error("Non-transmit mode not supported by set_rf_params_multi");
-    }
-    set_rf_params_multi(usrp, rf0, rf1, rx_channel_nums, tx_channel_nums);
   } else {
-    throw std::runtime_error("Number of channels requested not supported");
+    if (rf_sections.size() < rx_channel_nums.size()) {
+      throw std::runtime_error(to_string(rx_channel_nums.size()) + " channels need sections RF0 to RF" +
+                               to_string(rx_channel_nums.size() - 1) + ", only " +
+                               to_string(rf_sections.size()) + " found in the configuration");
+    }
+    set_rf_params_channels(usrp, rf_sections, rx_channel_nums, tx_channel_nums);
   }
-
-  // allow for some setup time
-  this_thread::sleep_for(chrono::seconds(1));
 }
 
 /*** @brief Checks the reference and local oscillator (LO) lock status
@@ -294,7 +418,7 @@ void Sdr::setRFParams(){
  * Checks the lock status of the reference and local oscillator
  * for both transmit and receive channels. It retrieves the sensor names for
  * each channel and checks if the "lo_locked" sensor is present. If it is,
- * it retrieves the lock status and asserts that it is true. If the lock is not
+ * it polls the lock status for up to lo_lock_timeout and asserts that it is true. If the lock is not
  * established, it throws an assertion error.
 */
 
@@ -304,10 +428,12 @@ void Sdr::refLoLockDetect(){
   if (transmit) {
     for (size_t ch = 0; ch < tx_channel_nums.size(); ch++) {
       // Check LO locked
-      tx_sensor_names = usrp->get_tx_sensor_names(ch);
+      size_t chan = tx_channel_nums[ch];
+      tx_sensor_names = usrp->get_tx_sensor_names(chan);
       if (find(tx_sensor_names.begin(), tx_sensor_names.end(), "lo_locked") != tx_sensor_names.end())
       {
-        sensor_value_t lo_locked = usrp->get_tx_sensor("lo_locked", ch);
+        poll_until([&]() { return usrp->get_tx_sensor("lo_locked", chan).to_bool(); }, lo_lock_timeout);
+        sensor_value_t lo_locked = usrp->get_tx_sensor("lo_locked", chan);
         cout << boost::format("Checking TX: %s ...") % lo_locked.to_pp_string()
             << endl;
         UHD_ASSERT_THROW(lo_locked.to_bool());
@@ -317,10 +443,12 @@ void Sdr::refLoLockDetect(){
 
   for (size_t ch = 0; ch < rx_channel_nums.size(); ch++) {
     // Check LO locked
-    rx_sensor_names = usrp->get_rx_sensor_names(ch);
+    size_t chan = rx_channel_nums[ch];
+    rx_sensor_names = usrp->get_rx_sensor_names(chan);
     if (find(rx_sensor_names.begin(), rx_sensor_names.end(), "lo_locked") != rx_sensor_names.end())
     {
-      sensor_value_t lo_locked = usrp->get_rx_sensor("lo_locked", ch);
+      poll_until([&]() { return usrp->get_rx_sensor("lo_locked", chan).to_bool(); }, lo_lock_timeout);
+      sensor_value_t lo_locked = usrp->get_rx_sensor("lo_locked", chan);
       cout << boost::format("Checking RX: %s ...") % lo_locked.to_pp_string()
            << endl;
       UHD_ASSERT_THROW(lo_locked.to_bool());
@@ -337,10 +465,12 @@ void Sdr::refLoLockDetect(){
 */
 
 void Sdr::setupGpio(){
-  cout << "Available GPIO banks: " << std::endl;
-  auto banks = usrp->get_gpio_banks(0);
-  for (auto& bank : banks) {
-      cout << "* " << bank << std::endl;
+  if (!warm_start) {
+    cout << "Available GPIO banks: " << std::endl;
+    auto banks = usrp->get_gpio_banks(0);
+    for (auto& bank : banks) {
+        cout << "* " << bank << std::endl;
+    }
   }
 
   // basic ATR setup
@@ -386,21 +516,42 @@ void Sdr::setupTx(){
   }
 }
 
-/*** @brief Sets up the receive stream for the USRP device
+/*** @brief Sets up the receive stream(s) for the USRP device
  * 
  * Initializes the receive stream with the specified CPU and OTW formats,
  * and sets the number of channels for reception. Retrieves the receive stream
  * from the USRP device and prints maximum number of samples that can be
  * received in a single call.
+ *
+ * With several motherboards, each one gets its own streamer for its channels instead,
+ * so the boards can be received on their own threads.
  */
 void Sdr::setupRx(){
-   stream_args_t rx_stream_args(cpu_format, otw_format);
-
-  // rx streamer
-  rx_stream_args.channels = rx_channel_nums;
-  rx_stream = usrp->get_rx_stream(rx_stream_args);
+  // group the RX channels by motherboard, in order
+  vector<size_t> stream_mboards;
+  rx_stream_channels.clear();
+  for (size_t k = 0; k < rx_channel_nums.size(); k++) {
+    size_t mb = (usrp->get_num_mboards() > 1) ? channel_mboard(usrp, rx_channel_nums[k], false) : 0;
+    size_t stream = find(stream_mboards.begin(), stream_mboards.end(), mb) - stream_mboards.begin();
+    if (stream == stream_mboards.size()) {
+      stream_mboards.push_back(mb);
+      rx_stream_channels.emplace_back();
+    }
+    rx_stream_channels[stream].push_back(k);
+  }
 
-  cout << "INFO: rx_stream get_max_num_samps: " << rx_stream->get_max_num_samps() << endl;
+  // rx streamer(s)
+  rx_streams.clear();
+  for (size_t stream = 0; stream < rx_stream_channels.size(); stream++) {
+    stream_args_t rx_stream_args(cpu_format, otw_format);
+    for (size_t k : rx_stream_channels[stream]) {
+      rx_stream_args.channels.push_back(rx_channel_nums[k]);
+    }
+    rx_streams.push_back(usrp->get_rx_stream(rx_stream_args));
+    cout << "INFO: rx_stream (motherboard " << stream_mboards[stream] << ", " << rx_stream_args.channels.size();
+    cout << " channels) get_max_num_samps: " << rx_streams.back()->get_max_num_samps() << endl;
+  }
+  rx_stream = (rx_streams.size() == 1) ? rx_streams[0] : nullptr;
 }
 
 // DEVICE
@@ -412,6 +563,10 @@ string Sdr::getTxChannels() const {return tx_channels;}
 string Sdr::getRxChannels() const {return rx_channels;}
 string Sdr::getCpuFormat() const {return cpu_format;}
 string Sdr::getOtwFormat() const {return otw_format;}
+double Sdr::getLockTimeout() const {return lock_timeout;}
+double Sdr::getLoLockTimeout() const {return lo_lock_timeout;}
+string Sdr::getStateCache() const {return state_cache;}
+string Sdr::getTransportCache() const {return transport_cache;}
 
 // GPIO
 int Sdr::getPwrAmpPin() const {return pwr_amp_pin;}
@@ -425,11 +580,14 @@ int Sdr::getRefOutInt() const {return ref_out_int;}
 // RF
 YAML::Node Sdr::getRf0() const {return rf0;}
 YAML::Node Sdr::getRf1() const {return rf1;}
+const vector<YAML::Node>& Sdr::getRfSections() const {return rf_sections;}
 double Sdr::getRxRate() const {return rx_rate;}
 double Sdr::getTxRate() const {return tx_rate;}
 double Sdr::getFreq() const {return freq;}
 double Sdr::getRxGain() const {return rx_gain;}
 double Sdr::getTxGain() const {return tx_gain;}
+double Sdr::getAppliedRxGain() const {return applied_rx_gain;}
+double Sdr::getAppliedTxGain() const {return applied_tx_gain;}
 double Sdr::getBw() const {return bw;}
 string Sdr::getRxAnt() const {return rx_ant;}
 string Sdr::getTxAnt() const {return tx_ant;}
@@ -439,7 +597,11 @@ bool Sdr::getTransmit() const {return transmit;}
 usrp::multi_usrp::sptr Sdr::getUsrp() const {return usrp;}
 tx_streamer::sptr Sdr::getTxStream() const {return tx_stream;}
 rx_streamer::sptr Sdr::getRxStream() const {return rx_stream;}
+vector<rx_streamer::sptr>& Sdr::getRxStreams() {return rx_streams;}
+vector<vector<size_t>>& Sdr::getRxStreamChannels() {return rx_stream_channels;}
 vector<string>& Sdr::getTxChannelStrings() {return tx_channel_strings;}
 vector<size_t>& Sdr::getTxChannelNums() {return tx_channel_nums;}
 vector<string>& Sdr::getRxChannelStrings() {return rx_channel_strings;}
 vector<size_t>& Sdr::getRxChannelNums() {return rx_channel_nums;}
+StartupTimer& Sdr::getStartupTimer() {return startup_timer;}
+bool Sdr::getWarmStart() const {return warm_start;}
@@ -3,6 +3,8 @@
 
 #include "yaml-cpp/yaml.h"
 #include "rf_settings.hpp"
+#include "startup.hpp"
+#include "transport_tune.hpp"
 #include "common.hpp"
 
 class Sdr {
@@ -21,6 +23,10 @@ class Sdr {
     string getRxChannels() const;
     string getCpuFormat() const;
     string getOtwFormat() const;
+    double getLockTimeout() const;
+    double getLoLockTimeout() const;
+    string getStateCache() const;
+    string getTransportCache() const;
 
     // GPIO
     int getPwrAmpPin() const;
@@ -34,11 +40,14 @@ class Sdr {
     // RF
     YAML::Node getRf0() const;
     YAML::Node getRf1() const;
+    const vector<YAML::Node>& getRfSections() const;
     double getRxRate() const;
     double getTxRate() const;
     double getFreq() const;
     double getRxGain() const;
     double getTxGain() const;
+    double getAppliedRxGain() const;
+    double getAppliedTxGain() const;
     double getBw() const;
     string getRxAnt() const;
     string getTxAnt() const;
@@ -48,10 +57,14 @@ class Sdr {
     usrp::multi_usrp::sptr getUsrp() const;
     tx_streamer::sptr getTxStream() const;
     rx_streamer::sptr getRxStream() const;
+    vector<rx_streamer::sptr>& getRxStreams();
+    vector<vector<size_t>>& getRxStreamChannels();
     vector<string>& getTxChannelStrings();
     vector<size_t>& getTxChannelNums();
     vector<string>& getRxChannelStrings();
     vector<size_t>& getRxChannelNums();
+    StartupTimer& getStartupTimer();
+    bool getWarmStart() const;
 
   private:
     friend class SdrHwTest;
@@ -59,12 +72,18 @@ class Sdr {
     void check10MhzLock();
     void gpsLock();
     void checkAndSetTime();
+    void checkTimeAlignment();
     void detectChannels();
     void setRFParams();
     void refLoLockDetect();
     void setupGpio();
     void setupTx();
     void setupRx();
+    string getSerial();
+    string getFingerprint() const;
+    void loadDeviceState();
+    void applyTransportProfile();
+    void saveDeviceState();
 
     // DEVICE
     string device_args;
@@ -77,6 +96,10 @@ class Sdr {
                         // Supported options: "fc32", "sc16", "sc8"
     string otw_format;  // On the wire format. See https://files.ettus.com/manual/structuhd_1_1stream__args__t.html#a0ba0e946d2f83f7ac085f4f4e2ce9578
                         // (Any format supported.)
+    double lock_timeout;    // [s] How long to wait for the reference and GPS to lock
+    double lo_lock_timeout; // [s] How long to wait for the LOs to lock after tuning
+    string state_cache;     // File recording the device state set up by the last run ("" to disable)
+    string transport_cache; // Transport parameters per device serial, written by tune_transport ("" to disable)
 
     // GPIO
     int pwr_amp_pin;        // Which GPIO pin to use for external power amplifier control (set to -1 if not using)
@@ -91,11 +114,14 @@ class Sdr {
     // RF
     YAML::Node rf0; // RF FRONTEND 0
     YAML::Node rf1; // RF FRONTEND 1 (not supported on b205mini)
+    vector<YAML::Node> rf_sections; // RF0, RF1, ... (channel k uses RFk)
     double rx_rate; // [Hz] RX Sample Rate
     double tx_rate; // [Hz] TX Sample Rate
     double freq;    // [Hz] Center Frequency (mixer frequency)
     double rx_gain; // [dB] RX Gain
     double tx_gain; // [dB] TX Gain - 60.8 is about -10 dBm output on the b205mini
+    double applied_rx_gain; // [dB] RX Gain set on the first channel (from RF0, like the rest of the device setup)
+    double applied_tx_gain; // [dB] TX Gain set on the first channel (from RF0)
     double bw;      // [Hz] Configurable filter bandwidth
     string rx_ant;  // Port to be used for RX
     string tx_ant;  // Port to be used for TX
@@ -104,12 +130,19 @@ class Sdr {
     // USRP
     usrp::multi_usrp::sptr usrp;
     tx_streamer::sptr tx_stream;
-    rx_streamer::sptr rx_stream;
+    rx_streamer::sptr rx_stream;              // All RX channels (null with several motherboards, see rx_streams)
+    vector<rx_streamer::sptr> rx_streams;     // One streamer per motherboard
+    vector<vector<size_t>> rx_stream_channels; // Channels of each streamer (indices into rx_channel_nums)
     vector<string> tx_channel_strings;
     vector<size_t> tx_channel_nums;
     vector<string> rx_channel_strings;
     vector<size_t> rx_channel_nums;
 
+    // STARTUP
+    StartupTimer startup_timer;
+    bool warm_start;  // The device is still in the state the cache describes (set up by a previous run)
+    bool time_synced; // The device time has been set from the GPSDO
+
 };
 
 #endif
@@ -0,0 +1,124 @@
+#include <fstream>
+#include <iomanip>
+#include <fcntl.h>
+#include <unistd.h>
+#include "startup.hpp"
+
+/**
+ * @brief Polls a condition until it is true or a deadline passes
+ *
+ * Used instead of fixed sleeps while waiting for lock sensors and the like, so startup only takes as long as the
+ * hardware actually needs.
+ * @param condition Function returning true once the wait is over
+ * @param timeout [s] Time to give up after
+ * @param interval [s] Time between checks
+ * @return Returns true if the condition became true before the deadline
+ */
+bool poll_until(function<bool()> condition, double timeout, double interval) {
+  auto deadline = chrono::steady_clock::now() + chrono::duration<double>(timeout);
+  while (true) {
+    if (condition()) {
+      return true;
+    }
+    if (chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+    this_thread::sleep_for(chrono::duration<double>(interval));
+  }
+}
+
+/**
+ * @brief Reads the device state saved by a previous run
+ *
+ * @param filename State file (one "key=value" per line)
+ * @param state Set to the saved state
+ * @return Returns false if there is no state file
+ */
+bool load_device_state(const string& filename, map<string, string>& state) {
+  ifstream file(filename);
+  if (!file.is_open()) {
+    return false;
+  }
+  state.clear();
+  string line;
+  while (getline(file, line)) {
+    size_t equals = line.find('=');
+    if (equals != string::npos) {
+      state[line.substr(0, equals)] = line.substr(equals + 1);
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Saves the device state for the next run
+ *
+ * @param filename State file (replaced)
+ * @param state State to save. Values must not contain newlines.
+ * @return Returns false if the file couldn't be written
+ */
+bool save_device_state(const string& filename, const map<string, string>& state) {
+  ofstream file(filename, ofstream::trunc);
+  for (const auto& entry : state) {
+    file << entry.first << "=" << entry.second << "\n";
+  }
+  return file.good();
+}
+
+/**
+ * @brief Reserves disk space for a file without changing its size
+ *
+ * The blocks stay allocated to the file as it is written, so the file system doesn't have to find
+ * space while recording. Fails harmlessly on file systems that don't support it.
+ * @param filename Existing file
+ * @param bytes Number of bytes to reserve from the start of the file
+ * @return Returns true if the space was reserved
+ */
+bool preallocate_file(const string& filename, size_t bytes) {
+  if (bytes == 0) {
+    return true;
+  }
+  int fd = open(filename.c_str(), O_WRONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, bytes) == 0);
+  close(fd);
+  return ok;
+}
+
+StartupTimer::StartupTimer() : origin(chrono::steady_clock::now()) {}
+
+/**
+ * @return [s] Time since the timer was created
+ */
+double StartupTimer::elapsed() const {
+  return chrono::duration<double>(chrono::steady_clock::now() - origin).count();
+}
+
+/**
+ * @brief Records a step that has just finished. Safe to call from any thread.
+ *
+ * @param phase Name of the step
+ * @param start_time [s] elapsed() when the step started
+ */
+void StartupTimer::record(const string& phase, double start_time) {
+  double end_time = elapsed();
+  lock_guard<mutex> lock(phases_mutex);
+  phases.push_back({phase, start_time, end_time});
+}
+
+/**
+ * @brief Prints every recorded step in order of start time
+ */
+void StartupTimer::print() {
+  lock_guard<mutex> phases_lock(phases_mutex);
+  sort(phases.begin(), phases.end(), [](const Phase& a, const Phase& b) { return a.start_time < b.start_time; });
+  lock_guard<mutex> cout_lock(cout_mutex);
+  for (const Phase& phase : phases) {
+    cout << "[STARTUP] " << left << setw(24) << phase.name << right << fixed << setprecision(3);
+    cout << setw(8) << phase.start_time << " -> " << setw(8) << phase.end_time << " s (";
+    cout << setprecision(0) << (phase.end_time - phase.start_time) * 1e3 << " ms)" << endl;
+  }
+  cout << defaultfloat << setprecision(6);
+}
@@ -0,0 +1,36 @@
+#ifndef STARTUP_HPP
+#define STARTUP_HPP
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include "common.hpp"
+
+bool poll_until(function<bool()> condition, double timeout, double interval = 0.01);
+
+bool load_device_state(const string& filename, map<string, string>& state);
+bool save_device_state(const string& filename, const map<string, string>& state);
+bool preallocate_file(const string& filename, size_t bytes);
+
+// Records how long each step of the startup takes. Steps may run on different threads at the same time.
+class StartupTimer {
+  public:
+    StartupTimer();
+
+    double elapsed() const;
+    void record(const string& phase, double start_time);
+    void print();
+
+  private:
+    struct Phase {
+      string name;
+      double start_time; // [s] since the timer was created
+      double end_time;
+    };
+
+    chrono::steady_clock::time_point origin;
+    mutex phases_mutex;
+    vector<Phase> phases;
+};
+
+#endif // STARTUP_HPP
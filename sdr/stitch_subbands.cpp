@@ -0,0 +1,86 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include "subband_stitch.hpp"
+
+using namespace std;
+
+// Offline stitcher for stepped-frequency schedules: combines the traces of the sub-band streams
+// (waveforms with freq set) into wideband range profiles.
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        cout << "Usage: " << argv[0] << " [--no-align] <config.yaml> <output.bin> <subband.bin>..." << endl;
+        cout << "Stitches the traces of a stepped-frequency schedule into wideband range profiles." << endl;
+        cout << "config.yaml must be the configuration file the data was recorded with. Give one trace file per" << endl;
+        cout << "SCHEDULE waveform with a freq, in the order they are listed (e.g. <prefix>_<name>_rx_samps.bin)." << endl;
+        cout << "--no-align skips the LO phase alignment (only for devices that retune phase-coherently)." << endl;
+        return 1;
+    }
+
+    int arg = 1;
+    bool align_phase = true;
+    if (string(argv[arg]) == "--no-align") {
+        align_phase = false;
+        arg++;
+    }
+
+    try {
+        YAML::Node config = YAML::LoadFile(argv[arg++]);
+        string output_filename = argv[arg++];
+        double rx_rate = config["RF0"]["rx_rate"].as<double>();
+        PulseSchedule schedule(config, config["RF0"]["tx_rate"].as<double>(), rx_rate);
+
+        vector<const Waveform*> subbands;
+        for (size_t i = 0; i < schedule.getNumWaveforms(); i++) {
+            if (!isnan(schedule.getWaveform(i).freq)) {
+                subbands.push_back(&schedule.getWaveform(i));
+            }
+        }
+        if ((int) subbands.size() != argc - arg) {
+            throw invalid_argument("The schedule has " + to_string(subbands.size()) + " sub-bands, but " +
+                                   to_string(argc - arg) + " trace files were given.");
+        }
+        SubbandStitcher stitcher(subbands, rx_rate, align_phase);
+
+        vector<ifstream> infiles;
+        for (size_t k = 0; k < subbands.size(); k++) {
+            infiles.emplace_back(argv[arg + k], ifstream::binary);
+            if (!infiles.back().is_open()) {
+                throw runtime_error(string("Could not open ") + argv[arg + k]);
+            }
+            cout << "Sub-band '" << subbands[k]->name << "' at " << subbands[k]->freq / 1e6 << " MHz: " << argv[arg + k] << endl;
+        }
+        ofstream outfile(output_filename, ofstream::binary);
+
+        // One trace of every sub-band at a time, until the shortest file ends
+        vector<vector<complex<float>>> traces(subbands.size(), vector<complex<float>>(stitcher.getInputSamps()));
+        vector<const complex<float>*> trace_ptrs;
+        for (auto& trace : traces) {
+            trace_ptrs.push_back(trace.data());
+        }
+        vector<complex<float>> profile(stitcher.getOutputSamps());
+        long int num_profiles = 0;
+        while (true) {
+            bool complete = true;
+            for (size_t k = 0; k < subbands.size(); k++) {
+                complete = complete && infiles[k].read((char*) traces[k].data(), traces[k].size() * sizeof(complex<float>));
+            }
+            if (!complete) {
+                break;
+            }
+            stitcher.stitch(trace_ptrs, profile.data());
+            outfile.write((const char*) profile.data(), profile.size() * sizeof(complex<float>));
+            num_profiles++;
+        }
+        if (!outfile.good()) {
+            throw runtime_error("Could not write " + output_filename);
+        }
+        cout << num_profiles << " profiles of " << stitcher.getOutputSamps() << " samples at " << stitcher.getOutputRate() / 1e6;
+        cout << " MHz written to " << output_filename << endl;
+    } catch (const exception& e) {
+        cout << "ERROR: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
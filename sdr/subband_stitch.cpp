@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cmath>
+#include "subband_stitch.hpp"
+
+/**
+ * @brief Prepares the matched filters and frequency grid
+ *
+ * All sub-bands must have the same RX window length, and the steps between their center frequencies
+ * must be multiples of sample_rate / num_rx_samps. Throws invalid_argument otherwise.
+ * @param subbands Waveforms of the sub-bands (each with freq set)
+ * @param sample_rate [Hz] RX (and TX) sample rate
+ * @param align_phase True to remove each sub-band's LO phase, by aligning the phase of the strongest return
+ *        (e.g. the direct path) across sub-bands. Only leave this off if the device retunes phase-coherently.
+ */
+SubbandStitcher::SubbandStitcher(const vector<const Waveform*>& subbands_in, double sample_rate, bool align_phase) :
+  sample_rate(sample_rate), align_phase(align_phase) {
+  if (subbands_in.size() < 2) {
+    throw invalid_argument("At least two sub-bands are needed.");
+  }
+  num_samps = subbands_in.front()->num_rx_samps;
+  bin_spacing = sample_rate / num_samps;
+
+  double max_freq = -INFINITY;
+  min_freq = INFINITY;
+  for (const Waveform* waveform : subbands_in) {
+    if (isnan(waveform->freq) || waveform->num_rx_samps != num_samps) {
+      throw invalid_argument("Sub-band '" + waveform->name + "' has no freq or a different rx_duration.");
+    }
+    if (waveform->chirp.sample_rate != sample_rate) {
+      throw invalid_argument("Sub-band '" + waveform->name + "' is generated at a different sample rate.");
+    }
+    Subband subband;
+    subband.freq_offset = waveform->freq - subbands_in.front()->freq;
+    double steps = subband.freq_offset / bin_spacing;
+    if (fabs(steps - round(steps)) > 1e-3) {
+      throw invalid_argument("Sub-band '" + waveform->name + "' is not a multiple of " + to_string(bin_spacing) + " Hz from the first.");
+    }
+
+    // Matched filter: conjugate spectrum of the chirp, zero padded or cut to the RX window
+    subband.matched_filter.assign(num_samps, 0.0);
+    for (size_t i = 0; i < min(num_samps, waveform->tx_chirp.size()); i++) {
+      subband.matched_filter[i] = complex<double>(waveform->tx_chirp[i]);
+    }
+    dft(subband.matched_filter, false);
+    for (auto& bin : subband.matched_filter) {
+      bin = conj(bin);
+    }
+
+    double low = subband.freq_offset + waveform->chirp.lo_offset_sw - waveform->chirp.chirp_bandwidth / 2;
+    double high = subband.freq_offset + waveform->chirp.lo_offset_sw + waveform->chirp.chirp_bandwidth / 2;
+    min_freq = min(min_freq, low);
+    max_freq = max(max_freq, high);
+    subbands.push_back(subband);
+  }
+  // Snap the grid to the sub-band bins
+  min_freq = floor(min_freq / bin_spacing) * bin_spacing;
+  size_t num_bins = (size_t) round((max_freq - min_freq) / bin_spacing) + 1;
+
+  // Bins of each sub-band that fall in its chirp's bandwidth
+  vector<int> coverage(num_bins, 0);
+  for (size_t k = 0; k < subbands.size(); k++) {
+    const ChirpParams& chirp = subbands_in[k]->chirp;
+    for (size_t i = 0; i < num_samps; i++) {
+      double bin_freq = ((i < (num_samps + 1) / 2) ? (double) i : (double) i - num_samps) * bin_spacing;
+      if (fabs(bin_freq - chirp.lo_offset_sw) > chirp.chirp_bandwidth / 2) {
+        continue;
+      }
+      long int j = lround((subbands[k].freq_offset + bin_freq - min_freq) / bin_spacing);
+      if (j >= 0 && j < (long int) num_bins) {
+        subbands[k].bins.push_back(make_pair(i, (size_t) j));
+        coverage[j]++;
+      }
+    }
+  }
+  weights.resize(num_bins);
+  for (size_t j = 0; j < num_bins; j++) {
+    weights[j] = coverage[j] > 0 ? 1.0 / coverage[j] : 0;
+  }
+  spectra.assign(subbands.size(), vector<complex<double>>(num_samps));
+  wideband.resize(num_bins);
+}
+
+/**
+ * @brief Returns a compressed sub-band at any delay (band-limited interpolation of its spectrum)
+ *
+ * @param k Sub-band index
+ * @param delay [s] Delay
+ * @return Compressed sample (times num_samps)
+ */
+complex<double> SubbandStitcher::compressedValue(size_t k, double delay) const {
+  complex<double> value = 0;
+  for (size_t i = 0; i < num_samps; i++) {
+    double bin_freq = ((i < (num_samps + 1) / 2) ? (double) i : (double) i - num_samps) * bin_spacing;
+    value += spectra[k][i] * polar(1.0, 2 * M_PI * bin_freq * delay);
+  }
+  return value;
+}
+
+size_t SubbandStitcher::getNumSubbands() const {return subbands.size();}
+size_t SubbandStitcher::getInputSamps() const {return num_samps;}
+size_t SubbandStitcher::getOutputSamps() const {return wideband.size();}
+
+/**
+ * @return [Hz] Sample rate of the stitched profile (its bandwidth)
+ */
+double SubbandStitcher::getOutputRate() const {return wideband.size() * bin_spacing;}
+
+/**
+ * @brief Stitches one trace of each sub-band into a wideband range profile
+ *
+ * The profile is complex baseband relative to the first sub-band's center frequency, with the same
+ * delay origin as the sub-band traces.
+ * @param traces getInputSamps() samples of each sub-band, in the order of the constructor's sub-bands
+ * @param output getOutputSamps() samples of the stitched profile
+ */
+void SubbandStitcher::stitch(const vector<const complex<float>*>& traces, complex<float>* output) {
+  // Pulse compress each sub-band
+  for (size_t k = 0; k < subbands.size(); k++) {
+    for (size_t i = 0; i < num_samps; i++) {
+      spectra[k][i] = complex<double>(traces[k][i]);
+    }
+    dft(spectra[k], false);
+    for (size_t i = 0; i < num_samps; i++) {
+      spectra[k][i] *= subbands[k].matched_filter[i];
+    }
+  }
+
+  vector<complex<double>> rotations(subbands.size(), 1.0);
+  if (align_phase) {
+    // Coarse delay of the strongest return, from the incoherent sum of the compressed sub-bands
+    vector<double> power(num_samps, 0);
+    vector<complex<double>> profile(num_samps);
+    for (size_t k = 0; k < subbands.size(); k++) {
+      profile = spectra[k];
+      dft(profile, true);
+      for (size_t i = 0; i < num_samps; i++) {
+        power[i] += norm(profile[i]);
+      }
+    }
+    double peak = max_element(power.begin(), power.end()) - power.begin();
+    if (peak > num_samps / 2.0) {
+      peak -= num_samps; // Circular correlation: late samples are negative delays
+    }
+
+    // Refine it to a small fraction of a sample: an error of d seconds would leave the sub-bands
+    // 2 pi d freq_offset out of phase, so the band-limited peak is searched (golden section)
+    auto incoherent_power = [&](double delay) {
+      double total = 0;
+      for (size_t k = 0; k < subbands.size(); k++) {
+        total += norm(compressedValue(k, delay));
+      }
+      return total;
+    };
+    const double ratio = (sqrt(5.0) - 1) / 2;
+    double low = (peak - 1) / sample_rate;
+    double high = (peak + 1) / sample_rate;
+    double a = high - ratio * (high - low);
+    double b = low + ratio * (high - low);
+    double power_a = incoherent_power(a);
+    double power_b = incoherent_power(b);
+    for (int iteration = 0; iteration < 40; iteration++) {
+      if (power_a < power_b) {
+        low = a;
+        a = b;
+        power_a = power_b;
+        b = low + ratio * (high - low);
+        power_b = incoherent_power(b);
+      } else {
+        high = b;
+        b = a;
+        power_b = power_a;
+        a = high - ratio * (high - low);
+        power_a = incoherent_power(a);
+      }
+    }
+    double delay = (low + high) / 2;
+
+    // Rotate each sub-band so its return has the phase it would have with a common LO phase
+    for (size_t k = 0; k < subbands.size(); k++) {
+      rotations[k] = polar(1.0, -arg(compressedValue(k, delay)) - 2 * M_PI * subbands[k].freq_offset * delay);
+    }
+  }
+
+  fill(wideband.begin(), wideband.end(), complex<double>(0, 0));
+  for (size_t k = 0; k < subbands.size(); k++) {
+    for (const auto& bin : subbands[k].bins) {
+      wideband[bin.second] += spectra[k][bin.first] * rotations[k] * weights[bin.second];
+    }
+  }
+  dft(wideband, true);
+
+  // Bin 0 is at min_freq: shift the profile back to baseband around the first sub-band
+  size_t num_bins = wideband.size();
+  for (size_t n = 0; n < num_bins; n++) {
+    double cycles = min_freq * n / (num_bins * bin_spacing);
+    output[n] = complex<float>(wideband[n] * polar(1.0, 2 * M_PI * (cycles - floor(cycles))) / (double) num_samps);
+  }
+}
@@ -0,0 +1,43 @@
+#ifndef SUBBAND_STITCH_HPP
+#define SUBBAND_STITCH_HPP
+
+#include <complex>
+#include "pulse_schedule.hpp"
+#include "fft.hpp"
+#include "common.hpp"
+
+// Combines the traces of the sub-bands of a stepped-frequency schedule into one wideband range profile.
+// Each sub-band trace is pulse compressed in the frequency domain, its chirp's bandwidth is placed at its
+// offset from the first sub-band on a common frequency grid (averaging where sub-bands overlap), and
+// the grid is transformed back to a profile sampled at the stitched bandwidth.
+class SubbandStitcher {
+  public:
+    SubbandStitcher(const vector<const Waveform*>& subbands, double sample_rate, bool align_phase);
+
+    size_t getNumSubbands() const;
+    size_t getInputSamps() const;
+    size_t getOutputSamps() const;
+    double getOutputRate() const;
+    void stitch(const vector<const complex<float>*>& traces, complex<float>* output);
+
+  private:
+    complex<double> compressedValue(size_t k, double delay) const;
+
+    struct Subband {
+        double freq_offset;                     // [Hz] Center frequency relative to the first sub-band
+        vector<complex<double>> matched_filter; // Conjugate spectrum of the sub-band's chirp
+        vector<pair<size_t, size_t>> bins;      // (Sub-band bin, wideband bin) of the chirp's bandwidth
+    };
+
+    vector<Subband> subbands;
+    size_t num_samps;       // Samples per sub-band trace
+    double sample_rate;     // [Hz] Sub-band sample rate
+    double bin_spacing;     // [Hz] sample_rate / num_samps, shared by the sub-bands and the wideband grid
+    double min_freq;        // [Hz] Frequency of wideband bin 0, relative to the first sub-band
+    bool align_phase;       // Remove each sub-band's LO phase using the strongest return
+    vector<double> weights; // 1 / number of sub-bands covering each wideband bin (0 if none)
+    vector<vector<complex<double>>> spectra; // Compressed spectrum of each sub-band (reused between traces)
+    vector<complex<double>> wideband;        // Wideband spectrum, then profile (reused between traces)
+};
+
+#endif // SUBBAND_STITCH_HPP
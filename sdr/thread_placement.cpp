@@ -0,0 +1,225 @@
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <cstring>
+#include "thread_placement.hpp"
+
+/**
+ * @brief Builds a ThreadPlacement from its THREADS config entries
+ *
+ * @param name Name of the thread (used in the startup report and warnings)
+ * @param cores CPU list in isolcpus/taskset syntax, e.g. "2" or "2-3,6" (empty = not pinned)
+ * @param priority SCHED_FIFO priority 1-99 (0 = keep the default priority)
+ * @return The placement. Throws invalid_argument if either entry is invalid.
+ */
+ThreadPlacement parse_thread_placement(const string& name, const string& cores, int priority) {
+  if (priority < 0 || priority > MAX_FIFO_PRIORITY) {
+    throw invalid_argument(name + "_priority must be between 0 and " + to_string(MAX_FIFO_PRIORITY) + ".");
+  }
+  ThreadPlacement placement;
+  placement.name = name;
+  placement.cores = parse_cpu_list(cores);
+  placement.priority = priority;
+  return placement;
+}
+
+/**
+ * @brief Parses a CPU list as used by isolcpus, taskset -c and sysfs (e.g. /sys/devices/system/cpu/online)
+ *
+ * @param list Comma-separated CPU numbers and ranges, e.g. "1,3-5". Whitespace is ignored.
+ * @return Sorted CPU numbers without duplicates. Throws invalid_argument on a malformed list.
+ */
+vector<int> parse_cpu_list(const string& list) {
+  vector<int> cpus;
+  string item;
+  stringstream ss(list);
+  while (getline(ss, item, ',')) {
+    item.erase(remove_if(item.begin(), item.end(), ::isspace), item.end());
+    if (item.empty()) {
+      continue;
+    }
+    size_t dash = item.find('-');
+    int first, last;
+    try {
+      size_t pos;
+      first = stoi(item.substr(0, dash), &pos);
+      if (pos != dash && !(dash == string::npos && pos == item.size())) {
+        throw invalid_argument(item);
+      }
+      last = (dash == string::npos) ? first : stoi(item.substr(dash + 1), &pos);
+      if (dash != string::npos && pos != item.size() - dash - 1) {
+        throw invalid_argument(item);
+      }
+    } catch (const logic_error&) {
+      throw invalid_argument("Invalid CPU list: \"" + list + "\"");
+    }
+    if (first < 0 || last < first || last >= CPU_SETSIZE) {
+      throw invalid_argument("Invalid CPU list: \"" + list + "\"");
+    }
+    for (int cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  sort(cpus.begin(), cpus.end());
+  cpus.erase(unique(cpus.begin(), cpus.end()), cpus.end());
+  return cpus;
+}
+
+/**
+ * @brief Formats CPU numbers as a compact CPU list (inverse of parse_cpu_list)
+ *
+ * @param cpus Sorted CPU numbers
+ * @return CPU list, e.g. "1,3-5", or "-" if empty
+ */
+string format_cpu_list(const vector<int>& cpus) {
+  if (cpus.empty()) {
+    return "-";
+  }
+  stringstream ss;
+  for (size_t i = 0; i < cpus.size(); i++) {
+    size_t j = i;
+    while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+      j++;
+    }
+    if (i > 0) {
+      ss << ",";
+    }
+    ss << cpus[i];
+    if (j > i) {
+      ss << "-" << cpus[j];
+    }
+    i = j;
+  }
+  return ss.str();
+}
+
+/**
+ * @brief Returns the CPUs isolated from the general scheduler (isolcpus= kernel parameter)
+ *
+ * @return Isolated CPU numbers (empty if none or if they can't be determined)
+ */
+vector<int> get_isolated_cpus() {
+  ifstream isolated("/sys/devices/system/cpu/isolated");
+  string list;
+  if (!isolated.is_open() || !getline(isolated, list)) {
+    return vector<int>();
+  }
+  try {
+    return parse_cpu_list(list);
+  } catch (const invalid_argument&) {
+    return vector<int>();
+  }
+}
+
+/**
+ * @brief Returns the CPUs the calling thread may currently run on
+ *
+ * @return CPU numbers (empty if the affinity can't be read)
+ */
+vector<int> get_thread_cores() {
+  vector<int> cores;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) != 0) {
+    return cores;
+  }
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &set)) {
+      cores.push_back(cpu);
+    }
+  }
+  return cores;
+}
+
+/**
+ * @brief Restricts the calling thread to a set of CPUs
+ *
+ * Threads created afterwards by this thread inherit the same set.
+ * @param cores CPU numbers (empty = no change)
+ * @return Returns false if the affinity could not be set
+ */
+bool set_thread_cores(const vector<int>& cores) {
+  if (cores.empty()) {
+    return true;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cores) {
+    CPU_SET(cpu, &set);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) == 0;
+}
+
+/**
+ * @brief Pins the calling thread to its cores and sets its SCHED_FIFO priority
+ *
+ * Failures are not fatal: a warning is printed and the thread keeps running where it was.
+ * Setting a real-time priority needs CAP_SYS_NICE or a sufficient rtprio limit (ulimit -r).
+ * @param placement Placement of the calling thread
+ * @return Returns false if any part of the placement could not be applied
+ */
+bool apply_thread_placement(const ThreadPlacement& placement) {
+  bool ok = true;
+  if (!set_thread_cores(placement.cores)) {
+    lock_guard<mutex> lock(cout_mutex);
+    cout << "WARNING: Could not pin " << placement.name << " thread to CPU(s) " << format_cpu_list(placement.cores) << endl;
+    ok = false;
+  }
+  if (placement.priority > 0) {
+    sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = placement.priority;
+    int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (ret != 0) {
+      lock_guard<mutex> lock(cout_mutex);
+      cout << "WARNING: Could not set SCHED_FIFO priority " << placement.priority << " for " << placement.name;
+      cout << " thread: " << strerror(ret) << " (needs CAP_SYS_NICE or ulimit -r)" << endl;
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+/**
+ * @brief Prints where each thread will run and checks the layout for likely sources of jitter
+ *
+ * Warns when a real-time thread is pinned to a CPU that isn't isolated (so ordinary processes such as
+ * the payload manager can be scheduled on it), when two different threads share a CPU, and when a
+ * configured CPU isn't online.
+ * @param placements Placement of every configured thread
+ */
+void print_thread_placement(const vector<ThreadPlacement>& placements) {
+  vector<int> isolated = get_isolated_cpus();
+  long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+  cout << "INFO: Thread placement (" << num_cpus << " CPUs online, isolated: " << format_cpu_list(isolated) << ")" << endl;
+  for (const ThreadPlacement& p : placements) {
+    cout << "  " << left << setw(8) << p.name << right << " CPUs: " << left << setw(8) << format_cpu_list(p.cores) << right;
+    if (p.priority > 0) {
+      cout << " SCHED_FIFO " << p.priority << endl;
+    } else {
+      cout << " default priority" << endl;
+    }
+  }
+
+  for (size_t i = 0; i < placements.size(); i++) {
+    const ThreadPlacement& p = placements[i];
+    for (int cpu : p.cores) {
+      if (cpu >= num_cpus) {
+        cout << "WARNING: " << p.name << " thread is pinned to CPU " << cpu << ", which is not online" << endl;
+      } else if (p.priority > 0 && !binary_search(isolated.begin(), isolated.end(), cpu)) {
+        cout << "WARNING: " << p.name << " thread is real-time but CPU " << cpu << " is not in isolcpus; ";
+        cout << "other processes can run on it" << endl;
+      }
+      for (size_t j = i + 1; j < placements.size(); j++) {
+        if (binary_search(placements[j].cores.begin(), placements[j].cores.end(), cpu)) {
+          cout << "WARNING: " << p.name << " and " << placements[j].name << " threads share CPU " << cpu << endl;
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,24 @@
+#ifndef THREAD_PLACEMENT_HPP
+#define THREAD_PLACEMENT_HPP
+
+#include "common.hpp"
+
+const int MAX_FIFO_PRIORITY = 99;
+
+// Where one of the radar's threads (or group of threads) runs: the cores it may use and its real-time priority
+struct ThreadPlacement {
+    string name;
+    vector<int> cores; // CPUs the thread is pinned to (empty = not pinned, inherits the process's CPU set)
+    int priority;      // SCHED_FIFO priority 1-99 (0 = leave the scheduling policy as it is)
+};
+
+ThreadPlacement parse_thread_placement(const string& name, const string& cores, int priority);
+vector<int> parse_cpu_list(const string& list);
+string format_cpu_list(const vector<int>& cpus);
+vector<int> get_isolated_cpus();
+vector<int> get_thread_cores();
+bool set_thread_cores(const vector<int>& cores);
+bool apply_thread_placement(const ThreadPlacement& placement);
+void print_thread_placement(const vector<ThreadPlacement>& placements);
+
+#endif // THREAD_PLACEMENT_HPP
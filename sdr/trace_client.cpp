@@ -0,0 +1,70 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include "trace_ring.hpp"
+
+using namespace std;
+
+// Example consumer of the live trace ring. Follows the newest traces and prints once a second how many
+// it received and how many it missed. With a large consume_ms it shows that a slow reader only loses
+// traces; the radar never waits for it.
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 3) {
+        cout << "Usage: " << argv[0] << " <shm_name> [consume_ms]" << endl;
+        cout << "Follows the presummed traces the radar publishes with PUBLISH:shm_name set." << endl;
+        cout << "consume_ms simulates per-trace processing time (default 0)." << endl;
+        return 1;
+    }
+    int consume_ms = (argc == 3) ? atoi(argv[2]) : 0;
+
+    unique_ptr<TraceSubscriber> ring;
+    try {
+        ring.reset(new TraceSubscriber(argv[1]));
+    } catch (const exception& e) {
+        cout << "ERROR: " << e.what() << endl;
+        return 1;
+    }
+    cout << "Attached to " << argv[1] << ": " << ring->getNumSlots() << " slots of " << ring->getSampsPerTrace() << " samples" << endl;
+
+    vector<complex<float>> samples(ring->getSampsPerTrace());
+    TraceInfo info = TraceInfo();
+    uint64_t next = ring->getNumPublished();
+    long int received = 0, missed = 0;
+    auto last_print = chrono::steady_clock::now();
+
+    while (true) {
+        uint64_t published = ring->getNumPublished();
+        // Skip ahead past anything that has already been overwritten
+        if (published > next + ring->getNumSlots()) {
+            missed += published - ring->getNumSlots() - next;
+            next = published - ring->getNumSlots();
+        }
+
+        int status = ring->read(next, info, samples.data());
+        if (status == TRACE_OK) {
+            received++;
+            next++;
+            if (consume_ms > 0) {
+                this_thread::sleep_for(chrono::milliseconds(consume_ms));
+            }
+        } else if (status == TRACE_OVERWRITTEN) {
+            missed++;
+            next++;
+        } else {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+
+        auto now = chrono::steady_clock::now();
+        if (now - last_print >= chrono::seconds(1)) {
+            cout << "published: " << published << "  received: " << received << "  missed: " << missed;
+            if (received > 0) {
+                double latency = chrono::duration<double>(chrono::system_clock::now().time_since_epoch()).count() - info.publish_time;
+                cout << "  last trace: " << info.trace_index << " (" << info.num_pulses << " pulses, " << info.error_count;
+                cout << " errors, " << latency * 1e3 << " ms old)";
+            }
+            cout << endl;
+            last_print = now;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,190 @@
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "trace_ring.hpp"
+
+// Slot size is rounded up so every slot (and its samples) starts on a cache line
+static size_t slot_bytes_for(size_t samps_per_trace) {
+  size_t n_bytes = sizeof(TraceSlotHeader) + samps_per_trace * sizeof(complex<float>);
+  return ((n_bytes + 63) / 64) * 64;
+}
+
+static string shm_path(const string& name) {
+  return (name[0] == '/') ? name : "/" + name;
+}
+
+/**
+ * @brief Creates the shared memory ring
+ *
+ * Any stale object with the same name (e.g. left behind by a crashed run) is replaced.
+ * Throws runtime_error if the shared memory can't be created.
+ * @param name Shared memory object name (appears as /dev/shm/<name>)
+ * @param samps_per_trace Number of samples in each trace
+ * @param num_slots Number of traces kept in the ring
+ */
+TracePublisher::TracePublisher(const string& name, size_t samps_per_trace, uint32_t num_slots) : name(shm_path(name)) {
+  if (num_slots < 1 || samps_per_trace < 1) {
+    throw invalid_argument("Trace ring needs at least one slot and one sample per trace.");
+  }
+  size_t slot_bytes = slot_bytes_for(samps_per_trace);
+  region_bytes = sizeof(TraceRingHeader) + num_slots * slot_bytes;
+
+  shm_unlink(this->name.c_str());
+  int fd = shm_open(this->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    throw runtime_error("Could not create shared memory " + this->name + ": " + strerror(errno));
+  }
+  if (ftruncate(fd, region_bytes) != 0) {
+    close(fd);
+    shm_unlink(this->name.c_str());
+    throw runtime_error("Could not size shared memory " + this->name + ": " + strerror(errno));
+  }
+  void* p = mmap(nullptr, region_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    shm_unlink(this->name.c_str());
+    throw runtime_error("Could not map shared memory " + this->name + ": " + strerror(errno));
+  }
+  region = (uint8_t*) p;
+  memset(region, 0, region_bytes); // Also faults in every page before streaming starts
+
+  header = new (region) TraceRingHeader;
+  header->num_slots = num_slots;
+  header->samps_per_trace = samps_per_trace;
+  header->slot_bytes = slot_bytes;
+  header->num_published.store(0);
+  header->version = TRACE_RING_VERSION;
+  atomic_thread_fence(memory_order_release);
+  header->magic = TRACE_RING_MAGIC; // Written last so readers never see a half-initialised header
+}
+
+TracePublisher::~TracePublisher() {
+  munmap(region, region_bytes);
+  shm_unlink(name.c_str()); // Readers that are still attached keep their mapping
+}
+
+/**
+ * @brief Copies a trace into the next slot of the ring
+ *
+ * Never blocks. Only one thread may publish.
+ * @param trace samps_per_trace samples
+ * @param num_pulses Number of error-free pulses recorded up to and including this trace
+ * @param error_count Number of error pulses so far
+ * @param num_presums Pulses averaged into this trace
+ */
+void TracePublisher::publish(const complex<float>* trace, int64_t num_pulses, int64_t error_count, int32_t num_presums) {
+  uint64_t index = header->num_published.load(memory_order_relaxed);
+  uint8_t* slot = region + sizeof(TraceRingHeader) + (index % header->num_slots) * header->slot_bytes;
+  TraceSlotHeader* slot_header = (TraceSlotHeader*) slot;
+
+  slot_header->seq.store(2 * index + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  slot_header->trace_index = index;
+  slot_header->num_pulses = num_pulses;
+  slot_header->error_count = error_count;
+  slot_header->num_presums = num_presums;
+  slot_header->publish_time = chrono::duration<double>(chrono::system_clock::now().time_since_epoch()).count();
+  memcpy(slot + sizeof(TraceSlotHeader), trace, header->samps_per_trace * sizeof(complex<float>));
+  slot_header->seq.store(2 * index + 2, memory_order_release);
+
+  header->num_published.store(index + 1, memory_order_release);
+}
+
+string TracePublisher::getName() const {return name;}
+uint64_t TracePublisher::getNumPublished() const {return header->num_published.load();}
+size_t TracePublisher::getRegionBytes() const {return region_bytes;}
+
+/**
+ * @brief Attaches read-only to a ring created by a TracePublisher
+ *
+ * Throws runtime_error if the shared memory doesn't exist or isn't a trace ring.
+ * @param name Shared memory object name used by the radar
+ */
+TraceSubscriber::TraceSubscriber(const string& name) {
+  string path = shm_path(name);
+  int fd = shm_open(path.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    throw runtime_error("Could not open shared memory " + path + ": " + strerror(errno));
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(TraceRingHeader)) {
+    close(fd);
+    throw runtime_error("Shared memory " + path + " is not a trace ring");
+  }
+  region_bytes = st.st_size;
+  void* p = mmap(nullptr, region_bytes, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    throw runtime_error("Could not map shared memory " + path + ": " + strerror(errno));
+  }
+  region = (const uint8_t*) p;
+  header = (const TraceRingHeader*) region;
+  if (header->magic != TRACE_RING_MAGIC || header->version != TRACE_RING_VERSION ||
+      sizeof(TraceRingHeader) + header->num_slots * header->slot_bytes > region_bytes) {
+    munmap((void*) region, region_bytes);
+    throw runtime_error("Shared memory " + path + " is not a compatible trace ring");
+  }
+  atomic_thread_fence(memory_order_acquire);
+}
+
+TraceSubscriber::~TraceSubscriber() {
+  munmap((void*) region, region_bytes);
+}
+
+/**
+ * @brief Hands a trace to consume() directly from shared memory, without copying it
+ *
+ * The writer may overwrite the slot while consume() runs; in that case TRACE_OVERWRITTEN is returned
+ * and whatever consume() computed must be discarded.
+ * @param trace Index of the trace to read
+ * @param consume Called with the trace metadata and a pointer to its samples
+ * @return TRACE_OK, TRACE_NOT_READY or TRACE_OVERWRITTEN
+ */
+int TraceSubscriber::view(uint64_t trace, const function<void(const TraceInfo&, const complex<float>*)>& consume) const {
+  const uint8_t* slot = region + sizeof(TraceRingHeader) + (trace % header->num_slots) * header->slot_bytes;
+  const TraceSlotHeader* slot_header = (const TraceSlotHeader*) slot;
+
+  uint64_t seq = slot_header->seq.load(memory_order_acquire);
+  if (seq < 2 * trace + 2) {
+    return TRACE_NOT_READY;
+  } else if (seq > 2 * trace + 2) {
+    return TRACE_OVERWRITTEN;
+  }
+  TraceInfo info;
+  info.trace_index = slot_header->trace_index;
+  info.num_pulses = slot_header->num_pulses;
+  info.error_count = slot_header->error_count;
+  info.num_presums = slot_header->num_presums;
+  info.publish_time = slot_header->publish_time;
+  consume(info, (const complex<float>*) (slot + sizeof(TraceSlotHeader)));
+
+  atomic_thread_fence(memory_order_acquire);
+  if (slot_header->seq.load(memory_order_relaxed) != seq) {
+    return TRACE_OVERWRITTEN;
+  }
+  return TRACE_OK;
+}
+
+/**
+ * @brief Copies a trace out of shared memory
+ *
+ * @param trace Index of the trace to read
+ * @param info Set to the trace metadata
+ * @param samples Buffer of getSampsPerTrace() samples the trace is copied to
+ * @return TRACE_OK, TRACE_NOT_READY or TRACE_OVERWRITTEN (info and samples are only valid for TRACE_OK)
+ */
+int TraceSubscriber::read(uint64_t trace, TraceInfo& info, complex<float>* samples) const {
+  size_t n_bytes = header->samps_per_trace * sizeof(complex<float>);
+  return view(trace, [&](const TraceInfo& slot_info, const complex<float>* slot_samples) {
+    info = slot_info;
+    memcpy(samples, slot_samples, n_bytes);
+  });
+}
+
+uint64_t TraceSubscriber::getNumPublished() const {return header->num_published.load(memory_order_acquire);}
+uint32_t TraceSubscriber::getNumSlots() const {return header->num_slots;}
+uint32_t TraceSubscriber::getSampsPerTrace() const {return header->samps_per_trace;}
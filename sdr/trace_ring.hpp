@@ -0,0 +1,99 @@
+#ifndef TRACE_RING_HPP
+#define TRACE_RING_HPP
+
+#include <atomic>
+#include <complex>
+#include <functional>
+#include "common.hpp"
+
+// Live presummed traces are published into a POSIX shared-memory ring (/dev/shm/<name>) so other
+// processes can follow the capture without touching the output files. The radar is the only writer
+// and never waits for readers: a reader that falls behind by more than num_slots traces simply
+// misses the overwritten ones. Each slot carries a sequence number (odd while the slot is being
+// written) that readers check before and after using the samples.
+//
+// Layout: TraceRingHeader, then num_slots slots of slot_bytes each. A slot is a TraceSlotHeader
+// followed by samps_per_trace complex<float> samples. All fields are little-endian.
+
+const uint32_t TRACE_RING_MAGIC = 0x52545243; // "CRTR"
+const uint32_t TRACE_RING_VERSION = 1;
+
+// Return codes of TraceSubscriber::read()
+const int TRACE_OK = 0;          // Trace returned
+const int TRACE_NOT_READY = 1;   // Trace hasn't been published yet
+const int TRACE_OVERWRITTEN = 2; // Trace was overwritten before (or while) it was read
+
+static_assert(atomic<uint64_t>::is_always_lock_free, "Trace ring needs lock-free 64 bit atomics");
+
+struct TraceRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_slots;
+    uint32_t samps_per_trace;
+    uint64_t slot_bytes;
+    atomic<uint64_t> num_published; // Number of traces completely written so far
+    uint8_t reserved[32];
+};
+
+struct TraceSlotHeader {
+    atomic<uint64_t> seq;  // 2 * trace_index + 1 while being written, 2 * trace_index + 2 once complete
+    int64_t trace_index;   // Sequence number of the trace (0 for the first trace of the run)
+    int64_t num_pulses;    // Number of error-free pulses recorded up to and including this trace
+    int64_t error_count;   // Number of error pulses so far
+    int32_t num_presums;   // Pulses averaged into this trace
+    int32_t reserved0;
+    double publish_time;   // [s] Host (UNIX) time the trace was published
+    uint8_t reserved1[16];
+};
+
+static_assert(sizeof(TraceRingHeader) == 64, "TraceRingHeader layout changed");
+static_assert(sizeof(TraceSlotHeader) == 64, "TraceSlotHeader layout changed");
+
+// Metadata of one trace, as seen by a reader
+struct TraceInfo {
+    int64_t trace_index;
+    int64_t num_pulses;
+    int64_t error_count;
+    int32_t num_presums;
+    double publish_time;
+};
+
+// Writer side, owned by the radar. Creates the shared memory object and removes it again when destroyed.
+class TracePublisher {
+  public:
+    TracePublisher(const string& name, size_t samps_per_trace, uint32_t num_slots);
+    ~TracePublisher();
+
+    void publish(const complex<float>* trace, int64_t num_pulses, int64_t error_count, int32_t num_presums);
+
+    string getName() const;
+    uint64_t getNumPublished() const;
+    size_t getRegionBytes() const;
+
+  private:
+    string name;
+    size_t region_bytes;
+    uint8_t* region;
+    TraceRingHeader* header;
+};
+
+// Read-only reader side, for consumers in other processes
+class TraceSubscriber {
+  public:
+    TraceSubscriber(const string& name);
+    ~TraceSubscriber();
+
+    int view(uint64_t trace, const function<void(const TraceInfo&, const complex<float>*)>& consume) const;
+    int read(uint64_t trace, TraceInfo& info, complex<float>* samples) const;
+
+    uint64_t getNumPublished() const;
+    uint32_t getNumSlots() const;
+    uint32_t getSampsPerTrace() const;
+
+  private:
+    size_t region_bytes;
+    const uint8_t* region;
+    const TraceRingHeader* header;
+};
+
+#endif // TRACE_RING_HPP
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <fstream>
+#include "transport_tune.hpp"
+
+/**
+ * @return Device arguments setting these transport parameters, e.g. "num_recv_frames=700,...,send_frame_size=11000"
+ */
+string TransportParams::toDeviceArgs() const {
+  return "num_recv_frames=" + to_string(num_frames) + ",num_send_frames=" + to_string(num_frames) +
+         ",recv_frame_size=" + to_string(frame_size) + ",send_frame_size=" + to_string(frame_size);
+}
+
+double TransportTrial::getErrorRate() const {
+  return pulses > 0 ? (double) errors / pulses : 1.0;
+}
+
+/**
+ * @brief Replaces or adds key=value pairs in a device argument string
+ *
+ * Keys of device_args keep their position; keys only in overrides are appended in their order.
+ * @param device_args Comma-separated key=value pairs, e.g. "addr=192.168.10.2,num_recv_frames=700"
+ * @param overrides Pairs that take precedence
+ * @return Merged device arguments
+ */
+string merge_device_args(const string& device_args, const string& overrides) {
+  auto split = [](const string& args) {
+    vector<pair<string, string>> pairs;
+    vector<string> items;
+    boost::split(items, args, boost::is_any_of(","));
+    for (string& item : items) {
+      boost::trim(item);
+      if (item.empty()) {
+        continue;
+      }
+      size_t equals = item.find('=');
+      pairs.push_back(equals == string::npos ? make_pair(item, string()) : make_pair(item.substr(0, equals), item.substr(equals + 1)));
+    }
+    return pairs;
+  };
+  vector<pair<string, string>> merged = split(device_args);
+  for (const auto& entry : split(overrides)) {
+    auto it = find_if(merged.begin(), merged.end(), [&entry](const pair<string, string>& p) { return p.first == entry.first; });
+    if (it != merged.end()) {
+      it->second = entry.second;
+    } else {
+      merged.push_back(entry);
+    }
+  }
+  string result;
+  for (const auto& entry : merged) {
+    result += (result.empty() ? "" : ",") + entry.first + (entry.second.empty() ? "" : "=" + entry.second);
+  }
+  return result;
+}
+
+/**
+ * @brief Returns every combination of frame counts and frame sizes
+ *
+ * @param num_frames Frame counts to try
+ * @param frame_sizes [bytes] Frame sizes to try
+ * @return Grid points, frame sizes varying fastest
+ */
+vector<TransportParams> transport_grid(const vector<size_t>& num_frames, const vector<size_t>& frame_sizes) {
+  vector<TransportParams> grid;
+  for (size_t frames : num_frames) {
+    for (size_t size : frame_sizes) {
+      if (frames == 0 || size == 0) {
+        throw invalid_argument("Transport frame counts and sizes must be > 0.");
+      }
+      grid.push_back({frames, size});
+    }
+  }
+  return grid;
+}
+
+/**
+ * @brief Picks the trial with the lowest error rate, and among those the lowest CPU load
+ *
+ * Throws invalid_argument if there are no trials.
+ * @param trials Calibration results
+ * @return Index of the best trial
+ */
+size_t select_best_trial(const vector<TransportTrial>& trials) {
+  if (trials.empty()) {
+    throw invalid_argument("No transport trials to choose from.");
+  }
+  size_t best = 0;
+  for (size_t i = 1; i < trials.size(); i++) {
+    double rate = trials[i].getErrorRate();
+    double best_rate = trials[best].getErrorRate();
+    if (rate < best_rate || (rate == best_rate && trials[i].cpu_load < trials[best].cpu_load)) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+/**
+ * @brief Reads the cached transport profile of a device
+ *
+ * @param filename Profile cache (YAML, one entry per device serial)
+ * @param serial Device serial number
+ * @param profile Set to the cached profile, if there is one
+ * @return Returns false if the file doesn't exist or has no profile for the device
+ */
+bool load_transport_profile(const string& filename, const string& serial, TransportProfile& profile) {
+  YAML::Node cache;
+  try {
+    cache = YAML::LoadFile(filename);
+  } catch (const YAML::BadFile&) {
+    return false;
+  }
+  YAML::Node entry = cache[serial];
+  if (!entry || !entry["device_args"]) {
+    return false;
+  }
+  profile.device_args = entry["device_args"].as<string>();
+  profile.rx_rate = entry["rx_rate"].as<double>(0);
+  profile.rx_duration = entry["rx_duration"].as<double>(0);
+  profile.pulse_rep_int = entry["pulse_rep_int"].as<double>(0);
+  profile.error_rate = entry["error_rate"].as<double>(0);
+  profile.cpu_load = entry["cpu_load"].as<double>(0);
+  return true;
+}
+
+/**
+ * @brief Stores the transport profile of a device, keeping the profiles of other devices
+ *
+ * @param filename Profile cache (YAML, created if it doesn't exist)
+ * @param serial Device serial number
+ * @param profile Profile to store
+ * @return Returns false if the file couldn't be written
+ */
+bool save_transport_profile(const string& filename, const string& serial, const TransportProfile& profile) {
+  YAML::Node cache;
+  try {
+    cache = YAML::LoadFile(filename);
+  } catch (const YAML::BadFile&) {
+    cache = YAML::Node(YAML::NodeType::Map);
+  }
+  YAML::Node entry;
+  entry["device_args"] = profile.device_args;
+  entry["rx_rate"] = profile.rx_rate;
+  entry["rx_duration"] = profile.rx_duration;
+  entry["pulse_rep_int"] = profile.pulse_rep_int;
+  entry["error_rate"] = profile.error_rate;
+  entry["cpu_load"] = profile.cpu_load;
+  cache[serial] = entry;
+
+  ofstream file(filename, ofstream::trunc);
+  file << cache << "\n";
+  return file.good();
+}
@@ -0,0 +1,42 @@
+#ifndef TRANSPORT_TUNE_HPP
+#define TRANSPORT_TUNE_HPP
+
+#include "yaml-cpp/yaml.h"
+#include "common.hpp"
+
+// One point of the transport parameter grid (the same values are used for RX and TX)
+struct TransportParams {
+    size_t num_frames; // num_recv_frames and num_send_frames
+    size_t frame_size; // [bytes] recv_frame_size and send_frame_size
+
+    string toDeviceArgs() const;
+};
+
+// Outcome of a calibration run with one set of transport parameters
+struct TransportTrial {
+    TransportParams params;
+    long int pulses;  // Pulses attempted
+    long int errors;  // RX errors plus TX async events
+    double cpu_load;  // Process CPU time (all threads, including UHD's) per wall-clock time
+
+    double getErrorRate() const;
+};
+
+// Best device_args found for a device, with the operating point they were measured at
+struct TransportProfile {
+    string device_args;   // Transport parameters only (merged into DEVICE:device_args)
+    double rx_rate;       // [Hz]
+    double rx_duration;   // [s]
+    double pulse_rep_int; // [s]
+    double error_rate;
+    double cpu_load;
+};
+
+string merge_device_args(const string& device_args, const string& overrides);
+vector<TransportParams> transport_grid(const vector<size_t>& num_frames, const vector<size_t>& frame_sizes);
+size_t select_best_trial(const vector<TransportTrial>& trials);
+
+bool load_transport_profile(const string& filename, const string& serial, TransportProfile& profile);
+bool save_transport_profile(const string& filename, const string& serial, const TransportProfile& profile);
+
+#endif // TRANSPORT_TUNE_HPP
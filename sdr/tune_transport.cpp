@@ -0,0 +1,206 @@
+#include <chrono>
+#include <atomic>
+#include <sys/resource.h>
+#include <uhd/convert.hpp>
+#include <uhd/utils/safe_main.hpp>
+#include "transport_tune.hpp"
+#include "chirp.hpp"
+#include "rx_pipeline.hpp"
+
+// Process CPU time (user + system, all threads) [s]
+static double process_cpu_time() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+}
+
+static vector<size_t> parse_channels(const string& channels) {
+  vector<string> items;
+  boost::split(items, channels, boost::is_any_of("\"',"));
+  vector<size_t> nums;
+  for (const string& item : items) {
+    if (!item.empty()) {
+      nums.push_back(stoul(item));
+    }
+  }
+  return nums;
+}
+
+/**
+ * @brief Runs timed TX/RX bursts with one set of transport parameters
+ *
+ * The device is opened with the parameters merged into DEVICE:device_args and runs num_pulses pulses
+ * at the configured rate, rx_duration and pulse period. Zeros are transmitted, so nothing is radiated
+ * but the TX transport carries the same load as a real run.
+ * @param config Radar configuration
+ * @param chirp Chirp parameters from the same configuration
+ * @param params Transport parameters to try
+ * @param num_pulses Number of pulses to run
+ * @param serial Set to the serial number of the (first) motherboard
+ * @return Errors and CPU load of the run
+ */
+static TransportTrial run_trial(const YAML::Node& config, Chirp& chirp, const TransportParams& params, long int num_pulses, string& serial) {
+  YAML::Node device = config["DEVICE"];
+  YAML::Node rf0 = config["RF0"];
+  double rx_rate = rf0["rx_rate"].as<double>();
+  double tx_rate = rf0["tx_rate"].as<double>();
+  bool transmit = rf0["transmit"].as<bool>(true);
+  string cpu_format = device["cpu_format"].as<string>("fc32");
+
+  usrp::multi_usrp::sptr usrp = usrp::multi_usrp::make(merge_device_args(device["device_args"].as<string>(), params.toDeviceArgs()));
+  serial = usrp->get_usrp_rx_info(0).get("mboard_serial", "");
+  if (transmit) {
+    usrp->set_tx_subdev_spec(device["subdev"].as<string>());
+  }
+  usrp->set_rx_subdev_spec(device["subdev"].as<string>());
+  usrp->set_master_clock_rate(device["clk_rate"].as<double>());
+  usrp->set_rx_rate(rx_rate);
+  usrp->set_tx_rate(tx_rate);
+
+  stream_args_t rx_args(cpu_format, device["otw_format"].as<string>());
+  rx_args.channels = parse_channels(device["rx_channels"].as<string>());
+  rx_streamer::sptr rx_stream = usrp->get_rx_stream(rx_args);
+  stream_args_t tx_args(cpu_format, device["otw_format"].as<string>());
+  tx_args.channels = parse_channels(device["tx_channels"].as<string>());
+  tx_streamer::sptr tx_stream = transmit ? usrp->get_tx_stream(tx_args) : nullptr;
+
+  size_t num_rx_samps = chirp.getRxDuration() * rx_rate;
+  size_t num_tx_samps = chirp.getTxDuration() * tx_rate;
+  size_t bytes_per_samp = convert::get_bytes_per_item(cpu_format);
+  vector<vector<char>> rx_buffs(rx_args.channels.size(), vector<char>(num_rx_samps * bytes_per_samp));
+  vector<char> zeros(num_tx_samps * bytes_per_samp, 0);
+  rx_streamer::buffs_type rx_ptrs(rx_buffs.size());
+  tx_streamer::buffs_type tx_ptrs(tx_args.channels.size(), zeros.data());
+
+  double start_time = usrp->get_time_now().get_real_secs() + 0.5;
+  auto pulse_time = [&](long int pulse) { return start_time + pulse * chirp.getPulseRepInt(); };
+
+  TransportTrial trial = {params, num_pulses, 0, 0};
+  atomic<long int> tx_errors(0);
+  atomic<long int> pulses_done(0);
+  atomic<bool> rx_done(false);
+  double wall_start = chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+  double cpu_start = process_cpu_time();
+
+  // TX bursts and async messages on their own threads, as in the radar
+  thread tx_thread, async_thread;
+  if (transmit) {
+    tx_thread = thread([&]() {
+      tx_metadata_t tx_md;
+      tx_md.start_of_burst = true;
+      tx_md.end_of_burst = true;
+      tx_md.has_time_spec = true;
+      for (long int pulse = 0; pulse < num_pulses && !rx_done; pulse++) {
+        while (pulse - pulses_done > chirp.getTxLookahead() && !rx_done) {
+          this_thread::sleep_for(chrono::microseconds(10));
+        }
+        tx_md.time_spec = time_spec_t(pulse_time(pulse) - chirp.getTxLead());
+        tx_stream->send(tx_ptrs, num_tx_samps, tx_md, 1.0);
+      }
+    });
+    async_thread = thread([&]() {
+      async_metadata_t async_md;
+      while (!rx_done) {
+        if (tx_stream->recv_async_msg(async_md, 0.1) && async_md.event_code != async_metadata_t::EVENT_CODE_BURST_ACK) {
+          tx_errors++;
+        }
+      }
+    });
+  }
+
+  // Timed RX commands, rx_lookahead pulses ahead of the pulse being received
+  auto issue_rx_command = [&](long int pulse) {
+    stream_cmd_t stream_cmd(stream_cmd_t::STREAM_MODE_NUM_SAMPS_AND_DONE);
+    stream_cmd.num_samps = num_rx_samps;
+    stream_cmd.stream_now = false;
+    stream_cmd.time_spec = time_spec_t(pulse_time(pulse));
+    rx_stream->issue_stream_cmd(stream_cmd);
+  };
+  long int rx_errors = 0;
+  for (long int pulse = 0; pulse < min<long int>(chirp.getRxLookahead(), num_pulses); pulse++) {
+    issue_rx_command(pulse);
+  }
+  rx_metadata_t rx_md;
+  for (long int pulse = 0; pulse < num_pulses; pulse++) {
+    auto recv_fragment = [&](size_t offset, size_t max_samps, rx_metadata_t& md) {
+      for (size_t ch = 0; ch < rx_buffs.size(); ch++) {
+        rx_ptrs[ch] = rx_buffs[ch].data() + offset * bytes_per_samp;
+      }
+      return rx_stream->recv(rx_ptrs, max_samps, md, 1.0 + chirp.getPulseRepInt());
+    };
+    RxAssembly assembly = assemble_pulse(recv_fragment, num_rx_samps, rx_rate, 1 / rx_rate, rx_md);
+    if (rx_md.error_code != rx_metadata_t::ERROR_CODE_NONE || assembly.contiguous_samps != num_rx_samps) {
+      rx_errors++;
+    }
+    pulses_done = pulse + 1;
+    if (pulse + chirp.getRxLookahead() < num_pulses) {
+      issue_rx_command(pulse + chirp.getRxLookahead());
+    }
+  }
+  rx_done = true;
+  if (transmit) {
+    tx_thread.join();
+    async_thread.join();
+  }
+
+  double wall_time = chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count() - wall_start;
+  trial.cpu_load = (process_cpu_time() - cpu_start) / wall_time;
+  trial.errors = rx_errors + tx_errors;
+  return trial;
+}
+
+// Calibration of the transport parameters (num_recv_frames, recv_frame_size, ...): runs short timed bursts
+// with every point of a grid and caches the best device_args per device serial in DEVICE:transport_cache,
+// where the radar picks them up on startup.
+int UHD_SAFE_MAIN(int argc, char *argv[]) {
+  if (argc < 2) {
+    cout << "Usage: " << argv[0] << " <config.yaml>" << endl;
+    cout << "Finds the transport parameters with the fewest errors (then the lowest CPU load) for the" << endl;
+    cout << "rates, rx_duration and pulse_rep_int in config.yaml, and caches them in DEVICE:transport_cache." << endl;
+    return 1;
+  }
+
+  try {
+    YAML::Node config = YAML::LoadFile(argv[1]);
+    Chirp chirp(argv[1]);
+    string cache_filename = config["DEVICE"]["transport_cache"].as<string>("");
+    if (cache_filename.empty()) {
+      throw invalid_argument("DEVICE:transport_cache must be set to store the result.");
+    }
+    YAML::Node tune = config["TRANSPORT_TUNE"];
+    vector<TransportParams> grid = transport_grid(tune["num_frames"].as<vector<size_t>>(vector<size_t>{256, 700, 1024}),
+                                                  tune["frame_sizes"].as<vector<size_t>>(vector<size_t>{4096, 8192, 11000, 16360}));
+    long int num_pulses = tune["pulses"].as<long int>(2000);
+
+    vector<TransportTrial> trials;
+    string serial;
+    for (const TransportParams& params : grid) {
+      cout << "[TUNE] " << params.toDeviceArgs() << endl;
+      try {
+        trials.push_back(run_trial(config, chirp, params, num_pulses, serial));
+      } catch (const exception& e) {
+        // Parameters the device or host can't handle at all count as failing every pulse
+        cout << "[TUNE] Failed: " << e.what() << endl;
+        trials.push_back({params, num_pulses, num_pulses, 0});
+      }
+      cout << "[TUNE] Errors: " << trials.back().errors << "/" << trials.back().pulses << " CPU load: " << trials.back().cpu_load << endl;
+      this_thread::sleep_for(chrono::seconds(1)); // Let the device close before it is opened again
+    }
+
+    const TransportTrial& best = trials[select_best_trial(trials)];
+    if (serial.empty()) {
+      throw runtime_error("Could not read the device serial number.");
+    }
+    TransportProfile profile = {best.params.toDeviceArgs(), config["RF0"]["rx_rate"].as<double>(), chirp.getRxDuration(),
+                                chirp.getPulseRepInt(), best.getErrorRate(), best.cpu_load};
+    if (!save_transport_profile(cache_filename, serial, profile)) {
+      throw runtime_error("Could not write " + cache_filename);
+    }
+    cout << "[TUNE] Best for " << serial << ": " << profile.device_args << " (error rate " << profile.error_rate;
+    cout << ", CPU load " << profile.cpu_load << "), saved to " << cache_filename << endl;
+  } catch (const exception& e) {
+    cout << "ERROR: " << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -1,6 +1,7 @@
 // Created 10/23/2021
 
 #include <string>
+#include <unistd.h>
 #include <boost/filesystem.hpp>
 #include <boost/format.hpp>
 #include "utils.hpp"
@@ -28,4 +29,53 @@ std::string generate_out_filename(
     base_fn_fp.replace_extension(boost::filesystem::path(
             str(boost::format("%02d%s") % this_num % base_fn_fp.extension().string())));
     return base_fn_fp.string();
-}
\ No newline at end of file
+}
+
+/**
+ * Read n_bytes from fd at offset. pread() may transfer fewer bytes than
+ * requested, so it is called until everything is read.
+ *
+ * Inputs: fd - file descriptor
+ *         buf - buffer of at least n_bytes
+ *         n_bytes - number of bytes to read
+ *         offset - file offset to read from
+ * Output: true if all n_bytes were read, false on an error or end of file
+ */
+bool pread_all(int fd, void* buf, size_t n_bytes, off_t offset)
+{
+    char* p = (char*) buf;
+    while (n_bytes > 0) {
+        ssize_t n = pread(fd, p, n_bytes, offset);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        n_bytes -= n;
+        offset += n;
+    }
+    return true;
+}
+
+/**
+ * Write n_bytes to fd at offset, calling pwrite() until everything is written.
+ *
+ * Inputs: fd - file descriptor
+ *         buf - buffer of n_bytes
+ *         n_bytes - number of bytes to write
+ *         offset - file offset to write to
+ * Output: true if all n_bytes were written
+ */
+bool pwrite_all(int fd, const void* buf, size_t n_bytes, off_t offset)
+{
+    const char* p = (const char*) buf;
+    while (n_bytes > 0) {
+        ssize_t n = pwrite(fd, p, n_bytes, offset);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        n_bytes -= n;
+        offset += n;
+    }
+    return true;
+}
@@ -4,10 +4,27 @@
 #define UTILS_HPP
 
 #include <string>
+#include <cstdint>
+#include <sys/types.h>
 
  // Change filename, e.g. from usrp_samples.dat to usrp_samples.00.dat,
  // if multiple filenames should be generated
 std::string generate_out_filename(
         const std::string& base_fn, size_t n_names, size_t this_name);
 
+ // pread()/pwrite() n_bytes at offset, looping over short transfers.
+ // Return false on an error or end of file
+bool pread_all(int fd, void* buf, size_t n_bytes, off_t offset);
+bool pwrite_all(int fd, const void* buf, size_t n_bytes, off_t offset);
+
+ // splitmix64 hash of key: uniform in [0, 1), the same for the same key
+ // (pseudo-random values that can be recomputed for any pulse)
+inline double splitmix64_uniform(uint64_t key) {
+    uint64_t z = key + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z = z ^ (z >> 31);
+    return (z >> 11) * 0x1.0p-53;
+}
+
 #endif //UTILS_HPP
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include "../../sdr/agc.hpp"
+
+using namespace std;
+
+AgcSettings test_settings() {
+    AgcSettings settings;
+    settings.target_peak = 0.25;
+    settings.max_clip_fraction = 0.01;
+    settings.clip_level = 0.95;
+    settings.max_step = 6;
+    settings.hysteresis = 1;
+    settings.min_gain = 0;
+    settings.max_gain = 30;
+    settings.window = 2;
+    return settings;
+}
+
+// Test the per-pulse metrics
+TEST(Agc, ComputesMetrics) {
+    vector<complex<float>> pulse = {{0.1, -0.2}, {0.96, 0}, {0, -1.0}, {0.5, 0.5}};
+    TraceMetrics metrics = compute_trace_metrics(pulse.data(), pulse.size(), 0.95, 7);
+    EXPECT_EQ(metrics.pulse_index, 7);
+    EXPECT_FLOAT_EQ(metrics.peak, 1.0);
+    EXPECT_EQ(metrics.num_clipped, 2);
+    EXPECT_NEAR(metrics.mean_power, (0.05 + 0.9216 + 1.0 + 0.5) / 4, 1e-6);
+}
+
+// Test the gain decisions: clipping, too weak, close enough
+TEST(Agc, DecidesGainStep) {
+    AgcSettings settings = test_settings();
+    TraceMetrics m = {0, 0.25, 0, 1000, 0};
+    EXPECT_EQ(agc_gain_step(settings, {m, m}), 0);
+    m.peak = 0.025; // 20 dB too weak, limited to max_step
+    EXPECT_DOUBLE_EQ(agc_gain_step(settings, {m, m}), 6);
+    m.peak = 0.5;   // 6 dB too strong
+    EXPECT_NEAR(agc_gain_step(settings, {m, m}), -6, 1e-9);
+    m.peak = 0.4;   // 4 dB too strong
+    EXPECT_NEAR(agc_gain_step(settings, {m, m}), -4.08, 0.01);
+    m.peak = 0.27;  // Within hysteresis
+    EXPECT_EQ(agc_gain_step(settings, {m, m}), 0);
+    TraceMetrics clipped = {0, 1.0, 50, 1000, 0};
+    EXPECT_DOUBLE_EQ(agc_gain_step(settings, {m, clipped}), -6);
+}
+
+// Test that the controller proposes a change, waits for it to be applied and ignores stale metrics
+TEST(Agc, ControllerHandshake) {
+    string log = "/tmp/test_agc_" + to_string(getpid()) + ".csv";
+    AgcController agc(test_settings(), 10, log);
+    TraceMetrics weak = {0, 0.025, 0, 1000, 0};
+    agc.addMetrics(weak);
+    weak.pulse_index = 5;
+    agc.addMetrics(weak);
+
+    double gain = 0;
+    for (int i = 0; i < 1000 && !agc.takeGainChange(gain); i++) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    EXPECT_DOUBLE_EQ(gain, 16);
+    agc.confirmGainChange(20, 1.5, gain);
+    EXPECT_DOUBLE_EQ(agc.getGain(), 16);
+    EXPECT_EQ(agc.getNumChanges(), 1);
+
+    // Metrics from before pulse 20 were taken at the old gain and must not cause another change
+    agc.addMetrics(weak);
+    agc.addMetrics(weak);
+    this_thread::sleep_for(chrono::milliseconds(20));
+    EXPECT_FALSE(agc.takeGainChange(gain));
+    agc.stop();
+    remove(log.c_str());
+}
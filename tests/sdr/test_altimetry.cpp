@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "../../sdr/altimetry.hpp"
+
+using namespace std;
+
+// Baseband linear chirp of n_chirp samples (bandwidth 0.5 of the sample rate)
+static vector<complex<float>> make_chirp(size_t n_chirp) {
+    vector<complex<float>> chirp(n_chirp);
+    for (size_t i = 0; i < n_chirp; i++) {
+        chirp[i] = polar(1.0f, (float) (M_PI * 0.5 * ((double) i * i / n_chirp - i)));
+    }
+    return chirp;
+}
+
+// Direct path at sample 20, surface at 300, a weaker bed at 600, in noise
+static vector<complex<float>> make_trace(const vector<complex<float>>& chirp, size_t n_samps, unsigned int seed) {
+    mt19937 gen(seed);
+    normal_distribution<float> noise(0.0, 0.02);
+    vector<complex<float>> trace(n_samps);
+    for (auto& s : trace) {
+        s = complex<float>(noise(gen), noise(gen));
+    }
+    vector<pair<size_t, complex<float>>> returns = {{20, 1.0f}, {300, polar(0.3f, 1.0f)}, {600, polar(0.05f, 2.0f)}};
+    for (auto& [delay, gain] : returns) {
+        for (size_t i = 0; i < chirp.size(); i++) {
+            trace[delay + i] += gain * chirp[i];
+        }
+    }
+    return trace;
+}
+
+// Test that both pickers find the direct path, surface and bed
+TEST(Altimetry, PicksSurfaceAndBed) {
+    vector<complex<float>> chirp = make_chirp(64);
+    vector<complex<float>> trace = make_trace(chirp, 1024, 1);
+    for (EchoPickerMethod method : {PICKER_THRESHOLD, PICKER_CFAR}) {
+        EchoPickerSettings settings = {method, 15, 4, 16, 50, 100, 50};
+        EchoPicker picker(chirp, trace.size(), settings);
+        EchoPick pick = picker.pick(trace.data());
+        EXPECT_EQ(pick.direct_index, 20u);
+        ASSERT_TRUE(pick.surface_found);
+        EXPECT_EQ(pick.surface_delay, 280u);
+        ASSERT_TRUE(pick.bed_found);
+        EXPECT_EQ(pick.bed_delay, 580u);
+        EXPECT_GT(pick.surface_snr, pick.bed_snr);
+    }
+
+    // Nothing above the threshold after the blanking
+    EchoPickerSettings settings = {PICKER_THRESHOLD, 80, 4, 16, 50, 100, 50};
+    EchoPick pick = EchoPicker(chirp, trace.size(), settings).pick(trace.data());
+    EXPECT_FALSE(pick.surface_found);
+    EXPECT_FALSE(pick.bed_found);
+    EXPECT_THROW(parse_picker_method("peak"), invalid_argument);
+}
+
+// Test that picks are written to the file and the UDP port, and traces are skipped while the picker is busy
+TEST(Altimetry, PublishesPicks) {
+    string filename = "/tmp/test_altimetry_" + to_string(getpid()) + ".bin";
+    int listen_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(bind(listen_fd, (struct sockaddr*) &addr, sizeof(addr)), 0);
+    socklen_t addr_len = sizeof(addr);
+    getsockname(listen_fd, (struct sockaddr*) &addr, &addr_len);
+    struct timeval timeout = {2, 0};
+    setsockopt(listen_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    vector<complex<float>> chirp = make_chirp(64);
+    vector<complex<float>> trace = make_trace(chirp, 1024, 2);
+    EchoPickerSettings settings = {PICKER_THRESHOLD, 15, 4, 16, 50, 100, 50};
+    const double rx_rate = 50e6;
+    {
+        Altimeter altimeter(filename, ntohs(addr.sin_port), chirp, trace.size(), settings, rx_rate, 1.68e8, 3600);
+        EXPECT_TRUE(altimeter.offer(trace.data(), 40));
+        EXPECT_FALSE(altimeter.offer(trace.data(), 80)); // Within pick_period
+
+        AltimetryRecord received;
+        ASSERT_EQ(recv(listen_fd, &received, sizeof(received), 0), (ssize_t) sizeof(received));
+        EXPECT_EQ(received.pulse, 40);
+        EXPECT_EQ(received.flags, ALTIMETRY_SURFACE_FOUND | ALTIMETRY_BED_FOUND);
+        EXPECT_NEAR(received.surface_range, 280 / rx_rate * 299792458.0 / 2, 1e-3);
+        EXPECT_NEAR(received.bed_depth, 300 / rx_rate * 1.68e8 / 2, 1e-3);
+        EXPECT_EQ(altimeter.getNumPicks(), 1u);
+    }
+    close(listen_fd);
+
+    ifstream infile(filename, ifstream::binary | ifstream::ate);
+    EXPECT_EQ(infile.tellg(), (streamoff) sizeof(AltimetryRecord));
+    remove(filename.c_str());
+}
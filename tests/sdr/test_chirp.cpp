@@ -24,6 +24,8 @@ TEST(assignVarFromYaml, loadsDefault){
     EXPECT_EQ(chirp.getNumPulses(), 10000);
     EXPECT_EQ(chirp.getNumPresums(), 1);
     EXPECT_EQ(chirp.getPhaseDither(), true);
+    EXPECT_EQ(chirp.getTxLookahead(), 6);
+    EXPECT_EQ(chirp.getRxLookahead(), 6);
 }
 
 /**
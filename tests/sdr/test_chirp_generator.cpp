@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include "../../sdr/chirp_generator.hpp"
+
+using namespace std;
+
+// Test that windows match numpy's (np.hamming, np.blackman, np.kaiser)
+TEST(ChirpGenerator, WindowsMatchNumpy) {
+    vector<double> hamming = make_window("hamming", 6);
+    vector<double> blackman = make_window("blackman", 6);
+    vector<double> kaiser10 = make_window("kaiser10", 6);
+    vector<double> kaiser14 = make_window("kaiser14", 7);
+    vector<double> expected_hamming = {0.08, 0.39785218258752425, 0.9121478174124759, 0.9121478174124759, 0.39785218258752425, 0.08};
+    vector<double> expected_blackman = {0, 0.20077014326253051, 0.84922985673746942, 0.84922985673746942, 0.20077014326253051, 0};
+    vector<double> expected_kaiser10 = {3.5514937472408539e-04, 1.5184912835305545e-01, 8.2568130216969937e-01,
+                                        8.2568130216969937e-01, 1.5184912835305545e-01, 3.5514937472408539e-04};
+    vector<double> expected_kaiser14 = {7.7268668352703676e-06, 3.2885525977867799e-02, 4.6271649780079116e-01, 1.0,
+                                        4.6271649780079116e-01, 3.2885525977867799e-02, 7.7268668352703676e-06};
+    for (size_t i = 0; i < 6; i++) {
+        EXPECT_NEAR(hamming[i], expected_hamming[i], 1e-12);
+        EXPECT_NEAR(blackman[i], expected_blackman[i], 1e-12);
+        EXPECT_NEAR(kaiser10[i], expected_kaiser10[i], 1e-12);
+    }
+    for (size_t i = 0; i < 7; i++) {
+        EXPECT_NEAR(kaiser14[i], expected_kaiser14[i], 1e-12);
+    }
+    EXPECT_EQ(make_window("rectangular", 4), vector<double>(4, 1.0));
+    EXPECT_THROW(make_window("hann", 4), invalid_argument);
+}
+
+// Test a zero padded, windowed linear chirp against samples from generate_chirp.py
+TEST(ChirpGenerator, LinearMatchesPython) {
+    ChirpParams params = {"linear", 50e6, 20e6, 0, "hamming", 1e-6, 1.25e-6};
+    aligned_sample_vector chirp = generate_chirp(params);
+    ASSERT_EQ(chirp.size(), 62);
+    EXPECT_EQ(chirp[5], complex<float>(0, 0));
+    EXPECT_EQ(chirp[56], complex<float>(0, 0));
+    EXPECT_NEAR(chirp[6].real(), 0.07999999821186066, 1e-6);
+    EXPECT_NEAR(chirp[6].imag(), 0.0, 1e-6);
+    EXPECT_NEAR(chirp[20].real(), 0.6391163468360901, 1e-6);
+    EXPECT_NEAR(chirp[20].imag(), -0.06446831673383713, 1e-6);
+    EXPECT_NEAR(chirp[37].real(), -0.5247224569320679, 1e-6);
+    EXPECT_NEAR(chirp[37].imag(), -0.667762041091919, 1e-6);
+    EXPECT_NEAR(chirp[55].real(), 0.026625564321875572, 1e-6);
+    EXPECT_NEAR(chirp[55].imag(), -0.07543924450874329, 1e-6);
+}
+
+// Test a hyperbolic chirp against samples from generate_chirp.py
+TEST(ChirpGenerator, HyperbolicMatchesPython) {
+    YAML::Node generate = YAML::Load("{chirp_type: hyperbolic, sample_rate: 50e6, chirp_bandwidth: 10e6, "
+                                     "lo_offset_sw: 12e6, window: kaiser10, chirp_length: 1e-6}");
+    ChirpParams params = load_chirp_params(generate);
+    EXPECT_DOUBLE_EQ(params.pulse_length, params.chirp_length);
+    aligned_sample_vector chirp = generate_chirp(params);
+    ASSERT_EQ(chirp.size(), 50);
+    EXPECT_NEAR(chirp[0].real(), 0.0003551493864506483, 1e-6);
+    EXPECT_NEAR(chirp[5].real(), -0.00447852211073041, 1e-6);
+    EXPECT_NEAR(chirp[5].imag(), -0.024682598188519478, 1e-6);
+    EXPECT_NEAR(chirp[20].real(), 0.30161160230636597, 1e-6);
+    EXPECT_NEAR(chirp[20].imag(), 0.795793354511261, 1e-6);
+    EXPECT_NEAR(chirp[37].real(), 0.08281321078538895, 1e-6);
+    EXPECT_NEAR(chirp[37].imag(), -0.2534744143486023, 1e-6);
+
+    // Without an offset the sweep crosses 0 Hz, which a hyperbolic chirp can't do
+    params.lo_offset_sw = 0;
+    EXPECT_THROW(generate_chirp(params), invalid_argument);
+    params.chirp_type = "quadratic";
+    EXPECT_THROW(generate_chirp(params), invalid_argument);
+}
+
+// Test the conversion to the cpu_format samples written to chirp.bin
+TEST(ChirpGenerator, ConvertsCpuFormats) {
+    aligned_sample_vector chirp = {complex<float>(1, -0.5), complex<float>(0, 0.25)};
+    vector<char> fc32 = convert_chirp(chirp, "fc32");
+    ASSERT_EQ(fc32.size(), 16);
+    EXPECT_EQ(((complex<float>*) fc32.data())[0], chirp[0]);
+
+    vector<char> sc16 = convert_chirp(chirp, "sc16");
+    ASSERT_EQ(sc16.size(), 8);
+    const int16_t* s16 = (const int16_t*) sc16.data();
+    EXPECT_EQ(s16[0], 32766);
+    EXPECT_EQ(s16[1], -16383);
+    EXPECT_EQ(s16[3], 8191);
+
+    vector<char> sc8 = convert_chirp(chirp, "sc8");
+    ASSERT_EQ(sc8.size(), 4);
+    EXPECT_EQ((int8_t) sc8[0], 126);
+    EXPECT_EQ((int8_t) sc8[1], -63);
+    EXPECT_THROW(convert_chirp(chirp, "sc12"), invalid_argument);
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <boost/filesystem.hpp>
+#include "../../sdr/control_socket.hpp"
+
+// Test parsing of valid and invalid command lines
+TEST(ControlSocket, ParseCommands) {
+    string command, parameter, error;
+    double value = 0;
+    EXPECT_TRUE(parse_control_command("set rx_gain 25.5", command, parameter, value, error));
+    EXPECT_EQ(command, "set");
+    EXPECT_EQ(parameter, "rx_gain");
+    EXPECT_DOUBLE_EQ(value, 25.5);
+    EXPECT_TRUE(parse_control_command("  status  ", command, parameter, value, error));
+    EXPECT_EQ(command, "status");
+
+    EXPECT_FALSE(parse_control_command("", command, parameter, value, error));
+    EXPECT_FALSE(parse_control_command("get rx_gain", command, parameter, value, error));
+    EXPECT_FALSE(parse_control_command("set rx_gain", command, parameter, value, error));
+    EXPECT_FALSE(parse_control_command("set rx_gain 25dB", command, parameter, value, error));
+    EXPECT_FALSE(parse_control_command("set rx_gain 25 30", command, parameter, value, error));
+    EXPECT_FALSE(parse_control_command("set rx_gain nan", command, parameter, value, error));
+    EXPECT_FALSE(parse_control_command("set pulse_rep_int inf", command, parameter, value, error));
+    EXPECT_FALSE(parse_control_command("set tx_gain -INF", command, parameter, value, error));
+    EXPECT_FALSE(parse_control_command("status now", command, parameter, value, error));
+}
+
+// Test a set and a status command over the socket
+TEST(ControlSocket, RoundTrip) {
+    string socket_path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("control-%%%%%%.sock")).string();
+    string last_parameter;
+    double last_value = 0;
+    ControlServer server(socket_path,
+        [&](const string& parameter, double value) {
+            last_parameter = parameter;
+            last_value = value;
+            return value > 0 ? string("OK 42") : string("ERROR must be positive");
+        },
+        []() { return string("pulses_received=7"); });
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    ASSERT_EQ(connect(fd, (sockaddr*) &addr, sizeof(addr)), 0);
+
+    string request = "set num_presums 8\nset num_presums -1\nstatus\n";
+    ASSERT_EQ(send(fd, request.data(), request.size(), 0), (ssize_t) request.size());
+    string replies;
+    char buf[256];
+    while (count(replies.begin(), replies.end(), '\n') < 3) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        ASSERT_GT(n, 0);
+        replies.append(buf, n);
+    }
+    close(fd);
+    EXPECT_EQ(replies, "OK 42\nERROR must be positive\nOK pulses_received=7\n");
+    EXPECT_EQ(last_parameter, "num_presums");
+    EXPECT_DOUBLE_EQ(last_value, -1);
+
+    server.stop();
+    EXPECT_FALSE(boost::filesystem::exists(socket_path));
+}
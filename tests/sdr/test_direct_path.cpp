@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <unistd.h>
+#include "../../sdr/direct_path.hpp"
+
+using namespace std;
+
+// Baseband linear chirp of n_chirp samples (bandwidth 0.5 of the sample rate), starting at sample delay
+static vector<complex<float>> make_trace(size_t n_samps, size_t n_chirp, double delay, complex<float> gain) {
+    vector<complex<float>> trace(n_samps, 0);
+    for (size_t i = 0; i < n_samps; i++) {
+        double t = i - delay;
+        if (t >= 0 && t < n_chirp) {
+            double phase = M_PI * 0.5 * (t * t / n_chirp - t);
+            trace[i] = gain * complex<float>(polar(1.0, phase));
+        }
+    }
+    return trace;
+}
+
+// Test that the peak delay is interpolated between samples and the amplitude and phase are recovered
+TEST(DirectPath, FindsSubSampleDelay) {
+    vector<complex<float>> reference = make_trace(64, 64, 0, 1);
+    complex<float> gain = polar(0.25f, 1.0f);
+    for (double delay : {40.0, 40.3, 40.5, 41.8}) {
+        vector<complex<float>> trace = make_trace(256, 64, delay, gain);
+        DirectPathPeak peak = find_direct_path(trace.data(), reference, 30, 50);
+        EXPECT_FALSE(peak.at_edge);
+        EXPECT_NEAR(peak.delay, delay, 0.15);
+        EXPECT_NEAR(peak.amplitude, 0.25, 0.03);
+        if (delay == 40.0) {
+            EXPECT_NEAR(peak.phase, 1.0, 1e-3);
+        }
+    }
+
+    // A peak outside the window is reported at the edge
+    vector<complex<float>> trace = make_trace(256, 64, 51, gain);
+    DirectPathPeak peak = find_direct_path(trace.data(), reference, 30, 50);
+    EXPECT_TRUE(peak.at_edge);
+    EXPECT_EQ(peak.delay, 50);
+}
+
+// Test that traces are stacked, zero padding in the reference is accounted for and measurements are recorded
+TEST(DirectPath, TrackerStacksTraces) {
+    string filename = "/tmp/test_direct_path_" + to_string(getpid()) + ".bin";
+    vector<complex<float>> chirp = make_trace(64, 64, 0, 1);
+    vector<complex<float>> reference(8, 0); // Zero padding on both sides
+    reference.insert(reference.end(), chirp.begin(), chirp.end());
+    reference.resize(reference.size() + 8, 0);
+    const size_t n_samps = 300;
+
+    mt19937 gen(3);
+    normal_distribution<float> noise(0.0, 0.5);
+    DirectPathTracker tracker(filename, reference, n_samps, 100, 10, 4);
+    for (int t = 0; t < 12; t++) {
+        // Pulse (with padding) starts at 100.25 in the first measurement, then 0.5 samples later in each
+        vector<complex<float>> trace = make_trace(n_samps, 64, 108.25 + 0.5 * (t / 4), polar(1.0f, 0.5f));
+        for (auto& s : trace) {
+            s += complex<float>(noise(gen), noise(gen));
+        }
+        EXPECT_EQ(tracker.addTrace(trace.data()), t % 4 == 3);
+    }
+    EXPECT_EQ(tracker.getNumMeasurements(), 3u);
+    EXPECT_NEAR(tracker.getFirstPeak().delay, 100.25, 0.15);
+    EXPECT_NEAR(tracker.getLastPeak().delay, 101.25, 0.15);
+    EXPECT_NEAR(tracker.getLastPeak().amplitude, 1.0, 0.1);
+
+    ifstream infile(filename, ifstream::binary);
+    vector<DirectPathRecord> records(3);
+    infile.read((char*) records.data(), records.size() * sizeof(DirectPathRecord));
+    EXPECT_TRUE(infile.good());
+    EXPECT_EQ(records[1].first_trace, 4);
+    EXPECT_NEAR(records[1].delay, 100.75, 0.15);
+    EXPECT_GT(records[2].host_time, 0);
+    remove(filename.c_str());
+
+    // The window must fit in the trace
+    EXPECT_THROW(DirectPathTracker(filename, reference, 60, 0, 10, 1), invalid_argument);
+    remove(filename.c_str());
+}
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <unistd.h>
+#include "../../sdr/file_merge.hpp"
+
+using namespace std;
+
+static string write_test_file(const string& filename, size_t n_bytes, unsigned int seed) {
+    mt19937 gen(seed);
+    string data(n_bytes, '\0');
+    for (char& c : data) {
+        c = (char) gen();
+    }
+    ofstream file(filename, ofstream::binary);
+    file.write(data.data(), data.size());
+    return data;
+}
+
+static string read_file(const string& filename) {
+    ifstream file(filename, ifstream::binary);
+    return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+}
+
+// Test that files of unaligned sizes are concatenated in order and every chunk is verified
+TEST(FileMerge, ConcatenatesInOrder) {
+    string prefix = "/tmp/test_file_merge_" + to_string(getpid());
+    vector<string> inputs = {prefix + ".bin.0", prefix + ".bin.1", prefix + ".bin.2", prefix + ".bin.3"};
+    vector<size_t> sizes = {3 * 4096, 10000, 0, 4096 + 17};
+    string expected;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        expected += write_test_file(inputs[i], sizes[i], i + 1);
+    }
+
+    string output = prefix + ".bin";
+    MergeStats stats = merge_files(inputs, output, 4096);
+    EXPECT_EQ(read_file(output), expected);
+    EXPECT_EQ(stats.bytes, expected.size());
+    EXPECT_EQ(stats.reflinked + stats.copy_ranged + stats.streamed, expected.size());
+    EXPECT_EQ(stats.chunks, 3u + 3u + 0u + 2u);
+    EXPECT_EQ(stats.verified, stats.chunks);
+
+    // The output is never overwritten
+    EXPECT_THROW(merge_files(inputs, output), runtime_error);
+    EXPECT_EQ(read_file(output), expected);
+
+    // A missing input leaves no partial output behind
+    string output2 = prefix + "_2.bin";
+    EXPECT_THROW(merge_files({inputs[0], prefix + ".missing"}, output2), runtime_error);
+    EXPECT_FALSE(ifstream(output2).good());
+
+    for (const string& fn : inputs) {
+        remove(fn.c_str());
+    }
+    remove(output.c_str());
+}
+
+// Test that the checksum depends on the content and position of every byte
+TEST(FileMerge, ChunkChecksum) {
+    string a = "0123456789abcdefXYZ";
+    string b = a;
+    b[17] = 'Q';
+    string c = a;
+    swap(c[0], c[8]);
+    EXPECT_EQ(chunk_checksum(a.data(), a.size()), chunk_checksum(a.data(), a.size()));
+    EXPECT_NE(chunk_checksum(a.data(), a.size()), chunk_checksum(b.data(), b.size()));
+    EXPECT_NE(chunk_checksum(a.data(), a.size()), chunk_checksum(c.data(), c.size()));
+    EXPECT_NE(chunk_checksum(a.data(), a.size()), chunk_checksum(a.data(), a.size() - 1));
+}
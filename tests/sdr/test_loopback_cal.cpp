@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <unistd.h>
+#include "yaml-cpp/yaml.h"
+#include "../../sdr/loopback_cal.hpp"
+
+using namespace std;
+
+// Baseband linear chirp of n_chirp samples from -0.25 to 0.25 of the sample rate, starting at sample delay
+static vector<complex<float>> make_chirp(size_t n_samps, size_t n_chirp, double delay, complex<float> gain) {
+    vector<complex<float>> chirp(n_samps, 0);
+    for (size_t i = 0; i < n_samps; i++) {
+        double t = i - delay;
+        if (t >= 0 && t < n_chirp) {
+            // Tukey taper over a quarter of the chirp at each end keeps it nearly band-limited
+            double edge = min(t, n_chirp - t) / (n_chirp / 4.0);
+            double taper = edge < 1 ? 0.5 * (1 - cos(M_PI * edge)) : 1;
+            chirp[i] = gain * complex<float>(polar(taper, M_PI * 0.5 * (t * t / n_chirp - t)));
+        }
+    }
+    return chirp;
+}
+
+// |<a, b>| / (|a| |b|)
+static double match(const vector<complex<float>>& a, const vector<complex<float>>& b) {
+    complex<double> dot = 0;
+    double norm_a = 0, norm_b = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        dot += complex<double>(a[i]) * conj(complex<double>(b[i]));
+        norm_a += norm(a[i]);
+        norm_b += norm(b[i]);
+    }
+    return abs(dot) / sqrt(norm_a * norm_b);
+}
+
+// Adds noisy copies of trace to the calibrator
+static void add_noisy_traces(LoopbackCalibrator& cal, const vector<complex<float>>& trace, int n_traces) {
+    mt19937 gen(7);
+    normal_distribution<float> noise(0.0, 0.02);
+    vector<complex<float>> noisy(trace.size());
+    for (int t = 0; t < n_traces; t++) {
+        for (size_t i = 0; i < trace.size(); i++) {
+            noisy[i] = trace[i] + complex<float>(noise(gen), noise(gen));
+        }
+        cal.addTrace(noisy.data());
+    }
+}
+
+// Test that a pure delay and gain are measured, and the reference equals the ideal chirp
+TEST(LoopbackCal, MeasuresDelayAndGain) {
+    vector<complex<float>> ideal(8, 0); // Zero padding on both sides
+    vector<complex<float>> chirp = make_chirp(64, 64, 0, 1);
+    ideal.insert(ideal.end(), chirp.begin(), chirp.end());
+    ideal.resize(ideal.size() + 8, 0);
+
+    const size_t n_samps = 400;
+    complex<float> gain = polar(0.5f, 0.7f);
+    LoopbackCalibrator calibrator(ideal, n_samps, 1.0, 0.0, 0.5);
+    EXPECT_THROW(calibrator.calibrate(), runtime_error);
+    add_noisy_traces(calibrator, make_chirp(n_samps, 64, 100.4 + 8, gain), 200);
+
+    LoopbackCalibration cal = calibrator.calibrate();
+    EXPECT_EQ(cal.num_traces, 200);
+    EXPECT_NEAR(cal.delay, 100.4, 0.1);
+    EXPECT_NEAR(abs(cal.gain), 0.5, 0.03);
+    EXPECT_NEAR(arg(cal.gain), 0.7, 0.05);
+    EXPECT_GT(cal.snr, 10);
+    EXPECT_LT(cal.max_ripple, 1.0);
+    ASSERT_EQ(cal.reference.size(), ideal.size());
+    EXPECT_GT(match(cal.reference, ideal), 0.99);
+
+    // The loopback chirp must be entirely inside the RX window
+    LoopbackCalibrator late(ideal, n_samps, 1.0, 0.0, 0.5);
+    late.addTrace(make_chirp(n_samps, 64, n_samps - 40, gain).data());
+    EXPECT_THROW(late.calibrate(), runtime_error);
+}
+
+// Test that the system response ends up in the reference and transfer function, and that they are saved
+TEST(LoopbackCal, MeasuresSystemResponse) {
+    const size_t n_samps = 400;
+    vector<complex<float>> ideal = make_chirp(80, 64, 8, 1);
+    // System with an echo 10 samples after the main response
+    vector<complex<float>> direct = make_chirp(n_samps, 64, 150, 1);
+    vector<complex<float>> echo = make_chirp(n_samps, 64, 160, 0.2f);
+    vector<complex<float>> trace(n_samps);
+    for (size_t i = 0; i < n_samps; i++) {
+        trace[i] = direct[i] + echo[i];
+    }
+    LoopbackCalibrator calibrator(ideal, n_samps, 1.0, 0.0, 0.5);
+    add_noisy_traces(calibrator, trace, 100);
+    LoopbackCalibration cal = calibrator.calibrate();
+    EXPECT_NEAR(cal.delay, 142, 0.5);
+    EXPECT_GT(cal.max_ripple, 1.0); // |1 + 0.2 exp(-j 2 pi f 10)| spans 0.8 to 1.2
+
+    // The reference matches the received waveform better than the ideal chirp does
+    vector<complex<float>> received(trace.begin() + 142, trace.begin() + 142 + ideal.size());
+    EXPECT_GT(match(cal.reference, received), match(ideal, received) + 0.005);
+
+    string filename = "/tmp/test_loopback_cal_" + to_string(getpid()) + ".bin";
+    string stem = filename.substr(0, filename.size() - 4);
+    ASSERT_TRUE(save_loopback_calibration(filename, cal, 1.0, 0.0, 0.5));
+    vector<complex<float>> loaded = load_reference_chirp(filename);
+    ASSERT_EQ(loaded.size(), cal.reference.size());
+    EXPECT_EQ(loaded[40], cal.reference[40]);
+    YAML::Node meta = YAML::LoadFile(stem + ".yaml");
+    EXPECT_NEAR(meta["delay_samples"].as<double>(), cal.delay, 1e-9);
+    EXPECT_EQ(meta["num_traces"].as<long int>(), 100);
+    ifstream transfer(stem + "_transfer.bin", ifstream::binary | ifstream::ate);
+    EXPECT_EQ(transfer.tellg(), (streamoff) (cal.transfer_function.size() * sizeof(complex<float>)));
+    remove(filename.c_str());
+    remove((stem + ".yaml").c_str());
+    remove((stem + "_transfer.bin").c_str());
+    EXPECT_THROW(load_reference_chirp(filename), runtime_error);
+}
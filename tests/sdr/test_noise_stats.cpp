@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include "../../sdr/noise_stats.hpp"
+
+using namespace std;
+
+// Test that the streaming statistics match the batch mean/variance/power of each range bin
+TEST(NoiseStats, MatchesBatchStatistics) {
+    const size_t n_samps = 10;
+    const uint32_t decimation = 3;
+    const uint32_t num_traces = 50;
+    string filename = "/tmp/test_noise_stats_" + to_string(getpid()) + ".bin";
+    mt19937 gen(1);
+    normal_distribution<float> noise(0.0, 0.5);
+
+    vector<vector<complex<float>>> traces(num_traces, vector<complex<float>>(n_samps));
+    for (auto& trace : traces) {
+        for (size_t i = 0; i < n_samps; i++) {
+            trace[i] = complex<float>(i + noise(gen), noise(gen));
+        }
+    }
+
+    NoiseStats stats(filename, n_samps, decimation, num_traces);
+    for (uint32_t t = 0; t < num_traces; t++) {
+        EXPECT_EQ(stats.addTrace(traces[t].data()), t == num_traces - 1);
+    }
+    remove(filename.c_str());
+
+    const vector<NoiseBinStats>& bins = stats.getLastSummary();
+    ASSERT_EQ(bins.size(), 4u);
+    for (size_t b = 0; b < bins.size(); b++) {
+        complex<double> mean = 0;
+        double power = 0;
+        for (auto& trace : traces) {
+            mean += complex<double>(trace[b * decimation]);
+            power += norm(trace[b * decimation]);
+        }
+        mean /= num_traces;
+        double variance = 0;
+        for (auto& trace : traces) {
+            variance += norm(complex<double>(trace[b * decimation]) - mean);
+        }
+        variance /= num_traces - 1;
+        EXPECT_NEAR(bins[b].mean_re, real(mean), 1e-4);
+        EXPECT_NEAR(bins[b].mean_im, imag(mean), 1e-4);
+        EXPECT_NEAR(bins[b].variance, variance, 1e-4);
+        EXPECT_NEAR(bins[b].power, power / num_traces, 1e-3);
+    }
+    EXPECT_NEAR(stats.getLastNoiseFloor(), 0.5, 0.2); // 2 * 0.5^2
+}
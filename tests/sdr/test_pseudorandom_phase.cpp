@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <complex>
 #include "../../sdr/pseudorandom_phase.hpp"
 
 // Test that the random generator returns a float
@@ -18,4 +19,40 @@ TEST(GetNPhases, VectorOfFloats) {
 TEST(GetNPhases, TestForZeroN) {
     auto result = get_next_n_phases(0, true);
     EXPECT_TRUE(result.empty());
-}
\ No newline at end of file
+}
+// Test that DFT codes are exactly orthogonal over their period and that code 0 leaves the chirp unchanged
+TEST(PhaseCodes, DftCodesAreOrthogonal) {
+    PhaseCodes codes(PHASE_CODE_DFT, 3);
+    EXPECT_EQ(codes.getPeriod(), 3u);
+    for (long int pulse = 0; pulse < 7; pulse++) {
+        EXPECT_EQ(codes.getPhase(0, pulse), 0.0f);
+    }
+    for (size_t a = 0; a < 3; a++) {
+        for (size_t b = 0; b < 3; b++) {
+            complex<double> correlation = 0;
+            for (long int pulse = 6; pulse < 9; pulse++) { // Any 3 consecutive pulses
+                correlation += polar(1.0, (double) codes.getPhase(a, pulse) - codes.getPhase(b, pulse));
+            }
+            EXPECT_NEAR(abs(correlation), (a == b) ? 3.0 : 0.0, 1e-5);
+        }
+    }
+}
+
+// Test that random codes depend only on seed, code and pulse, and differ between codes
+TEST(PhaseCodes, RandomCodesAreCounterBased) {
+    PhaseCodes codes(PHASE_CODE_RANDOM, 2, 7);
+    PhaseCodes same(PHASE_CODE_RANDOM, 2, 7);
+    EXPECT_EQ(codes.getPeriod(), 0u);
+    EXPECT_EQ(codes.getPhase(1, 1000), same.getPhase(1, 1000));
+    complex<double> correlation = 0;
+    const int n = 10000;
+    for (long int pulse = 0; pulse < n; pulse++) {
+        float phase = codes.getPhase(0, pulse);
+        EXPECT_GE(phase, 0.0f);
+        EXPECT_LT(phase, 6.2832f);
+        correlation += polar(1.0, (double) phase - codes.getPhase(1, pulse));
+    }
+    EXPECT_LT(abs(correlation) / n, 5.0 / sqrt(n)); // Cross-talk averages down like noise
+    EXPECT_THROW(parse_phase_code_family("hadamard"), invalid_argument);
+    EXPECT_EQ(parse_phase_code_family("random"), PHASE_CODE_RANDOM);
+}
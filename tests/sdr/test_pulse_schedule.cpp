@@ -0,0 +1,224 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <unistd.h>
+#include "../../sdr/pulse_schedule.hpp"
+#include "../../sdr/pseudorandom_phase.hpp"
+#include "../../sdr/presum.hpp"
+
+using namespace std;
+
+static YAML::Node make_config() {
+    return YAML::Load(R"(
+GENERATE:
+    sample_rate: 10e6
+    chirp_type: 'linear'
+    chirp_bandwidth: 2e6
+    lo_offset_sw: 0
+    window: 'rectangular'
+    chirp_length: 2e-6
+    pulse_length: 2e-6
+CHIRP:
+    tx_duration: 2e-6
+    rx_duration: 5e-6
+    pulse_rep_int: 20e-6
+    tx_lead: 0
+    tr_off_trail: 0
+    num_presums: 2
+SCHEDULE:
+    enabled: true
+    waveforms:
+        - name: short
+        - name: long
+          chirp_length: 8e-6
+          pulse_length: 10e-6
+          rx_duration: 15e-6
+          chirp_bandwidth: 4e6
+          num_presums: 1
+          rx_gain: 20
+    sequence: [short, long, long]
+    gain_settle_time: 1e-6
+)");
+}
+
+// Test that waveforms take GENERATE/CHIRP defaults with their own overrides, and that pulses cycle through the sequence
+TEST(PulseSchedule, WaveformsAndSequence) {
+    PulseSchedule schedule(make_config(), 10e6, 10e6);
+    ASSERT_EQ(schedule.getNumWaveforms(), 2u);
+    const Waveform& short_waveform = schedule.getWaveform(0);
+    const Waveform& long_waveform = schedule.getWaveform(1);
+    EXPECT_EQ(short_waveform.name, "short");
+    EXPECT_EQ(short_waveform.num_tx_samps, 20u);
+    EXPECT_EQ(short_waveform.num_rx_samps, 50u);
+    EXPECT_EQ(short_waveform.num_presums, 2);
+    EXPECT_EQ(short_waveform.tx_chirp.size(), 20u);
+    EXPECT_EQ(long_waveform.num_tx_samps, 100u);
+    EXPECT_EQ(long_waveform.num_rx_samps, 150u);
+    EXPECT_EQ(long_waveform.num_presums, 1);
+    EXPECT_DOUBLE_EQ(long_waveform.chirp.chirp_bandwidth, 4e6);
+    EXPECT_DOUBLE_EQ(long_waveform.chirp.sample_rate, 10e6);
+    EXPECT_EQ(long_waveform.tx_chirp, generate_chirp(long_waveform.chirp));
+
+    EXPECT_EQ(schedule.getSequenceLength(), 3u);
+    EXPECT_EQ(schedule.getSequenceCount(0), 1u);
+    EXPECT_EQ(schedule.getSequenceCount(1), 2u);
+    vector<size_t> expected = {0, 1, 1, 0, 1, 1, 0};
+    for (size_t pulse = 0; pulse < expected.size(); pulse++) {
+        EXPECT_EQ(schedule.getWaveformIndex(pulse), expected[pulse]);
+    }
+    EXPECT_EQ(schedule.getPulseWaveform(4).name, "long");
+    EXPECT_EQ(schedule.getMaxTxSamps(), 100u);
+    EXPECT_EQ(schedule.getMaxRxSamps(), 150u);
+
+    // Only the long waveform stages its RX gain
+    EXPECT_TRUE(isnan(short_waveform.rx_gain));
+    EXPECT_DOUBLE_EQ(long_waveform.rx_gain, 20);
+    EXPECT_TRUE(isnan(long_waveform.tx_gain));
+    EXPECT_TRUE(schedule.stagesRxGain());
+    EXPECT_FALSE(schedule.stagesTxGain());
+    EXPECT_DOUBLE_EQ(schedule.getGainSettleTime(), 1e-6);
+    EXPECT_FALSE(schedule.stepsFreq());
+}
+
+// Test that per-waveform frequencies turn on frequency stepping
+TEST(PulseSchedule, SteppedFrequency) {
+    YAML::Node config = make_config();
+    config["SCHEDULE"]["waveforms"][0]["freq"] = 440e6;
+    config["SCHEDULE"]["waveforms"][1]["freq"] = 460e6;
+    config["SCHEDULE"]["lo_settle_time"] = 50e-6;
+    PulseSchedule schedule(config, 10e6, 10e6);
+    EXPECT_TRUE(schedule.stepsFreq());
+    EXPECT_DOUBLE_EQ(schedule.getWaveform(0).freq, 440e6);
+    EXPECT_DOUBLE_EQ(schedule.getWaveform(1).freq, 460e6);
+    EXPECT_DOUBLE_EQ(schedule.getLoSettleTime(), 50e-6);
+    EXPECT_DOUBLE_EQ(schedule.getWaveform(0).chirp.chirp_bandwidth, 2e6); // freq isn't a chirp parameter
+
+    config["SCHEDULE"]["lo_settle_time"] = -1e-6;
+    EXPECT_THROW(PulseSchedule(config, 10e6, 10e6), invalid_argument);
+}
+
+// Test that invalid schedules are rejected
+TEST(PulseSchedule, RejectsInvalidSchedules) {
+    YAML::Node config = make_config();
+    config["SCHEDULE"]["sequence"].push_back("medium");
+    EXPECT_THROW(PulseSchedule(config, 10e6, 10e6), invalid_argument);
+
+    config = make_config();
+    config["SCHEDULE"]["waveforms"][1]["rx_duration"] = 25e-6; // Longer than pulse_rep_int
+    EXPECT_THROW(PulseSchedule(config, 10e6, 10e6), invalid_argument);
+
+    config = make_config();
+    config["SCHEDULE"]["waveforms"][1]["name"] = "short";
+    EXPECT_THROW(PulseSchedule(config, 10e6, 10e6), invalid_argument);
+
+    config = make_config();
+    config["SCHEDULE"]["gain_settle_time"] = -1e-6;
+    EXPECT_THROW(PulseSchedule(config, 10e6, 10e6), invalid_argument);
+
+    config = make_config();
+    config["SCHEDULE"].remove("sequence"); // Each waveform once
+    PulseSchedule schedule(config, 10e6, 10e6);
+    EXPECT_EQ(schedule.getSequenceLength(), 2u);
+    EXPECT_EQ(schedule.getWaveformIndex(3), 1u);
+}
+
+// Test that a stream writes one averaged trace per num_presums pulses
+TEST(TraceStream, PresumsAndWrites) {
+    string filename = "/tmp/test_trace_stream_" + to_string(getpid()) + ".bin";
+    const size_t n_samps = 4;
+    {
+        TraceStream stream(filename, n_samps, 2);
+        vector<complex<float>> pulse(n_samps);
+        for (int p = 0; p < 5; p++) {
+            fill(pulse.begin(), pulse.end(), complex<float>(p, -p));
+            EXPECT_EQ(stream.addPulse(pulse.data(), false, 0), p % 2 == 1);
+            if (p == 3) {
+                EXPECT_EQ(stream.getTrace()[0], complex<float>(2.5, -2.5));
+            }
+        }
+        EXPECT_EQ(stream.getTracesWritten(), 2);
+        EXPECT_EQ(stream.getPulsesPending(), 1);
+        stream.close();
+    }
+
+    ifstream file(filename, ifstream::binary);
+    vector<complex<float>> traces(2 * n_samps);
+    file.read((char*) traces.data(), traces.size() * sizeof(complex<float>));
+    ASSERT_TRUE(file.good());
+    file.get();
+    EXPECT_TRUE(file.eof()); // The unfinished trace isn't written
+    remove(filename.c_str());
+    for (size_t i = 0; i < n_samps; i++) {
+        EXPECT_EQ(traces[i], complex<float>(0.5, -0.5));
+        EXPECT_EQ(traces[n_samps + i], complex<float>(2.5, -2.5));
+    }
+}
+
+// Test that stream names go before the extension
+TEST(TraceStream, Filenames) {
+    EXPECT_EQ(stream_filename("data/rx_samps.bin", "short"), "data/rx_samps_short.bin");
+    EXPECT_EQ(stream_filename("../../data.d/rx_samps", "long"), "../../data.d/rx_samps_long");
+}
+
+// Test that two phase-coded transmitters received on one channel are decoded into separate streams
+TEST(TraceStream, DecodesPhaseCodes) {
+    const size_t n_samps = 1500; // More than one block of presum_codes()
+    const int num_presums = 4;
+    PhaseCodes codes(PHASE_CODE_DFT, 2);
+    vector<complex<float>> echo0(n_samps), echo1(n_samps);
+    for (size_t i = 0; i < n_samps; i++) {
+        echo0[i] = polar(1.0f, 0.01f * i);
+        echo1[i] = complex<float>(0.5f, (i % 7) * 0.1f);
+    }
+
+    string base = "/tmp/test_coded_stream_" + to_string(getpid());
+    TraceStream tx0(base + "_tx0.bin", n_samps, num_presums);
+    TraceStream tx1(base + "_tx1.bin", n_samps, num_presums);
+    CodedTraceStreams streams({&tx0, &tx1});
+    vector<complex<float>> pulse(n_samps);
+    vector<complex<float>> decoders(2);
+    const float dither = 12345.678f;
+    for (long int p = 0; p < num_presums; p++) {
+        // Both transmitters add the same dither and their own code
+        complex<float> code0 = polar(1.0f, dither) * polar(1.0f, codes.getPhase(0, p));
+        complex<float> code1 = polar(1.0f, dither) * polar(1.0f, codes.getPhase(1, p));
+        for (size_t i = 0; i < n_samps; i++) {
+            pulse[i] = echo0[i] * code0 + echo1[i] * code1;
+        }
+        for (size_t t = 0; t < 2; t++) {
+            decoders[t] = polar(1.0f, -dither) * polar(1.0f, -codes.getPhase(t, p));
+        }
+        EXPECT_EQ(streams.addPulse(pulse.data(), decoders), p == num_presums - 1);
+    }
+    for (size_t i = 0; i < n_samps; i++) {
+        EXPECT_NEAR(abs(tx0.getTrace()[i] - echo0[i]), 0, 1e-5);
+        EXPECT_NEAR(abs(tx1.getTrace()[i] - echo1[i]), 0, 1e-5);
+    }
+    remove((base + "_tx0.bin").c_str());
+    remove((base + "_tx1.bin").c_str());
+}
+
+// Test that decoding several codes at once matches decoding each one on its own
+TEST(PresumCodes, MatchesPresumPulse) {
+    const size_t n_samps = 2500;
+    vector<complex<float>> pulse(n_samps);
+    for (size_t i = 0; i < n_samps; i++) {
+        pulse[i] = complex<float>(sin(0.1f * i), cos(0.3f * i));
+    }
+    const size_t num_codes = 3;
+    vector<vector<complex<float>>> sums(num_codes, vector<complex<float>>(n_samps, complex<float>(1, 1)));
+    vector<complex<float>*> sum_ptrs;
+    vector<complex<float>> weights;
+    for (size_t k = 0; k < num_codes; k++) {
+        sum_ptrs.push_back(sums[k].data());
+        weights.push_back(polar(0.25f, 0.7f * k));
+    }
+    presum_codes(pulse.data(), sum_ptrs.data(), weights.data(), num_codes, n_samps);
+    for (size_t k = 0; k < num_codes; k++) {
+        vector<complex<float>> expected(n_samps, complex<float>(1, 1));
+        vector<complex<float>> copy = pulse;
+        presum_pulse(copy.data(), expected.data(), n_samps, 4, true, 0.7f * k);
+        for (size_t i = 0; i < n_samps; i++) {
+            EXPECT_NEAR(abs(sums[k][i] - expected[i]), 0, 1e-6);
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <unistd.h>
+#include "../../sdr/quicklook.hpp"
+
+using namespace std;
+
+// Test that traces are stacked, binned and converted to dB, and that rows roll over
+TEST(Quicklook, StacksAndRolls) {
+    const size_t n_samps = 12;
+    const uint32_t width = 4;
+    const uint32_t num_rows = 3;
+    string filename = "/tmp/test_quicklook_" + to_string(getpid()) + ".bin";
+    {
+        Quicklook quicklook(filename, n_samps, width, num_rows, 2, 0.5);
+        vector<complex<float>> trace(n_samps);
+        for (int t = 0; t < 10; t++) {
+            // Row r holds traces 2r and 2r+1, with power 10^r in every sample
+            fill(trace.begin(), trace.end(), complex<float>(sqrt(pow(10.0f, t / 2)), 0));
+            quicklook.addTrace(trace.data());
+        }
+        EXPECT_EQ(quicklook.getRowsWritten(), 5u);
+    }
+
+    ifstream file(filename, ifstream::binary);
+    QuicklookHeader header;
+    file.read((char*) &header, sizeof(header));
+    EXPECT_EQ(header.magic, QUICKLOOK_MAGIC);
+    EXPECT_EQ(header.rows_written, 5u);
+    vector<float> rows(num_rows * width);
+    file.read((char*) rows.data(), rows.size() * sizeof(float));
+    ASSERT_TRUE(file.good());
+    remove(filename.c_str());
+
+    // Rows 3 and 4 overwrote slots 0 and 1, slot 2 still holds row 2
+    vector<float> expected_db = {30, 40, 20};
+    for (uint32_t slot = 0; slot < num_rows; slot++) {
+        for (uint32_t b = 0; b < width; b++) {
+            EXPECT_NEAR(rows[slot * width + b], expected_db[slot], 1e-3);
+        }
+    }
+}
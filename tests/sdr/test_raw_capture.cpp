@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <cstring>
+#include <boost/filesystem.hpp>
+#include "../../sdr/raw_capture.hpp"
+#include "../../sdr/presum.hpp"
+#include "../../sdr/pseudorandom_phase.hpp"
+
+using namespace std;
+
+/**
+ * @brief Writes a synthetic raw capture and the output a normal run would produce from the same pulses
+ *
+ * Every 5th pulse is marked as an error pulse so the dither sequence has to skip over it.
+ */
+static vector<complex<float>> make_raw_capture(const string& raw_fn, const string& meta_fn, size_t n_pulses,
+                                               size_t n_samps, int num_presums, bool phase_dither) {
+    mt19937 sample_gen(1234);
+    normal_distribution<float> noise(0.0, 1.0);
+    ofstream rawfile(raw_fn, ofstream::binary);
+    ofstream metafile(meta_fn, ofstream::binary);
+
+    vector<complex<float>> expected;
+    vector<complex<float>> buff(n_samps);
+    vector<complex<float>> sample_sum(n_samps, 0);
+    long int good_pulses = 0;
+    reset_phase_generator(false);
+    for (size_t p = 0; p < n_pulses; p++) {
+        float inversion_phase = 0;
+        if (phase_dither) {
+            inversion_phase = -1.0 * get_next_phase(false);
+        }
+        RawPulseRecord record = {(int64_t) p, RAW_ERROR_NONE, (uint32_t) n_samps, 0.0};
+        if (p % 5 == 3) {
+            record.error_code = RAW_ERROR_SHORT_RECV;
+            metafile.write((const char*) &record, sizeof(record));
+            continue;
+        }
+        for (auto& s : buff) {
+            s = complex<float>(noise(sample_gen), noise(sample_gen));
+        }
+        metafile.write((const char*) &record, sizeof(record));
+        rawfile.write((const char*) buff.data(), n_samps * sizeof(complex<float>));
+
+        // Same steps as handleRxBuffer() + checkForFullSampleSum()
+        presum_pulse(buff.data(), sample_sum.data(), n_samps, num_presums, phase_dither, inversion_phase);
+        good_pulses++;
+        if (good_pulses % num_presums == 0) {
+            expected.insert(expected.end(), sample_sum.begin(), sample_sum.end());
+            fill(sample_sum.begin(), sample_sum.end(), complex<float>(0,0));
+        }
+    }
+    return expected;
+}
+
+static vector<complex<float>> read_samples(const string& fn) {
+    ifstream f(fn, ifstream::binary | ifstream::ate);
+    vector<complex<float>> samples(f.tellg() / sizeof(complex<float>));
+    f.seekg(0);
+    f.read((char*) samples.data(), samples.size() * sizeof(complex<float>));
+    return samples;
+}
+
+// Test that offline processing is byte-identical to inline processing, with and without dithering
+TEST(PresumRawCapture, MatchesInlineProcessing) {
+    boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(dir);
+    string raw_fn = (dir / "raw.bin").string();
+    string meta_fn = (dir / "meta.bin").string();
+    string out_fn = (dir / "out.bin").string();
+
+    for (bool phase_dither : {true, false}) {
+        for (int num_presums : {1, 4}) {
+            vector<complex<float>> expected = make_raw_capture(raw_fn, meta_fn, 103, 64, num_presums, phase_dither);
+            long int num_traces = presum_raw_capture(raw_fn, meta_fn, out_fn, num_presums, phase_dither, 3);
+            vector<complex<float>> result = read_samples(out_fn);
+
+            EXPECT_EQ(num_traces * 64, expected.size());
+            ASSERT_EQ(result.size(), expected.size());
+            EXPECT_EQ(memcmp(result.data(), expected.data(), result.size() * sizeof(complex<float>)), 0);
+        }
+    }
+
+    boost::filesystem::remove_all(dir);
+}
+
+// Test that a metadata file with missing pulses is rejected, since the dither sequence can't be rebuilt
+TEST(PresumRawCapture, RejectsGapInMetadata) {
+    boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(dir);
+    string meta_fn = (dir / "meta.bin").string();
+
+    ofstream metafile(meta_fn, ofstream::binary);
+    RawPulseRecord records[2] = {{0, RAW_ERROR_NONE, 16, 0.0}, {2, RAW_ERROR_NONE, 16, 0.0}};
+    metafile.write((const char*) records, sizeof(records));
+    metafile.close();
+
+    EXPECT_THROW(presum_raw_capture((dir / "raw.bin").string(), meta_fn, (dir / "out.bin").string(), 1, true, 1), runtime_error);
+
+    boost::filesystem::remove_all(dir);
+}
@@ -0,0 +1,222 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include "../../sdr/rx_pipeline.hpp"
+#include "../../sdr/presum.hpp"
+
+using namespace std;
+
+// Test that the worker pool writes the same bytes, in the same order, as sequential processing
+TEST(RxWorkerPool, MatchesSequentialProcessing) {
+    const size_t n_samps = 128;
+    const int num_presums = 5;
+    const int num_traces = 40;
+    mt19937 gen(42);
+    normal_distribution<float> noise(0.0, 1.0);
+    uniform_real_distribution<float> phase(-1e9, 1e9);
+
+    vector<complex<float>> pulses(num_traces * num_presums * n_samps);
+    vector<float> phases(num_traces * num_presums);
+    for (auto& s : pulses) {
+        s = complex<float>(noise(gen), noise(gen));
+    }
+    for (auto& p : phases) {
+        p = phase(gen);
+    }
+
+    // Sequential reference (same steps as handleRxBuffer() + checkForFullSampleSum())
+    vector<complex<float>> expected;
+    vector<complex<float>> buff(n_samps);
+    vector<complex<float>> sample_sum(n_samps, 0);
+    for (int p = 0; p < num_traces * num_presums; p++) {
+        copy(&pulses[p * n_samps], &pulses[(p + 1) * n_samps], buff.begin());
+        presum_pulse(buff.data(), sample_sum.data(), n_samps, num_presums, true, phases[p]);
+        if ((p + 1) % num_presums == 0) {
+            expected.insert(expected.end(), sample_sum.begin(), sample_sum.end());
+            fill(sample_sum.begin(), sample_sum.end(), complex<float>(0,0));
+        }
+    }
+
+    vector<complex<float>> result;
+    SampleBufferPool buffers(n_samps, 4 * (num_presums + 1), false, -1);
+    RxWorkerPool pool(buffers, num_presums, true, 3, 4, [&](const complex<float>* trace, int trace_presums) {
+        EXPECT_EQ(trace_presums, num_presums);
+        result.insert(result.end(), trace, trace + n_samps);
+        return true;
+    });
+    for (int t = 0; t < num_traces; t++) {
+        PresumGroup* group = pool.acquire();
+        for (int k = 0; k < num_presums; k++) {
+            int p = t * num_presums + k;
+            copy(&pulses[p * n_samps], &pulses[(p + 1) * n_samps], group->pulse(k));
+            group->inversion_phases[k] = phases[p];
+        }
+        group->num_pulses = num_presums;
+        pool.submit(group);
+    }
+    EXPECT_TRUE(pool.finish());
+
+    ASSERT_EQ(result.size(), expected.size());
+    EXPECT_EQ(memcmp(result.data(), expected.data(), result.size() * sizeof(complex<float>)), 0);
+}
+
+// Test that a failed write is reported
+TEST(RxWorkerPool, ReportsWriteFailure) {
+    SampleBufferPool buffers(16, 4, false, -1);
+    RxWorkerPool pool(buffers, 1, false, 2, 2, [](const complex<float>*, int) { return false; });
+    PresumGroup* group = pool.acquire();
+    group->num_pulses = 1;
+    pool.submit(group);
+    EXPECT_FALSE(pool.finish());
+    EXPECT_FALSE(pool.ok());
+}
+
+// Test that pooled buffers are aligned, distinct, and that exhaustion is reported
+TEST(SampleBufferPool, AlignedAndBounded) {
+    SampleBufferPool buffers(100, 3, false, -1);
+    complex<float>* a = buffers.acquire();
+    complex<float>* b = buffers.acquire();
+    complex<float>* c = buffers.acquire();
+    for (complex<float>* p : {a, b, c}) {
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % BUFFER_ALIGNMENT, 0u);
+    }
+    EXPECT_NE(a, b);
+    EXPECT_NE(b, c);
+    EXPECT_EQ(buffers.getNumFree(), 0u);
+    EXPECT_THROW(buffers.acquire(), runtime_error);
+    buffers.release(b);
+    EXPECT_EQ(buffers.acquire(), b);
+}
+
+// Fake RX stream delivering a burst in fragments of at most frame_samps samples, with an optional timestamp gap
+struct FakeBurst {
+    vector<complex<float>> samples;
+    size_t frame_samps;
+    double start_time;
+    double rate;
+    size_t gap_at;     // Fragment starting at this sample is stamped late (0 = no gap)
+    size_t next = 0;
+    int calls = 0;
+
+    size_t recv(complex<float>* buff, size_t max_samps, rx_metadata_t& md) {
+        calls++;
+        md.error_code = rx_metadata_t::ERROR_CODE_NONE;
+        size_t n = min({max_samps, frame_samps, samples.size() - next});
+        md.has_time_spec = true;
+        md.time_spec = time_spec_t(start_time + next / rate + ((gap_at != 0 && next == gap_at) ? 1e-3 : 0));
+        copy(samples.begin() + next, samples.begin() + next + n, buff);
+        next += n;
+        md.end_of_burst = (next == samples.size());
+        return n;
+    }
+};
+
+static RxAssembly assemble(FakeBurst& burst, vector<complex<float>>& buff, size_t num_samps, rx_metadata_t& md) {
+    auto recv_fragment = [&](size_t offset, size_t max_samps, rx_metadata_t& fragment_md) {
+        return burst.recv(buff.data() + offset, max_samps, fragment_md);
+    };
+    return assemble_pulse(recv_fragment, num_samps, burst.rate, 1 / burst.rate, md);
+}
+
+// Test that a pulse is assembled from frames smaller than the RX window
+TEST(AssemblePulse, AssemblesFragments) {
+    const size_t n_samps = 1000;
+    FakeBurst burst = {vector<complex<float>>(n_samps), 364, 2.5, 10e6, 0};
+    for (size_t i = 0; i < n_samps; i++) {
+        burst.samples[i] = complex<float>(i, -(float) i);
+    }
+    vector<complex<float>> buff(n_samps);
+    rx_metadata_t md;
+    RxAssembly assembly = assemble(burst, buff, n_samps, md);
+    EXPECT_EQ(assembly.num_samps, n_samps);
+    EXPECT_EQ(assembly.contiguous_samps, n_samps);
+    EXPECT_EQ(assembly.num_fragments, 3);
+    EXPECT_EQ(buff, burst.samples);
+    EXPECT_DOUBLE_EQ(md.time_spec.get_real_secs(), 2.5); // Time of the first sample
+    EXPECT_TRUE(md.end_of_burst);
+}
+
+// Test that a timestamp gap and an early end of burst both leave the pulse short
+TEST(AssemblePulse, DetectsGapsAndShortBursts) {
+    const size_t n_samps = 1000;
+    vector<complex<float>> buff(n_samps);
+    rx_metadata_t md;
+
+    FakeBurst gap = {vector<complex<float>>(n_samps), 250, 2.5, 10e6, 500};
+    RxAssembly assembly = assemble(gap, buff, n_samps, md);
+    EXPECT_EQ(assembly.num_samps, n_samps); // Read to the end of the burst, so the next pulse stays aligned
+    EXPECT_EQ(assembly.contiguous_samps, 500u);
+    EXPECT_EQ(assembly.num_fragments, 4);
+
+    FakeBurst short_burst = {vector<complex<float>>(600), 250, 2.5, 10e6, 0};
+    assembly = assemble(short_burst, buff, n_samps, md);
+    EXPECT_EQ(assembly.contiguous_samps, 600u);
+    EXPECT_EQ(short_burst.calls, 3); // Stops at the end of the burst instead of waiting for more
+}
+
+// Fills every channel of a pulse with pulse * 10 + channel and stamps the pulse's time
+static size_t fake_recv_pulse(long int pulse, const vector<void *>& buffs, rx_metadata_t& md, const atomic<bool>&, size_t n_samps) {
+    for (size_t ch = 0; ch < buffs.size(); ch++) {
+        complex<float>* buff = (complex<float>*) buffs[ch];
+        fill(buff, buff + n_samps, complex<float>(pulse * 10 + ch, 0));
+    }
+    md.error_code = rx_metadata_t::ERROR_CODE_NONE;
+    md.has_time_spec = true;
+    md.time_spec = time_spec_t(pulse * 0.1);
+    return n_samps;
+}
+
+// Test that two receivers (as for two motherboards) hand out every pulse in order and never run more
+// than num_slots pulses ahead of the consumer
+TEST(StreamReceiver, ReceivesInLockstep) {
+    const size_t n_samps = 64;
+    const int num_slots = 3;
+    atomic<long int> max_ahead(0);
+    atomic<long int> consumed(0);
+    vector<unique_ptr<StreamReceiver>> receivers;
+    for (size_t num_channels : {2, 1}) {
+        auto recv_pulse = [&](long int pulse, const vector<void *>& buffs, rx_metadata_t& md, const atomic<bool>& stopping) {
+            long int ahead = pulse - consumed;
+            long int seen = max_ahead;
+            while (ahead > seen && !max_ahead.compare_exchange_weak(seen, ahead)) {}
+            return fake_recv_pulse(pulse, buffs, md, stopping, n_samps);
+        };
+        receivers.emplace_back(new StreamReceiver(num_channels, n_samps, num_slots, recv_pulse));
+    }
+
+    for (long int pulse = 0; pulse < 50; pulse++) {
+        for (size_t r = 0; r < receivers.size(); r++) {
+            ReceivedPulse* received = receivers[r]->next();
+            ASSERT_NE(received, nullptr);
+            EXPECT_EQ(received->index, pulse);
+            EXPECT_EQ(received->num_samps, n_samps);
+            EXPECT_DOUBLE_EQ(received->md.time_spec.get_real_secs(), pulse * 0.1);
+            for (size_t ch = 0; ch < received->channels.size(); ch++) {
+                EXPECT_EQ(received->channels[ch][n_samps - 1], complex<float>(pulse * 10 + ch, 0));
+            }
+        }
+        consumed = pulse + 1;
+        for (auto& receiver : receivers) {
+            receiver->release();
+        }
+    }
+    EXPECT_LE(max_ahead, num_slots);
+}
+
+// Test that stop() ends a receive thread that is waiting for a pulse, and that next() then returns nullptr
+TEST(StreamReceiver, StopsWhileWaiting) {
+    auto recv_pulse = [](long int pulse, const vector<void *>& buffs, rx_metadata_t& md, const atomic<bool>& stopping) -> size_t {
+        if (pulse > 0) {
+            // The pulse is never commanded
+            while (!stopping) {
+                this_thread::sleep_for(chrono::milliseconds(1));
+            }
+            return 0;
+        }
+        return fake_recv_pulse(pulse, buffs, md, stopping, 16);
+    };
+    StreamReceiver receiver(1, 16, 4, recv_pulse);
+    ASSERT_NE(receiver.next(), nullptr);
+    receiver.release();
+    receiver.stop();
+    EXPECT_EQ(receiver.next(), nullptr);
+}
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include "../../sdr/scheduler.hpp"
+
+// Test that pulses are spaced by the pulse period when there are no errors
+TEST(PulseTimeline, UniformWithoutErrors) {
+    PulseTimeline timeline(1.0, 200e-6);
+    EXPECT_DOUBLE_EQ(timeline.getRxTime(0, 0), 1.0);
+    EXPECT_DOUBLE_EQ(timeline.getRxTime(10, 0), 1.0 + 10 * 200e-6);
+    EXPECT_EQ(timeline.getLastPulseAssigned(), 10);
+}
+
+// Test that new errors delay only pulses that haven't been handed out yet
+TEST(PulseTimeline, ErrorDelayOnlyAffectsFuturePulses) {
+    PulseTimeline timeline(1.0, 200e-6);
+    double t5 = timeline.getRxTime(5, 0);
+
+    // Another thread asks for an earlier pulse after an error: its time must not change
+    EXPECT_DOUBLE_EQ(timeline.getRxTime(3, 1), 1.0 + 3 * 200e-6);
+    EXPECT_DOUBLE_EQ(timeline.getRxTime(5, 1), t5);
+
+    // Later pulses are delayed by 2 pulse periods per error
+    EXPECT_DOUBLE_EQ(timeline.getRxTime(6, 1), 1.0 + 2 * 200e-6 + 6 * 200e-6);
+    EXPECT_DOUBLE_EQ(timeline.getRxTime(7, 3), 1.0 + 6 * 200e-6 + 7 * 200e-6);
+    EXPECT_DOUBLE_EQ(timeline.getRxTime(6, 3), 1.0 + 2 * 200e-6 + 6 * 200e-6);
+}
+
+// Test that a pulse period change moves the pulses after it, but not the ones before
+TEST(PulseTimeline, PulseRepIntChange) {
+    PulseTimeline timeline(1.0, 200e-6);
+    timeline.getRxTime(3, 0);
+
+    // With groups of 4 pulses, the first boundary after pulse 3 is pulse 4
+    EXPECT_EQ(timeline.scheduleChange("pulse_rep_int", 500e-6, 4, 0), 4);
+    EXPECT_DOUBLE_EQ(timeline.getRxTime(3, 0), 1.0 + 3 * 200e-6);
+    EXPECT_DOUBLE_EQ(timeline.getRxTime(4, 0), 1.0 + 4 * 200e-6);
+    EXPECT_DOUBLE_EQ(timeline.getRxTime(6, 0), 1.0 + 4 * 200e-6 + 2 * 500e-6);
+    EXPECT_DOUBLE_EQ(timeline.getPulseRepInt(3), 200e-6);
+    EXPECT_DOUBLE_EQ(timeline.getPulseRepInt(4), 500e-6);
+
+    // Error delays after the change use the new pulse period
+    EXPECT_DOUBLE_EQ(timeline.getRxTime(7, 1), 1.0 + 4 * 200e-6 + 3 * 500e-6 + 2 * 500e-6);
+}
+
+// Test that changes land on group boundaries (counted without errored pulses) and are taken once, in order
+TEST(PulseTimeline, ScheduledChanges) {
+    PulseTimeline timeline(1.0, 200e-6);
+    timeline.getRxTime(5, 1);
+
+    // With one errored pulse, groups of 4 start at pulses 1, 5, 9, ... and pulse 5 is already handed out
+    EXPECT_EQ(timeline.scheduleChange("rx_gain", 30, 4, 1), 9);
+    EXPECT_EQ(timeline.scheduleChange("tx_gain", 10, 4, 1), 9);
+    EXPECT_EQ(timeline.scheduleChange("rx_gain", 20, 4, 1), 9);
+
+    ScheduledChange change;
+    EXPECT_FALSE(timeline.takeChange("rx_gain", 8, change));
+    EXPECT_TRUE(timeline.takeChange("rx_gain", 9, change));
+    EXPECT_EQ(change.first_pulse, 9);
+    EXPECT_DOUBLE_EQ(change.value, 30);
+    EXPECT_TRUE(timeline.takeChange("rx_gain", 10, change));
+    EXPECT_DOUBLE_EQ(change.value, 20);
+    EXPECT_FALSE(timeline.takeChange("rx_gain", 10, change));
+    EXPECT_TRUE(timeline.takeChange("tx_gain", 100, change));
+    EXPECT_EQ(change.parameter, "tx_gain");
+    EXPECT_FALSE(timeline.takeChange("tx_gain", 100, change));
+}
+
+// Test that a stagger pattern repeats, is scaled to a mean of one period and carries across a pulse period change
+TEST(PulseTimeline, StaggeredPri) {
+    PriSequence stagger({2, 3, 5}); // Scaled to 0.6, 0.9, 1.5
+    EXPECT_DOUBLE_EQ(stagger.getPosition(0), 0);
+    EXPECT_DOUBLE_EQ(stagger.getPosition(2), 1.5);
+    EXPECT_DOUBLE_EQ(stagger.getPosition(4), 3.6);
+    EXPECT_DOUBLE_EQ(stagger.getMinSpacing(100e-6), 60e-6);
+    EXPECT_FALSE(stagger.isUniform());
+    EXPECT_TRUE(PriSequence().isUniform());
+
+    PulseTimeline timeline(1.0, 100e-6, stagger);
+    EXPECT_DOUBLE_EQ(timeline.getRxTime(4, 0), 1.0 + 3.6 * 100e-6);
+    EXPECT_EQ(timeline.scheduleChange("pulse_rep_int", 200e-6, 1, 0), 5);
+    EXPECT_DOUBLE_EQ(timeline.getRxTime(5, 0), 1.0 + 4.5 * 100e-6);
+    EXPECT_DOUBLE_EQ(timeline.getRxTime(6, 0), 1.0 + 4.5 * 100e-6 + 1.5 * 200e-6);
+    EXPECT_DOUBLE_EQ(timeline.getScheduledTime(6), timeline.getRxTime(6, 0));
+
+    EXPECT_THROW(PriSequence({1, 0}), invalid_argument);
+    EXPECT_THROW(PriSequence({}, -1e-6), invalid_argument);
+}
+
+// Test that jitter only depends on the pulse index and matches postprocessing/pulse_times.py
+TEST(PulseTimeline, JitteredPri) {
+    PriSequence jitter({}, 1e-5, 0);
+    EXPECT_NEAR(jitter.getJitter(0), 7.666216164272853e-06, 1e-18);
+    EXPECT_NEAR(jitter.getJitter(1), 1.331231503445618e-06, 1e-18);
+    EXPECT_NEAR(PriSequence({}, 1e-5, 7).getJitter(1000), 7.985757946125676e-06, 1e-18);
+    EXPECT_DOUBLE_EQ(jitter.getMinSpacing(100e-6), 80e-6);
+    for (long int pulse = 0; pulse < 1000; pulse++) {
+        EXPECT_LE(fabs(jitter.getJitter(pulse)), 1e-5);
+    }
+
+    PulseTimeline timeline(1.0, 100e-6, jitter);
+    EXPECT_DOUBLE_EQ(timeline.getRxTime(1, 0), 1.0 + 100e-6 + 1.331231503445618e-06);
+    // Error delays move later pulses but keep their jitter
+    EXPECT_DOUBLE_EQ(timeline.getRxTime(3, 1), 1.0 + 5 * 100e-6 + jitter.getJitter(3));
+}
+
+// Test that device times map to the last pulse handed out that starts at or before them
+TEST(PulseTimeline, PulseAtTime) {
+    PulseTimeline timeline(1.0, 200e-6);
+    EXPECT_EQ(timeline.getPulseAt(1.0), -1); // Nothing handed out yet
+    timeline.getRxTime(10, 0);
+    EXPECT_EQ(timeline.getPulseAt(0.5), -1);
+    EXPECT_EQ(timeline.getPulseAt(1.0), 0);
+    EXPECT_EQ(timeline.getPulseAt(1.0 + 3.5 * 200e-6), 3);
+    EXPECT_EQ(timeline.getPulseAt(5.0), 10);
+    timeline.getRxTime(11, 1); // Pulse 11 is delayed by 2 pulse periods
+    EXPECT_EQ(timeline.getPulseAt(1.0 + 11.5 * 200e-6), 10);
+    EXPECT_EQ(timeline.getPulseAt(1.0 + 13 * 200e-6), 11);
+}
+
+// Test that TX events drop their pulse only if the RX loop hasn't checked it yet
+TEST(TxEventLog, AttributesEventsToPulses) {
+    TxEventLog log;
+    EXPECT_EQ(log.claimPulse(0), 0);
+    EXPECT_TRUE(log.record(2, async_metadata_t::EVENT_CODE_UNDERFLOW));
+    EXPECT_TRUE(log.record(2, async_metadata_t::EVENT_CODE_TIME_ERROR));
+    EXPECT_FALSE(log.record(0, async_metadata_t::EVENT_CODE_UNDERFLOW)); // Already claimed
+    EXPECT_FALSE(log.record(-1, async_metadata_t::EVENT_CODE_SEQ_ERROR)); // Unknown pulse
+    EXPECT_EQ(log.claimPulse(1), 0);
+    EXPECT_EQ(log.claimPulse(2), async_metadata_t::EVENT_CODE_UNDERFLOW | async_metadata_t::EVENT_CODE_TIME_ERROR);
+    EXPECT_EQ(log.getPulseEvents(2), async_metadata_t::EVENT_CODE_UNDERFLOW | async_metadata_t::EVENT_CODE_TIME_ERROR);
+    EXPECT_TRUE(log.record(4, async_metadata_t::EVENT_CODE_UNDERFLOW));
+    EXPECT_EQ(log.claimPulse(3), 0);
+    EXPECT_EQ(log.getPulseEvents(2), 0); // Forgotten once the next pulse is claimed
+    EXPECT_EQ(log.getPulseEvents(4), async_metadata_t::EVENT_CODE_UNDERFLOW);
+    EXPECT_EQ(log.getNumEvents(), 5);
+    EXPECT_EQ(log.getNumLateEvents(), 2);
+    EXPECT_EQ(log.getNumEvents(async_metadata_t::EVENT_CODE_UNDERFLOW), 3);
+
+    EXPECT_EQ(async_event_name(async_metadata_t::EVENT_CODE_UNDERFLOW), "EVENT_CODE_UNDERFLOW");
+    EXPECT_EQ(async_event_name(async_metadata_t::EVENT_CODE_UNDERFLOW | async_metadata_t::EVENT_CODE_TIME_ERROR),
+              "EVENT_CODE_UNDERFLOW|EVENT_CODE_TIME_ERROR");
+    EXPECT_EQ(async_event_name(0), "EVENT_CODE_UNKNOWN");
+}
+
+// Test that slack statistics are accumulated correctly
+TEST(LatenessStats, RecordsSlack) {
+    LatenessStats stats("[TEST]");
+    stats.record(2e-3);
+    stats.record(-1e-3);
+    stats.record(5e-3);
+    EXPECT_EQ(stats.getCount(), 3);
+    EXPECT_EQ(stats.getNumLate(), 1);
+    EXPECT_DOUBLE_EQ(stats.getMinSlack(), -1e-3);
+    EXPECT_DOUBLE_EQ(stats.getMeanSlack(), 2e-3);
+}
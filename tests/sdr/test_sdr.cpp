@@ -47,6 +47,8 @@ TEST(loadConfigFromYaml, LoadsDefault){
     EXPECT_EQ(sdr.getFreq(), 450e6);
     EXPECT_EQ(sdr.getRxGain(), 10);
     EXPECT_EQ(sdr.getTxGain(), 10);
+    EXPECT_EQ(sdr.getAppliedRxGain(), 36);
+    EXPECT_EQ(sdr.getAppliedTxGain(), 65);
     EXPECT_EQ(sdr.getBw(), 56e6);
     EXPECT_EQ(sdr.getTxAnt(), "TX/RX");
     EXPECT_EQ(sdr.getRxAnt(), "RX2");
@@ -70,6 +72,22 @@ TEST(GetterMethods, UntestedInLoadsDefault){
 }
 
 
+/**
+ * @brief tests that the RF sections are read in order, up to the first missing one
+ */
+TEST(loadRfSections, ReadsConsecutiveSections){
+    const string kYamlFile = string(CONFIG_DIR) + "/default.yaml";
+    Sdr sdr(kYamlFile);
+    ASSERT_EQ(sdr.getRfSections().size(), 2u); // RF0 and RF1
+    EXPECT_EQ(sdr.getRfSections()[0]["rx_gain"].as<double>(), sdr.getRf0()["rx_gain"].as<double>());
+
+    YAML::Node config = YAML::Load("{RF0: {freq: 1}, RF1: {freq: 2}, RF3: {freq: 4}}");
+    vector<YAML::Node> sections = load_rf_sections(config);
+    ASSERT_EQ(sections.size(), 2u); // RF3 isn't reached without RF2
+    EXPECT_EQ(sections[1]["freq"].as<double>(), 2);
+    EXPECT_THROW(load_rf_sections(YAML::Load("{RF1: {freq: 2}}")), invalid_argument);
+}
+
 //hardware testing for usrp, all run at the very beginning
 
 /**
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+#include "../../sdr/startup.hpp"
+
+// Test that polling returns as soon as the condition holds, and gives up at the deadline
+TEST(Startup, PollUntil) {
+    atomic<bool> ready(false);
+    thread setter([&]() {
+        this_thread::sleep_for(chrono::milliseconds(50));
+        ready = true;
+    });
+    auto start = chrono::steady_clock::now();
+    EXPECT_TRUE(poll_until([&]() { return ready.load(); }, 5.0, 0.005));
+    EXPECT_LT(chrono::duration<double>(chrono::steady_clock::now() - start).count(), 1.0);
+    setter.join();
+
+    start = chrono::steady_clock::now();
+    EXPECT_FALSE(poll_until([]() { return false; }, 0.05, 0.005));
+    double waited = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    EXPECT_GE(waited, 0.05);
+    EXPECT_LT(waited, 1.0);
+}
+
+// Test that the device state survives a save and load
+TEST(Startup, DeviceStateRoundTrip) {
+    string filename = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("device-state-%%%%%%")).string();
+    map<string, string> state;
+    EXPECT_FALSE(load_device_state(filename, state));
+
+    state["serial"] = "31C9A2B";
+    state["fingerprint"] = "1f2e3d";
+    state["time_synced"] = "1";
+    ASSERT_TRUE(save_device_state(filename, state));
+
+    map<string, string> loaded;
+    ASSERT_TRUE(load_device_state(filename, loaded));
+    EXPECT_EQ(loaded, state);
+    boost::filesystem::remove(filename);
+}
+
+// Test that preallocation reserves blocks without changing the file size
+TEST(Startup, PreallocateKeepsSize) {
+    string filename = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("prealloc-%%%%%%")).string();
+    ofstream(filename).close();
+    if (!preallocate_file(filename, 1 << 20)) {
+        boost::filesystem::remove(filename);
+        GTEST_SKIP() << "fallocate not supported on " << boost::filesystem::temp_directory_path();
+    }
+    struct stat st;
+    ASSERT_EQ(stat(filename.c_str(), &st), 0);
+    EXPECT_EQ(st.st_size, 0);
+    EXPECT_GE(st.st_blocks * 512, 1 << 20);
+    boost::filesystem::remove(filename);
+}
+
+// Test that phases recorded from several threads are all kept
+TEST(Startup, TimerRecordsPhases) {
+    StartupTimer timer;
+    double start = timer.elapsed();
+    thread other([&]() { timer.record("device", timer.elapsed()); });
+    timer.record("host", start);
+    other.join();
+    EXPECT_GE(timer.elapsed(), start);
+    testing::internal::CaptureStdout();
+    timer.print();
+    string output = testing::internal::GetCapturedStdout();
+    EXPECT_NE(output.find("[STARTUP] device"), string::npos);
+    EXPECT_NE(output.find("[STARTUP] host"), string::npos);
+}
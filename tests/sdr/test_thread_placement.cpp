@@ -0,0 +1,27 @@
+#include <gtest/gtest.h>
+#include "../../sdr/thread_placement.hpp"
+
+using namespace std;
+
+// Test that CPU lists in isolcpus syntax are parsed and formatted consistently
+TEST(ThreadPlacement, ParsesCpuLists) {
+    EXPECT_EQ(parse_cpu_list(""), vector<int>());
+    EXPECT_EQ(parse_cpu_list("2"), vector<int>({2}));
+    EXPECT_EQ(parse_cpu_list("5, 1-3,2"), vector<int>({1, 2, 3, 5}));
+    EXPECT_EQ(format_cpu_list({1, 2, 3, 5, 7, 8}), "1-3,5,7-8");
+    EXPECT_EQ(format_cpu_list({}), "-");
+    EXPECT_THROW(parse_cpu_list("3-1"), invalid_argument);
+    EXPECT_THROW(parse_cpu_list("a"), invalid_argument);
+    EXPECT_THROW(parse_cpu_list("1x"), invalid_argument);
+    EXPECT_THROW(parse_thread_placement("rx", "1", 100), invalid_argument);
+}
+
+// Test that the calling thread can be pinned to a core it is already allowed on
+TEST(ThreadPlacement, PinsCallingThread) {
+    vector<int> cores = get_thread_cores();
+    ASSERT_FALSE(cores.empty());
+    EXPECT_TRUE(apply_thread_placement(parse_thread_placement("test", to_string(cores.front()), 0)));
+    EXPECT_EQ(get_thread_cores(), vector<int>({cores.front()}));
+    EXPECT_TRUE(set_thread_cores(cores));
+    EXPECT_EQ(get_thread_cores(), cores);
+}
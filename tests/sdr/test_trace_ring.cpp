@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include "../../sdr/trace_ring.hpp"
+
+using namespace std;
+
+// Test that readers get the published traces back and are told when they fall behind
+TEST(TraceRing, PublishAndRead) {
+    const size_t n_samps = 100;
+    const uint32_t num_slots = 4;
+    string name = "/test_trace_ring_" + to_string(getpid());
+    TracePublisher publisher(name, n_samps, num_slots);
+    TraceSubscriber subscriber(name);
+    EXPECT_EQ(subscriber.getNumSlots(), num_slots);
+    EXPECT_EQ(subscriber.getSampsPerTrace(), n_samps);
+
+    vector<complex<float>> trace(n_samps);
+    for (int t = 0; t < 10; t++) {
+        fill(trace.begin(), trace.end(), complex<float>(t, -t));
+        publisher.publish(trace.data(), (t + 1) * 5, t, 5);
+    }
+    EXPECT_EQ(subscriber.getNumPublished(), 10u);
+
+    vector<complex<float>> samples(n_samps);
+    TraceInfo info;
+    EXPECT_EQ(subscriber.read(5, info, samples.data()), TRACE_OVERWRITTEN);
+    EXPECT_EQ(subscriber.read(10, info, samples.data()), TRACE_NOT_READY);
+    for (uint64_t t = 6; t < 10; t++) {
+        ASSERT_EQ(subscriber.read(t, info, samples.data()), TRACE_OK);
+        EXPECT_EQ(info.trace_index, (int64_t) t);
+        EXPECT_EQ(info.num_pulses, (int64_t) (t + 1) * 5);
+        EXPECT_EQ(info.error_count, (int64_t) t);
+        EXPECT_EQ(info.num_presums, 5);
+        EXPECT_EQ(samples.front(), complex<float>(t, -1.0 * t));
+        EXPECT_EQ(samples.back(), complex<float>(t, -1.0 * t));
+    }
+}
+
+// Test that attaching to a ring that doesn't exist fails cleanly
+TEST(TraceRing, MissingRing) {
+    EXPECT_THROW(TraceSubscriber("/test_trace_ring_missing"), runtime_error);
+}
@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include "../../sdr/transport_tune.hpp"
+
+using namespace std;
+
+// Test that overrides replace keys in place and add missing ones
+TEST(TransportTune, MergeDeviceArgs) {
+    EXPECT_EQ(merge_device_args("addr=192.168.10.2,num_recv_frames=700", "num_recv_frames=256,recv_frame_size=8192"),
+              "addr=192.168.10.2,num_recv_frames=256,recv_frame_size=8192");
+    EXPECT_EQ(merge_device_args("", TransportParams{700, 11000}.toDeviceArgs()),
+              "num_recv_frames=700,num_send_frames=700,recv_frame_size=11000,send_frame_size=11000");
+    EXPECT_EQ(merge_device_args("type=b200, serial=ABC", ""), "type=b200,serial=ABC");
+}
+
+// Test that the grid covers every combination and the best trial has the fewest errors, then the lowest CPU load
+TEST(TransportTune, GridAndSelection) {
+    vector<TransportParams> grid = transport_grid({256, 700}, {4096, 8192, 16360});
+    ASSERT_EQ(grid.size(), 6u);
+    EXPECT_EQ(grid[1].num_frames, 256u);
+    EXPECT_EQ(grid[1].frame_size, 8192u);
+    EXPECT_EQ(grid[5].num_frames, 700u);
+    EXPECT_THROW(transport_grid({0}, {4096}), invalid_argument);
+
+    vector<TransportTrial> trials = {
+        {grid[0], 1000, 12, 0.2},
+        {grid[1], 1000, 0, 0.5},
+        {grid[2], 1000, 0, 0.3},
+        {grid[3], 1000, 1000, 0.0}, // Failed to open
+    };
+    EXPECT_EQ(select_best_trial(trials), 2u);
+    EXPECT_THROW(select_best_trial({}), invalid_argument);
+}
+
+// Test that profiles are cached per serial without losing other devices' profiles
+TEST(TransportTune, ProfileCache) {
+    string filename = "/tmp/test_transport_profiles_" + to_string(getpid()) + ".yaml";
+    TransportProfile profile;
+    EXPECT_FALSE(load_transport_profile(filename, "ABC", profile));
+
+    ASSERT_TRUE(save_transport_profile(filename, "ABC", {"num_recv_frames=256", 56e6, 20e-6, 1e-3, 0, 0.4}));
+    ASSERT_TRUE(save_transport_profile(filename, "XYZ", {"num_recv_frames=1024", 20e6, 60e-6, 2e-3, 0.01, 0.2}));
+    ASSERT_TRUE(load_transport_profile(filename, "ABC", profile));
+    EXPECT_EQ(profile.device_args, "num_recv_frames=256");
+    EXPECT_DOUBLE_EQ(profile.rx_rate, 56e6);
+    EXPECT_DOUBLE_EQ(profile.cpu_load, 0.4);
+    ASSERT_TRUE(load_transport_profile(filename, "XYZ", profile));
+    EXPECT_DOUBLE_EQ(profile.error_rate, 0.01);
+    EXPECT_FALSE(load_transport_profile(filename, "DEF", profile));
+    remove(filename.c_str());
+}
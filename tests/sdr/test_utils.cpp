@@ -13,3 +13,17 @@ TEST(GenerateOutFilename, MultipleFilenames) {
 }
 
 // TODO: test edge cases of generate_out_filename() such as many (>99) files generated, multiple .'s in base_fn, etc.
+
+// Test that the splitmix64 hash is repeatable, in [0, 1) and spread out
+TEST(Splitmix64Uniform, RepeatableAndUniform) {
+    EXPECT_EQ(splitmix64_uniform(12345), splitmix64_uniform(12345));
+    EXPECT_NE(splitmix64_uniform(12345), splitmix64_uniform(12346));
+    double sum = 0;
+    for (uint64_t key = 0; key < 10000; key++) {
+        double u = splitmix64_uniform(key);
+        ASSERT_GE(u, 0.0);
+        ASSERT_LT(u, 1.0);
+        sum += u;
+    }
+    EXPECT_NEAR(sum / 10000, 0.5, 0.01);
+}